@@ -9,8 +9,11 @@
 
 #include "GoSetupUtil.h"
 #include "SgGameWriter.h"
-#include "SgGameReader.h"
+#include "SgLog.h"
+#include "SgMappedFile.h"
+#include "SgMappedGameReader.h"
 #include "SgProp.h"
+#include "SgTrace.h"
 #include "GoModBoard.h"
 
 namespace Go_Backend {
@@ -18,7 +21,10 @@ Game::Game()
     : _go_game(),
       _game_finished(false),
       _while_capturing(false),
-      _differences()
+      _differences(),
+      _journal(),
+      _journal_compaction_interval(100),
+      _journal_records_since_compaction(0)
 {}
 
 bool Game::validSetup(const GoSetup& setup) const {
@@ -51,7 +57,7 @@ bool Game::init(int size, GoSetup setup, GoRules rules) {
 
     // check if setup contains only valid stones!
     if (!validSetup(setup)) {
-        std::cout << __TIMESTAMP__ << "[" << __FUNCTION__ << "] " << " GoSetup contains invalid stones! Skipping..." << std::endl;
+        SG_LOG(SG_LOG_WARNING) << "GoSetup contains invalid stones! Skipping...";
         return false;
     }
 
@@ -68,6 +74,12 @@ bool Game::init(int size, GoSetup setup, GoRules rules) {
     _game_finished = false;
     _while_capturing = false;
 
+    JournalRecord record(JournalRecordType::Init);
+    record.board_size = size;
+    record.rules = rules;
+    record.setup = setup;
+    journal(record);
+
     return true;
 }
 
@@ -75,8 +87,15 @@ void Game::init(SgNode* game_tree) {
     _go_game.Init(game_tree);
 
     // fast forward to latest move
-    while (canNavigateHistory(SgNode::Direction::NEXT))
-        navigateHistory(SgNode::Direction::NEXT);
+    // going there directly updates the board only once, instead of replaying the game from the root for every move
+    const SgNode* last_node = _go_game.CurrentNode();
+    while (last_node->HasSon())
+        last_node = last_node->LeftMostSon();
+    _go_game.GoToNode(last_node);
+
+    // the journal can't express loading a new game tree, start a new journal with it
+    if (_journal)
+        compactJournal();
 }
 
 const GoBoard& Game::getBoard() const {
@@ -85,9 +104,11 @@ const GoBoard& Game::getBoard() const {
 
 
 UpdateResult Game::update(GoSetup setup) {
+    SG_TRACE_ZONE("Game::update");
+
     // check if setup contains only valid stones!
     if (!validSetup(setup)) {
-        std::cout << __TIMESTAMP__ << " [" << __FUNCTION__ << "] " << " GoSetup contains invalid stones! Skipping..." << std::endl;
+        SG_LOG(SG_LOG_WARNING) << "GoSetup contains invalid stones! Skipping...";
         return UpdateResult::Illegal;
     }
 
@@ -115,6 +136,10 @@ UpdateResult Game::update(GoSetup setup) {
         assert(_while_capturing == false);
         placeHandicap(setup);
 
+        JournalRecord record(JournalRecordType::Handicap);
+        record.setup = setup;
+        journal(record);
+
         // this is a valid move -> clear differences as the internal board now matches the real board
         _differences.Clear();
         return UpdateResult::Legal;
@@ -213,7 +238,7 @@ UpdateResult Game::updateSingleMove(SgPoint point, SgBlackWhite player, SgPointS
 
         if (removed_of_player.IsEmpty() && removed_of_opponent.IsEmpty()) {
             // completely valid move
-            _go_game.AddMove(point, player);
+            addMove(point, player);
             return UpdateResult::Legal;
         }
         else {
@@ -231,12 +256,12 @@ UpdateResult Game::updateSingleMove(SgPoint point, SgBlackWhite player, SgPointS
 
         if (removed_of_opponent == captured_stones) {
             // all stones that are to capture have already been removed
-            _go_game.AddMove(point, player);
+            addMove(point, player);
             return UpdateResult::Legal;
         }
         else if (removed_of_opponent.IsEmpty() || removed_of_opponent.SubsetOf(captured_stones)) {
             // legal capturing move
-            _go_game.AddMove(point, player);
+            addMove(point, player);
 
             // some stones may have already been removed after playing the move,
             // but there are still stones left to be removed, tell the user to remove them as well
@@ -316,11 +341,20 @@ void Game::placeHandicap(GoSetup new_setup) {
 
 
 
+void Game::addMove(SgPoint point, SgBlackWhite player) {
+    _go_game.AddMove(point, player);
+
+    JournalRecord record(JournalRecordType::Move);
+    record.color = player;
+    record.point = point;
+    journal(record);
+}
+
 UpdateResult Game::playMove(SgPoint position) {
     auto current_player = getBoard().ToPlay();
 
     if (getBoard().IsLegal(position, current_player)) {
-        _go_game.AddMove(position, current_player);
+        addMove(position, current_player);
         return UpdateResult::Legal;
     }
     else {
@@ -348,28 +382,60 @@ bool Game::saveGame(string file_path, string name_black, string name_white, stri
     string date = to_simple_string(day_clock::local_day());
     _go_game.UpdateDate(date);
 
-    SgGameWriter writer(file);
+    writeSgf(file);
+
+    return true;
+}
+
+void Game::writeSgf(std::ostream& out) const {
+    SgGameWriter writer(out);
 
     bool all_props = true; // all properties like player names and game name
     int file_format = 0; // default file format
     int game_number = SG_PROPPOINTFMT_GO; // the game of go
     int default_size = 19; // default boardsize, never actually relevant as _go_game.Init gets always called
     writer.WriteGame(_go_game.Root(), all_props, file_format, game_number, default_size);
-
-    return true;
 }
 
 SgNode* Game::loadGame(string file_path) {
-    std::ifstream file(file_path.c_str());
-    if (!file.is_open()) {
+    // the file is parsed directly from memory, which is a lot faster than reading it through a stream
+    SgMappedFile file;
+    if (!file.Open(file_path)) {
         // @todo(jschmer): support better diagnostics such as throwing an exception like FAILED_TO_OPEN_FILE
         return nullptr;
     }
 
-    SgGameReader reader(file);
+    SgMappedGameReader reader(file);
     return reader.ReadGame();
 }
 
+bool Game::saveSnapshot(string file_path) const {
+    return GameSnapshot::write(*_go_game.CurrentNode(), getBoard(), _game_finished, file_path);
+}
+
+bool Game::loadSnapshot(string file_path) {
+    GameSnapshot snapshot;
+    if (!snapshot.open(file_path))
+        return false;
+
+    const SgNode* current = nullptr;
+    _go_game.Init(snapshot.createGameTree(current), snapshot.rules());
+    _go_game.GoToNode(current);
+
+    if (getBoard().All(SG_BLACK) != snapshot.stones(SG_BLACK) || getBoard().All(SG_WHITE) != snapshot.stones(SG_WHITE))
+        SG_LOG(SG_LOG_WARNING) << "Snapshot board doesn't match its moves!";
+
+    _game_finished = snapshot.gameFinished();
+    _while_capturing = false;
+    _differences.Clear();
+
+    // the journal can't express loading a new game tree, start a new journal with it
+    if (_journal)
+        compactJournal();
+
+    return true;
+}
+
 std::string Game::finishGame() {
     pass();
     pass();
@@ -409,6 +475,8 @@ void Game::pass() {
 
         _game_finished = true;
     }
+
+    journal(JournalRecord(JournalRecordType::Pass));
 }
 
 void Game::resign() {
@@ -422,6 +490,8 @@ void Game::resign() {
     _go_game.UpdateResult(result);
 
     _game_finished = true;
+
+    journal(JournalRecord(JournalRecordType::Resign));
 }
 
 std::string Game::getResult() const {
@@ -437,10 +507,121 @@ bool Game::hasEnded() const {
 
 void Game::navigateHistory(SgNode::Direction dir) {
     _go_game.GoInDirection(dir);
+
+    JournalRecord record(JournalRecordType::Navigate);
+    record.direction = dir;
+    journal(record);
 }
 
 bool Game::canNavigateHistory(SgNode::Direction dir) const {
     return _go_game.CanGoInDirection(dir);
 }
 
-} // 
+std::vector<PositionOccurrence> Game::findPosition(const PositionIndex& index) const {
+    return index.find(getBoard());
+}
+
+bool Game::startJournal(string journal_file, string sgf_file, int compaction_interval) {
+    stopJournal();
+
+    std::unique_ptr<GameJournal> journal(new GameJournal());
+    if (!journal->open(journal_file, sgf_file))
+        return false;
+
+    _journal = std::move(journal);
+    _journal_compaction_interval = compaction_interval;
+
+    // the journal needs the current game as its starting point
+    compactJournal();
+    return true;
+}
+
+void Game::stopJournal(bool remove_files) {
+    if (_journal) {
+        _journal->close(remove_files);
+        _journal.reset();
+    }
+}
+
+bool Game::recoverFromJournal(string journal_file, string sgf_file) {
+    SgNode* game_tree = nullptr;
+    std::vector<int> current_path;
+    std::vector<JournalRecord> records;
+    if (!GameJournal::read(journal_file, sgf_file, game_tree, current_path, records))
+        return false;
+
+    if (!game_tree && records.empty())
+        return false;
+
+    // don't write the recovered changes into a running journal again
+    auto journal = std::move(_journal);
+
+    if (game_tree) {
+        init(game_tree);
+
+        // go to the node that was current when the journal was compacted
+        const SgNode* node = &_go_game.Root();
+        for (auto index : current_path) {
+            if (index >= node->NumSons())
+                break;
+            node = node->LeftMostSon();
+            for (int i = 0; i < index; ++i)
+                node = node->RightBrother();
+        }
+        _go_game.GoToNode(node);
+        _game_finished = !getResult().empty();
+    }
+
+    for (auto& record : records)
+        applyJournalRecord(record);
+
+    _journal = std::move(journal);
+    if (_journal)
+        compactJournal();
+
+    return true;
+}
+
+void Game::journal(const JournalRecord& record) {
+    if (!_journal)
+        return;
+
+    _journal->append(record);
+
+    if (++_journal_records_since_compaction >= _journal_compaction_interval)
+        compactJournal();
+}
+
+void Game::compactJournal() {
+    _journal->compact(_go_game.Root(), *_go_game.CurrentNode());
+    _journal_records_since_compaction = 0;
+}
+
+void Game::applyJournalRecord(const JournalRecord& record) {
+    switch (record.type) {
+    case JournalRecordType::Init:
+        init(record.board_size, record.setup, record.rules);
+        break;
+    case JournalRecordType::Move:
+        // same as in updateSingleMove(), the first move after a setup may be played by any player
+        if (getBoard().ToPlay() != record.color)
+            _go_game.SetToPlay(record.color);
+        addMove(record.point, record.color);
+        break;
+    case JournalRecordType::Pass:
+        pass();
+        break;
+    case JournalRecordType::Resign:
+        resign();
+        break;
+    case JournalRecordType::Handicap:
+        placeHandicap(record.setup);
+        break;
+    case JournalRecordType::Navigate:
+        if (canNavigateHistory(record.direction))
+            navigateHistory(record.direction);
+        break;
+    }
+}
+
+} // 
\ No newline at end of file
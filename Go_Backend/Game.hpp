@@ -3,7 +3,13 @@
 #pragma once
 
 #include "GoGame.h"
+#include "GameJournal.hpp"
+#include "GameSnapshot.hpp"
+#include "PositionIndex.hpp"
+#include <iosfwd>
+#include <memory>
 #include <string>
+#include <vector>
 
 /**
  * Classes for representing a go game
@@ -121,6 +127,11 @@ public:
      */
     bool saveGame(string file_path, string name_black = "", string name_white = "", string game_name = "");
 
+    /**
+     * @brief        Writes the whole game tree in sgf format to a stream, without changing any game information.
+     */
+    void writeSgf(std::ostream& out) const;
+
     /**
      * @brief        Overwrites the current game state with the game in a sgf file. The board size has to be defined
      *               in the sgf.
@@ -129,6 +140,21 @@ public:
      */
     SgNode* loadGame(string file_path);
 
+    /**
+     * @brief        Writes the current game state to a binary snapshot file, which can be loaded much faster
+     *               than a sgf file. Only the line of the game tree through the current node is saved,
+     *               see Go_Backend::GameSnapshot.
+     * @returns      false if the file could not be written, true otherwise
+     */
+    bool saveSnapshot(string file_path) const;
+
+    /**
+     * @brief        Overwrites the current game state with the game in a snapshot file written by saveSnapshot()
+     *               or GameSnapshot::convertSgf(). Restores the rules and the current position in the history.
+     * @returns      false if the file could not be opened or is no valid snapshot, true otherwise
+     */
+    bool loadSnapshot(string file_path);
+
 
     /**
      * @brief        Convenience function to quickly finish a game. Plays a pass for each player and
@@ -177,6 +203,42 @@ public:
      */
     void navigateHistory(SgNode::Direction dir);
 
+    /**
+     * @brief       Looks up the current board position in an index of sgf games.
+     *              Also finds rotated and mirrored positions.
+     * @param[in]   index   opened position index
+     * @returns     All games the position occurred in and the moves played next, see Go_Backend::PositionIndex::find()
+     */
+    std::vector<PositionOccurrence> findPosition(const PositionIndex& index) const;
+
+    /**
+     * @brief       Starts autosaving the game. Every following change of the game is appended to a journal file
+     *              by a background thread, see Go_Backend::GameJournal. Every compaction_interval changes, the
+     *              whole game is written to the sgf file and the journal starts anew.\n
+     *              A running journal is stopped first.
+     * @param[in]   journal_file        path of the journal, an existing journal is overwritten
+     * @param[in]   sgf_file            path of the sgf file the journal is compacted into
+     * @param[in]   compaction_interval number of changes after which the journal is compacted
+     * @returns     false if the journal file could not be created, true otherwise
+     */
+    bool startJournal(string journal_file, string sgf_file, int compaction_interval = 100);
+
+    /**
+     * @brief       Stops autosaving the game. Waits until all changes have been written.
+     * @param[in]   remove_files    also deletes the journal and the sgf file
+     */
+    void stopJournal(bool remove_files = false);
+
+    /**
+     * @brief       Overwrites the current game with the game state saved by a journal, e.g. after a crash.
+     *              Should be called before startJournal(), which overwrites the journal.
+     * @param[in]   journal_file    path of the journal
+     * @param[in]   sgf_file        path of the sgf file the journal was compacted into
+     * @returns     false if the journal or the sgf file could not be read or the journal contains no game,
+     *              true otherwise
+     */
+    bool recoverFromJournal(string journal_file, string sgf_file);
+
 private:
     // Not implemented
     Game(const Game&);
@@ -205,6 +267,11 @@ private:
      */
     UpdateResult updateSingleMove(SgPoint point, SgBlackWhite player, SgPointSet removed_of_player, SgPointSet removed_of_opponent);
 
+    /**
+     * @brief       Plays the move and appends it to the journal.
+     */
+    void addMove(SgPoint point, SgBlackWhite player);
+
     /**
      * @brief       Returns the possibly captured stones when current player of cons_board would play at point.
      */
@@ -213,6 +280,17 @@ private:
     bool validSetup(const GoSetup& setup) const;
     bool allValidPoints(const SgPointSet& stones) const;
 
+    /**
+     * @brief       Appends the change to the journal, if there is one, and compacts it if it is time to.
+     */
+    void journal(const JournalRecord& record);
+    void compactJournal();
+
+    /**
+     * @brief       Redoes a change read from a journal, see recoverFromJournal().
+     */
+    void applyJournalRecord(const JournalRecord& record);
+
 private:
     GoGame _go_game;
     bool _game_finished; // we need this variable because fuego doesn't tag a game
@@ -220,6 +298,10 @@ private:
 
     SgPointSet _differences; // differences of the last setup that was updated to the current board
     bool _while_capturing;
+
+    std::unique_ptr<GameJournal> _journal; // nullptr if the game isn't autosaved
+    int _journal_compaction_interval;
+    int _journal_records_since_compaction;
 };
 
 }
\ No newline at end of file
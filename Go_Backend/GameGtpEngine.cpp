@@ -0,0 +1,652 @@
+#include "GameGtpEngine.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "GoBoardUtil.h"
+#include "GoGtpCommandUtil.h"
+#include "GoSetupUtil.h"
+#include "SgGtpUtil.h"
+#include "SgRandom.h"
+#include "SgTrace.h"
+
+namespace Go_Backend {
+namespace {
+const int DEFAULT_PLAYOUTS = 1000;
+
+// jobs whose result has not been fetched are kept, but not infinitely many
+const size_t MAX_FINISHED_JOBS = 100;
+
+const char* updateResultName(UpdateResult result) {
+    switch (result) {
+    case UpdateResult::Illegal:   return "illegal";
+    case UpdateResult::ToCapture: return "to_capture";
+    case UpdateResult::Legal:     return "legal";
+    }
+    return "?";
+}
+
+const char* jobStateName(JobState state) {
+    switch (state) {
+    case JobState::Queued:   return "queued";
+    case JobState::Running:  return "running";
+    case JobState::Finished: return "finished";
+    case JobState::Failed:   return "failed";
+    case JobState::Canceled: return "canceled";
+    }
+    return "?";
+}
+
+bool isDone(JobState state) {
+    return state == JobState::Finished || state == JobState::Failed || state == JobState::Canceled;
+}
+
+void writeStones(GtpCommand& cmd, const SgBWSet& stones) {
+    cmd << "black";
+    for (auto iter = SgSetIterator(stones[SG_BLACK]); iter; ++iter)
+        cmd << ' ' << SgWritePoint(*iter);
+    cmd << "\nwhite";
+    for (auto iter = SgSetIterator(stones[SG_WHITE]); iter; ++iter)
+        cmd << ' ' << SgWritePoint(*iter);
+}
+
+/**
+ * @brief       Plays random moves until both players pass. Points whose neighbors all belong to one color are
+ *              not filled, so the final position can be scored with GoBoardUtil::ScoreSimpleEndPosition().
+ * @returns     number of moves played (including passes), to undo them
+ */
+int playRandomGame(GoBoard& board, SgFastRandom& random) {
+    const int max_moves = 3 * board.Size() * board.Size();
+    std::vector<SgPoint> empty;
+    int num_moves = 0;
+    int num_passes = 0;
+    while (num_passes < 2 && num_moves < max_moves) {
+        empty.clear();
+        for (auto iter = SgSetIterator(board.AllEmpty()); iter; ++iter)
+            empty.push_back(*iter);
+
+        // try the empty points in random order, starting at a random index
+        SgMove move = SG_PASS;
+        if (!empty.empty()) {
+            size_t start = random.Int(empty.size());
+            for (size_t i = 0; i < empty.size(); ++i) {
+                SgPoint p = empty[(start + i) % empty.size()];
+                if (!GoBoardUtil::IsCompletelySurrounded(board, p) && board.IsLegal(p)) {
+                    move = p;
+                    break;
+                }
+            }
+        }
+
+        board.Play(move);
+        ++num_moves;
+        num_passes = move == SG_PASS ? num_passes + 1 : 0;
+    }
+    return num_moves;
+}
+} // namespace
+
+//----------------------------------------------------------------------------
+
+/**
+ * @brief   A command run by the worker threads, see GameGtpEngine::cmdAsync().
+ */
+struct GameGtpEngine::Job {
+    Job(unsigned int id, const string& line, LongCommand command);
+
+    unsigned int id;
+    string       line;
+    LongCommand  command;
+
+    // set by the workers, protected by GameGtpEngine::_jobs_mutex
+    JobState     state;
+    string       response;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point end_time;
+
+    std::atomic<bool> canceled;
+};
+
+GameGtpEngine::Job::Job(unsigned int id, const string& line, LongCommand command)
+    : id(id),
+      line(line),
+      command(command),
+      state(JobState::Queued),
+      response(),
+      canceled(false)
+{}
+
+/**
+ * @brief   Runs a long command synchronously, as a normal GtpEngine command.
+ */
+class GameGtpEngine::LongCommandCallback : public GtpCallbackBase {
+public:
+    LongCommandCallback(GameGtpEngine& engine, LongCommand command)
+        : _engine(engine),
+          _command(command)
+    {}
+
+    void operator()(GtpCommand& cmd) {
+        (_engine.*_command)(cmd, _engine._interrupted);
+    }
+
+private:
+    GameGtpEngine& _engine;
+    LongCommand    _command;
+};
+
+//----------------------------------------------------------------------------
+
+GameGtpEngine::GameGtpEngine(int num_workers)
+    : _game(),
+      _game_is_initialized(false),
+      _scan_setup(),
+      _scan_board_size(0),
+      _last_update(UpdateResult::Legal),
+      _has_update(false),
+      _num_scans(0),
+      _num_failed_scans(0),
+      _scan_error(),
+      _last_scan_time(),
+      _index(),
+      _quit_received(false),
+      _interrupted(false),
+      _next_job_id(1),
+      _shutdown(false)
+{
+    Register("name",              &GameGtpEngine::CmdName,            this);
+    Register("version",           &GameGtpEngine::CmdVersion,         this);
+    Register("quit",              &GameGtpEngine::CmdQuit,            this);
+    Register("gogui-analyze_commands", &GameGtpEngine::cmdAnalyzeCommands, this);
+    Register("showboard",         &GameGtpEngine::cmdShowBoard,       this);
+    Register("list_stones",       &GameGtpEngine::cmdListStones,      this);
+    Register("ag_status",         &GameGtpEngine::cmdStatus,          this);
+    Register("ag_setup",          &GameGtpEngine::cmdSetup,           this);
+    Register("ag_scan_setup",     &GameGtpEngine::cmdScanSetup,       this);
+    Register("ag_differences",    &GameGtpEngine::cmdDifferences,     this);
+    Register("ag_moves",          &GameGtpEngine::cmdMoves,           this);
+    Register("ag_sgf",            &GameGtpEngine::cmdSgf,             this);
+    Register("ag_index_open",     &GameGtpEngine::cmdIndexOpen,       this);
+    Register("ag_trace",          &GameGtpEngine::cmdTrace,           this);
+    Register("ag_async",          &GameGtpEngine::cmdAsync,           this);
+    Register("ag_jobs",           &GameGtpEngine::cmdJobs,            this);
+    Register("ag_job_status",     &GameGtpEngine::cmdJobStatus,       this);
+    Register("ag_job_wait",       &GameGtpEngine::cmdJobWait,         this);
+    Register("ag_job_result",     &GameGtpEngine::cmdJobResult,       this);
+    Register("ag_job_cancel",     &GameGtpEngine::cmdJobCancel,       this);
+    registerLong("ag_find_position",  &GameGtpEngine::cmdFindPosition);
+    registerLong("ag_estimate_score", &GameGtpEngine::cmdEstimateScore);
+    registerLong("ag_ownership",      &GameGtpEngine::cmdOwnership);
+
+    for (int i = 0; i < std::max(num_workers, 1); ++i)
+        _workers.push_back(std::thread(&GameGtpEngine::workerLoop, this));
+}
+
+GameGtpEngine::~GameGtpEngine() {
+    {
+        std::lock_guard<std::mutex> lock(_jobs_mutex);
+        _shutdown = true;
+        for (auto iter = _jobs.begin(); iter != _jobs.end(); ++iter)
+            iter->second->canceled = true;
+    }
+    _job_queued.notify_all();
+    for (auto iter = _workers.begin(); iter != _workers.end(); ++iter)
+        iter->join();
+}
+
+void GameGtpEngine::registerLong(const string& name, LongCommand command) {
+    _long_commands[name] = command;
+    Register(name, new LongCommandCallback(*this, command));
+}
+
+UpdateResult GameGtpEngine::updateFromScan(const GoSetup& setup, int board_size) {
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    ++_num_scans;
+    _scan_setup = setup;
+    _scan_board_size = board_size;
+    _scan_error.clear();
+    _last_scan_time = std::chrono::steady_clock::now();
+
+    UpdateResult result;
+    if (_game_is_initialized && board_size == _game.getBoard().Size()) {
+        result = _game.update(setup);
+    }
+    else if (board_size == 9 || board_size == 13 || board_size == 19) {
+        // first scan or the board has been changed, start a new game with the scanned setup
+        _game_is_initialized = _game.init(board_size, setup);
+        result = _game_is_initialized ? UpdateResult::Legal : UpdateResult::Illegal;
+    }
+    else {
+        result = UpdateResult::Illegal;
+    }
+
+    _last_update = result;
+    _has_update = true;
+    return result;
+}
+
+void GameGtpEngine::scanFailed(const string& reason) {
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    ++_num_scans;
+    ++_num_failed_scans;
+    _scan_error = reason;
+    _last_scan_time = std::chrono::steady_clock::now();
+}
+
+void GameGtpEngine::BeforeHandleCommand() {
+    _interrupted = false;
+}
+
+void GameGtpEngine::Interrupt() {
+    _interrupted = true;
+
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+    for (auto iter = _jobs.begin(); iter != _jobs.end(); ++iter)
+        iter->second->canceled = true;
+}
+
+//----------------------------------------------------------------------------
+// commands
+
+void GameGtpEngine::CmdName(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    cmd << "Augmented Go";
+}
+
+void GameGtpEngine::CmdVersion(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    cmd << "1.0";
+}
+
+void GameGtpEngine::CmdQuit(GtpCommand& cmd) {
+    GtpEngine::CmdQuit(cmd);
+    _quit_received = true;
+}
+
+bool GameGtpEngine::quitReceived() const {
+    return _quit_received;
+}
+
+void GameGtpEngine::cmdAnalyzeCommands(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    cmd << "string/AG Status/ag_status\n"
+           "plist/AG Differences/ag_differences\n"
+           "string/AG Moves/ag_moves\n"
+           "string/AG Estimate Score/ag_estimate_score\n"
+           "sboard/AG Ownership/ag_ownership\n"
+           "string/AG Find Position/ag_find_position\n"
+           "string/ShowBoard/showboard\n"
+           "plist/List Stones/list_stones %c\n";
+}
+
+void GameGtpEngine::cmdShowBoard(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    cmd << '\n' << _game.getBoard();
+}
+
+void GameGtpEngine::cmdListStones(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    SgBlackWhite color = GoGtpCommandUtil::BlackWhiteArg(cmd, 0);
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    SgGtpUtil::RespondPointSet(cmd, _game.getBoard().All(color));
+}
+
+void GameGtpEngine::cmdStatus(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    size_t num_jobs = 0;
+    {
+        std::lock_guard<std::mutex> lock(_jobs_mutex);
+        for (auto iter = _jobs.begin(); iter != _jobs.end(); ++iter)
+            if (!isDone(iter->second->state))
+                ++num_jobs;
+    }
+
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    const GoBoard& board = _game.getBoard();
+    cmd << "initialized " << (_game_is_initialized ? 1 : 0) << '\n'
+        << "board_size " << board.Size() << '\n'
+        << "to_play " << SgBW(board.ToPlay()) << '\n'
+        << "move_number " << board.MoveNumber() << '\n'
+        << "ended " << (_game.hasEnded() ? 1 : 0) << '\n'
+        << "result " << (_game.hasEnded() ? _game.getResult() : "-") << '\n'
+        << "last_update " << (_has_update ? updateResultName(_last_update) : "-") << '\n'
+        << "differences " << _game.getDifferences().Size() << '\n'
+        << "scans " << _num_scans << '\n'
+        << "failed_scans " << _num_failed_scans << '\n'
+        << "scan_board_size " << _scan_board_size << '\n';
+    if (_num_scans > 0) {
+        auto age = std::chrono::steady_clock::now() - _last_scan_time;
+        cmd << "last_scan_ms " << std::chrono::duration_cast<std::chrono::milliseconds>(age).count() << '\n';
+    }
+    else {
+        cmd << "last_scan_ms -\n";
+    }
+    cmd << "scan_error " << (_scan_error.empty() ? "-" : _scan_error) << '\n'
+        << "active_jobs " << num_jobs;
+}
+
+void GameGtpEngine::cmdSetup(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    const GoBoard& board = _game.getBoard();
+    writeStones(cmd, SgBWSet(board.All(SG_BLACK), board.All(SG_WHITE)));
+}
+
+void GameGtpEngine::cmdScanSetup(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    writeStones(cmd, _scan_setup.m_stones);
+}
+
+void GameGtpEngine::cmdDifferences(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    SgGtpUtil::RespondPointSet(cmd, _game.getDifferences());
+}
+
+void GameGtpEngine::cmdMoves(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    const GoBoard& board = _game.getBoard();
+    for (int i = 0; i < board.MoveNumber(); ++i) {
+        GoPlayerMove move = board.Move(i);
+        cmd << SgBW(move.Color()) << ' ' << SgWritePoint(move.Point()) << '\n';
+    }
+}
+
+void GameGtpEngine::cmdSgf(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::ostringstream sgf;
+    {
+        std::lock_guard<std::mutex> lock(_game_mutex);
+        _game.writeSgf(sgf);
+    }
+    cmd << '\n' << sgf.str();
+}
+
+void GameGtpEngine::cmdIndexOpen(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    std::shared_ptr<PositionIndex> index(new PositionIndex());
+    if (!index->open(cmd.Arg(0)))
+        throw GtpFailure() << "cannot open position index " << cmd.Arg(0);
+    cmd << index->numGames() << " games, " << index->numPositions() << " positions";
+
+    std::lock_guard<std::mutex> lock(_index_mutex);
+    _index = index;
+}
+
+void GameGtpEngine::cmdTrace(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    if (!SgTraceWriteChromeFile(cmd.Arg(0)))
+        throw GtpFailure() << "cannot write trace to " << cmd.Arg(0);
+}
+
+//----------------------------------------------------------------------------
+// long commands
+
+bool GameGtpEngine::copyPosition(int& size, GoSetup& setup, GoRules& rules) const {
+    std::lock_guard<std::mutex> lock(_game_mutex);
+    if (!_game_is_initialized)
+        return false;
+    const GoBoard& board = _game.getBoard();
+    size = board.Size();
+    setup = GoSetupUtil::CurrentPosSetup(board);
+    rules = board.Rules();
+    return true;
+}
+
+void GameGtpEngine::cmdFindPosition(GtpCommand& cmd, const std::atomic<bool>& canceled) {
+    cmd.CheckNuArgLessEqual(1);
+    size_t max_results = cmd.NuArg() == 0 ? 20 : cmd.ArgMin<size_t>(0, 1);
+
+    std::shared_ptr<PositionIndex> index;
+    {
+        std::lock_guard<std::mutex> lock(_index_mutex);
+        index = _index;
+    }
+    if (!index)
+        throw GtpFailure("no position index opened, see ag_index_open");
+
+    int size;
+    GoSetup setup;
+    GoRules rules;
+    if (!copyPosition(size, setup, rules))
+        throw GtpFailure("no game");
+    GoBoard board(size, setup, rules);
+
+    auto occurrences = index->find(board);
+    cmd << occurrences.size() << " games\n";
+    for (size_t i = 0; i < occurrences.size() && i < max_results; ++i) {
+        if (canceled)
+            break;
+        const PositionOccurrence& occurrence = occurrences[i];
+        cmd << index->gameFile(occurrence.game_id) << ' '
+            << index->gameNumberInFile(occurrence.game_id) << ' '
+            << occurrence.move_number << ' ';
+        if (occurrence.next_move == SG_NULLMOVE)
+            cmd << '-';
+        else
+            cmd << SgWritePoint(occurrence.next_move);
+        cmd << '\n';
+    }
+}
+
+double GameGtpEngine::runPlayouts(int max_playouts, const std::atomic<bool>& canceled, int& num_playouts,
+                                  SgPointArray<int>& ownership, int& board_size) const {
+    int size;
+    GoSetup setup;
+    GoRules rules;
+    if (!copyPosition(size, setup, rules))
+        throw GtpFailure("no game");
+    GoBoard board(size, setup, rules);
+    board_size = size;
+
+    // deterministic for a given random seed (see SgRandom::SetSeed()), otherwise each call uses another stream
+    unsigned int stream = 0;
+    if (SgRandom::Seed() <= 0)
+        stream = static_cast<unsigned int>(std::chrono::steady_clock::now().time_since_epoch().count());
+    SgFastRandom random(stream);
+    const float komi = rules.Komi().ToFloat();
+    SgPointArray<SgEmptyBlackWhite> score_board;
+
+    ownership.Fill(0);
+    double score_sum = 0;
+    for (num_playouts = 0; num_playouts < max_playouts && !canceled; ++num_playouts) {
+        int num_moves = playRandomGame(board, random);
+        score_sum += GoBoardUtil::ScoreSimpleEndPosition(board, komi, SgBWSet(), true, &score_board);
+        for (GoBoard::Iterator iter(board); iter; ++iter) {
+            if (score_board[*iter] == SG_BLACK)
+                ++ownership[*iter];
+            else if (score_board[*iter] == SG_WHITE)
+                --ownership[*iter];
+        }
+        for (int i = 0; i < num_moves; ++i)
+            board.Undo();
+    }
+    if (num_playouts == 0)
+        throw GtpFailure("canceled");
+    return score_sum;
+}
+
+void GameGtpEngine::cmdEstimateScore(GtpCommand& cmd, const std::atomic<bool>& canceled) {
+    cmd.CheckNuArgLessEqual(1);
+    int max_playouts = cmd.NuArg() == 0 ? DEFAULT_PLAYOUTS : cmd.ArgMin<int>(0, 1);
+
+    int num_playouts;
+    int size;
+    SgPointArray<int> ownership;
+    double score = runPlayouts(max_playouts, canceled, num_playouts, ownership, size) / num_playouts;
+
+    // the result is returned even if the command was canceled, it is just less accurate
+    cmd << (score >= 0 ? "B+" : "W+") << std::fixed << std::setprecision(1) << std::abs(score)
+        << " (" << num_playouts << " playouts)";
+}
+
+void GameGtpEngine::cmdOwnership(GtpCommand& cmd, const std::atomic<bool>& canceled) {
+    cmd.CheckNuArgLessEqual(1);
+    int max_playouts = cmd.NuArg() == 0 ? DEFAULT_PLAYOUTS : cmd.ArgMin<int>(0, 1);
+
+    int num_playouts;
+    int size;
+    SgPointArray<int> ownership;
+    runPlayouts(max_playouts, canceled, num_playouts, ownership, size);
+
+    // ownership in percent, the point array of the response only needs a board of the right size
+    GoBoard board(size);
+    for (GoBoard::Iterator iter(board); iter; ++iter)
+        ownership[*iter] = ownership[*iter] * 100 / num_playouts;
+    GoGtpCommandUtil::RespondNumberArray(cmd, ownership, 1, board);
+}
+
+//----------------------------------------------------------------------------
+// background jobs
+
+void GameGtpEngine::cmdAsync(GtpCommand& cmd) {
+    if (cmd.NuArg() == 0)
+        throw GtpFailure("missing command");
+    auto command = _long_commands.find(cmd.Arg(0));
+    if (command == _long_commands.end())
+        throw GtpFailure() << "not a long command: " << cmd.Arg(0);
+
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+
+    // forget the oldest finished jobs whose result nobody fetched
+    size_t num_finished = 0;
+    for (auto iter = _jobs.begin(); iter != _jobs.end(); ++iter)
+        if (isDone(iter->second->state))
+            ++num_finished;
+    for (auto iter = _jobs.begin(); iter != _jobs.end() && num_finished >= MAX_FINISHED_JOBS; ) {
+        if (isDone(iter->second->state)) {
+            iter = _jobs.erase(iter);
+            --num_finished;
+        }
+        else {
+            ++iter;
+        }
+    }
+
+    std::shared_ptr<Job> job(new Job(_next_job_id++, cmd.ArgLine(), command->second));
+    _jobs[job->id] = job;
+    _queue.push_back(job);
+    _job_queued.notify_one();
+
+    cmd << job->id;
+}
+
+std::shared_ptr<GameGtpEngine::Job> GameGtpEngine::findJob(const GtpCommand& cmd) {
+    // _jobs_mutex has to be locked
+    unsigned int id = cmd.Arg<unsigned int>(0);
+    auto iter = _jobs.find(id);
+    if (iter == _jobs.end())
+        throw GtpFailure() << "unknown job " << id;
+    return iter->second;
+}
+
+void GameGtpEngine::writeJobResponse(GtpCommand& cmd, const Job& job) {
+    // _jobs_mutex has to be locked
+    // the result is fetched only once, this keeps the job list short
+    _jobs.erase(job.id);
+    if (job.state == JobState::Finished)
+        cmd << job.response;
+    else
+        throw GtpFailure() << jobStateName(job.state) << ": " << job.response;
+}
+
+void GameGtpEngine::cmdJobs(GtpCommand& cmd) {
+    cmd.CheckArgNone();
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+    for (auto iter = _jobs.begin(); iter != _jobs.end(); ++iter)
+        cmd << iter->first << ' ' << jobStateName(iter->second->state) << ' ' << iter->second->line << '\n';
+}
+
+void GameGtpEngine::cmdJobStatus(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+    auto job = findJob(cmd);
+    cmd << jobStateName(job->state);
+    if (job->state != JobState::Queued) {
+        auto end = isDone(job->state) ? job->end_time : std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - job->start_time).count() / 1000.0;
+        cmd << ' ' << std::fixed << std::setprecision(3) << seconds;
+    }
+}
+
+void GameGtpEngine::cmdJobWait(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    auto job = findJob(cmd);
+    // an interrupt cancels the job, so waiting ends as well
+    while (!isDone(job->state))
+        _job_done.wait(lock);
+    writeJobResponse(cmd, *job);
+}
+
+void GameGtpEngine::cmdJobResult(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+    auto job = findJob(cmd);
+    if (!isDone(job->state))
+        throw GtpFailure() << "job " << job->id << " is " << jobStateName(job->state);
+    writeJobResponse(cmd, *job);
+}
+
+void GameGtpEngine::cmdJobCancel(GtpCommand& cmd) {
+    cmd.CheckNuArg(1);
+    std::lock_guard<std::mutex> lock(_jobs_mutex);
+    auto job = findJob(cmd);
+    job->canceled = true;
+    if (job->state == JobState::Queued) {
+        // never started, the workers skip it
+        job->state = JobState::Canceled;
+        _job_done.notify_all();
+    }
+}
+
+void GameGtpEngine::workerLoop() {
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    while (true) {
+        while (!_shutdown && _queue.empty())
+            _job_queued.wait(lock);
+        if (_shutdown)
+            return;
+
+        auto job = _queue.front();
+        _queue.pop_front();
+        if (job->state != JobState::Queued)
+            continue; // canceled while queued
+
+        job->state = JobState::Running;
+        job->start_time = std::chrono::steady_clock::now();
+        lock.unlock();
+
+        // same error handling as GtpEngine for synchronous commands
+        GtpCommand cmd(job->line);
+        bool success = true;
+        string response;
+        try {
+            (this->*job->command)(cmd, job->canceled);
+            response = cmd.Response();
+        }
+        catch (const GtpFailure& failure) {
+            success = false;
+            response = failure.Response();
+        }
+        catch (const std::exception& e) {
+            success = false;
+            response = e.what();
+        }
+
+        lock.lock();
+        job->response = response;
+        job->end_time = std::chrono::steady_clock::now();
+        if (success)
+            job->state = JobState::Finished;
+        else
+            job->state = job->canceled ? JobState::Canceled : JobState::Failed;
+        _job_done.notify_all();
+    }
+}
+
+}
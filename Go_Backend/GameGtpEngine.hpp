@@ -0,0 +1,227 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GtpEngine.h"
+#include "Game.hpp"
+#include "PositionIndex.hpp"
+
+namespace Go_Backend {
+using std::string;
+
+/**
+ * @brief   States of a command that runs in the background, see GameGtpEngine.
+ */
+enum class JobState {
+    Queued,     ///< waiting for a free worker thread
+    Running,
+    Finished,   ///< the command succeeded, its response is available
+    Failed,     ///< the command failed, its error message is available
+    Canceled    ///< canceled with ag_job_cancel or "# interrupt" before it could produce a result
+};
+
+/**
+ * @brief   Headless GTP front-end for a Game that is fed by the scanner. External tools and engines can read the
+ *          live game state (current setup, differences to the last scan, move list, sgf) without the Qt GUI.\n
+ *          The scanning thread passes each scan result to updateFromScan() or scanFailed(), the GTP commands are
+ *          handled by GtpEngine::MainLoop() in another thread. Both only hold the game lock for a short time;
+ *          analysis commands work on a copy of the position.\n
+ *          Long running analysis commands can be run synchronously as every other command, or in the background
+ *          with <tt>ag_async command args</tt>, which answers immediately with a job id. The jobs are run by a
+ *          fixed pool of worker threads. While they run, the main loop keeps answering status queries, and
+ *          <tt>ag_job_status</tt>, <tt>ag_job_wait</tt>, <tt>ag_job_result</tt> and <tt>ag_job_cancel</tt>
+ *          manage the jobs. The GoGui interrupt line <tt># interrupt</tt> cancels the running synchronous command
+ *          and all background jobs.
+ *
+ * Commands:
+ *   - @c showboard, @c list_stones: as in GoGtpEngine
+ *   - @c ag_status: game and scanner state, one "key value" pair per line
+ *   - @c ag_setup: stones on the internal board, one line per color
+ *   - @c ag_scan_setup: stones of the last successful scan, one line per color
+ *   - @c ag_differences: points where the last scan differs from the internal board, see Game::getDifferences()
+ *   - @c ag_moves: moves played since the setup, one "color point" pair per line
+ *   - @c ag_sgf: the game tree in sgf format
+ *   - @c ag_index_open: opens a position index, see PositionIndex
+ *   - @c ag_trace file: writes the timing zones of the scanner and the game (see SgTrace.h) as Chrome trace
+ *   - @c ag_find_position [max]: (long) games of the index in which the current position occurred
+ *   - @c ag_estimate_score [playouts]: (long) Monte-Carlo score estimate of the current position
+ *   - @c ag_ownership [playouts]: (long) Monte-Carlo ownership of each point in percent, positive for black
+ *   - @c ag_async, @c ag_jobs, @c ag_job_status, @c ag_job_wait, @c ag_job_result, @c ag_job_cancel: background jobs
+ *
+ * Usage Example:
+   \code{.cpp}
+     GameGtpEngine engine;
+     std::thread scan_thread([&] {
+         while (scanning) {
+             if (scanner.scanCamera(setup, board_size, image) == Go_Scanner::ScanResult::Success)
+                 engine.updateFromScan(setup, board_size);
+             else
+                 engine.scanFailed("Board could not be detected");
+         }
+     });
+
+     GtpInputStream in(std::cin);
+     GtpOutputStream out(std::cout);
+     engine.MainLoop(in, out);
+   \endcode
+ */
+class GameGtpEngine : public GtpEngine {
+public:
+    /**
+     * @param[in]   num_workers     number of worker threads for background commands
+     */
+    explicit GameGtpEngine(int num_workers = 2);
+
+    /**
+     * @brief       Cancels all background commands and waits for the worker threads.
+     */
+    ~GameGtpEngine();
+
+    /**
+     * @brief       Updates the game with the setup of a successful scan. The first scan of a supported board size
+     *              (9, 13 or 19) initializes a new game with the setup. Thread safe.
+     * @returns     Result of Game::update(), Illegal if the board size is not supported.
+     */
+    UpdateResult updateFromScan(const GoSetup& setup, int board_size);
+
+    /**
+     * @brief       Records a scan that did not produce a setup, reported by ag_status. Thread safe.
+     */
+    void scanFailed(const string& reason);
+
+    /**
+     * @brief       Whether a client sent the quit command. GtpEngine::IsQuitSet() is also set at the end of the input,
+     *              e.g. when a socket client disconnects.
+     */
+    bool quitReceived() const;
+
+    /** @name Command Callbacks */
+    // @{
+    void CmdName(GtpCommand& cmd);
+    void CmdQuit(GtpCommand& cmd);
+    void CmdVersion(GtpCommand& cmd);
+    void cmdAnalyzeCommands(GtpCommand& cmd);
+    void cmdShowBoard(GtpCommand& cmd);
+    void cmdListStones(GtpCommand& cmd);
+    void cmdStatus(GtpCommand& cmd);
+    void cmdSetup(GtpCommand& cmd);
+    void cmdScanSetup(GtpCommand& cmd);
+    void cmdDifferences(GtpCommand& cmd);
+    void cmdMoves(GtpCommand& cmd);
+    void cmdSgf(GtpCommand& cmd);
+    void cmdIndexOpen(GtpCommand& cmd);
+    void cmdTrace(GtpCommand& cmd);
+    void cmdAsync(GtpCommand& cmd);
+    void cmdJobs(GtpCommand& cmd);
+    void cmdJobStatus(GtpCommand& cmd);
+    void cmdJobWait(GtpCommand& cmd);
+    void cmdJobResult(GtpCommand& cmd);
+    void cmdJobCancel(GtpCommand& cmd);
+    // @} // @name
+
+    /** @name Long Commands
+     *  Poll the canceled flag, which is set by ag_job_cancel or "# interrupt".
+     */
+    // @{
+    void cmdFindPosition(GtpCommand& cmd, const std::atomic<bool>& canceled);
+    void cmdEstimateScore(GtpCommand& cmd, const std::atomic<bool>& canceled);
+    void cmdOwnership(GtpCommand& cmd, const std::atomic<bool>& canceled);
+    // @} // @name
+
+    /**
+     * @brief       Cancels the running synchronous command and all background jobs.
+     *              Called by the GtpEngine read thread on "# interrupt".
+     */
+    void Interrupt();
+
+protected:
+    void BeforeHandleCommand();
+
+private:
+    // Not implemented
+    GameGtpEngine(const GameGtpEngine&);
+    GameGtpEngine& operator=(const GameGtpEngine&);
+
+private:
+    typedef void (GameGtpEngine::*LongCommand)(GtpCommand&, const std::atomic<bool>&);
+
+    // see GameGtpEngine.cpp
+    struct Job;
+    class LongCommandCallback;
+
+    /**
+     * @brief       Registers a long command, which can be run synchronously or with ag_async.
+     */
+    void registerLong(const string& name, LongCommand command);
+
+    /**
+     * @brief       Copies the current position, so it can be analyzed without holding the game lock.
+     * @returns     false if the game has not been initialized yet
+     */
+    bool copyPosition(int& size, GoSetup& setup, GoRules& rules) const;
+
+    /**
+     * @brief       Plays random playouts from the current position and sums up who owns each point at the end.
+     *              Stops early if canceled is set.
+     * @param[out]  ownership       per point: number of playouts black owned the point minus those white owned it
+     * @returns     sum of the final scores (positive for black, including komi)
+     */
+    double runPlayouts(int max_playouts, const std::atomic<bool>& canceled, int& num_playouts,
+                       SgPointArray<int>& ownership, int& board_size) const;
+
+    std::shared_ptr<Job> findJob(const GtpCommand& cmd);
+    void writeJobResponse(GtpCommand& cmd, const Job& job);
+
+    /**
+     * @brief       Main function of the worker threads: runs queued jobs until the engine is destroyed.
+     */
+    void workerLoop();
+
+private:
+    // game and scanner state, protected by _game_mutex
+    mutable std::mutex _game_mutex;
+    Game    _game;
+    bool    _game_is_initialized;
+    GoSetup _scan_setup;
+    int     _scan_board_size;
+    UpdateResult _last_update;
+    bool    _has_update;
+    long long _num_scans;
+    long long _num_failed_scans;
+    string  _scan_error;
+    std::chrono::steady_clock::time_point _last_scan_time;
+
+    // opened by ag_index_open, jobs keep their own reference while the next index is opened
+    std::shared_ptr<PositionIndex> _index;
+    std::mutex _index_mutex;
+
+    std::map<string, LongCommand> _long_commands;
+
+    bool _quit_received;
+
+    // canceled flag of the synchronously running command, reset before each command
+    std::atomic<bool> _interrupted;
+
+    // background jobs, protected by _jobs_mutex
+    std::mutex _jobs_mutex;
+    std::condition_variable _job_queued;
+    std::condition_variable _job_done;
+    std::map<unsigned int, std::shared_ptr<Job>> _jobs; // all jobs whose result has not been fetched
+    std::deque<std::shared_ptr<Job>> _queue;
+    unsigned int _next_job_id;
+    bool _shutdown;
+    std::vector<std::thread> _workers;
+};
+
+}
@@ -0,0 +1,523 @@
+#include "GameJournal.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+#include "SgGameWriter.h"
+#include "SgLog.h"
+#include "SgMappedFile.h"
+#include "SgMappedGameReader.h"
+#include "SgProp.h"
+
+// File format of a journal, all numbers little endian:
+//
+//   header:
+//     char[4]  magic "AGJL"
+//     uint32   version
+//     uint64   checksum of the sgf file the journal continues, 0 if it starts with an empty game
+//     uint32   length of the path to the current node
+//     uint32[] path to the current node as son indices, starting at the root
+//
+//   followed by the records:
+//     uint8    JournalRecordType
+//     uint16   payload length
+//     uint8[]  payload, see encodeRecord()
+//     uint32   checksum of type, length and payload
+
+namespace Go_Backend {
+namespace {
+const char     JOURNAL_MAGIC[4] = { 'A', 'G', 'J', 'L' };
+const uint32_t JOURNAL_VERSION  = 1;
+
+void putU8(std::vector<char>& out, uint32_t value) {
+    out.push_back(static_cast<char>(value & 0xff));
+}
+
+void putU16(std::vector<char>& out, uint32_t value) {
+    putU8(out, value);
+    putU8(out, value >> 8);
+}
+
+void putU32(std::vector<char>& out, uint32_t value) {
+    putU16(out, value);
+    putU16(out, value >> 16);
+}
+
+void putU64(std::vector<char>& out, uint64_t value) {
+    putU32(out, static_cast<uint32_t>(value));
+    putU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void putPoints(std::vector<char>& out, const SgPointSet& points) {
+    putU16(out, points.Size());
+    for (auto iter = SgSetIterator(points); iter; ++iter)
+        putU16(out, *iter);
+}
+
+/**
+ * @brief   Bounds checked reading of the numbers written by the put functions.
+ *          After reading past the end, ok() returns false and all reads return 0.
+ */
+class Reader {
+public:
+    Reader(const char* begin, const char* end)
+        : _pos(begin), _end(end), _ok(true)
+    {}
+
+    uint32_t u8() {
+        if (_pos == _end) {
+            _ok = false;
+            return 0;
+        }
+        return static_cast<unsigned char>(*_pos++);
+    }
+
+    uint32_t u16() {
+        uint32_t low = u8();
+        return low | (u8() << 8);
+    }
+
+    uint32_t u32() {
+        uint32_t low = u16();
+        return low | (u16() << 16);
+    }
+
+    uint64_t u64() {
+        uint64_t low = u32();
+        return low | (static_cast<uint64_t>(u32()) << 32);
+    }
+
+    SgPointSet points() {
+        SgPointSet points;
+        uint32_t count = u16();
+        for (uint32_t i = 0; i < count && _ok; ++i) {
+            SgPoint point = u16();
+            if (!SgPointUtil::InBoardRange(point)) {
+                _ok = false;
+                break;
+            }
+            points.Include(point);
+        }
+        return points;
+    }
+
+    const char* pos() const { return _pos; }
+    bool atEnd() const      { return _pos == _end; }
+    bool ok() const         { return _ok; }
+
+private:
+    const char* _pos;
+    const char* _end;
+    bool        _ok;
+};
+
+/**
+ * @brief   FNV-1a hash, used as checksum of records and sgf files.
+ */
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    // 0 is reserved for "no sgf file"
+    return hash == 0 ? 1 : hash;
+}
+
+void encodeRecord(std::vector<char>& out, const JournalRecord& record) {
+    std::vector<char> payload;
+    switch (record.type) {
+    case JournalRecordType::Init:
+        {
+            float komi = record.rules.Komi().ToFloat();
+            uint32_t komi_bits;
+            std::memcpy(&komi_bits, &komi, sizeof(komi_bits));
+
+            putU8(payload, record.board_size);
+            putU32(payload, komi_bits);
+            putU8(payload, (record.rules.JapaneseScoring() ? 1 : 0) | (record.rules.TwoPassesEndGame() ? 2 : 0));
+            putPoints(payload, record.setup.m_stones[SG_BLACK]);
+            putPoints(payload, record.setup.m_stones[SG_WHITE]);
+            break;
+        }
+    case JournalRecordType::Move:
+        putU8(payload, record.color);
+        putU16(payload, record.point);
+        break;
+    case JournalRecordType::Handicap:
+        putPoints(payload, record.setup.m_stones[SG_BLACK]);
+        break;
+    case JournalRecordType::Navigate:
+        putU8(payload, record.direction);
+        break;
+    case JournalRecordType::Pass:
+    case JournalRecordType::Resign:
+        // the player is always the current player
+        break;
+    }
+
+    const size_t start = out.size();
+    putU8(out, static_cast<uint32_t>(record.type));
+    putU16(out, static_cast<uint32_t>(payload.size()));
+    out.insert(out.end(), payload.begin(), payload.end());
+    putU32(out, static_cast<uint32_t>(checksum(&out[start], out.size() - start)));
+}
+
+/**
+ * @returns     false if the record is incomplete or damaged, which happens if the program crashed while writing it
+ */
+bool decodeRecord(Reader& in, JournalRecord& record) {
+    const char* start = in.pos();
+    uint32_t type = in.u8();
+    uint32_t length = in.u16();
+    if (!in.ok() || type > static_cast<uint32_t>(JournalRecordType::Navigate))
+        return false;
+
+    // verify the checksum before interpreting the payload
+    Reader payload = in;
+    for (uint32_t i = 0; i < length; ++i)
+        in.u8();
+    const char* payload_end = in.pos();
+    uint32_t stored_checksum = in.u32();
+    if (!in.ok() || stored_checksum != static_cast<uint32_t>(checksum(start, payload_end - start)))
+        return false;
+
+    record = JournalRecord(static_cast<JournalRecordType>(type));
+    switch (record.type) {
+    case JournalRecordType::Init:
+        {
+            record.board_size = payload.u8();
+            uint32_t komi_bits = payload.u32();
+            float komi;
+            std::memcpy(&komi, &komi_bits, sizeof(komi));
+            uint32_t flags = payload.u8();
+            record.rules = GoRules(0, GoKomi(komi), (flags & 1) != 0, (flags & 2) != 0);
+            record.setup.m_stones[SG_BLACK] = payload.points();
+            record.setup.m_stones[SG_WHITE] = payload.points();
+            if (record.board_size < SG_MIN_SIZE || record.board_size > SG_MAX_SIZE)
+                return false;
+            break;
+        }
+    case JournalRecordType::Move:
+        record.color = payload.u8();
+        record.point = payload.u16();
+        if (!SgIsBlackWhite(record.color) || !SgPointUtil::InBoardRange(record.point))
+            return false;
+        break;
+    case JournalRecordType::Handicap:
+        record.setup.m_stones[SG_BLACK] = payload.points();
+        break;
+    case JournalRecordType::Navigate:
+        {
+            uint32_t direction = payload.u8();
+            if (direction > SgNode::END_OF_GAME)
+                return false;
+            record.direction = static_cast<SgNode::Direction>(direction);
+            break;
+        }
+    case JournalRecordType::Pass:
+    case JournalRecordType::Resign:
+        break;
+    }
+    return payload.ok() && payload.pos() <= payload_end;
+}
+
+void encodeHeader(std::vector<char>& out, uint64_t sgf_checksum, const std::vector<int>& current_path) {
+    out.insert(out.end(), JOURNAL_MAGIC, JOURNAL_MAGIC + sizeof(JOURNAL_MAGIC));
+    putU32(out, JOURNAL_VERSION);
+    putU64(out, sgf_checksum);
+    putU32(out, static_cast<uint32_t>(current_path.size()));
+    for (auto index : current_path)
+        putU32(out, index);
+}
+
+/**
+ * @brief       Writes data to the file and makes sure it reached the disk.
+ */
+bool syncFile(FILE* file) {
+    if (std::fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool writeFile(const string& path, const char* data, size_t size) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool success = std::fwrite(data, 1, size, file) == size && syncFile(file);
+    return std::fclose(file) == 0 && success;
+}
+
+/**
+ * @brief       Atomically replaces target with source.
+ */
+bool replaceFile(const string& source, const string& target) {
+    boost::system::error_code error;
+    boost::filesystem::rename(source, target, error);
+    return !error;
+}
+} // namespace
+
+JournalRecord::JournalRecord(JournalRecordType type)
+    : type(type),
+      color(SG_BLACK),
+      point(SG_NULLPOINT),
+      direction(SgNode::NEXT),
+      board_size(0),
+      rules(),
+      setup()
+{}
+
+GameJournal::GameJournal()
+    : _journal_file(),
+      _sgf_file(),
+      _file(nullptr),
+      _pending_jobs(0),
+      _stop(false)
+{}
+
+GameJournal::~GameJournal() {
+    close();
+}
+
+bool GameJournal::open(const string& journal_file, const string& sgf_file) {
+    close();
+
+    std::vector<char> header;
+    encodeHeader(header, 0, std::vector<int>());
+    if (!writeFile(journal_file, header.data(), header.size()))
+        return false;
+
+    _file = std::fopen(journal_file.c_str(), "ab");
+    if (!_file)
+        return false;
+
+    _journal_file = journal_file;
+    _sgf_file     = sgf_file;
+    _stop         = false;
+    _writer       = std::thread(&GameJournal::writerLoop, this);
+    return true;
+}
+
+void GameJournal::close(bool remove_files) {
+    if (!isOpen())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _work_available.notify_one();
+    _writer.join(); // writes the remaining jobs before stopping
+
+    if (_file)
+        std::fclose(_file);
+    _file = nullptr;
+
+    if (remove_files) {
+        boost::system::error_code error;
+        boost::filesystem::remove(_journal_file, error);
+        boost::filesystem::remove(_sgf_file, error);
+    }
+}
+
+bool GameJournal::isOpen() const {
+    return _writer.joinable();
+}
+
+void GameJournal::append(const JournalRecord& record) {
+    Job job;
+    job.tree = nullptr;
+    encodeRecord(job.records, record);
+    push(job);
+}
+
+void GameJournal::compact(const SgNode& root, const SgNode& current) {
+    Job job;
+    job.tree = root.CopyTree();
+
+    for (auto node = &current; node->HasFather(); node = node->Father())
+        job.current_path.push_back(node->NumLeftBrothers());
+    std::reverse(job.current_path.begin(), job.current_path.end());
+
+    push(job);
+}
+
+void GameJournal::push(Job& job) {
+    if (!isOpen()) {
+        if (job.tree)
+            job.tree->DeleteTree();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!job.tree && !_queue.empty() && !_queue.back().tree) {
+            // the writer thread hasn't picked up the last records yet, just add to them
+            auto& records = _queue.back().records;
+            records.insert(records.end(), job.records.begin(), job.records.end());
+            return;
+        }
+
+        _queue.push_back(Job());
+        _queue.back().records.swap(job.records);
+        _queue.back().tree = job.tree;
+        _queue.back().current_path.swap(job.current_path);
+        ++_pending_jobs;
+    }
+    _work_available.notify_one();
+}
+
+void GameJournal::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _work_done.wait(lock, [this] { return _pending_jobs == 0; });
+}
+
+void GameJournal::writerLoop() {
+    while (true) {
+        std::deque<Job> jobs;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _work_available.wait(lock, [this] { return _stop || !_queue.empty(); });
+            if (_queue.empty())
+                break; // stopped and everything is written
+            jobs.swap(_queue);
+        }
+
+        bool needs_sync = false;
+        for (auto& job : jobs) {
+            if (job.tree) {
+                if (needs_sync && !syncFile(_file))
+                    SG_LOG(SG_LOG_ERROR) << "Error writing game journal \"" << _journal_file << "\"!";
+                needs_sync = false;
+
+                writeCompaction(job);
+                job.tree->DeleteTree();
+            }
+            else if (_file) {
+                if (std::fwrite(job.records.data(), 1, job.records.size(), _file) != job.records.size())
+                    SG_LOG(SG_LOG_ERROR) << "Error writing game journal \"" << _journal_file << "\"!";
+                needs_sync = true;
+            }
+            else {
+                // the journal couldn't be reopened after the last compaction, records are lost until the next one
+                SG_LOG(SG_LOG_ERROR) << "Game journal \"" << _journal_file << "\" is not open, record dropped!";
+            }
+        }
+
+        // one sync for all records written in this batch
+        if (needs_sync && !syncFile(_file))
+            SG_LOG(SG_LOG_ERROR) << "Error writing game journal \"" << _journal_file << "\"!";
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending_jobs -= static_cast<int>(jobs.size());
+        }
+        _work_done.notify_all();
+    }
+}
+
+void GameJournal::writeCompaction(const Job& job) {
+    // same format as Game::saveGame()
+    std::ostringstream sgf_stream;
+    SgGameWriter writer(sgf_stream);
+    writer.WriteGame(*job.tree, true, 0, SG_PROPPOINTFMT_GO, 19);
+    const string sgf = sgf_stream.str();
+
+    // the old sgf file stays valid until the new one is completely written
+    const string sgf_temp = _sgf_file + ".tmp";
+    if (!writeFile(sgf_temp, sgf.data(), sgf.size()) || !replaceFile(sgf_temp, _sgf_file)) {
+        // keep appending to the current journal, it still matches the old sgf file
+        SG_LOG(SG_LOG_ERROR) << "Error writing game journal sgf \"" << _sgf_file << "\"!";
+        return;
+    }
+
+    std::vector<char> header;
+    encodeHeader(header, checksum(sgf.data(), sgf.size()), job.current_path);
+    const string journal_temp = _journal_file + ".tmp";
+    if (!writeFile(journal_temp, header.data(), header.size())) {
+        // the old journal doesn't match the new sgf anymore, read() will fall back to the sgf alone
+        SG_LOG(SG_LOG_ERROR) << "Error writing game journal \"" << _journal_file << "\"!";
+        return;
+    }
+
+    if (_file)
+        std::fclose(_file);
+    if (!replaceFile(journal_temp, _journal_file))
+        SG_LOG(SG_LOG_ERROR) << "Error writing game journal \"" << _journal_file << "\"!";
+    _file = std::fopen(_journal_file.c_str(), "ab");
+    if (!_file) {
+        // the journal on disk still matches the new sgf file, only the following records are lost;
+        // the next compaction tries again
+        SG_LOG(SG_LOG_ERROR) << "Error reopening game journal \"" << _journal_file
+                             << "\", records are dropped until the next compaction!";
+    }
+}
+
+bool GameJournal::read(const string& journal_file, const string& sgf_file, SgNode*& game_tree,
+                       std::vector<int>& current_path, std::vector<JournalRecord>& records) {
+    game_tree = nullptr;
+    current_path.clear();
+    records.clear();
+
+    SgMappedFile journal;
+    if (!journal.Open(journal_file))
+        return false;
+
+    Reader in(journal.Begin(), journal.End());
+    for (auto magic_char : JOURNAL_MAGIC) {
+        if (in.u8() != static_cast<unsigned char>(magic_char))
+            return false;
+    }
+    if (in.u32() != JOURNAL_VERSION)
+        return false;
+    uint64_t sgf_checksum = in.u64();
+    uint32_t path_length = in.u32();
+    for (uint32_t i = 0; i < path_length && in.ok(); ++i)
+        current_path.push_back(static_cast<int>(in.u32()));
+    if (!in.ok())
+        return false;
+
+    JournalRecord record;
+    while (!in.atEnd() && decodeRecord(in, record))
+        records.push_back(record);
+
+    if (sgf_checksum == 0) {
+        // the journal starts with an empty game
+        return true;
+    }
+
+    SgMappedFile sgf;
+    if (!sgf.Open(sgf_file))
+        return false;
+
+    SgMappedGameReader reader(sgf);
+    game_tree = reader.ReadGame();
+    if (!game_tree)
+        return false;
+
+    if (checksum(sgf.Begin(), sgf.Size()) != sgf_checksum) {
+        // crashed after a compaction wrote the new sgf but before the new journal was written,
+        // the sgf already contains all changes of the journal
+        current_path.clear();
+        records.clear();
+    }
+    return true;
+}
+
+}
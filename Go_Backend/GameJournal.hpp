@@ -0,0 +1,170 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SgSystem.h"
+#include "GoRules.h"
+#include "GoSetup.h"
+#include "SgNode.h"
+
+namespace Go_Backend {
+using std::string;
+
+/**
+ * @brief   Types of the records in a game journal, see JournalRecord.
+ */
+enum class JournalRecordType {
+    Init,       ///< Game::init() with board size, rules and setup
+    Move,       ///< move of a player, from Game::update() or Game::playMove()
+    Pass,       ///< Game::pass()
+    Resign,     ///< Game::resign()
+    Handicap,   ///< handicap stones placed by Game::update()
+    Navigate    ///< Game::navigateHistory()
+};
+
+/**
+ * @brief   One change of the game state, as it is stored in the journal.
+ *          Only the members listed for the record type are used.
+ */
+struct JournalRecord {
+    JournalRecord(JournalRecordType type = JournalRecordType::Pass);
+
+    JournalRecordType type;
+    SgBlackWhite      color;        ///< Move
+    SgPoint           point;        ///< Move
+    SgNode::Direction direction;    ///< Navigate
+    int               board_size;   ///< Init
+    GoRules           rules;        ///< Init
+    GoSetup           setup;        ///< Init, Handicap (only black stones)
+};
+
+/**
+ * @brief   Crash safe autosave for a game. Every change of the game is appended as a small record to a journal file.
+ *          All file operations are done by a background thread, so logging a record never blocks the caller
+ *          (usually the scanning thread) on disk I/O. The records queued since the last write are written
+ *          together and synced to disk with one fsync.\n
+ *          To keep the journal short, compact() periodically writes the whole game tree to a normal sgf file and
+ *          starts a new journal that only contains the changes after that sgf. The sgf is written to a
+ *          temporary file first and renamed, so there always is a complete sgf file on disk. The journal header
+ *          stores a checksum of the sgf it continues, read() uses it to detect a crash between writing the sgf
+ *          and the new journal.\n
+ *          Game uses this class through Game::startJournal() and Game::recoverFromJournal().
+ *
+ * Usage Example:
+   \code{.cpp}
+     GameJournal journal;
+     journal.open("autosave.agj", "autosave.sgf");
+     journal.compact(game_root, current_node);
+
+     JournalRecord record(JournalRecordType::Move);
+     record.color = SG_BLACK;
+     record.point = SgPointUtil::Pt(3, 3);
+     journal.append(record);
+   \endcode
+ */
+class GameJournal {
+public:
+    GameJournal();
+
+    /**
+     * @brief       Writes all queued records and stops the background thread, see close().
+     */
+    ~GameJournal();
+
+    /**
+     * @brief       Creates a new, empty journal and starts the background thread.
+     *              An existing journal file is overwritten, use read() first to recover from it.
+     * @param[in]   journal_file    path of the journal
+     * @param[in]   sgf_file        path of the sgf file written by compact()
+     * @returns     false if the journal file could not be created, true otherwise
+     */
+    bool open(const string& journal_file, const string& sgf_file);
+
+    /**
+     * @brief       Writes all queued records, stops the background thread and closes the journal.
+     * @param[in]   remove_files    also deletes the journal and the sgf file, e.g. if the game was closed normally
+     */
+    void close(bool remove_files = false);
+
+    bool isOpen() const;
+
+    /**
+     * @brief       Queues a record to be appended to the journal. Returns immediately.
+     */
+    void append(const JournalRecord& record);
+
+    /**
+     * @brief       Queues writing a copy of the game tree to the sgf file and starting a new journal after it.
+     *              The tree is copied before returning, the file operations run in the background.
+     * @param[in]   root    root of the game tree
+     * @param[in]   current current node of the game, it is restored by read()
+     */
+    void compact(const SgNode& root, const SgNode& current);
+
+    /**
+     * @brief       Blocks until all queued records and compactions have been written to disk.
+     */
+    void flush();
+
+    /**
+     * @brief       Reads a journal and the sgf file it continues.
+     *              A record that was only partly written before a crash ends the journal.
+     * @param[in]   journal_file    path of the journal
+     * @param[in]   sgf_file        path of the sgf file
+     * @param[out]  game_tree       the game tree of the sgf file, nullptr if the journal starts with an empty game.
+     *                              The caller takes ownership.
+     * @param[out]  current_path    path from the root to the current node of game_tree, as son indices
+     * @param[out]  records         records to apply to the game after loading game_tree
+     * @returns     false if the journal or the sgf file could not be read, true otherwise
+     */
+    static bool read(const string& journal_file, const string& sgf_file, SgNode*& game_tree,
+                     std::vector<int>& current_path, std::vector<JournalRecord>& records);
+
+private:
+    // Not implemented
+    GameJournal(const GameJournal&);
+    GameJournal& operator=(const GameJournal&);
+
+private:
+    /**
+     * @brief       Work item of the background thread. Either encoded records or a compaction.
+     */
+    struct Job {
+        std::vector<char> records;
+        SgNode*           tree;         // owned copy of the game tree for a compaction, nullptr otherwise
+        std::vector<int>  current_path;
+    };
+
+    void writerLoop();
+
+    /**
+     * @brief       Runs on the background thread. Writes the sgf file and replaces the journal with a new one
+     *              that continues the sgf.
+     */
+    void writeCompaction(const Job& job);
+
+    void push(Job& job);
+
+    string _journal_file;
+    string _sgf_file;
+    FILE*  _file; // only used by the background thread while it is running, nullptr if reopening after a compaction failed
+
+    std::thread             _writer;
+    std::mutex              _mutex;
+    std::condition_variable _work_available;
+    std::condition_variable _work_done;
+    std::deque<Job>         _queue;
+    int                     _pending_jobs; // queued jobs and jobs currently written by the background thread
+    bool                    _stop;
+};
+
+}
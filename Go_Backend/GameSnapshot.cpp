@@ -0,0 +1,480 @@
+#include "GameSnapshot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "GoGame.h"
+#include "SgGameWriter.h"
+#include "SgMappedGameReader.h"
+#include "SgProp.h"
+
+namespace Go_Backend {
+
+// Snapshot file format, all values in native byte order:
+//   SnapshotHeader
+//   SetupEntry setups[num_setups]                  ordered by node
+//   TextEntry  texts[num_texts]                    ordered by node
+//   uint16_t   moves[num_nodes]                    move of each node of the line, see packMove()
+//   uint16_t   setup_points[num_setup_points]      see packSetupPoint()
+//   uint16_t   stones[num_stones[0] + num_stones[1]] black, then white stones on the board at the current node
+//   char       text[text_size]                     texts of the TextEntries
+struct GameSnapshot::SnapshotHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t board_size;
+    float    komi;
+    uint32_t flags;
+    uint32_t handicap;
+    uint32_t num_nodes;        // nodes of the stored line, the first one is the root
+    uint32_t current_node;     // index of the current node in the line
+    uint32_t num_setups;
+    uint32_t num_setup_points;
+    uint32_t num_texts;
+    uint32_t text_size;
+    uint32_t prisoners[2];     // indexed by SgBlackWhite
+    uint32_t num_stones[2];    // indexed by SgBlackWhite
+};
+
+/**
+ * Setup stones and player to move of a node.
+ */
+struct GameSnapshot::SetupEntry {
+    uint32_t node;
+    uint32_t first_point;
+    uint32_t num_points;
+    uint32_t player; // SG_BLACK or SG_WHITE if the node sets the player to move, SG_EMPTY otherwise
+};
+
+/**
+ * Text property of a node, see textProperty().
+ */
+struct GameSnapshot::TextEntry {
+    uint32_t node;
+    uint32_t property;
+    uint32_t offset;
+    uint32_t length;
+};
+
+namespace {
+const char     SNAPSHOT_MAGIC[4] = { 'A', 'G', 'S', 'S' };
+const uint32_t SNAPSHOT_VERSION  = 1;
+
+// SnapshotHeader::flags
+const uint32_t FLAG_JAPANESE_SCORING  = 1;
+const uint32_t FLAG_TWO_PASSES_END    = 2;
+const uint32_t FLAG_GAME_FINISHED     = 4;
+const uint32_t FLAG_KOMI_UNKNOWN      = 8;
+
+// moves are stored as the move in the lower 15 bits and the player in the highest bit
+const uint16_t NO_MOVE    = 0xffff;
+const uint16_t WHITE_MOVE = 0x8000;
+
+// setup points are stored as the point in the lower 14 bits and the color (SgEmptyBlackWhite) in the highest 2 bits
+const int SETUP_COLOR_SHIFT = 14;
+const uint16_t SETUP_POINT_MASK = (1 << SETUP_COLOR_SHIFT) - 1;
+
+const uint32_t NUM_TEXT_PROPERTIES = 6;
+
+/**
+ * The stored text properties, the index is TextEntry::property.
+ * SgPropIDs are only valid after SgInit(), so they can't be put into a static table.
+ */
+SgPropID textProperty(uint32_t property) {
+    switch (property) {
+    case 0:  return SG_PROP_COMMENT;
+    case 1:  return SG_PROP_PLAYER_BLACK;
+    case 2:  return SG_PROP_PLAYER_WHITE;
+    case 3:  return SG_PROP_GAME_NAME;
+    case 4:  return SG_PROP_DATE;
+    default: return SG_PROP_RESULT;
+    }
+}
+
+uint16_t packMove(SgMove move, SgBlackWhite player) {
+    return static_cast<uint16_t>(move) | (player == SG_WHITE ? WHITE_MOVE : 0);
+}
+
+uint16_t packSetupPoint(SgPoint point, SgEmptyBlackWhite color) {
+    return static_cast<uint16_t>(point | (color << SETUP_COLOR_SHIFT));
+}
+
+/**
+ * @returns     Whether the node has properties that are stored in a SetupEntry.
+ */
+bool hasSetup(const SgNode& node) {
+    return node.HasProp(SG_PROP_ADD_BLACK) || node.HasProp(SG_PROP_ADD_WHITE) || node.HasProp(SG_PROP_ADD_EMPTY)
+        || node.HasProp(SG_PROP_PLAYER);
+}
+
+void addSetupPoints(const SgNode& node, SgPropID id, SgEmptyBlackWhite color, std::vector<uint16_t>& setup_points) {
+    auto prop = static_cast<const SgPropAddStone*>(node.Get(id));
+    if (!prop)
+        return;
+    for (SgVectorIterator<SgPoint> it(prop->Value()); it; ++it)
+        setup_points.push_back(packSetupPoint(*it, color));
+}
+
+/**
+ * @returns     Whether the point is on a board of this size. SgPointUtil::InBoardRange() also accepts the border
+ *              points and the points outside of boards smaller than SG_MAX_SIZE.
+ */
+bool isOnBoard(SgPoint point, uint32_t board_size) {
+    if (!SgPointUtil::InBoardRange(point))
+        return false;
+    // SgPointUtil::Col() and Row() assert that the point is on the largest board
+    const uint32_t col = point % SG_NS;
+    const uint32_t row = point / SG_NS;
+    return col >= 1 && col <= board_size && row >= 1 && row <= board_size;
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    if (!values.empty())
+        out.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(T));
+}
+
+} // namespace
+
+GameSnapshot::GameSnapshot()
+    : _header(nullptr),
+      _setups(nullptr),
+      _texts(nullptr),
+      _moves(nullptr),
+      _setup_points(nullptr),
+      _stones(nullptr),
+      _text(nullptr)
+{}
+
+bool GameSnapshot::write(const SgNode& current, const GoBoard& board, bool game_finished,
+                         const string& snapshot_file) {
+    // the stored line: root to current node, then the first variation
+    std::vector<const SgNode*> line;
+    for (auto node = &current; node != nullptr; node = node->Father())
+        line.push_back(node);
+    std::reverse(line.begin(), line.end());
+    const uint32_t current_node = static_cast<uint32_t>(line.size() - 1);
+    for (auto node = current.LeftMostSon(); node != nullptr; node = node->LeftMostSon())
+        line.push_back(node);
+
+    std::vector<SetupEntry> setups;
+    std::vector<TextEntry> texts;
+    std::vector<uint16_t> moves;
+    std::vector<uint16_t> setup_points;
+    string text;
+    moves.reserve(line.size());
+
+    for (uint32_t i = 0; i < line.size(); ++i) {
+        const SgNode& node = *line[i];
+
+        moves.push_back(node.HasNodeMove() ? packMove(node.NodeMove(), node.NodePlayer()) : NO_MOVE);
+
+        if (hasSetup(node)) {
+            SetupEntry setup;
+            setup.node = i;
+            setup.first_point = static_cast<uint32_t>(setup_points.size());
+            addSetupPoints(node, SG_PROP_ADD_BLACK, SG_BLACK, setup_points);
+            addSetupPoints(node, SG_PROP_ADD_WHITE, SG_WHITE, setup_points);
+            addSetupPoints(node, SG_PROP_ADD_EMPTY, SG_EMPTY, setup_points);
+            setup.num_points = static_cast<uint32_t>(setup_points.size()) - setup.first_point;
+
+            auto player = static_cast<const SgPropPlayer*>(node.Get(SG_PROP_PLAYER));
+            setup.player = player ? player->Value() : SG_EMPTY;
+            setups.push_back(setup);
+        }
+
+        for (uint32_t property = 0; property < NUM_TEXT_PROPERTIES; ++property) {
+            string value;
+            if (node.GetStringProp(textProperty(property), &value)) {
+                TextEntry entry;
+                entry.node = i;
+                entry.property = property;
+                entry.offset = static_cast<uint32_t>(text.size());
+                entry.length = static_cast<uint32_t>(value.size());
+                texts.push_back(entry);
+                text += value;
+            }
+        }
+    }
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.board_size = board.Size();
+
+    const GoRules& rules = board.Rules();
+    if (rules.Komi().IsUnknown())
+        header.flags |= FLAG_KOMI_UNKNOWN;
+    else
+        header.komi = rules.Komi().ToFloat();
+    if (rules.JapaneseScoring())
+        header.flags |= FLAG_JAPANESE_SCORING;
+    if (rules.TwoPassesEndGame())
+        header.flags |= FLAG_TWO_PASSES_END;
+    if (game_finished)
+        header.flags |= FLAG_GAME_FINISHED;
+    header.handicap = rules.Handicap();
+
+    header.num_nodes = static_cast<uint32_t>(line.size());
+    header.current_node = current_node;
+    header.num_setups = static_cast<uint32_t>(setups.size());
+    header.num_setup_points = static_cast<uint32_t>(setup_points.size());
+    header.num_texts = static_cast<uint32_t>(texts.size());
+    header.text_size = static_cast<uint32_t>(text.size());
+
+    std::vector<uint16_t> stones;
+    for (SgBWIterator it; it; ++it) {
+        SgBlackWhite color = *it;
+        header.prisoners[color] = board.NumPrisoners(color);
+        header.num_stones[color] = board.All(color).Size();
+        for (auto iter = SgSetIterator(board.All(color)); iter; ++iter)
+            stones.push_back(static_cast<uint16_t>(*iter));
+    }
+
+    std::ofstream out(snapshot_file.c_str(), std::ios::binary);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(out, setups);
+    writeArray(out, texts);
+    writeArray(out, moves);
+    writeArray(out, setup_points);
+    writeArray(out, stones);
+    out.write(text.data(), text.size());
+    return out.good();
+}
+
+bool GameSnapshot::convertSgf(const string& sgf_file, const string& snapshot_file) {
+    SgMappedFile file;
+    if (!file.Open(sgf_file))
+        return false;
+
+    SgMappedGameReader reader(file);
+    SgNode* root = reader.ReadGame();
+    if (!root)
+        return false;
+
+    // the rules are only known as far as they are stored in the sgf file
+    int handicap = 0;
+    root->GetIntProp(SG_PROP_HANDICAP, &handicap);
+    GoKomi komi;
+    if (root->HasProp(SG_PROP_KOMI))
+        komi = GoKomi(static_cast<float>(root->GetRealProp(SG_PROP_KOMI)));
+
+    // the game takes ownership of the tree
+    GoGame game;
+    game.Init(root, GoRules(handicap, komi));
+
+    // go to the end of the main line, the board is updated only once
+    const SgNode* current = root;
+    while (current->HasSon())
+        current = current->LeftMostSon();
+    game.GoToNode(current);
+
+    return write(*game.CurrentNode(), game.Board(), false, snapshot_file);
+}
+
+bool GameSnapshot::convertToSgf(const string& snapshot_file, const string& sgf_file) {
+    GameSnapshot snapshot;
+    if (!snapshot.open(snapshot_file))
+        return false;
+
+    std::ofstream out(sgf_file.c_str());
+    if (!out)
+        return false;
+
+    const SgNode* current;
+    SgNode* root = snapshot.createGameTree(current);
+
+    // same format as Game::saveGame()
+    SgGameWriter writer(out);
+    writer.WriteGame(*root, true, 0, SG_PROPPOINTFMT_GO, 19);
+    root->DeleteTree();
+
+    return out.good();
+}
+
+bool GameSnapshot::open(const string& snapshot_file) {
+    close();
+    if (!_file.Open(snapshot_file))
+        return false;
+
+    if (!mapSections()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GameSnapshot::close() {
+    _file.Close();
+    _header = nullptr;
+    _setups = nullptr;
+    _texts = nullptr;
+    _moves = nullptr;
+    _setup_points = nullptr;
+    _stones = nullptr;
+    _text = nullptr;
+}
+
+bool GameSnapshot::isOpen() const {
+    return _header != nullptr;
+}
+
+bool GameSnapshot::mapSections() {
+    const char* data = _file.Begin();
+    size_t size = _file.Size();
+    if (size < sizeof(SnapshotHeader))
+        return false;
+
+    auto header = reinterpret_cast<const SnapshotHeader*>(data);
+    if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+        || header->version != SNAPSHOT_VERSION
+        || header->board_size < SG_MIN_SIZE || header->board_size > SG_MAX_SIZE
+        || header->num_nodes == 0 || header->current_node >= header->num_nodes)
+        return false;
+
+    const size_t num_stones = static_cast<size_t>(header->num_stones[SG_BLACK]) + header->num_stones[SG_WHITE];
+    size_t offset = sizeof(SnapshotHeader);
+    size_t expected_size = offset
+                           + header->num_setups * sizeof(SetupEntry)
+                           + header->num_texts * sizeof(TextEntry)
+                           + (static_cast<size_t>(header->num_nodes) + header->num_setup_points + num_stones)
+                             * sizeof(uint16_t)
+                           + header->text_size;
+    if (size != expected_size)
+        return false;
+
+    _setups = reinterpret_cast<const SetupEntry*>(data + offset);
+    offset += header->num_setups * sizeof(SetupEntry);
+    _texts = reinterpret_cast<const TextEntry*>(data + offset);
+    offset += header->num_texts * sizeof(TextEntry);
+    _moves = reinterpret_cast<const uint16_t*>(data + offset);
+    offset += header->num_nodes * sizeof(uint16_t);
+    _setup_points = reinterpret_cast<const uint16_t*>(data + offset);
+    offset += header->num_setup_points * sizeof(uint16_t);
+    _stones = reinterpret_cast<const uint16_t*>(data + offset);
+    offset += num_stones * sizeof(uint16_t);
+    _text = data + offset;
+
+    // check all indices once, so that createGameTree() can trust them
+    for (uint32_t i = 0; i < header->num_setups; ++i) {
+        const SetupEntry& setup = _setups[i];
+        if (setup.node >= header->num_nodes || (i > 0 && setup.node <= _setups[i - 1].node)
+            || setup.first_point > header->num_setup_points
+            || setup.num_points > header->num_setup_points - setup.first_point
+            || (setup.player != SG_EMPTY && !SgIsBlackWhite(setup.player)))
+            return false;
+    }
+    for (uint32_t i = 0; i < header->num_texts; ++i) {
+        const TextEntry& text = _texts[i];
+        if (text.node >= header->num_nodes || (i > 0 && text.node < _texts[i - 1].node)
+            || text.property >= NUM_TEXT_PROPERTIES
+            || text.offset > header->text_size || text.length > header->text_size - text.offset)
+            return false;
+    }
+    for (uint32_t i = 0; i < header->num_nodes; ++i) {
+        uint16_t move = _moves[i];
+        if (move != NO_MOVE && (move & ~WHITE_MOVE) != SG_PASS && !isOnBoard(move & ~WHITE_MOVE, header->board_size))
+            return false;
+    }
+    for (uint32_t i = 0; i < header->num_setup_points; ++i) {
+        if (!isOnBoard(_setup_points[i] & SETUP_POINT_MASK, header->board_size)
+            || (_setup_points[i] >> SETUP_COLOR_SHIFT) > SG_EMPTY)
+            return false;
+    }
+    for (size_t i = 0; i < num_stones; ++i) {
+        if (!isOnBoard(_stones[i], header->board_size))
+            return false;
+    }
+
+    _header = header;
+    return true;
+}
+
+SgNode* GameSnapshot::createGameTree(const SgNode*& current) const {
+    assert(isOpen());
+
+    SgNode* root = new SgNode();
+    root->Add(new SgPropInt(SG_PROP_SIZE, _header->board_size));
+    if (!(_header->flags & FLAG_KOMI_UNKNOWN))
+        root->SetRealProp(SG_PROP_KOMI, _header->komi, 1);
+    if (_header->handicap > 0)
+        root->Add(new SgPropInt(SG_PROP_HANDICAP, _header->handicap));
+
+    current = root;
+    SgNode* node = root;
+    uint32_t setup_index = 0;
+    uint32_t text_index = 0;
+    for (uint32_t i = 0; i < _header->num_nodes; ++i) {
+        if (i > 0)
+            node = node->NewRightMostSon();
+
+        uint16_t move = _moves[i];
+        if (move != NO_MOVE)
+            node->AddMoveProp(move & ~WHITE_MOVE, (move & WHITE_MOVE) ? SG_WHITE : SG_BLACK);
+
+        if (setup_index < _header->num_setups && _setups[setup_index].node == i) {
+            const SetupEntry& setup = _setups[setup_index++];
+
+            SgVector<SgPoint> points[3]; // indexed by SgEmptyBlackWhite
+            for (uint32_t p = setup.first_point; p < setup.first_point + setup.num_points; ++p)
+                points[_setup_points[p] >> SETUP_COLOR_SHIFT].PushBack(_setup_points[p] & SETUP_POINT_MASK);
+
+            if (!points[SG_BLACK].IsEmpty())
+                node->Add(new SgPropAddStone(SG_PROP_ADD_BLACK, points[SG_BLACK]));
+            if (!points[SG_WHITE].IsEmpty())
+                node->Add(new SgPropAddStone(SG_PROP_ADD_WHITE, points[SG_WHITE]));
+            if (!points[SG_EMPTY].IsEmpty())
+                node->Add(new SgPropAddStone(SG_PROP_ADD_EMPTY, points[SG_EMPTY]));
+            if (setup.player != SG_EMPTY)
+                node->Add(new SgPropPlayer(SG_PROP_PLAYER, setup.player));
+        }
+
+        while (text_index < _header->num_texts && _texts[text_index].node == i) {
+            const TextEntry& text = _texts[text_index++];
+            node->SetStringProp(textProperty(text.property), string(_text + text.offset, text.length));
+        }
+
+        if (i == _header->current_node)
+            current = node;
+    }
+    return root;
+}
+
+int GameSnapshot::boardSize() const {
+    return _header->board_size;
+}
+
+GoRules GameSnapshot::rules() const {
+    GoKomi komi;
+    if (!(_header->flags & FLAG_KOMI_UNKNOWN))
+        komi = GoKomi(_header->komi);
+    return GoRules(_header->handicap, komi, (_header->flags & FLAG_JAPANESE_SCORING) != 0,
+                   (_header->flags & FLAG_TWO_PASSES_END) != 0);
+}
+
+bool GameSnapshot::gameFinished() const {
+    return (_header->flags & FLAG_GAME_FINISHED) != 0;
+}
+
+int GameSnapshot::currentNodeDepth() const {
+    return _header->current_node;
+}
+
+SgPointSet GameSnapshot::stones(SgBlackWhite color) const {
+    const uint16_t* begin = _stones + (color == SG_WHITE ? _header->num_stones[SG_BLACK] : 0);
+    SgPointSet stones;
+    for (auto point = begin; point != begin + _header->num_stones[color]; ++point)
+        stones.Include(*point);
+    return stones;
+}
+
+int GameSnapshot::prisoners(SgBlackWhite color) const {
+    return _header->prisoners[color];
+}
+
+}
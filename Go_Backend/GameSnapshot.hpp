@@ -0,0 +1,135 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "GoBoard.h"
+#include "SgMappedFile.h"
+#include "SgNode.h"
+
+namespace Go_Backend {
+using std::string;
+
+/**
+ * @brief   Binary snapshot of a game, that can be restored much faster than a sgf file.\n
+ *          A snapshot stores one line of the game tree (from the root through the current node, continued with the
+ *          first variation) as packed moves and setup stones, together with the game information, comments, the
+ *          rules and the position of the current node. It also stores the stones and prisoners on the board at the
+ *          current node, which can be read without restoring the game.\n
+ *          Restoring creates the nodes directly from the snapshot and replays them once to the current node,
+ *          instead of parsing a sgf file. The file is memory-mapped.\n
+ *          Other variations and other properties than moves, setup stones, player to move, comments and the game
+ *          information (players, game name, date, result, handicap, komi) are not stored.
+ *
+ * Usage Example:
+   \code{.cpp}
+     GameSnapshot::convertSgf("game.sgf", "game.ags");
+
+     GameSnapshot snapshot;
+     if (snapshot.open("game.ags")) {
+         const SgNode* current;
+         SgNode* root = snapshot.createGameTree(current);
+         ...
+     }
+   \endcode
+ */
+class GameSnapshot {
+public:
+    GameSnapshot();
+
+    /**
+     * @brief       Writes a snapshot of a game.
+     * @param[in]   current         current node of the game, the stored line starts at the root of its tree
+     * @param[in]   board           board at the current node
+     * @param[in]   game_finished   whether the game has ended, see Game::hasEnded()
+     * @param[in]   snapshot_file   path of the snapshot file
+     * @returns     false if the file could not be written, true otherwise
+     */
+    static bool write(const SgNode& current, const GoBoard& board, bool game_finished, const string& snapshot_file);
+
+    /**
+     * @brief       Converts the first game of a sgf file into a snapshot, with the end of the main line as
+     *              current node.
+     * @returns     false if the sgf file could not be read or the snapshot could not be written, true otherwise
+     */
+    static bool convertSgf(const string& sgf_file, const string& snapshot_file);
+
+    /**
+     * @brief       Converts a snapshot into a sgf file.
+     * @returns     false if the snapshot could not be read or the sgf file could not be written, true otherwise
+     */
+    static bool convertToSgf(const string& snapshot_file, const string& sgf_file);
+
+    /**
+     * @brief       Opens a snapshot file. A previously opened snapshot is closed.
+     * @returns     false if the file could not be opened or is no valid snapshot of this version, true otherwise
+     */
+    bool open(const string& snapshot_file);
+
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief       Creates the game tree stored in the snapshot.
+     * @param[out]  current     the current node of the game, a node of the returned tree
+     * @returns     Root of the new tree, the caller takes ownership.
+     */
+    SgNode* createGameTree(const SgNode*& current) const;
+
+    int boardSize() const;
+
+    /**
+     * @returns     Rules of the game, including the handicap.
+     */
+    GoRules rules() const;
+
+    bool gameFinished() const;
+
+    /**
+     * @returns     Number of nodes from the root to the current node, 0 if the root is the current node.
+     */
+    int currentNodeDepth() const;
+
+    /**
+     * @returns     Stones of a color on the board at the current node.
+     */
+    SgPointSet stones(SgBlackWhite color) const;
+
+    /**
+     * @returns     Number of captured stones of a color at the current node, see GoBoard::NumPrisoners().
+     */
+    int prisoners(SgBlackWhite color) const;
+
+private:
+    // Not implemented
+    GameSnapshot(const GameSnapshot&);
+    GameSnapshot& operator=(const GameSnapshot&);
+
+private:
+    // parts of the snapshot file, see GameSnapshot.cpp for the file format
+    struct SnapshotHeader;
+    struct SetupEntry;
+    struct TextEntry;
+
+    /**
+     * @brief       Sets the pointers to the parts of the mapped file.
+     * @returns     false if the mapped file is no valid snapshot
+     */
+    bool mapSections();
+
+    SgMappedFile _file;
+
+    // pointers into the mapped file
+    const SnapshotHeader* _header;
+    const SetupEntry*     _setups;
+    const TextEntry*      _texts;
+    const uint16_t*       _moves;
+    const uint16_t*       _setup_points;
+    const uint16_t*       _stones;
+    const char*           _text;
+};
+
+}
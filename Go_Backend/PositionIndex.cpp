@@ -0,0 +1,474 @@
+#include "PositionIndex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "GoBoardUpdater.h"
+#include "SgBoardConst.h"
+#include "SgException.h"
+#include "SgMappedGameReader.h"
+#include "SgNode.h"
+
+namespace Go_Backend {
+
+// Index file format, all values in native byte order:
+//   IndexHeader
+//   uint64_t   keys[num_keys]                  sorted position keys
+//   uint32_t   first_posting[num_keys + 1]     postings of keys[i] are [first_posting[i], first_posting[i + 1])
+//   Posting    postings[num_postings]          ordered by game id and move number for each key
+//   GameEntry  games[num_games]
+//   uint32_t   name_offsets[num_files + 1]     file name i is names[name_offsets[i]..name_offsets[i + 1])
+//   char       names[]                         file names relative to the indexed directory
+struct PositionIndex::IndexHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t zobrist_check; // detects index files that were written with different Zobrist hash codes
+    uint32_t num_keys;
+    uint32_t num_postings;
+    uint32_t num_games;
+    uint32_t num_files;
+};
+
+struct PositionIndex::Posting {
+    uint32_t game_id;
+    uint16_t move_number;
+    int16_t  next_move; // in the normalized orientation of the position
+};
+
+struct PositionIndex::GameEntry {
+    uint32_t file;
+    uint32_t number_in_file;
+};
+
+namespace {
+const char     INDEX_MAGIC[4] = { 'A', 'G', 'P', 'I' };
+const uint32_t INDEX_VERSION  = 1;
+
+/**
+ * Zobrist codes of GoBoard::GetHashCode() as 64 bit integers.
+ * Created once before any worker thread starts, so that the threads don't touch the lazily initialized statics of SgHash.
+ */
+class ZobristCodes {
+public:
+    ZobristCodes() {
+        for (int i = 0; i < NUM_CODES; ++i)
+            _codes[i] = toInteger(SgHashUtil::GetZobrist<64>(i));
+        for (int size = 0; size <= SG_MAX_SIZE; ++size)
+            _size_codes[size] = toInteger(SgHashCode(static_cast<unsigned int>(size)));
+    }
+
+    // same index as in GoBoard::HashCode::XorStone
+    uint64_t stone(SgPoint p, SgBlackWhite c) const { return _codes[p + c * SG_MAXPOINT]; }
+
+    // same index as in GoBoard::HashCode::GetInclToPlay
+    uint64_t toPlay(SgBlackWhite c) const { return _codes[c + 1]; }
+
+    uint64_t size(int size) const { return _size_codes[size]; }
+
+private:
+    static uint64_t toInteger(const SgHashCode& code) {
+        // Code1() holds the lower, Code2() the upper 32 bits
+        return (static_cast<uint64_t>(code.Code2()) << 32) | code.Code1();
+    }
+
+    static const int NUM_CODES = 2 * SG_MAXPOINT + 1;
+
+    uint64_t _codes[NUM_CODES];
+    uint64_t _size_codes[SG_MAX_SIZE + 1];
+};
+
+/**
+ * Hash codes of a position in all 8 orientations, updated incrementally while following a game.
+ */
+class SymmetricKeys {
+public:
+    explicit SymmetricKeys(const ZobristCodes& codes)
+        : _codes(codes),
+          _size(GO_DEFAULT_SIZE)
+    {
+        std::fill(_keys, _keys + 8, 0);
+    }
+
+    void reset(const GoBoard& board) {
+        _size = board.Size();
+        std::fill(_keys, _keys + 8, 0);
+        for (SgBWIterator color; color; ++color)
+            for (SgSetIterator it(board.All(*color)); it; ++it)
+                toggleStone(*it, *color);
+    }
+
+    void toggleStone(SgPoint p, SgBlackWhite c) {
+        for (int rotation = 0; rotation < 8; ++rotation)
+            _keys[rotation] ^= _codes.stone(SgPointUtil::Rotate(rotation, p, _size), c);
+    }
+
+    uint64_t normalized(SgBlackWhite to_play, int& rotation) const {
+        rotation = 0;
+        for (int r = 1; r < 8; ++r) {
+            if (_keys[r] < _keys[rotation])
+                rotation = r;
+        }
+        return _keys[rotation] ^ _codes.toPlay(to_play) ^ _codes.size(_size);
+    }
+
+private:
+    const ZobristCodes& _codes;
+    int _size;
+    uint64_t _keys[8];
+};
+
+struct BuildEntry {
+    uint64_t key;
+    uint32_t file;
+    uint32_t number_in_file;
+    uint16_t move_number;
+    int16_t  next_move;
+};
+
+bool hasSetup(const SgNode* node) {
+    return node->HasProp(SG_PROP_ADD_BLACK) || node->HasProp(SG_PROP_ADD_WHITE) || node->HasProp(SG_PROP_ADD_EMPTY);
+}
+
+/**
+ * Adds an entry for every position in the main line of the game to entries.
+ */
+void indexGame(const SgNode* root, uint32_t file, uint32_t number_in_file, GoBoard& board, SymmetricKeys& keys,
+               std::vector<BuildEntry>& entries) {
+    int size = GO_DEFAULT_SIZE;
+    if (!root->GetIntProp(SG_PROP_SIZE, &size) || size < SG_MIN_SIZE || size > SG_MAX_SIZE)
+        size = GO_DEFAULT_SIZE;
+    board.Init(size);
+    keys.reset(board);
+
+    bool has_pending = false;
+    int pending_rotation = 0;
+    BuildEntry pending;
+    for (const SgNode* node = root; node; node = node->LeftMostSon()) {
+        bool setup = hasSetup(node);
+        SgMove move = SG_NULLMOVE;
+        if (node->HasProp(SG_PROP_MOVE))
+            move = static_cast<SgPropMove*>(node->Get(SG_PROP_MOVE))->Value();
+
+        // nodes without moves or setups don't change the position
+        if (node != root && !setup && move == SG_NULLMOVE)
+            continue;
+
+        if (has_pending) {
+            if (!setup && move != SG_NULLMOVE)
+                pending.next_move = static_cast<int16_t>(SgPointUtil::Rotate(pending_rotation, move, size));
+            entries.push_back(pending);
+        }
+
+        int move_number = board.MoveNumber();
+        GoBoardUpdater::UpdateNode(node, board);
+        if (setup || board.LastMoveInfo(GO_MOVEFLAG_SUICIDE)) {
+            keys.reset(board);
+        }
+        else if (board.MoveNumber() != move_number && move != SG_PASS) {
+            keys.toggleStone(move, board.Opponent());
+            const GoPointList& captured = board.CapturedStones();
+            for (auto it = GoPointList::Iterator(captured); it; ++it)
+                keys.toggleStone(*it, board.ToPlay());
+        }
+
+        pending.key            = keys.normalized(board.ToPlay(), pending_rotation);
+        pending.file           = file;
+        pending.number_in_file = number_in_file;
+        pending.move_number    = static_cast<uint16_t>(std::min(board.MoveNumber(), 0xffff));
+        pending.next_move      = SG_NULLMOVE;
+        has_pending = true;
+    }
+    if (has_pending)
+        entries.push_back(pending);
+}
+
+/**
+ * Adds the entries of all games in the file.
+ * @returns     number of games in the file
+ */
+uint32_t indexFile(const string& path, uint32_t file, GoBoard& board, SymmetricKeys& keys,
+                   std::vector<BuildEntry>& entries) {
+    SgMappedFile mapped;
+    if (!mapped.Open(path))
+        return 0;
+
+    SgMappedGameReader reader(mapped);
+    uint32_t num_games = 0;
+    while (SgNode* root = reader.ReadMainLine()) {
+        try {
+            indexGame(root, file, num_games, board, keys, entries);
+        }
+        catch (const SgException&) {
+            // skip broken games, but keep the game numbers of the file intact
+        }
+        root->DeleteTree();
+        ++num_games;
+    }
+    return num_games;
+}
+
+bool compareEntries(const BuildEntry& lhs, const BuildEntry& rhs) {
+    if (lhs.key != rhs.key)
+        return lhs.key < rhs.key;
+    if (lhs.file != rhs.file)
+        return lhs.file < rhs.file;
+    if (lhs.number_in_file != rhs.number_in_file)
+        return lhs.number_in_file < rhs.number_in_file;
+    return lhs.move_number < rhs.move_number;
+}
+
+template<typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    if (!values.empty())
+        out.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(T));
+}
+
+} // namespace
+
+PositionIndex::PositionIndex()
+    : _header(nullptr),
+      _keys(nullptr),
+      _first_posting(nullptr),
+      _postings(nullptr),
+      _games(nullptr),
+      _name_offsets(nullptr),
+      _names(nullptr)
+{}
+
+bool PositionIndex::build(const string& sgf_directory, const string& index_file, int num_threads) {
+    namespace fs = boost::filesystem;
+
+    // collect all sgf files, sorted to get the same game ids on every build
+    std::vector<string> files;
+    try {
+        fs::path directory(sgf_directory);
+        if (!fs::is_directory(directory))
+            return false;
+        auto prefix_length = directory.generic_string().size();
+        for (fs::recursive_directory_iterator it(directory), end; it != end; ++it) {
+            string extension = it->path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (fs::is_regular_file(it->status()) && extension == ".sgf")
+                files.push_back(it->path().generic_string().substr(prefix_length + 1));
+        }
+    }
+    catch (const fs::filesystem_error&) {
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    if (num_threads <= 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // SgBoardConst creates its tables lazily, which is not thread-safe
+    for (int size = SG_MIN_SIZE; size <= SG_MAX_SIZE; ++size)
+        SgBoardConst board_const(size);
+    const ZobristCodes codes;
+
+    std::vector<uint32_t> games_per_file(files.size(), 0);
+    std::vector<std::vector<BuildEntry>> thread_entries(num_threads);
+    std::atomic<size_t> next_file(0);
+
+    auto worker = [&](int thread_id) {
+        GoBoard board;
+        SymmetricKeys keys(codes);
+        for (size_t file = next_file++; file < files.size(); file = next_file++) {
+            string path = sgf_directory + "/" + files[file];
+            games_per_file[file] = indexFile(path, static_cast<uint32_t>(file), board, keys, thread_entries[thread_id]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i)
+        threads.push_back(std::thread(worker, i));
+    for (auto& thread : threads)
+        thread.join();
+
+    // merge
+    std::vector<BuildEntry> entries;
+    for (auto& part : thread_entries) {
+        entries.insert(entries.end(), part.begin(), part.end());
+        std::vector<BuildEntry>().swap(part);
+    }
+    std::sort(entries.begin(), entries.end(), compareEntries);
+
+    std::vector<GameEntry> games;
+    std::vector<uint32_t> first_game(files.size(), 0);
+    for (size_t file = 0; file < files.size(); ++file) {
+        first_game[file] = static_cast<uint32_t>(games.size());
+        for (uint32_t number = 0; number < games_per_file[file]; ++number) {
+            GameEntry game = { static_cast<uint32_t>(file), number };
+            games.push_back(game);
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> first_posting;
+    std::vector<Posting>  postings;
+    postings.reserve(entries.size());
+    for (auto& entry : entries) {
+        if (keys.empty() || keys.back() != entry.key) {
+            keys.push_back(entry.key);
+            first_posting.push_back(static_cast<uint32_t>(postings.size()));
+        }
+        Posting posting = { first_game[entry.file] + entry.number_in_file, entry.move_number, entry.next_move };
+        postings.push_back(posting);
+    }
+    first_posting.push_back(static_cast<uint32_t>(postings.size()));
+
+    std::vector<uint32_t> name_offsets;
+    string names;
+    for (auto& file : files) {
+        name_offsets.push_back(static_cast<uint32_t>(names.size()));
+        names += file;
+    }
+    name_offsets.push_back(static_cast<uint32_t>(names.size()));
+
+    IndexHeader header;
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version       = INDEX_VERSION;
+    header.zobrist_check = codes.stone(SgPointUtil::Pt(1, 1), SG_BLACK);
+    header.num_keys      = static_cast<uint32_t>(keys.size());
+    header.num_postings  = static_cast<uint32_t>(postings.size());
+    header.num_games     = static_cast<uint32_t>(games.size());
+    header.num_files     = static_cast<uint32_t>(files.size());
+
+    std::ofstream out(index_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(out, keys);
+    writeArray(out, first_posting);
+    writeArray(out, postings);
+    writeArray(out, games);
+    writeArray(out, name_offsets);
+    out.write(names.data(), names.size());
+    return out.good();
+}
+
+bool PositionIndex::open(const string& index_file) {
+    close();
+    if (!_file.Open(index_file))
+        return false;
+
+    if (!mapSections()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool PositionIndex::mapSections() {
+    const char* data = _file.Begin();
+    size_t size = _file.Size();
+    if (size < sizeof(IndexHeader))
+        return false;
+
+    auto header = reinterpret_cast<const IndexHeader*>(data);
+    if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->version != INDEX_VERSION
+        || header->zobrist_check != ZobristCodes().stone(SgPointUtil::Pt(1, 1), SG_BLACK))
+        return false;
+
+    size_t offset = sizeof(IndexHeader);
+    size_t names_offset = offset
+                          + header->num_keys * sizeof(uint64_t)
+                          + (header->num_keys + 1) * sizeof(uint32_t)
+                          + header->num_postings * sizeof(Posting)
+                          + header->num_games * sizeof(GameEntry)
+                          + (header->num_files + 1) * sizeof(uint32_t);
+    if (size < names_offset)
+        return false;
+
+    _keys = reinterpret_cast<const uint64_t*>(data + offset);
+    offset += header->num_keys * sizeof(uint64_t);
+    _first_posting = reinterpret_cast<const uint32_t*>(data + offset);
+    offset += (header->num_keys + 1) * sizeof(uint32_t);
+    _postings = reinterpret_cast<const Posting*>(data + offset);
+    offset += header->num_postings * sizeof(Posting);
+    _games = reinterpret_cast<const GameEntry*>(data + offset);
+    offset += header->num_games * sizeof(GameEntry);
+    _name_offsets = reinterpret_cast<const uint32_t*>(data + offset);
+    _names = data + names_offset;
+
+    if (size - names_offset < _name_offsets[header->num_files])
+        return false;
+
+    _header = header;
+    return true;
+}
+
+void PositionIndex::close() {
+    _header        = nullptr;
+    _keys          = nullptr;
+    _first_posting = nullptr;
+    _postings      = nullptr;
+    _games         = nullptr;
+    _name_offsets  = nullptr;
+    _names         = nullptr;
+    _file.Close();
+}
+
+bool PositionIndex::isOpen() const {
+    return _header != nullptr;
+}
+
+std::vector<PositionOccurrence> PositionIndex::find(const GoBoard& board) const {
+    std::vector<PositionOccurrence> occurrences;
+    if (!isOpen())
+        return occurrences;
+
+    int rotation;
+    auto key = positionKey(board, rotation);
+    auto keys_end = _keys + _header->num_keys;
+    auto it = std::lower_bound(_keys, keys_end, key);
+    if (it == keys_end || *it != key)
+        return occurrences;
+
+    // transforms the moves back from the normalized orientation to the one of the board
+    int inverse_rotation = SgPointUtil::InvRotation(rotation);
+    auto index = it - _keys;
+    for (auto i = _first_posting[index]; i < _first_posting[index + 1]; ++i) {
+        const Posting& posting = _postings[i];
+        PositionOccurrence occurrence;
+        occurrence.game_id     = posting.game_id;
+        occurrence.move_number = posting.move_number;
+        occurrence.next_move   = posting.next_move;
+        if (occurrence.next_move != SG_NULLMOVE)
+            occurrence.next_move = SgPointUtil::Rotate(inverse_rotation, occurrence.next_move, board.Size());
+        occurrences.push_back(occurrence);
+    }
+    return occurrences;
+}
+
+string PositionIndex::gameFile(unsigned int game_id) const {
+    assert(isOpen() && game_id < _header->num_games);
+    auto file = _games[game_id].file;
+    return string(_names + _name_offsets[file], _names + _name_offsets[file + 1]);
+}
+
+int PositionIndex::gameNumberInFile(unsigned int game_id) const {
+    assert(isOpen() && game_id < _header->num_games);
+    return _games[game_id].number_in_file;
+}
+
+unsigned int PositionIndex::numGames() const {
+    return isOpen() ? _header->num_games : 0;
+}
+
+unsigned int PositionIndex::numPositions() const {
+    return isOpen() ? _header->num_keys : 0;
+}
+
+uint64_t PositionIndex::positionKey(const GoBoard& board, int& rotation) {
+    ZobristCodes codes;
+    SymmetricKeys keys(codes);
+    keys.reset(board);
+    return keys.normalized(board.ToPlay(), rotation);
+}
+
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GoBoard.h"
+#include "SgMappedFile.h"
+
+namespace Go_Backend {
+using std::string;
+
+/**
+ * @brief   One occurrence of a position in a game of an indexed sgf collection.
+ */
+struct PositionOccurrence {
+    /**
+     * Id of the game, see PositionIndex::gameFile() and PositionIndex::gameNumberInFile().
+     */
+    unsigned int game_id;
+
+    /**
+     * Number of moves played in the game before the position occurred.
+     */
+    int move_number;
+
+    /**
+     * Move that was played next in the game, already transformed to the orientation of the queried board.
+     * SG_NULLMOVE if the game ended in this position or continued with a setup.
+     */
+    SgMove next_move;
+};
+
+/**
+ * @brief   On-disk index over a directory of sgf files, that maps board positions to the games they occurred in.\n
+ *          Positions are keyed by their Zobrist hash (using the same hash codes as GoBoard::GetHashCode()) combined with
+ *          the player to move and the board size. The key is normalized over all 8 board symmetries, so rotated or
+ *          mirrored positions are found as well.\n
+ *          The index file is built once with build() and then memory-mapped by open(), so opening is instant
+ *          and queries are a binary search over the keys.
+ *
+ * Usage Example:
+   \code{.cpp}
+     PositionIndex::build("path/to/sgfs", "games.idx");
+
+     PositionIndex index;
+     if (index.open("games.idx")) {
+         for (auto& occurrence : index.find(game.getBoard()))
+             std::cout << index.gameFile(occurrence.game_id) << " " << occurrence.move_number << std::endl;
+     }
+   \endcode
+ */
+class PositionIndex {
+public:
+    PositionIndex();
+
+    /**
+     * @brief       Indexes all positions in the main lines of all games in all sgf files in a directory and its
+     *              subdirectories. The files are read in parallel. Files that cannot be read are skipped.
+     * @param[in]   sgf_directory   directory with the sgf files
+     * @param[in]   index_file      path of the index file to write
+     * @param[in]   num_threads     number of threads to use, 0 uses one thread per core
+     * @returns     false if the directory doesn't exist or the index file could not be written, true otherwise
+     */
+    static bool build(const string& sgf_directory, const string& index_file, int num_threads = 0);
+
+    /**
+     * @brief       Opens an index file written by build(). A previously opened index is closed.
+     * @returns     false if the file could not be opened or is no valid index file, true otherwise
+     */
+    bool open(const string& index_file);
+
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief       Finds all occurrences of the position on the board, including the player to move.
+     * @returns     Occurrences ordered by game id and move number, empty if no index is open.
+     */
+    std::vector<PositionOccurrence> find(const GoBoard& board) const;
+
+    /**
+     * @returns     Path of the sgf file that contains the game, relative to the indexed directory.
+     */
+    string gameFile(unsigned int game_id) const;
+
+    /**
+     * @returns     Index of the game inside its sgf file, 0 for the first game.
+     */
+    int gameNumberInFile(unsigned int game_id) const;
+
+    unsigned int numGames() const;
+
+    /**
+     * @returns     Number of distinct positions in the index.
+     */
+    unsigned int numPositions() const;
+
+    /**
+     * @brief       Computes the symmetry normalized key of a position.
+     * @param[out]  rotation    rotation (see SgPointUtil::Rotate) that transforms the board into the normalized orientation
+     */
+    static uint64_t positionKey(const GoBoard& board, int& rotation);
+
+private:
+    // Not implemented
+    PositionIndex(const PositionIndex&);
+    PositionIndex& operator=(const PositionIndex&);
+
+private:
+    // parts of the index file, see PositionIndex.cpp for the file format
+    struct IndexHeader;
+    struct Posting;
+    struct GameEntry;
+
+    /**
+     * @brief       Sets the pointers to the parts of the mapped file.
+     * @returns     false if the mapped file is no valid index file
+     */
+    bool mapSections();
+
+    SgMappedFile _file;
+
+    // pointers into the mapped file
+    const IndexHeader* _header;
+    const uint64_t*    _keys;
+    const uint32_t*    _first_posting;
+    const Posting*     _postings;
+    const GameEntry*   _games;
+    const uint32_t*    _name_offsets;
+    const char*        _names;
+};
+
+}
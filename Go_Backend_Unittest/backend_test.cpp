@@ -2,20 +2,31 @@
 
 // augmented go
 #include "Game.hpp"
+#include "GameGtpEngine.hpp"
 
 // fuego
 #include "GoInit.h"
 #include "SgInit.h"
 #include "GoSetupUtil.h"
+#include "SgGameReader.h"
+#include "SgGameWriter.h"
+#include "SgMappedGameReader.h"
+#include "SgNode.h"
 
 // other libraries
+#include <cstring>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 namespace Go_BackendGameTest
 {
     using Go_Backend::Game;
+    using Go_Backend::GameGtpEngine;
+    using Go_Backend::GameSnapshot;
+    using Go_Backend::PositionIndex;
     using Go_Backend::UpdateResult;
     using SgPointUtil::Pt;
     using std::string;
@@ -1335,6 +1346,50 @@ namespace Go_BackendGameTest
             Assert::IsTrue(expected_setup == setup);
         }
 
+        TEST_METHOD(mapped_reader_creates_same_trees_as_stream_reader) {
+            // escaped brackets and backslashes, an escaped line break and a variation
+            const string sgf = "(;FF[4]SZ[9]KM[6.5]\n"
+                               "C[first line\n"
+                               "second line with \\] and \\\\ and a \\\n"
+                               "joined line]\n"
+                               ";B[cc]C[[x\\]]LB[dd:a][ee:b]\n"
+                               "(;W[gg];B[cg])\n"
+                               "(;W[gc]))\n";
+            string crlf_sgf;
+            for (auto c : sgf) {
+                if (c == '\n')
+                    crlf_sgf += '\r';
+                crlf_sgf += c;
+            }
+
+            auto write_tree = [](const SgNode* root) -> string {
+                Assert::IsNotNull(root);
+                std::ostringstream out;
+                SgGameWriter writer(out);
+                writer.WriteGame(*root, true, 0, 1, 19);
+                return out.str();
+            };
+
+            // on Windows the stream reader gets the text from a text mode stream, without the carriage returns
+            std::istringstream in(sgf);
+            SgGameReader stream_reader(in);
+            SgNode* expected = stream_reader.ReadGame();
+            const string expected_sgf = write_tree(expected);
+            Assert::AreNotEqual(string::npos, expected_sgf.find("(;W[gc])"));
+
+            SgMappedGameReader reader(sgf.data(), sgf.data() + sgf.size());
+            SgNode* root = reader.ReadGame();
+            Assert::AreEqual(expected_sgf, write_tree(root));
+            root->DeleteTree();
+
+            SgMappedGameReader crlf_reader(crlf_sgf.data(), crlf_sgf.data() + crlf_sgf.size());
+            root = crlf_reader.ReadGame();
+            Assert::AreEqual(expected_sgf, write_tree(root));
+            root->DeleteTree();
+
+            expected->DeleteTree();
+        }
+
     };
 
     TEST_CLASS(PlayMoveTest) {
@@ -1572,4 +1627,230 @@ namespace Go_BackendGameTest
             Assert::IsTrue(GoSetupUtil::CurrentPosSetup(go_game.getBoard()) == first_variation);
         }
     };
+
+    TEST_CLASS(PositionIndexTest) {
+        TEST_METHOD(finds_positions_of_indexed_games) {
+            string directory = "position_index_test";
+            boost::filesystem::create_directories(directory + "/more");
+
+            std::ofstream file(directory + "/first.sgf");
+            file << "(;SZ[9];B[cc];W[gg];B[cg])";
+            file.close();
+            // the same opening, mirrored
+            file.open(directory + "/more/second.SGF");
+            file << "(;SZ[9];B[gc];W[cg])";
+            file.close();
+
+            Assert::IsTrue(PositionIndex::build(directory, "position_index_test.idx", 2));
+
+            PositionIndex index;
+            Assert::IsTrue(index.open("position_index_test.idx"));
+            Assert::AreEqual(2u, index.numGames());
+            Assert::AreEqual(string("first.sgf"), index.gameFile(0));
+            Assert::AreEqual(string("more/second.SGF"), index.gameFile(1));
+
+            Game go_game;
+            go_game.init(9);
+            go_game.playMove(Pt(3, 7));
+
+            // both games continued with the same move, relative to our board
+            auto occurrences = go_game.findPosition(index);
+            Assert::AreEqual(size_t(2), occurrences.size());
+            Assert::AreEqual(0u, occurrences[0].game_id);
+            Assert::AreEqual(1u, occurrences[1].game_id);
+            Assert::AreEqual(1, occurrences[0].move_number);
+            Assert::AreEqual(Pt(7, 3), occurrences[0].next_move);
+            Assert::AreEqual(Pt(7, 3), occurrences[1].next_move);
+
+            // last position of the second game
+            go_game.playMove(Pt(7, 3));
+            occurrences = go_game.findPosition(index);
+            Assert::AreEqual(size_t(2), occurrences.size());
+            Assert::AreEqual(SG_NULLMOVE, occurrences[1].next_move);
+
+            // a white stone on the same point is a different position
+            go_game.init(9);
+            go_game.pass();
+            go_game.playMove(Pt(3, 7));
+            Assert::IsTrue(go_game.findPosition(index).empty());
+        }
+    };
+
+    TEST_CLASS(GameJournalTest) {
+        TEST_METHOD(recovers_game_from_journal) {
+            string journal_file = "journal_test.agj";
+            string sgf_file = "journal_test.sgf";
+            GoSetup expected_setup;
+            int expected_move_number = 0;
+
+            {
+                GoSetup setup;
+                setup.AddWhite(Pt(5, 5));
+
+                Game go_game;
+                Assert::IsTrue(go_game.startJournal(journal_file, sgf_file, 3)); // compacts after every third change
+                go_game.init(9, setup);
+                go_game.playMove(Pt(3, 3));
+                go_game.playMove(Pt(7, 7));
+
+                // first move after the compaction is played by the scanner
+                setup.AddBlack(Pt(3, 3));
+                setup.AddWhite(Pt(7, 7));
+                setup.AddBlack(Pt(3, 7));
+                Assert::IsTrue(go_game.update(setup) == UpdateResult::Legal);
+                go_game.pass();
+
+                go_game.navigateHistory(SgNode::Direction::PREVIOUS);
+                go_game.navigateHistory(SgNode::Direction::PREVIOUS);
+
+                expected_setup = GoSetupUtil::CurrentPosSetup(go_game.getBoard());
+                expected_move_number = go_game.getBoard().MoveNumber();
+
+                // the game is destroyed without removing the journal, just like after a crash
+            }
+
+            // a partly written record at the end is ignored
+            std::ofstream journal(journal_file, std::ios::binary | std::ios::app);
+            journal << '\x01';
+            journal.close();
+
+            Game recovered_game;
+            Assert::IsTrue(recovered_game.recoverFromJournal(journal_file, sgf_file));
+            Assert::IsTrue(GoSetupUtil::CurrentPosSetup(recovered_game.getBoard()) == expected_setup);
+            Assert::AreEqual(expected_move_number, recovered_game.getBoard().MoveNumber());
+
+            // the moves after the current one are recovered as well
+            recovered_game.navigateHistory(SgNode::Direction::NEXT);
+            recovered_game.navigateHistory(SgNode::Direction::NEXT);
+            Assert::IsTrue(recovered_game.getBoard().GetLastMove() == SG_PASS);
+            Assert::IsFalse(recovered_game.canNavigateHistory(SgNode::Direction::NEXT));
+
+            // stopping the journal normally removes the files
+            Assert::IsTrue(recovered_game.startJournal(journal_file, sgf_file));
+            recovered_game.stopJournal(true);
+            Assert::IsFalse(boost::filesystem::exists(journal_file));
+            Assert::IsFalse(boost::filesystem::exists(sgf_file));
+            Assert::IsFalse(recovered_game.recoverFromJournal(journal_file, sgf_file));
+        }
+    };
+
+    TEST_CLASS(GameSnapshotTest) {
+        TEST_METHOD(restores_game_from_snapshot) {
+            GoSetup setup;
+            setup.AddBlack(Pt(4, 4));
+            setup.AddBlack(Pt(6, 6));
+
+            Game go_game;
+            go_game.init(9, setup, GoRules(0, GoKomi(0.5), false, true));
+            go_game.playMove(Pt(1, 1));
+            go_game.playMove(Pt(1, 2));
+            go_game.playMove(Pt(9, 9));
+            go_game.playMove(Pt(2, 1)); // captures
+            go_game.pass();
+            go_game.navigateHistory(SgNode::Direction::PREVIOUS);
+
+            Assert::IsTrue(go_game.saveSnapshot("snapshot_test.ags"));
+
+            Game loaded_game;
+            Assert::IsTrue(loaded_game.loadSnapshot("snapshot_test.ags"));
+            Assert::IsTrue(GoSetupUtil::CurrentPosSetup(loaded_game.getBoard()) == GoSetupUtil::CurrentPosSetup(go_game.getBoard()));
+            Assert::AreEqual(go_game.getBoard().MoveNumber(), loaded_game.getBoard().MoveNumber());
+            Assert::AreEqual(1, loaded_game.getBoard().NumPrisoners(SG_WHITE));
+            Assert::IsTrue(loaded_game.getBoard().Rules() == go_game.getBoard().Rules());
+            Assert::AreEqual(2, loaded_game.getBoard().Rules().Handicap());
+
+            // the moves after the current one are restored as well
+            loaded_game.navigateHistory(SgNode::Direction::NEXT);
+            Assert::IsTrue(loaded_game.getBoard().GetLastMove() == SG_PASS);
+            Assert::IsFalse(loaded_game.canNavigateHistory(SgNode::Direction::NEXT));
+
+            // converting to sgf and back gives the same game, with the end of the game as current position
+            Assert::IsTrue(GameSnapshot::convertToSgf("snapshot_test.ags", "snapshot_test.sgf"));
+            Assert::IsTrue(GameSnapshot::convertSgf("snapshot_test.sgf", "snapshot_test_converted.ags"));
+            Assert::IsTrue(loaded_game.loadSnapshot("snapshot_test_converted.ags"));
+            Assert::AreEqual(go_game.getBoard().MoveNumber() + 1, loaded_game.getBoard().MoveNumber());
+            Assert::AreEqual(2, loaded_game.getBoard().Rules().Handicap());
+            Assert::IsTrue(loaded_game.getBoard().Rules().Komi() == GoKomi(0.5));
+
+            Assert::IsFalse(loaded_game.loadSnapshot("snapshot_test.sgf"));
+        }
+
+        TEST_METHOD(rejects_points_outside_of_the_board) {
+            Game go_game;
+            go_game.init(9, GoSetup(), GoRules(0, GoKomi(0.5), false, true));
+            go_game.playMove(Pt(7, 8));
+            Assert::IsTrue(go_game.saveSnapshot("snapshot_test_off_board.ags"));
+
+            // move the stone and its move one column to the right, off the 9x9 board
+            std::string data;
+            {
+                std::ifstream in("snapshot_test_off_board.ags", std::ios::binary);
+                std::ostringstream buffer;
+                buffer << in.rdbuf();
+                data = buffer.str();
+            }
+            const uint16_t on_board = static_cast<uint16_t>(Pt(7, 8));
+            const uint16_t off_board = static_cast<uint16_t>(Pt(10, 8));
+            int replaced = 0;
+            for (size_t i = 0; i + sizeof(uint16_t) <= data.size(); i += sizeof(uint16_t)) {
+                if (std::memcmp(&data[i], &on_board, sizeof(uint16_t)) == 0) {
+                    std::memcpy(&data[i], &off_board, sizeof(uint16_t));
+                    ++replaced;
+                }
+            }
+            Assert::AreEqual(2, replaced);
+            {
+                std::ofstream out("snapshot_test_off_board.ags", std::ios::binary);
+                out << data;
+            }
+
+            Game loaded_game;
+            Assert::IsFalse(loaded_game.loadSnapshot("snapshot_test_off_board.ags"));
+        }
+    };
+
+    TEST_CLASS(GameGtpEngineTest) {
+        TEST_METHOD(answers_commands_about_the_scanned_game) {
+            GameGtpEngine engine(1);
+            std::ostringstream log;
+            Assert::AreEqual(string("black\nwhite"), engine.ExecuteCommand("ag_setup", log));
+
+            GoSetup setup;
+            setup.AddBlack(Pt(3, 3));
+            Assert::IsTrue(engine.updateFromScan(setup, 9) == UpdateResult::Legal);
+            setup.AddWhite(Pt(7, 7));
+            Assert::IsTrue(engine.updateFromScan(setup, 9) == UpdateResult::Legal);
+            Assert::AreEqual(string("B C3\nW G7\n"), engine.ExecuteCommand("ag_moves", log));
+
+            // two added stones are illegal and show up as differences, the scanned setup is kept anyway
+            GoSetup illegal_setup = setup;
+            illegal_setup.AddBlack(Pt(5, 5));
+            illegal_setup.AddBlack(Pt(5, 6));
+            Assert::IsTrue(engine.updateFromScan(illegal_setup, 9) == UpdateResult::Illegal);
+            Assert::AreEqual(string("E5 E6"), engine.ExecuteCommand("ag_differences", log));
+            Assert::AreEqual(string("black C3\nwhite G7"), engine.ExecuteCommand("ag_setup", log));
+            Assert::AreEqual(string("black C3 E5 E6\nwhite G7"), engine.ExecuteCommand("ag_scan_setup", log));
+            Assert::AreNotEqual(string::npos, engine.ExecuteCommand("ag_sgf", log).find("W[gc]"));
+
+            // long commands in the background
+            Assert::AreEqual(string("1"), engine.ExecuteCommand("ag_async ag_estimate_score 100", log));
+            Assert::AreNotEqual(string::npos, engine.ExecuteCommand("ag_job_wait 1", log).find("(100 playouts)"));
+            Assert::ExpectException<GtpFailure>([&] { engine.ExecuteCommand("ag_job_status 1", log); }); // result was fetched
+
+            Assert::AreEqual(string("2"), engine.ExecuteCommand("ag_async ag_ownership 100000000", log));
+            Assert::AreNotEqual(string::npos, engine.ExecuteCommand("ag_status", log).find("active_jobs 1"));
+            Assert::ExpectException<GtpFailure>([&] { engine.ExecuteCommand("ag_job_result 2", log); }); // still running
+            engine.ExecuteCommand("ag_job_cancel 2", log);
+            // canceled long commands return what they have so far, or fail if they had no playout yet
+            try {
+                engine.ExecuteCommand("ag_job_wait 2", log);
+            }
+            catch (const GtpFailure&) {
+                // the response of a failed command is only written to the log
+                Assert::AreNotEqual(string::npos, log.str().find("? canceled"));
+            }
+
+            Assert::ExpectException<GtpFailure>([&] { engine.ExecuteCommand("ag_async showboard", log); });
+        }
+    };
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <thread>
+
+namespace Go_Benchmark {
+
+SuiteOptions::SuiteOptions()
+    : board_size(9),
+      max_threads(std::max(1u, std::thread::hardware_concurrency())),
+      seconds(1),
+      filter()
+{}
+
+bool SuiteOptions::isSelected(const string& name) const {
+    return name.find(filter) != string::npos;
+}
+
+Result::Result(const string& name)
+    : _name(name)
+{}
+
+Result& Result::addValue(const string& key, double value) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(std::abs(value) < 10 ? 4 : 1) << value;
+    _values.push_back(std::make_pair(key, out.str()));
+    return *this;
+}
+
+Result& Result::addCount(const string& key, long long count) {
+    std::ostringstream out;
+    out << count;
+    _values.push_back(std::make_pair(key, out.str()));
+    return *this;
+}
+
+Result& Result::addFlag(const string& key, bool flag) {
+    _values.push_back(std::make_pair(key, string(flag ? "true" : "false")));
+    return *this;
+}
+
+void Result::write(std::ostream& out) const {
+    out << "    { \"name\": \"" << _name << '"';
+    for (auto iter = _values.begin(); iter != _values.end(); ++iter)
+        out << ", \"" << iter->first << "\": " << iter->second;
+    out << " }";
+}
+
+void writeResults(std::ostream& out, const string& suite, const SuiteOptions& options,
+                  const std::vector<Result>& results, bool passed) {
+    out << "{\n"
+        << "  \"suite\": \"" << suite << "\",\n"
+        << "  \"assertions\": "
+#ifdef NDEBUG
+        << "false"
+#else
+        << "true"
+#endif
+        << ",\n"
+        << "  \"compact_uct_node\": "
+#ifdef SG_UCT_COMPACT_NODE
+        << "true"
+#else
+        << "false"
+#endif
+        << ",\n"
+        << "  \"board_size\": " << options.board_size << ",\n"
+        << "  \"max_threads\": " << options.max_threads << ",\n"
+        << "  \"seconds\": " << options.seconds << ",\n"
+        << "  \"passed\": " << (passed ? "true" : "false") << ",\n"
+        << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n");
+        results[i].write(out);
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::vector<int> threadCounts(int max_threads) {
+    std::vector<int> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(std::max(1, max_threads));
+    return counts;
+}
+
+double currentTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Go_Benchmark {
+using std::string;
+
+/**
+ * @brief   Options of the benchmark suites that measure searches and data structures.
+ *          The board suite has its own options, see GoBoardCheckPerformance::BenchmarkOptions.
+ */
+struct SuiteOptions {
+    SuiteOptions();
+
+    /**
+     * @brief       Checks the filter.
+     * @returns     true if the benchmark with this name should be run
+     */
+    bool isSelected(const string& name) const;
+
+    int    board_size;  // size of the board the searches start on, default 9
+    int    max_threads; // thread counts 1, 2, 4, ... up to this number are measured, default is the number of cores
+    double seconds;     // duration of each timed search, default 1
+    string filter;      // only run benchmarks whose name contains this string, default is empty (all benchmarks)
+};
+
+/**
+ * @brief   Measured values of one benchmark run, written as a JSON object by writeResults().
+ */
+class Result {
+public:
+    explicit Result(const string& name);
+
+    Result& addValue(const string& key, double value);
+    Result& addCount(const string& key, long long count);
+    Result& addFlag(const string& key, bool flag);
+
+    void write(std::ostream& out) const;
+
+private:
+    string _name;
+    std::vector<std::pair<string, string>> _values; // keys and JSON encoded values, in the order they were added
+};
+
+/**
+ * @brief       Writes the results of a suite as a JSON object.
+ * @param[in]   passed  false if a consistency check of the suite failed
+ */
+void writeResults(std::ostream& out, const string& suite, const SuiteOptions& options,
+                  const std::vector<Result>& results, bool passed);
+
+/**
+ * @brief       Thread counts to measure: 1, 2, 4, ... and max_threads.
+ */
+std::vector<int> threadCounts(int max_threads);
+
+/**
+ * @brief       Current time of a steady clock in seconds.
+ */
+double currentTime();
+
+}
@@ -0,0 +1,405 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#include "BookBenchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "GoAutoBook.h"
+#include "SgBookBuilder.h"
+#include "SgHash.h"
+
+namespace Go_Benchmark {
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+// nodes of the book, a multi-million-node book like the ones built for 9x9
+const std::size_t NUM_NODES = 4000000;
+
+// numbers of the synthetic game of book_parallel, see SyntheticBookBuilder
+const int GAME_MOVES = 20;
+
+// simulated time of an evaluation of the children of a position, like a short search per child
+const int EVALUATION_MILLISECONDS = 20;
+
+// iterations of book_parallel: Expand() and Cover() of a line with a minimum number of expansions
+const int PARALLEL_EXPANSIONS = 200;
+const int COVER_EXPANSIONS = 8;
+const SgMove COVER_LINE[] = { 3, 5, 7 };
+
+// thread counts of book_parallel, independent of the cores because the threads mostly wait for the evaluator
+const int PARALLEL_THREADS[] = { 1, 2, 4, 8 };
+
+// values of won and lost positions of the synthetic game, the other values are in [0, 1]
+const float WIN = 1000;
+const float LOSS = -1000;
+
+// FNV-1a, the values of the synthetic game do not depend on SgRandom
+std::uint64_t hashString(const string& text) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (auto iter = text.begin(); iter != text.end(); ++iter) {
+        hash ^= static_cast<unsigned char>(*iter);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// the numbers taken by each player in sorted order, so that all move orders of a position have the same key
+string positionKey(const std::vector<SgMove>& moves) {
+    std::vector<SgMove> player_moves[2];
+    for (size_t i = 0; i < moves.size(); ++i)
+        player_moves[i % 2].push_back(moves[i]);
+    std::ostringstream key;
+    for (int player = 0; player < 2; ++player) {
+        std::sort(player_moves[player].begin(), player_moves[player].end());
+        for (auto iter = player_moves[player].begin(); iter != player_moves[player].end(); ++iter)
+            key << *iter << ',';
+        key << '|';
+    }
+    return key.str();
+}
+
+// a few positions are won or lost, the others have a value that only depends on the position
+float evaluatePosition(const string& key) {
+    std::uint64_t hash = hashString(key);
+    if (hash % 97 == 0)
+        return LOSS;
+    if (hash % 89 == 0)
+        return WIN;
+    return static_cast<float>((hash >> 11) % 10000) / 10000;
+}
+
+/**
+ * @brief       Evaluates the children of the position after the moves, waits EVALUATION_MILLISECONDS.
+ */
+void evaluateChildren(std::vector<SgMove> moves, const std::vector<SgMove>& children_to_do,
+                      std::vector<std::pair<SgMove, float>>& scores) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(EVALUATION_MILLISECONDS));
+    for (auto iter = children_to_do.begin(); iter != children_to_do.end(); ++iter) {
+        moves.push_back(*iter);
+        scores.push_back(std::make_pair(*iter, evaluatePosition(positionKey(moves))));
+        moves.pop_back();
+    }
+}
+
+/**
+ * @brief   Evaluator of a worker thread of SyntheticBookBuilder.
+ */
+class SyntheticEvaluator : public SgBookChildEvaluator {
+public:
+    explicit SyntheticEvaluator(const std::vector<SgMove>& start_moves)
+        : _start_moves(start_moves)
+    {}
+
+    void EvaluateChildren(const std::vector<SgMove>& sequence, const std::vector<SgMove>& children_to_do,
+                          std::vector<std::pair<SgMove, float>>& scores) {
+        std::vector<SgMove> moves = _start_moves;
+        moves.insert(moves.end(), sequence.begin(), sequence.end());
+        evaluateChildren(moves, children_to_do, scores);
+    }
+
+private:
+    const std::vector<SgMove> _start_moves;
+};
+
+/**
+ * @brief   Book builder of a synthetic game with transpositions and an evaluator that waits like a real one.
+ *          The players take turns to take one of the numbers 0 to GAME_MOVES - 1, a position is the set of the numbers
+ *          of each player. The book is a map in memory.
+ */
+class SyntheticBookBuilder : public SgBookBuilder {
+public:
+    SyntheticBookBuilder()
+        : _num_evaluations(0)
+    {}
+
+    float InverseEval(float eval) const {
+        return eval == WIN || eval == LOSS ? -eval : 1 - eval;
+    }
+
+    bool IsLoss(float eval) const {
+        return eval == LOSS;
+    }
+
+    float Value(const SgBookNode& node) const {
+        return node.m_value;
+    }
+
+    // a hash of all nodes, the same for identical books
+    std::uint64_t checksum() const {
+        std::ostringstream text;
+        for (auto iter = _book.begin(); iter != _book.end(); ++iter)
+            text << iter->first << ' ' << iter->second.ToString() << '\n';
+        return hashString(text.str());
+    }
+
+    std::size_t numNodes() const {
+        return _book.size();
+    }
+
+    // calls of EvaluateChildren() in the main thread
+    std::size_t numEvaluations() const {
+        return _num_evaluations;
+    }
+
+protected:
+    string MoveString(SgMove move) const {
+        std::ostringstream out;
+        out << move;
+        return out.str();
+    }
+
+    // the statistics of Expand() and Cover() are not part of the results
+    void PrintMessage(string) {}
+
+    void PlayMove(SgMove move) {
+        _moves.push_back(move);
+    }
+
+    void UndoMove(SgMove) {
+        _moves.pop_back();
+    }
+
+    bool GetNode(SgBookNode& node) const {
+        auto iter = _book.find(positionKey(_moves));
+        if (iter == _book.end())
+            return false;
+        node = iter->second;
+        return true;
+    }
+
+    void WriteNode(const SgBookNode& node) {
+        _book[positionKey(_moves)] = node;
+    }
+
+    void FlushBook() {}
+
+    void EnsureRootExists() {
+        SgBookNode node;
+        if (!GetNode(node))
+            WriteNode(SgBookNode(evaluatePosition(positionKey(_moves))));
+    }
+
+    // the moves in an order that depends on the position, the game ends when all numbers are taken
+    bool GenerateMoves(std::vector<SgMove>& moves, float& value) {
+        GetAllLegalMoves(moves);
+        if (moves.empty()) {
+            value = 0.5;
+            return true;
+        }
+        std::vector<std::pair<std::uint64_t, SgMove>> ordered;
+        for (auto iter = moves.begin(); iter != moves.end(); ++iter)
+            ordered.push_back(std::make_pair(hashString(positionKey(_moves) + MoveString(*iter)), *iter));
+        std::sort(ordered.begin(), ordered.end());
+        for (size_t i = 0; i < moves.size(); ++i)
+            moves[i] = ordered[i].second;
+        return false;
+    }
+
+    void GetAllLegalMoves(std::vector<SgMove>& moves) {
+        for (SgMove move = 0; move < GAME_MOVES; ++move) {
+            if (std::find(_moves.begin(), _moves.end(), move) == _moves.end())
+                moves.push_back(move);
+        }
+    }
+
+    void EvaluateChildren(const std::vector<SgMove>& children_to_do, std::vector<std::pair<SgMove, float>>& scores) {
+        ++_num_evaluations;
+        evaluateChildren(_moves, children_to_do, scores);
+    }
+
+    SgBookChildEvaluator* CreateChildEvaluator(std::size_t) {
+        return new SyntheticEvaluator(_moves);
+    }
+
+    void ClearAllVisited() {
+        _visited.clear();
+    }
+
+    void MarkAsVisited() {
+        _visited.insert(positionKey(_moves));
+    }
+
+    bool HasBeenVisited() {
+        return _visited.count(positionKey(_moves)) > 0;
+    }
+
+private:
+    std::map<string, SgBookNode> _book;
+    std::vector<SgMove>          _moves;
+    std::set<string>             _visited;
+    std::size_t                  _num_evaluations;
+};
+
+// the node with this index, its count is the index, so lookups can be checked
+SgBookNode node(std::size_t index) {
+    SgBookNode result(static_cast<float>(index % 1000) / 1000);
+    result.m_count = static_cast<unsigned>(index);
+    return result;
+}
+
+/**
+ * @brief       Looks up all codes in the book.
+ * @returns     true if all nodes are found with their count
+ */
+bool hasAllNodes(const GoAutoBook& book, const std::vector<SgHashCode>& codes) {
+    SgBookNode found;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        if (!book.Get(codes[i], found) || found.m_count != i)
+            return false;
+    }
+    return book.NuNodes() == codes.size();
+}
+
+// the value of a label of GoAutoBook::WriteInfo()
+long long infoValue(const GoAutoBook& book, const string& label) {
+    std::ostringstream out;
+    book.WriteInfo(out);
+    std::istringstream in(out.str());
+    string key;
+    long long value;
+    while (in >> key >> value) {
+        if (key == label)
+            return value;
+    }
+    return 0;
+}
+
+bool runBook(std::vector<Result>& results) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path("go_benchmark_book_%%%%%%%%");
+    fs::create_directories(directory);
+    const string text_file = (directory / "book.txt").string();
+    const string binary_file = (directory / "book.dat").string();
+
+    std::vector<SgHashCode> codes(NUM_NODES);
+    {
+        std::ofstream out(text_file.c_str());
+        for (size_t i = 0; i < codes.size(); ++i) {
+            codes[i] = SgHashCode::Random();
+            out << codes[i] << '\t' << node(i).ToString() << '\n';
+        }
+    }
+    // codes that are not in the book, each second lookup is a miss
+    std::vector<SgHashCode> other_codes(NUM_NODES / 2);
+    for (auto iter = other_codes.begin(); iter != other_codes.end(); ++iter)
+        *iter = SgHashCode::Random();
+
+    GoAutoBookParam param;
+    bool passed = true;
+
+    double start_time = currentTime();
+    double text_load_time, binary_save_time;
+    long long text_memory;
+    {
+        GoAutoBook book(text_file, param);
+        text_load_time = currentTime() - start_time;
+        text_memory = infoValue(book, "MemoryUsed");
+        passed = hasAllNodes(book, codes) && passed;
+
+        start_time = currentTime();
+        book.Save(binary_file);
+        binary_save_time = currentTime() - start_time;
+    }
+
+    double open_time, lookup_time, replace_time;
+    long long binary_memory;
+    std::size_t num_found = 0;
+    {
+        start_time = currentTime();
+        GoAutoBook book(binary_file, param);
+        open_time = currentTime() - start_time;
+        binary_memory = infoValue(book, "MemoryUsed");
+        passed = hasAllNodes(book, codes) && passed;
+
+        SgBookNode found;
+        start_time = currentTime();
+        for (size_t i = 0; i < other_codes.size(); ++i) {
+            // a prime stride, so consecutive hits are not in neighbouring slots
+            num_found += book.Get(codes[(i * 1000003) % codes.size()], found);
+            num_found += book.Get(other_codes[i], found);
+        }
+        lookup_time = currentTime() - start_time;
+        passed = passed && num_found == other_codes.size();
+
+        start_time = currentTime();
+        book.Save(binary_file);
+        replace_time = currentTime() - start_time;
+        passed = hasAllNodes(book, codes) && passed;
+    }
+
+    results.push_back(Result("book")
+                      .addCount("nodes", NUM_NODES)
+                      .addValue("text_load_s", text_load_time)
+                      .addValue("text_megabytes", fs::file_size(text_file) / 1e6)
+                      .addValue("text_memory_megabytes", text_memory / 1e6)
+                      .addValue("binary_save_s", binary_save_time)
+                      .addValue("binary_megabytes", fs::file_size(binary_file) / 1e6)
+                      .addValue("binary_open_ms", 1e3 * open_time)
+                      .addValue("binary_memory_megabytes", binary_memory / 1e6)
+                      .addValue("lookups_per_second", 2 * other_codes.size() / lookup_time)
+                      .addValue("found", static_cast<double>(num_found) / (2 * other_codes.size()))
+                      .addValue("replace_s", replace_time)
+                      .addFlag("all_nodes", passed));
+
+    // the books are closed, so the files can be removed on Windows too
+    boost::system::error_code error;
+    fs::remove_all(directory, error);
+    return passed;
+}
+
+bool runParallelBuild(std::vector<Result>& results) {
+    const std::vector<std::vector<SgMove>> lines(1, std::vector<SgMove>(COVER_LINE, COVER_LINE + 3));
+    bool passed = true;
+    double single_thread_time = 0;
+    std::uint64_t sequential_checksum = 0;
+    for (size_t i = 0; i < sizeof(PARALLEL_THREADS) / sizeof(PARALLEL_THREADS[0]); ++i) {
+        SyntheticBookBuilder builder;
+        builder.SetNumThreads(PARALLEL_THREADS[i]);
+        builder.SetExpandWidth(4);
+        double start_time = currentTime();
+        builder.Expand(PARALLEL_EXPANSIONS);
+        builder.Cover(COVER_EXPANSIONS, false, lines);
+        double time = currentTime() - start_time;
+
+        std::uint64_t checksum = builder.checksum();
+        if (i == 0) {
+            single_thread_time = time;
+            sequential_checksum = checksum;
+        }
+        bool same_book = checksum == sequential_checksum;
+        passed = passed && same_book;
+        results.push_back(Result("book_parallel")
+                          .addCount("threads", PARALLEL_THREADS[i])
+                          .addValue("seconds", time)
+                          .addValue("speedup", time > 0 ? single_thread_time / time : 0)
+                          .addCount("nodes", builder.numNodes())
+                          .addCount("main_thread_evaluations", builder.numEvaluations())
+                          // 53 bits, so that JSON readers with doubles get the exact value
+                          .addCount("checksum", static_cast<long long>(checksum >> 11))
+                          .addFlag("same_book", same_book));
+    }
+    return passed;
+}
+
+} // namespace
+
+bool runBookSuite(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+    if (options.isSelected("book"))
+        passed = runBook(results) && passed;
+    if (options.isSelected("book_parallel"))
+        passed = runParallelBuild(results) && passed;
+    return passed;
+}
+
+}
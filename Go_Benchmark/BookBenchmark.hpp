@@ -0,0 +1,26 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace Go_Benchmark {
+
+/**
+ * @brief       Benchmarks of the opening books:
+ *              - book: GoAutoBook files with a book of 4,000,000 nodes with random hash codes. The book is written as
+ *                a text book into a temporary directory, which is removed afterwards. Time to load the text book, to
+ *                save it as a binary book, to open the binary book (the file is mapped) and to save the binary book
+ *                to its own file (the file is replaced), the file sizes and the memory used by the loaded books.
+ *                Lookups per second in the opened binary book, half of them hits and half of them misses. All nodes
+ *                have to be found with the same count after each step.
+ *              - book_parallel: wall time of SgBookBuilder::Expand() and Cover() with 1, 2, 4 and 8 threads, on a
+ *                synthetic game of 20 moves with transpositions and an evaluator that waits 20 ms for the children of
+ *                a position. The book has to be identical to the book of one thread (same checksum).
+ * @returns     false if a check failed
+ */
+bool runBookSuite(const SuiteOptions& options, std::vector<Result>& results);
+
+}
@@ -0,0 +1,201 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#include "SearchBenchmark.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "GoBoard.h"
+#include "GoBoardUtil.h"
+#include "GoSearch.h"
+#include "SgHashTable.h"
+#include "SgParallelSearch.h"
+#include "SgSearchControl.h"
+
+namespace Go_Benchmark {
+
+namespace {
+
+// depth of the search that is timed to completion, a few tenths of a second with one thread on 9x9
+const int FIXED_DEPTH = 4;
+
+// size of the shared hash table in megabytes
+const int HASH_MEGABYTES = 64;
+
+// size of the hash table of search_hash in megabytes, it is filled to half of its entries
+const int HASH_TABLE_MEGABYTES = 16;
+
+// calls of SgHashTable::Age() in search_hash, a multiple of the 256 generations stored in the entries
+const int NUM_AGE_CALLS = 1024;
+
+/**
+ * @brief   Search with a cheap evaluation: the stones of each color, weighted by their line.
+ *          Own eyes are not filled, so the board doesn't fill up in deep searches.
+ */
+class StoneSearch : public GoSearch {
+public:
+    StoneSearch(GoBoard& board, SgSearchHashTable* hash)
+        : GoSearch(board, hash)
+    {}
+
+    void Generate(SgVector<SgMove>* moves, int) {
+        const GoBoard& board = Board();
+        for (GoBoard::Iterator iter(board); iter; ++iter) {
+            if (board.IsEmpty(*iter) && !GoBoardUtil::IsCompletelySurrounded(board, *iter) && board.IsLegal(*iter))
+                moves->PushBack(*iter);
+        }
+    }
+
+    int Evaluate(bool* is_exact, int) {
+        *is_exact = false;
+        const GoBoard& board = Board();
+        SgBlackWhite to_play = board.ToPlay();
+        return value(board, to_play) - value(board, SgOppBW(to_play));
+    }
+
+private:
+    static int value(const GoBoard& board, SgBlackWhite color) {
+        // a stone counts 10, the third and fourth line a bit more than the edge
+        int value = 0;
+        for (SgSetIterator iter(board.All(color)); iter; ++iter)
+            value += 10 + std::min(board.Line(*iter), 4);
+        return value;
+    }
+};
+
+/**
+ * @brief   The boards and searches of the threads and the shared hash table.
+ */
+class ParallelSearch {
+public:
+    ParallelSearch(int board_size, int num_threads)
+        : _hash(HASH_MEGABYTES)
+    {
+        std::vector<SgSearch*> searches;
+        for (int i = 0; i < num_threads; ++i) {
+            _boards.push_back(std::make_shared<GoBoard>(board_size));
+            _searches.push_back(std::make_shared<StoneSearch>(*_boards.back(), &_hash));
+            searches.push_back(_searches.back().get());
+        }
+        _search.reset(new SgParallelSearch(searches, &_hash));
+    }
+
+    SgParallelSearch& search() {
+        return *_search;
+    }
+
+    const GoBoard& board() const {
+        return *_boards.front();
+    }
+
+private:
+    SgSearchHashTable                          _hash;
+    std::vector<std::shared_ptr<GoBoard>>      _boards;
+    std::vector<std::shared_ptr<StoneSearch>>  _searches;
+    std::unique_ptr<SgParallelSearch>          _search;
+};
+
+bool runParallel(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+    double single_thread_time = 0;
+    std::vector<int> counts = threadCounts(options.max_threads);
+    for (auto iter = counts.begin(); iter != counts.end(); ++iter) {
+        ParallelSearch parallel(options.board_size, *iter);
+        SgParallelSearch& search = parallel.search();
+
+        // time to depth
+        SgVector<SgMove> sequence;
+        double start_time = currentTime();
+        int value = search.IteratedSearch(1, FIXED_DEPTH, &sequence);
+        double time = currentTime() - start_time;
+        if (*iter == 1)
+            single_thread_time = time;
+        bool is_legal = sequence.NonEmpty() && parallel.board().IsLegal(sequence[0]);
+        passed = passed && is_legal;
+
+        // nodes per second until the time is over
+        SgTimeSearchControl control(options.seconds);
+        search.SetSearchControl(&control);
+        sequence.Clear();
+        search.IteratedSearch(1, 100, &sequence);
+        search.SetSearchControl(nullptr);
+
+        results.push_back(Result("search_parallel")
+                          .addCount("threads", *iter)
+                          .addCount("depth", FIXED_DEPTH)
+                          .addValue("time_to_depth_ms", 1e3 * time)
+                          .addValue("speedup", time > 0 ? single_thread_time / time : 0)
+                          .addCount("value", value)
+                          .addFlag("legal_move", is_legal)
+                          .addCount("nodes", search.Statistics().NumNodes())
+                          .addValue("nodes_per_second", search.Statistics().NumNodesPerSecond())
+                          .addCount("depth_completed", search.DepthCompleted()));
+    }
+    return passed;
+}
+
+bool runHash(std::vector<Result>& results) {
+    SgSearchHashTable table(HASH_TABLE_MEGABYTES);
+    std::vector<SgHashCode> codes(table.MaxHash() / 2);
+    for (auto iter = codes.begin(); iter != codes.end(); ++iter)
+        *iter = SgHashCode::Random();
+    std::vector<SgHashCode> other_codes(codes.size());
+    for (auto iter = other_codes.begin(); iter != other_codes.end(); ++iter)
+        *iter = SgHashCode::Random();
+
+    double start_time = currentTime();
+    for (size_t i = 0; i < codes.size(); ++i)
+        table.Store(codes[i], SgSearchHashData(1 + i % 10, static_cast<int>(i % 1000), static_cast<SgMove>(i % 361)));
+    double store_time = currentTime() - start_time;
+
+    SgSearchHashData data;
+    start_time = currentTime();
+    std::size_t num_found = 0;
+    for (auto iter = codes.begin(); iter != codes.end(); ++iter)
+        num_found += table.Lookup(*iter, &data);
+    double hit_time = currentTime() - start_time;
+    start_time = currentTime();
+    for (auto iter = other_codes.begin(); iter != other_codes.end(); ++iter)
+        table.Lookup(*iter, &data);
+    double miss_time = currentTime() - start_time;
+
+    // entries that were not replaced since the first call have to stay aged after any number of calls
+    start_time = currentTime();
+    for (int i = 0; i < NUM_AGE_CALLS; ++i)
+        table.Age();
+    double age_time = currentTime() - start_time;
+    std::size_t num_aged = 0;
+    std::size_t num_found_after_age = 0;
+    for (auto iter = codes.begin(); iter != codes.end(); ++iter) {
+        if (table.Lookup(*iter, &data)) {
+            ++num_found_after_age;
+            num_aged += data.Depth() == 0;
+        }
+    }
+
+    bool passed = num_aged == num_found_after_age;
+    results.push_back(Result("search_hash")
+                      .addCount("entries", table.MaxHash())
+                      .addCount("stores", codes.size())
+                      .addValue("store_ns", 1e9 * store_time / codes.size())
+                      .addValue("lookup_hit_ns", 1e9 * hit_time / codes.size())
+                      .addValue("lookup_miss_ns", 1e9 * miss_time / codes.size())
+                      .addValue("found", static_cast<double>(num_found) / codes.size())
+                      .addValue("age_us_per_call", 1e6 * age_time / NUM_AGE_CALLS)
+                      .addCount("age_calls", NUM_AGE_CALLS)
+                      .addFlag("aged", passed));
+    return passed;
+}
+
+} // namespace
+
+bool runSearchSuite(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+    if (options.isSelected("search_parallel"))
+        passed = runParallel(options, results) && passed;
+    if (options.isSelected("search_hash"))
+        passed = runHash(results) && passed;
+    return passed;
+}
+
+}
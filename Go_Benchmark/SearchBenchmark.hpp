@@ -0,0 +1,26 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace Go_Benchmark {
+
+/**
+ * @brief       Benchmarks of the alpha-beta search SgParallelSearch and its hash table.
+ *              The searches are GoSearch instances on the empty board, one board per thread, that share one hash
+ *              table. They evaluate the stones on the board and their distance to the edge, so the positions are cheap
+ *              and the benchmark measures the search:
+ *              - search_parallel: nodes per second of a time limited iterated search with 1, 2, 4, ... threads, and
+ *                the time to complete a search to a fixed depth. The speedup is the time to depth of one thread
+ *                divided by the time to depth of the thread count. The best move of the fixed depth search has to be
+ *                legal.
+ *              - search_hash: time of SgHashTable::Store() and Lookup() with random codes in a table filled to half
+ *                of its entries, and of Age(). After 1024 calls of Age(), all entries have to be aged.
+ * @returns     false if a check failed
+ */
+bool runSearchSuite(const SuiteOptions& options, std::vector<Result>& results);
+
+}
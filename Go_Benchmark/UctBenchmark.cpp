@@ -0,0 +1,617 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#include "UctBenchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#include "GoBoard.h"
+#include "GoBoardUtil.h"
+#include "SgDebug.h"
+#include "SgException.h"
+#include "SgMpiSharedMemorySynchronizer.h"
+#include "SgRandom.h"
+#include "SgUctSearch.h"
+
+#ifndef WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Go_Benchmark {
+
+namespace {
+
+const float KOMI = 6.5f;
+
+// the searches are only limited by time
+const SgUctValue MAX_GAMES = 1e9f;
+
+// enough for the searches of a few seconds, the nodes of all threads are allocated at the start of each search
+const std::size_t MAX_NODES = 2000000;
+
+// size of the trees of uct_layout, large enough to not fit into the caches
+const std::size_t LAYOUT_NODES = 4000000;
+
+// children per node of the trees of uct_layout: a few moves like near the end of a game, and a full 19x19 board
+const int LAYOUT_WIDTHS[] = { 8, 250 };
+
+// size and children per node of the tree of uct_extract, the extracted subtree of a root child has over 100000 nodes
+const std::size_t EXTRACT_NODES = 2000000;
+const int EXTRACT_WIDTH = 20;
+
+// thread counts of uct_batch, independent of the cores because the threads mostly wait for the evaluator
+const int BATCH_THREADS[] = { 1, 4, 16, 64 };
+
+// batch size of uct_batch, per-leaf evaluation is measured with batch size 1
+const std::size_t BATCH_SIZE = 64;
+
+// simulated cost of a call of the mock evaluator, like an evaluator in another process or on a GPU
+const int EVALUATOR_CALL_MICROSECONDS = 200;
+const int EVALUATOR_POSITION_MICROSECONDS = 5;
+
+// maximum number of processes of uct_processes
+const int MAX_PROCESSES = 8;
+
+/**
+ * @brief   Thread state of PlayoutSearch: a board, on which random games without filling own eyes are played.
+ */
+class PlayoutState : public SgUctThreadState {
+public:
+    PlayoutState(unsigned int thread_id, int board_size);
+
+    SgUctValue Evaluate();
+    void Execute(SgMove move);
+    void ExecutePlayout(SgMove move);
+    bool GenerateAllMoves(SgUctValue count, std::vector<SgUctMoveInfo>& moves, SgUctProvenType& proven_type);
+    SgMove GeneratePlayoutMove(bool& skip_rave_update);
+    void StartSearch();
+    void TakeBackInTree(std::size_t num_moves);
+    void TakeBackPlayout(std::size_t num_moves);
+
+private:
+    bool isGameOver() const;
+    bool isCandidate(SgPoint p) const;
+
+    const int            _board_size;
+    GoBoard              _board;
+    SgFastRandom         _random; // a stream per thread, so the threads play different games
+    std::vector<SgPoint> _empty;
+};
+
+PlayoutState::PlayoutState(unsigned int thread_id, int board_size)
+    : SgUctThreadState(thread_id, SG_PASS + 1),
+      _board_size(board_size),
+      _board(board_size),
+      _random(thread_id)
+{}
+
+SgUctValue PlayoutState::Evaluate() {
+    // the game can end at the move limit with points left to play, so don't check for a simple end position
+    float score = GoBoardUtil::ScoreSimpleEndPosition(_board, KOMI, true);
+    return (score > 0) == (_board.ToPlay() == SG_BLACK) ? 1 : 0;
+}
+
+void PlayoutState::Execute(SgMove move) {
+    _board.Play(move);
+}
+
+void PlayoutState::ExecutePlayout(SgMove move) {
+    _board.Play(move);
+}
+
+bool PlayoutState::GenerateAllMoves(SgUctValue, std::vector<SgUctMoveInfo>& moves, SgUctProvenType& proven_type) {
+    proven_type = SG_NOT_PROVEN;
+    moves.clear();
+    if (isGameOver())
+        return false;
+    for (GoBoard::Iterator iter(_board); iter; ++iter) {
+        if (isCandidate(*iter))
+            moves.push_back(SgUctMoveInfo(*iter));
+    }
+    if (moves.empty())
+        moves.push_back(SgUctMoveInfo(SG_PASS));
+    return false;
+}
+
+SgMove PlayoutState::GeneratePlayoutMove(bool&) {
+    if (isGameOver())
+        return SG_NULLMOVE;
+
+    // same as the playouts of Go_Backend::GameGtpEngine: the empty points in random order, starting at a random index
+    _empty.clear();
+    for (auto iter = SgSetIterator(_board.AllEmpty()); iter; ++iter)
+        _empty.push_back(*iter);
+    if (_empty.empty())
+        return SG_PASS;
+    size_t start = _random.Int(_empty.size());
+    for (size_t i = 0; i < _empty.size(); ++i) {
+        SgPoint p = _empty[(start + i) % _empty.size()];
+        if (isCandidate(p))
+            return p;
+    }
+    return SG_PASS;
+}
+
+void PlayoutState::StartSearch() {
+    _board.Init(_board_size);
+}
+
+void PlayoutState::TakeBackInTree(std::size_t num_moves) {
+    for (std::size_t i = 0; i < num_moves; ++i)
+        _board.Undo();
+}
+
+void PlayoutState::TakeBackPlayout(std::size_t num_moves) {
+    for (std::size_t i = 0; i < num_moves; ++i)
+        _board.Undo();
+}
+
+bool PlayoutState::isGameOver() const {
+    return GoBoardUtil::TwoPasses(_board) || _board.MoveNumber() >= 3 * _board_size * _board_size;
+}
+
+bool PlayoutState::isCandidate(SgPoint p) const {
+    return _board.IsEmpty(p) && !GoBoardUtil::IsCompletelySurrounded(_board, p) && _board.IsLegal(p);
+}
+
+class PlayoutStateFactory : public SgUctThreadStateFactory {
+public:
+    explicit PlayoutStateFactory(int board_size)
+        : _board_size(board_size)
+    {}
+
+    SgUctThreadState* Create(unsigned int thread_id, const SgUctSearch&) {
+        return new PlayoutState(thread_id, _board_size);
+    }
+
+private:
+    const int _board_size;
+};
+
+/**
+ * @brief   Evaluator that waits a fixed time per call and per position, and counts its calls.
+ */
+class MockEvaluator : public SgUctBatchEvaluator {
+public:
+    MockEvaluator()
+        : _num_calls(0),
+          _num_positions(0)
+    {}
+
+    void Evaluate(const std::vector<SgUctEvaluationRequest*>& requests) {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            EVALUATOR_CALL_MICROSECONDS + EVALUATOR_POSITION_MICROSECONDS * static_cast<int>(requests.size())));
+        for (auto iter = requests.begin(); iter != requests.end(); ++iter)
+            (*iter)->m_value = 0.5;
+        // calls are serialized by the search
+        ++_num_calls;
+        _num_positions += requests.size();
+    }
+
+    double meanBatchSize() const {
+        return _num_calls == 0 ? 0 : static_cast<double>(_num_positions) / _num_calls;
+    }
+
+private:
+    std::size_t _num_calls;
+    std::size_t _num_positions;
+};
+
+/**
+ * @brief   Search with random playouts from the empty board.
+ */
+class PlayoutSearch : public SgUctSearch {
+public:
+    PlayoutSearch(int board_size, int num_threads)
+        : SgUctSearch(new PlayoutStateFactory(board_size), SG_PASS + 1)
+    {
+        SetNumberThreads(num_threads);
+        SetLockFree(true);
+        SetMaxNodes(MAX_NODES);
+    }
+
+    std::string MoveString(SgMove move) const {
+        std::ostringstream out;
+        out << SgWritePoint(move);
+        return out.str();
+    }
+
+    SgUctValue UnknownEval() const {
+        return 0.5;
+    }
+};
+
+/**
+ * @brief   Checks the counts of a tree after a lock-free search.
+ *          Every game of the search increments the position count of the root and the move count of one child. Only
+ *          when threads expand the root at the same time, the children of the last one replace the others, so each
+ *          other thread can lose the move count of its game.
+ */
+bool isConsistent(const SgUctTree& tree, int num_threads) {
+    try {
+        tree.CheckConsistency();
+    }
+    catch (const SgException&) {
+        return false;
+    }
+    SgUctValue sum = 0;
+    for (SgUctChildIterator iter(tree, tree.Root()); iter; ++iter)
+        sum += (*iter).MoveCount();
+    SgUctValue lost = tree.Root().PosCount() - sum;
+    return lost >= 0 && lost < num_threads;
+}
+
+bool runStress(const SuiteOptions& options, std::vector<Result>& results) {
+    // more threads than cores, so that the updates are interrupted in the middle
+    const int num_threads = std::max(16, options.max_threads);
+    const int num_adds = 100000;
+    SgUctStatisticsAtomic statistics;
+    std::vector<std::thread> threads;
+    double start_time = currentTime();
+    for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(std::thread([&statistics] {
+            for (int j = 0; j < num_adds; ++j)
+                statistics.Add(0.25f);
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    double time = currentTime() - start_time;
+
+    const SgUctValue expected = static_cast<SgUctValue>(num_threads) * num_adds;
+    bool passed = statistics.Count() == expected && std::abs(statistics.Mean() - 0.25f) < 1e-3f;
+    results.push_back(Result("uct_stress")
+                      .addCount("threads", num_threads)
+                      .addCount("adds", static_cast<long long>(expected))
+                      .addCount("count", static_cast<long long>(statistics.Count()))
+                      .addValue("ns_per_add", 1e9 * time / expected)
+                      .addFlag("passed", passed));
+    return passed;
+}
+
+/**
+ * @brief   Fills a tree breadth-first with nodes of the given number of children, until it is full.
+ *          The move count of each node is the number of nodes in its subtree, like in a search that expands a node
+ *          at its first visit, so the counts of the root are consistent.
+ */
+void fillTree(SgUctTree& tree, int width) {
+    std::vector<SgUctMoveInfo> moves;
+    for (int i = 0; i < width; ++i)
+        moves.push_back(SgUctMoveInfo(i));
+    // the nodes with their fathers in breadth-first order
+    std::vector<std::pair<const SgUctNode*, const SgUctNode*>> nodes(1, std::make_pair(&tree.Root(), nullptr));
+    for (size_t next = 0; next < nodes.size() && tree.HasCapacity(0, moves.size()); ++next) {
+        const SgUctNode& node = *nodes[next].first;
+        tree.CreateChildren(0, node, moves);
+        for (SgUctChildIterator iter(tree, node); iter; ++iter)
+            nodes.push_back(std::make_pair(&(*iter), &node));
+    }
+    // children are stored after their fathers, so the counts of the children are complete when a father is reached
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const SgUctNode& node = *nodes[i].first;
+        SgUctValue count = node.PosCount() + 1;
+        tree.AddGameResults(node, nodes[i].second, (i % 2) ? 1 : 0, count);
+    }
+}
+
+/**
+ * @brief   Compares the moves, counts, means and children of two subtrees.
+ */
+bool isSameSubtree(const SgUctTree& tree1, const SgUctNode& node1, const SgUctTree& tree2, const SgUctNode& node2) {
+    if (node1.Move() != node2.Move() || node1.MoveCount() != node2.MoveCount()
+        || node1.PosCount() != node2.PosCount() || node1.NuChildren() != node2.NuChildren()
+        || (node1.HasMean() && node1.Mean() != node2.Mean()))
+        return false;
+    if (!node1.HasChildren())
+        return true;
+    SgUctChildIterator iter2(tree2, node2);
+    for (SgUctChildIterator iter1(tree1, node1); iter1; ++iter1, ++iter2) {
+        if (!isSameSubtree(tree1, *iter1, tree2, *iter2))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief       Extracts the subtree of a node to the target tree until the time is over.
+ * @returns     the average time of an extraction in seconds
+ */
+double timeExtract(const SgUctTree& tree, const SgUctNode& node, SgUctTree& target, double seconds) {
+    int num_runs = 0;
+    double start_time = currentTime();
+    double time;
+    do {
+        tree.ExtractSubtree(target, node, true);
+        ++num_runs;
+        time = currentTime() - start_time;
+    } while (time < seconds);
+    return time / num_runs;
+}
+
+bool runExtract(const SuiteOptions& options, std::vector<Result>& results) {
+    SgUctTree tree;
+    tree.CreateAllocators(1);
+    tree.SetMaxNodes(EXTRACT_NODES);
+    fillTree(tree, EXTRACT_WIDTH);
+    const SgUctNode* node = nullptr;
+    for (SgUctChildIterator iter(tree, tree.Root()); iter; ++iter) {
+        if (!node || (*iter).MoveCount() > node->MoveCount())
+            node = &(*iter);
+    }
+
+    // a target with one allocator is copied sequentially, the subtree is large enough for a parallel copy otherwise
+    SgUctTree serial_target;
+    serial_target.CreateAllocators(1);
+    serial_target.SetMaxNodes(EXTRACT_NODES);
+    double serial_time = timeExtract(tree, *node, serial_target, options.seconds / 2);
+
+    bool passed = true;
+    std::vector<int> counts = threadCounts(options.max_threads);
+    for (auto iter = counts.begin(); iter != counts.end(); ++iter) {
+        if (*iter == 1)
+            continue;
+        SgUctTree parallel_target;
+        parallel_target.CreateAllocators(*iter);
+        parallel_target.SetMaxNodes(EXTRACT_NODES);
+        double parallel_time = timeExtract(tree, *node, parallel_target, options.seconds / 2);
+
+        bool identical = isSameSubtree(serial_target, serial_target.Root(), parallel_target, parallel_target.Root());
+        passed = passed && identical;
+        results.push_back(Result("uct_extract")
+                          .addCount("threads", *iter)
+                          .addCount("nodes", static_cast<long long>(parallel_target.NuNodes()))
+                          .addValue("serial_ms", 1e3 * serial_time)
+                          .addValue("parallel_ms", 1e3 * parallel_time)
+                          .addValue("speedup", serial_time / parallel_time)
+                          .addFlag("identical", identical));
+    }
+    return passed;
+}
+
+bool runLayout(const SuiteOptions& options, std::vector<Result>& results) {
+    for (size_t i = 0; i < sizeof(LAYOUT_WIDTHS) / sizeof(LAYOUT_WIDTHS[0]); ++i) {
+        SgUctTree tree;
+        tree.CreateAllocators(1);
+        tree.SetMaxNodes(LAYOUT_NODES);
+        double start_time = currentTime();
+        fillTree(tree, LAYOUT_WIDTHS[i]);
+        double fill_time = currentTime() - start_time;
+
+        // read the statistics of all nodes like the move selection does, until the time is over
+        double checksum = 0;
+        long long num_visited = 0;
+        start_time = currentTime();
+        double time;
+        do {
+            for (SgUctTreeIterator iter(tree); iter; ++iter) {
+                const SgUctNode& node = *iter;
+                if (node.HasMean())
+                    checksum += node.Mean() + node.MoveCount();
+                ++num_visited;
+            }
+            time = currentTime() - start_time;
+        } while (time < options.seconds);
+
+        results.push_back(Result("uct_layout")
+                          .addCount("children", LAYOUT_WIDTHS[i])
+                          .addCount("node_bytes", sizeof(SgUctNode))
+                          .addCount("nodes", static_cast<long long>(tree.NuNodes()))
+                          .addValue("tree_megabytes", 1e-6 * sizeof(SgUctNode) * tree.MaxNodes())
+                          .addValue("fill_mnodes_per_second", 1e-6 * tree.NuNodes() / fill_time)
+                          .addValue("iterate_mnodes_per_second", 1e-6 * num_visited / time)
+                          .addValue("checksum", checksum));
+    }
+    return true;
+}
+
+bool runBatch(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(BATCH_THREADS) / sizeof(BATCH_THREADS[0]); ++i) {
+        const std::size_t batch_sizes[] = { 1, BATCH_SIZE };
+        for (size_t j = 0; j < sizeof(batch_sizes) / sizeof(batch_sizes[0]); ++j) {
+            MockEvaluator evaluator;
+            PlayoutSearch search(options.board_size, BATCH_THREADS[i]);
+            search.SetBatchEvaluator(&evaluator);
+            search.SetBatchSize(batch_sizes[j]);
+            std::vector<SgMove> sequence;
+            double start_time = currentTime();
+            search.Search(MAX_GAMES, options.seconds, sequence);
+            double time = currentTime() - start_time;
+
+            bool consistent = isConsistent(search.Tree(), BATCH_THREADS[i]);
+            passed = passed && consistent;
+            results.push_back(Result("uct_batch")
+                              .addCount("threads", BATCH_THREADS[i])
+                              .addCount("batch_size", batch_sizes[j])
+                              .addCount("games", static_cast<long long>(search.GamesPlayed()))
+                              .addValue("games_per_second", search.GamesPlayed() / time)
+                              .addValue("mean_batch", evaluator.meanBatchSize())
+                              .addFlag("consistent", consistent));
+        }
+    }
+    return passed;
+}
+
+bool runScaling(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+    double single_thread_rate = 0;
+    std::vector<int> counts = threadCounts(options.max_threads);
+    for (auto iter = counts.begin(); iter != counts.end(); ++iter) {
+        PlayoutSearch search(options.board_size, *iter);
+        std::vector<SgMove> sequence;
+        double start_time = currentTime();
+        search.Search(MAX_GAMES, options.seconds, sequence);
+        double time = currentTime() - start_time;
+
+        double rate = search.GamesPlayed() / time;
+        if (*iter == 1)
+            single_thread_rate = rate;
+        bool consistent = isConsistent(search.Tree(), *iter);
+        passed = passed && consistent;
+        results.push_back(Result("uct_scaling")
+                          .addCount("threads", *iter)
+                          .addCount("games", static_cast<long long>(search.GamesPlayed()))
+                          .addCount("nodes", static_cast<long long>(search.Tree().NuNodes()))
+                          .addValue("games_per_second", rate)
+                          .addValue("speedup", single_thread_rate > 0 ? rate / single_thread_rate : 0)
+                          .addFlag("consistent", consistent));
+    }
+    return passed;
+}
+
+#ifndef WIN32
+
+/**
+ * @brief   What a process of uct_processes reports about its search.
+ */
+struct ProcessReport {
+    int        rank;
+    double     games;       // own games, SgUctSearch::GamesPlayed()
+    double     merged;      // games of the other processes added to the root children
+    double     child_sum;   // sum of the move counts of the root children
+    long long  merges;
+    int        move;        // the move of SynchronizeMove(), the own best move in the root process
+    bool       ok;          // false if the search threw an exception
+};
+
+std::ostream& operator<<(std::ostream& out, const ProcessReport& report) {
+    return out << report.rank << ' ' << report.games << ' ' << report.merged << ' ' << report.child_sum << ' '
+               << report.merges << ' ' << report.move << ' ' << report.ok << '\n';
+}
+
+std::istream& operator>>(std::istream& in, ProcessReport& report) {
+    return in >> report.rank >> report.games >> report.merged >> report.child_sum >> report.merges >> report.move
+              >> report.ok;
+}
+
+// the search of one process of uct_processes
+ProcessReport searchInProcess(const SuiteOptions& options, const string& name, int num_processes, int rank) {
+    ProcessReport report = ProcessReport();
+    report.rank = rank;
+    report.move = SG_NULLMOVE;
+    try {
+        // the processes would play the same games with the same seed
+        if (rank > 0)
+            SgRandom::SetSeed(std::max(SgRandom::Seed(), 0) + rank);
+        PlayoutSearch search(options.board_size, 1);
+        auto synchronizer = new SgMpiSharedMemorySynchronizer(name, num_processes, rank);
+        search.SetMpiSynchronizer(SgMpiSynchronizerHandle(synchronizer));
+        synchronizer->SetPositionKey(1);
+        std::vector<SgMove> sequence;
+        search.Search(MAX_GAMES, options.seconds, sequence);
+
+        report.games = search.GamesPlayed();
+        report.merged = synchronizer->MergedGames();
+        report.merges = synchronizer->NuMerges();
+        for (SgUctChildIterator iter(search.Tree(), search.Tree().Root()); iter; ++iter)
+            report.child_sum += (*iter).MoveCount();
+        // a collective call: the other processes receive the move of the root process
+        SgMove move = sequence.empty() ? SG_PASS : sequence[0];
+        synchronizer->SynchronizeMove(move);
+        report.move = move;
+        report.ok = true;
+    }
+    catch (const SgException& e) {
+        SgDebug() << "uct_processes: process " << rank << ": " << e.what() << '\n';
+    }
+    return report;
+}
+
+bool runProcesses(const SuiteOptions& options, std::vector<Result>& results) {
+    const int num_processes = std::max(2, std::min(options.max_threads, MAX_PROCESSES));
+    std::ostringstream name;
+    name << "go_benchmark_uct_" << getpid();
+    int reports_pipe[2];
+    if (pipe(reports_pipe) != 0)
+        return false;
+
+    double start_time = currentTime();
+    const int rank = SgMpiSharedMemorySynchronizer::ForkProcesses(name.str(), num_processes);
+    ProcessReport own_report = searchInProcess(options, name.str(), num_processes, rank);
+    if (rank > 0) {
+        // a child process only reports to the parent, it must not return into main()
+        close(reports_pipe[0]);
+        std::ostringstream out;
+        out << own_report;
+        const string line = out.str();
+        bool written = write(reports_pipe[1], line.c_str(), line.size()) == static_cast<ssize_t>(line.size());
+        close(reports_pipe[1]);
+        _exit(written ? 0 : 1);
+    }
+    double time = currentTime() - start_time;
+
+    close(reports_pipe[1]);
+    string text;
+    char buffer[256];
+    ssize_t num_read;
+    while ((num_read = read(reports_pipe[0], buffer, sizeof(buffer))) > 0)
+        text.append(buffer, num_read);
+    close(reports_pipe[0]);
+    bool exited = true;
+    for (int i = 1; i < num_processes; ++i) {
+        int status;
+        exited = wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 && exited;
+    }
+
+    std::vector<ProcessReport> reports(1, own_report);
+    std::istringstream in(text);
+    ProcessReport report;
+    while (in >> report)
+        reports.push_back(report);
+
+    // each game of a process, own or merged, is counted in one root child, except the first own game, which only
+    // expands the root
+    double total_games = 0;
+    bool consistent = exited && static_cast<int>(reports.size()) == num_processes;
+    bool broadcast = consistent;
+    for (auto iter = reports.begin(); iter != reports.end(); ++iter) {
+        total_games += iter->games;
+        double lost = iter->games + iter->merged - iter->child_sum;
+        consistent = consistent && iter->ok && lost >= 0 && lost <= 1;
+        broadcast = broadcast && iter->move == own_report.move;
+    }
+    // the root process can only merge games of the others, and must have merged some
+    bool merged = own_report.merged > 0 && own_report.merged <= total_games - own_report.games;
+
+    results.push_back(Result("uct_processes")
+                      .addCount("processes", num_processes)
+                      .addCount("games", static_cast<long long>(total_games))
+                      .addValue("games_per_second", total_games / time)
+                      .addCount("root_games", static_cast<long long>(own_report.games))
+                      .addCount("root_merged", static_cast<long long>(own_report.merged))
+                      .addCount("root_merges", own_report.merges)
+                      .addFlag("consistent", consistent)
+                      .addFlag("merged", merged)
+                      .addFlag("move_broadcast", broadcast));
+    return consistent && merged && broadcast;
+}
+
+#endif // WIN32
+
+} // namespace
+
+bool runUctSuite(const SuiteOptions& options, std::vector<Result>& results) {
+    bool passed = true;
+#ifndef WIN32
+    // first, fork() must be called before any threads are started
+    if (options.isSelected("uct_processes"))
+        passed = runProcesses(options, results) && passed;
+#endif
+    if (options.isSelected("uct_stress"))
+        passed = runStress(options, results) && passed;
+    if (options.isSelected("uct_layout"))
+        passed = runLayout(options, results) && passed;
+    if (options.isSelected("uct_extract"))
+        passed = runExtract(options, results) && passed;
+    if (options.isSelected("uct_scaling"))
+        passed = runScaling(options, results) && passed;
+    if (options.isSelected("uct_batch"))
+        passed = runBatch(options, results) && passed;
+    return passed;
+}
+
+}
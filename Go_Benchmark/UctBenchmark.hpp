@@ -0,0 +1,40 @@
+// Copyright (c) 2013 augmented-go team
+// See the file LICENSE for full license and copying terms.
+#pragma once
+
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace Go_Benchmark {
+
+/**
+ * @brief       Benchmarks of SgUctSearch and SgUctTree.
+ *              The searches start on an empty board and play random games without filling own eyes, one GoBoard per
+ *              thread, so they measure the search and not a playout policy:
+ *              - uct_stress: all threads add values to one SgUctStatisticsAtomic at the same time, the count has to be
+ *                exact afterwards
+ *              - uct_layout: size of SgUctNode and the memory of a tree of a few million nodes, the speed of creating
+ *                the nodes and of reading their statistics with SgUctTreeIterator. Compare builds with and without
+ *                SG_UCT_COMPACT_NODE (CMake option FUEGO_COMPACT_UCT_NODE).
+ *              - uct_extract: SgUctTree::ExtractSubtree() of a root child with over 100000 nodes to a target tree with one
+ *                allocator (sequential copy) and with 2, 4, ... allocators (parallel copy), the copies have to be
+ *                identical
+ *              - uct_scaling: games per second of a lock-free search with 1, 2, 4, ... threads and the speedup over one
+ *                thread. After each search the tree is checked: the position count of the root has to be the sum of the
+ *                move counts of its children. Only threads that expand the root at the same time as another thread
+ *                can lose the move count of their game.
+ *              - uct_batch: games per second of a search with a mock SgUctBatchEvaluator, that waits 200 us per call
+ *                and 5 us per position, with 1, 4, 16 and 64 threads. Each thread count is measured with batch size 1
+ *                (one call per leaf) and 64. The trees are checked like in uct_scaling.
+ *              - uct_processes (not on Windows): root-parallel search with --threads processes (2 to 8), created with
+ *                fork() and synchronized by SgMpiSharedMemorySynchronizer, each with a single-threaded search. Runs
+ *                before the other cases, because fork() must be called before any threads are started. Each process
+ *                checks that the move counts of its root children are its own games plus the merged games of the
+ *                others, the root process must have merged some and at most all of their games, and the move
+ *                broadcast with SynchronizeMove() after the search has to reach all processes.
+ * @returns     false if a check failed
+ */
+bool runUctSuite(const SuiteOptions& options, std::vector<Result>& results);
+
+}
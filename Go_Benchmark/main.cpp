@@ -0,0 +1,156 @@
+#include "SgSystem.h"
+#include "SgInit.h"
+#include "GoInit.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GoBoardCheckPerformance.h"
+
+#include "Benchmark.hpp"
+#include "BookBenchmark.hpp"
+#include "SearchBenchmark.hpp"
+#include "UctBenchmark.hpp"
+
+namespace {
+
+using Go_Benchmark::Result;
+using Go_Benchmark::SuiteOptions;
+
+typedef bool (*SuiteFunction)(const SuiteOptions& options, std::vector<Result>& results);
+
+struct Suite {
+    const char*   name;
+    SuiteFunction function;
+};
+
+// the board suite is run by GoBoardCheckPerformance::RunBenchmarks()
+const Suite SUITES[] = {
+    { "uct",    Go_Benchmark::runUctSuite },
+    { "search", Go_Benchmark::runSearchSuite },
+    { "book",   Go_Benchmark::runBookSuite }
+};
+
+void printUsage() {
+    std::cerr << "Usage: go_benchmark [options]\n"
+                 "Runs the benchmarks of the Go engine hot paths and writes the results as JSON.\n"
+                 "  --suite name    board (default): the board, ladder, safety and sgf hot paths\n"
+                 "                  uct: SgUctSearch and SgUctTree\n"
+                 "                  search: SgParallelSearch\n"
+                 "                  book: GoAutoBook files with 4,000,000 nodes\n"
+                 "  --sizes list    comma separated board sizes (default 9,13,19), the other suites use the first one\n"
+                 "  --filter name   only run the benchmarks whose name contains name\n"
+                 "  --runs n        timed runs per benchmark, the median is reported (default 5, board suite)\n"
+                 "  --min-time s    minimum time of a run in seconds (default 0.05, board suite)\n"
+                 "  --threads n     maximum number of search threads (default: number of cores, other suites)\n"
+                 "  --seconds s     duration of each timed search (default 1, other suites)\n"
+                 "  --output file   write the results to file instead of stdout\n"
+                 "  --check         run the performance checks (board, ladder, safety) instead of a suite and\n"
+                 "                  write their reports as text\n"
+                 "Exits with 2 if a checksum differed between runs or a check failed.\n";
+}
+
+bool parseSizes(const std::string& list, std::vector<int>& sizes) {
+    sizes.clear();
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int size = std::atoi(item.c_str());
+        if (size < SG_MIN_SIZE || size > SG_MAX_SIZE)
+            return false;
+        sizes.push_back(size);
+    }
+    return !sizes.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GoBoardCheckPerformance::BenchmarkOptions options;
+    SuiteOptions suite_options;
+    std::string suite = "board";
+    std::string output;
+    bool run_checks = false;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--sizes") == 0 && has_value) {
+            if (!parseSizes(argv[++i], options.m_sizes)) {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--suite") == 0 && has_value)
+            suite = argv[++i];
+        else if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+            options.m_filter = argv[++i];
+        else if (std::strcmp(argv[i], "--runs") == 0 && has_value)
+            options.m_runs = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--min-time") == 0 && has_value)
+            options.m_minTime = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && has_value)
+            suite_options.max_threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--seconds") == 0 && has_value)
+            suite_options.seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+            output = argv[++i];
+        else if (std::strcmp(argv[i], "--check") == 0)
+            run_checks = true;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    suite_options.board_size = options.m_sizes.front();
+    suite_options.filter = options.m_filter;
+
+    const Suite* selected_suite = nullptr;
+    for (size_t i = 0; i < sizeof(SUITES) / sizeof(SUITES[0]); ++i) {
+        if (suite == SUITES[i].name)
+            selected_suite = &SUITES[i];
+    }
+    if (suite != "board" && !selected_suite) {
+        printUsage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output.c_str());
+        if (!file) {
+            std::cerr << "Could not open " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    // init fuego
+    SgInit();
+    GoInit();
+
+    bool is_stable;
+    if (run_checks) {
+        is_stable = GoBoardCheckPerformance::RunChecks(options, out);
+    }
+    else if (selected_suite) {
+        std::vector<Result> results;
+        is_stable = selected_suite->function(suite_options, results);
+        Go_Benchmark::writeResults(out, suite, suite_options, results, is_stable);
+    }
+    else {
+        is_stable = GoBoardCheckPerformance::RunBenchmarks(options, out);
+    }
+
+    // "clean up" fuego
+    GoFini();
+    SgFini();
+
+    return is_stable ? 0 : 2;
+}
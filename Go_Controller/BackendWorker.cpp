@@ -6,9 +6,38 @@
 
 #include "SgPoint.h"
 #include "SgSystem.h"
+#include "SgLog.h"
+#include "SgMetrics.h"
+#include "SgTrace.h"
 
 namespace Go_Controller {
 
+// autosave of the current game, relative to the working directory (the directory of the executable)
+const char* AUTOSAVE_JOURNAL_FILE = "autosave.agj";
+const char* AUTOSAVE_SGF_FILE     = "autosave.sgf";
+
+// files with this extension are saved and loaded as Go_Backend::GameSnapshot instead of sgf
+const QString SNAPSHOT_EXTENSION = ".ags";
+
+namespace {
+// metrics of the scan loop, see SgMetrics.h
+SgMetricHistogram& frame_seconds_metric = SgMetrics::Global().Histogram(
+    "ag_backend_frame_seconds", "Time of one scan of the backend, including the game update and the image conversion");
+SgMetricGauge& frame_rate_metric = SgMetrics::Global().Gauge(
+    "ag_backend_frames_per_second", "Camera images passed to the gui per second");
+SgMetricCounter& unstable_frames_metric = SgMetrics::Global().Counter(
+    "ag_backend_unstable_frames_total", "Scanned setups that were ignored because they were not stable yet");
+
+const char* const updates_metric_name = "ag_game_updates_total";
+const char* const updates_metric_help = "Game updates with a scanned setup, by result";
+SgMetricCounter& legal_updates_metric      = SgMetrics::Global().Counter(updates_metric_name, updates_metric_help, "result=\"legal\"");
+SgMetricCounter& illegal_updates_metric    = SgMetrics::Global().Counter(updates_metric_name, updates_metric_help, "result=\"illegal\"");
+SgMetricCounter& to_capture_updates_metric = SgMetrics::Global().Counter(updates_metric_name, updates_metric_help, "result=\"to_capture\"");
+
+// only used by the backend thread
+SgMetricRate frame_rate(frame_rate_metric);
+}
+
 // converts a cv::Mat to a QImage
 // inspired from http://www.qtforum.de/forum/viewtopic.php?t=9721
 //
@@ -17,6 +46,8 @@ namespace Go_Controller {
 //   - number of channels has to be 3 (RGB, or BGR in opencv)
 QImage mat_to_QImage(cv::Mat source)
 {
+    SG_TRACE_ZONE("mat_to_QImage");
+
     assert(source.depth() == CV_8U);
     assert(source.channels() == 3);
 
@@ -51,6 +82,13 @@ BackendWorker::BackendWorker()
      */
     _new_game_rules = GoRules(0, GoKomi(6.5), true, true);
 
+    // the autosave files are only left over if the program crashed, continue the game in that case
+    if (_game.recoverFromJournal(AUTOSAVE_JOURNAL_FILE, AUTOSAVE_SGF_FILE))
+        _game_is_initialized = true;
+
+    if (!_game.startJournal(AUTOSAVE_JOURNAL_FILE, AUTOSAVE_SGF_FILE))
+        SG_LOG(SG_LOG_ERROR) << "Error creating autosave file \"" << AUTOSAVE_JOURNAL_FILE << "\"!";
+
     connect(&_scan_timer, SIGNAL(timeout()), this, SLOT(scan()));
     _scan_timer.setInterval(40); // call the connected slot periodically in this interval (ms)
     _scan_timer.start();         // put one timer event in this threads event queue
@@ -60,10 +98,15 @@ BackendWorker::BackendWorker()
 }
 
 
-BackendWorker::~BackendWorker()
-{}
+BackendWorker::~BackendWorker() {
+    // normal exit, nothing to recover on the next start
+    _game.stopJournal(true);
+}
 
 void BackendWorker::scan() {
+    SG_TRACE_ZONE("BackendWorker::scan");
+    SgMetricTimer timer(frame_seconds_metric);
+
     cv::Mat image;
     GoSetup setup;
 
@@ -86,12 +129,15 @@ void BackendWorker::scan() {
                     // update game state
                     UpdateResult result = _game.update(setup);
                     if (result == UpdateResult::Illegal) {
+                        illegal_updates_metric.Increment();
                         emit displayErrorMessage("Your board differs from virtual board!");
                     }
                     else if (result == UpdateResult::ToCapture) {
+                        to_capture_updates_metric.Increment();
                         emit displayErrorMessage("There are stones left to capture.\nMake sure your board matches the virtual one.");
                     }
                     else {
+                        legal_updates_metric.Increment();
                         emit displayErrorMessage(""); // no error
                     }
                 }
@@ -109,11 +155,15 @@ void BackendWorker::scan() {
 
                 signalGuiGameDataChanged();
             }
+            else {
+                unstable_frames_metric.Increment();
+            }
 
             // converting image (OpenCV data type) to QImage (Qt data type)
             const auto scanner_image = mat_to_QImage(image);
             // and send signal with new image to gui
             emit newImage(scanner_image);
+            frame_rate.Tick();
 
             break;
         }
@@ -124,6 +174,7 @@ void BackendWorker::scan() {
             const auto scanner_image = mat_to_QImage(image);
             // send signal with new image to gui
             emit newImage(scanner_image);
+            frame_rate.Tick();
 
             emit displayErrorMessage("Board could not be detected correctly!\nBoard selection still accurate?");
             break;
@@ -142,13 +193,24 @@ void BackendWorker::scan() {
 void BackendWorker::saveSgf(QString path, QString blackplayer_name, QString whiteplayer_name, QString game_name) {
     auto filepath = path.toStdString();
 
+    if (path.endsWith(SNAPSHOT_EXTENSION, Qt::CaseInsensitive)) {
+        if (!_game.saveSnapshot(filepath))
+            SG_LOG(SG_LOG_ERROR) << "Error writing game data to file \"" << filepath << "\"!";
+        return;
+    }
+
     if (!_game.saveGame(filepath, blackplayer_name.toStdString(), whiteplayer_name.toStdString(), game_name.toStdString()))
-        std::cerr << "Error writing game data to file \"" << filepath << "\"!" << std::endl;
+        SG_LOG(SG_LOG_ERROR) << "Error writing game data to file \"" << filepath << "\"!";
 }
 
 void BackendWorker::loadSgf(QString path) {
     auto filepath = path.toStdString();
 
+    if (path.endsWith(SNAPSHOT_EXTENSION, Qt::CaseInsensitive)) {
+        loadSnapshot(filepath);
+        return;
+    }
+
     auto new_game = _game.loadGame(filepath);
     if (!new_game) {
         emit displayErrorMessagebox("Error loading the game", "Failed to open the selected sgf-file!");
@@ -179,6 +241,29 @@ void BackendWorker::loadSgf(QString path) {
     signalGuiGameDataChanged();
 }
 
+void BackendWorker::loadSnapshot(const std::string& filepath) {
+    Go_Backend::GameSnapshot snapshot;
+    if (!snapshot.open(filepath)) {
+        emit displayErrorMessagebox("Error loading the game", "Failed to open the selected snapshot file!");
+        return;
+    }
+
+    auto size = snapshot.boardSize();
+    if (size != 9 && size != 13 && size != 19) {
+        emit displayErrorMessagebox("Error loading the game", "Only board sizes of 9x9, 13x13 and 19x19 are supported!");
+        return;
+    }
+    snapshot.close();
+
+    if (!_game.loadSnapshot(filepath)) {
+        emit displayErrorMessagebox("Error loading the game", "Failed to open the selected snapshot file!");
+        return;
+    }
+    _game_is_initialized = true;
+
+    signalGuiGameDataChanged();
+}
+
 void BackendWorker::pass() {
     _game.pass();
     
@@ -52,6 +52,7 @@ namespace Go_Controller {
         /**
          * @brief       Saves the current game as sgf at the specified path with the given player names and game name.
          *              See Go_Backend::Game::saveGame()
+         *              Files with the extension ".ags" are saved as snapshot, see Go_Backend::Game::saveSnapshot().
          * @param[in]   path                
          * @param[in]   blackplayer_name    
          * @param[in]   whiteplayer_name    
@@ -61,6 +62,7 @@ namespace Go_Controller {
 
         /**
          * @brief       Loads the specified game from a sgf file, discards the current one.
+         *              Files with the extension ".ags" are loaded as snapshot, see Go_Backend::Game::loadSnapshot().
          */
         void loadSgf(QString fileName);
 
@@ -184,6 +186,7 @@ namespace Go_Controller {
     private:
         void signalGuiGameHasEnded() const;
         void signalGuiGameDataChanged() const;
+        void loadSnapshot(const std::string& filepath);
         bool virtualModeActive() const;
         bool setupIsStable(const GoSetup& setup);
 
@@ -1,5 +1,12 @@
 #include "SgInit.h"
 #include "GoInit.h"
+#include "SgDebug.h"
+#include "SgException.h"
+#include "SgLog.h"
+#include "SgMetrics.h"
+#include "SgTrace.h"
+
+#include <cstdlib>
 
 #include "BackendWorker.hpp"
 #include "GUI.hpp"
@@ -13,6 +20,22 @@ int main(int argc, char** argv) {
     SgInit();
     GoInit();
 
+    SgTraceSetThreadName("gui");
+
+    // logging of the scan and gui threads must not wait for the console
+    SgDebugToLog();
+
+    // export of the runtime metrics (see SgMetrics.h) to a file or to "unix:/path/of/socket"
+    SgMetricsExporter metrics_exporter;
+    if (const char* metrics_target = std::getenv("AUGMENTED_GO_METRICS")) {
+        try {
+            metrics_exporter.Start(metrics_target);
+        }
+        catch (const SgException& e) {
+            SG_LOG(SG_LOG_ERROR) << "Cannot export metrics: " << e.what();
+        }
+    }
+
     {
         using Go_Controller::BackendWorker;
         using Go_GUI::GUI;
@@ -25,6 +48,7 @@ int main(int argc, char** argv) {
 
         QThread worker_thread;
         QObject::connect( &worker_thread, SIGNAL(finished()), worker, SLOT(deleteLater()) ); // clean up the worker when the thread is stopped
+        QObject::connect( &worker_thread, &QThread::started, [] { SgTraceSetThreadName("backend"); } ); // emitted in the new thread
 
         // move the worker into the thread
         worker->moveToThread(&worker_thread);
@@ -63,6 +87,8 @@ int main(int argc, char** argv) {
         worker_thread.wait();
     } 
 
+    metrics_exporter.Stop();
+
     // "clean up" fuego
     GoFini();
     SgFini();
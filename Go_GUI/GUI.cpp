@@ -14,9 +14,25 @@
 #include "VirtualView.hpp"
 #include "AugmentedView.hpp"
 #include "Version.hpp"
+#include "SgLog.h"
+#include "SgMetrics.h"
+#include "SgTrace.h"
 
 
 namespace Go_GUI {
+
+namespace {
+// metrics of the image display, see SgMetrics.h
+SgMetricHistogram& image_seconds_metric = SgMetrics::Global().Histogram(
+    "ag_gui_image_seconds", "Time to display a new camera image");
+SgMetricCounter& images_metric = SgMetrics::Global().Counter(
+    "ag_gui_images_total", "Camera images displayed by the gui");
+SgMetricGauge& frame_rate_metric = SgMetrics::Global().Gauge(
+    "ag_gui_frames_per_second", "Camera images displayed by the gui per second");
+
+// only used by the gui thread
+SgMetricRate frame_rate(frame_rate_metric);
+}
     
 
 GUI::GUI(QWidget *parent)
@@ -68,6 +84,7 @@ GUI::GUI(QWidget *parent)
     connect(this->virtual_view,	        &VirtualView::signal_virtualViewplayMove,	this, &GUI::slot_passOnVirtualViewPlayMove);
     connect(ui_main.scannerdebugimage_action,	&QAction::triggered,	this, &GUI::slot_toggleScannerDebugImage);
     connect(ui_main.scanning_rate_action, &QAction::triggered,	this, &GUI::slot_MenuChangeScanRate);
+    connect(ui_main.save_trace_action,  &QAction::triggered,	this, &GUI::slot_MenuSaveTrace);
 
     // setting initial values
     this->init();
@@ -99,6 +116,11 @@ void GUI::init(){
 
     emit signal_setVirtualGameMode(ui_main.virtual_game_mode_action->isChecked());
 
+#ifndef SG_TRACE
+    // nothing is recorded if tracing was disabled at compile time
+    ui_main.save_trace_action->setEnabled(false);
+#endif
+
     // initially disable board selection buttons, they get enabled again when the first camera picture arrives
     slot_noCameraImage();
 }
@@ -203,7 +225,7 @@ void GUI::slot_MenuOpen(){
         this,
         "open sgf-file",
         NULL,
-        tr("SGF (*.sgf)" ),
+        tr("SGF (*.sgf);;Augmented Go snapshot (*.ags)" ),
         &selfilter 
     );
 
@@ -218,7 +240,7 @@ void GUI::slot_MenuSave(){
         this,
         "save sgf-file",
         NULL,
-        tr("SGF (*.sgf)" ),
+        tr("SGF (*.sgf);;Augmented Go snapshot (*.ags)" ),
         &selfilter 
     );
 
@@ -256,6 +278,18 @@ void GUI::slot_MenuChangeScanRate() {
     scan_rate_dialog.exec();
 }
 
+void GUI::slot_MenuSaveTrace() {
+    QString fileName = QFileDialog::getSaveFileName(
+        this,
+        "save timing trace",
+        NULL,
+        tr("Chrome trace (*.json)")
+    );
+
+    if (!fileName.isNull() && !SgTraceWriteChromeFile(fileName.toStdString()))
+        slot_displayErrorMessagebox("Save Timing Trace", "The trace could not be written to " + fileName);
+}
+
 void GUI::slot_BoardDetectionManually() {
     emit signal_boardDetectionManually();
 }
@@ -317,7 +351,12 @@ void GUI::slot_changeScanRate(int fps) {
 //////////
 
 void GUI::slot_newImage(QImage image) {
-        printf(">>> New Image arrived! '%d x %d' -- Format: %d <<<\n", image.width(), image.height(), image.format());
+        SG_TRACE_ZONE("GUI::slot_newImage");
+        SgMetricTimer timer(image_seconds_metric);
+        images_metric.Increment();
+        frame_rate.Tick();
+
+        SG_LOG(SG_LOG_DEBUG) << "New image arrived: " << image.width() << " x " << image.height() << ", format " << image.format();
         augmented_view->setImage(image);
         augmented_view->rescaleImage(augmented_view->parentWidget()->size());
 
@@ -373,7 +412,7 @@ void GUI::slot_newGameData(const Go_Backend::Game* game) {
     ui_main.forward_button->setDisabled(!go_game->canNavigateHistory(SgNode::Direction::NEXT));
     ui_main.backward_button->setDisabled(!go_game->canNavigateHistory(SgNode::Direction::PREVIOUS));
 
-    printf(">>> New Game data! <<<\n");
+    SG_LOG(SG_LOG_DEBUG) << "New game data";
 }    
 
 void GUI::slot_showFinishedGameResults(QString result){
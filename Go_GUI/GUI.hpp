@@ -263,6 +263,13 @@ private slots:
      */
     void slot_MenuChangeScanRate();
 
+    /**
+     * @brief	SLOT QAction "MenuSaveTrace"
+     *			opens a filedialog and saves the timing zones of scanner, backend and gui
+     *          in the Chrome trace format (viewable in chrome://tracing), see SgTrace.h
+     */
+    void slot_MenuSaveTrace();
+
     /**
      * @brief	SLOT "ViewSwitch"
      *			Switches big view with small view.
@@ -8,6 +8,7 @@
 #include <QtGui\QMouseEvent>
 
 #include <GoBoard.h>
+#include <SgTrace.h>
 
 namespace Go_GUI {
 
@@ -45,6 +46,8 @@ VirtualView::~VirtualView(){
 
 void VirtualView::createAndSetScene(QSize size, SgPointSet difference_points, const GoBoard* game_board)
 {
+    SG_TRACE_ZONE("VirtualView::createAndSetScene");
+
     if (game_board == nullptr)
         return;
 
@@ -0,0 +1,200 @@
+#include "SgSystem.h"
+#include "SgInit.h"
+#include "SgDebug.h"
+#include "SgException.h"
+#include "SgLog.h"
+#include "SgMetrics.h"
+#include "SgTrace.h"
+#include "GoInit.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include "GameGtpEngine.hpp"
+#include "Scanner.hpp"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: augmented_go_gtp [options]\n"
+                 "Scans the board with the camera and answers GTP commands about the game on stdin/stdout.\n"
+                 "  --port n        listen on 127.0.0.1:n instead of stdin/stdout, one client at a time\n"
+                 "  --interval ms   minimum time between two scans (default 40)\n"
+                 "  --stable ms     time a setup has to stay the same before the game is updated (default 100)\n"
+                 "  --workers n     number of threads for background commands (default 2)\n"
+                 "  --select mode   board selection before scanning: auto, manual or none (default auto)\n"
+                 "  --metrics path  export runtime metrics every 5 s to a file, or serve them on a unix socket with unix:path\n";
+}
+
+// same loop as Go_Controller::BackendWorker::scan(), but without images and the gui
+void scanLoop(Go_Backend::GameGtpEngine& engine, const std::atomic<bool>& stop, std::string select,
+              int interval_ms, int stable_ms) {
+    using std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+
+    SgTraceSetThreadName("scanner");
+
+    Go_Scanner::Scanner scanner;
+    GoSetup stable_reference_setup;
+    auto stable_since = steady_clock::now();
+    int board_size = 0;
+
+    // the board selection works on the last camera image of the scanner, so scan once before
+    if (select != "none") {
+        cv::Mat image;
+        GoSetup setup;
+        scanner.scanCamera(setup, board_size, image);
+        if (select == "manual")
+            scanner.selectBoardManually();
+        else
+            scanner.selectBoardAutomatically();
+    }
+
+    while (!stop) {
+        auto scan_start = steady_clock::now();
+
+        cv::Mat image;
+        GoSetup setup;
+        switch (scanner.scanCamera(setup, board_size, image)) {
+        case Go_Scanner::ScanResult::Success:
+            // only update the game if the same setup was scanned for some time,
+            // so a hand hovering over the board isn't detected as stones
+            if (!(setup == stable_reference_setup)) {
+                stable_reference_setup = setup;
+                stable_since = steady_clock::now();
+            }
+            else if (steady_clock::now() - stable_since >= milliseconds(stable_ms)) {
+                engine.updateFromScan(setup, board_size);
+            }
+            break;
+        case Go_Scanner::ScanResult::Failed:
+            engine.scanFailed("Board could not be detected correctly");
+            break;
+        case Go_Scanner::ScanResult::NoCamera:
+            engine.scanFailed("No camera image could be retrieved");
+            break;
+        }
+
+        std::this_thread::sleep_until(scan_start + milliseconds(interval_ms));
+    }
+}
+
+// serves one GTP client after another, until a client sends quit
+void serveSocket(Go_Backend::GameGtpEngine& engine, unsigned short port) {
+    using boost::asio::ip::tcp;
+
+    boost::asio::io_service io_service;
+    tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+    SG_LOG(SG_LOG_INFO) << "Waiting for GTP connections on 127.0.0.1:" << port;
+
+    while (!engine.quitReceived()) {
+        tcp::iostream stream;
+        boost::system::error_code error;
+        acceptor.accept(*stream.rdbuf(), error);
+        if (error) {
+            SG_LOG(SG_LOG_ERROR) << "Error accepting GTP connection: " << error.message();
+            continue;
+        }
+
+        // separate streams on the socket buffer, so the end of the input doesn't set the error state of the output
+        std::istream in_stream(stream.rdbuf());
+        std::ostream out_stream(stream.rdbuf());
+        GtpInputStream in(in_stream);
+        GtpOutputStream out(out_stream);
+        engine.MainLoop(in, out);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port       = 0;
+    int interval   = 40;
+    int stable     = 100;
+    int workers    = 2;
+    std::string select = "auto";
+    std::string metrics;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--port") == 0 && has_value)
+            port = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--interval") == 0 && has_value)
+            interval = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--stable") == 0 && has_value)
+            stable = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--workers") == 0 && has_value)
+            workers = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--select") == 0 && has_value)
+            select = argv[++i];
+        else if (std::strcmp(argv[i], "--metrics") == 0 && has_value)
+            metrics = argv[++i];
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // init fuego
+    SgInit();
+    GoInit();
+
+    // diagnostics of the scan thread must not wait for the terminal
+    SgDebugToLog();
+
+    SgTraceSetThreadName("gtp");
+
+    SgMetricsExporter metrics_exporter;
+    if (!metrics.empty()) {
+        try {
+            metrics_exporter.Start(metrics);
+        }
+        catch (const SgException& e) {
+            SG_LOG(SG_LOG_ERROR) << "Cannot export metrics: " << e.what();
+            return 1;
+        }
+    }
+
+    {
+        Go_Backend::GameGtpEngine engine(workers);
+
+        // our modules log to std::cerr (see SgLog.h), but libraries like OpenCV may still print to std::cout, which
+        // would corrupt the GTP responses on stdout, so std::cout is redirected to std::cerr and the responses go
+        // to the original stdout buffer
+        std::ostream gtp_stream(std::cout.rdbuf());
+        if (port == 0)
+            std::cout.rdbuf(std::cerr.rdbuf());
+
+        // the scanner is only used by the scan thread, GTP commands run concurrently
+        std::atomic<bool> stop(false);
+        std::thread scan_thread(scanLoop, std::ref(engine), std::cref(stop), select, interval, stable);
+
+        if (port > 0) {
+            serveSocket(engine, static_cast<unsigned short>(port));
+        }
+        else {
+            GtpInputStream in(std::cin);
+            GtpOutputStream out(gtp_stream);
+            engine.MainLoop(in, out);
+        }
+
+        stop = true;
+        scan_thread.join();
+        std::cout.rdbuf(gtp_stream.rdbuf());
+    }
+
+    metrics_exporter.Stop();
+
+    // "clean up" fuego
+    GoFini();
+    SgFini();
+
+    return 0;
+}
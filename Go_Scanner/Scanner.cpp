@@ -3,6 +3,9 @@
 #include "detect_linies_intersections.hpp"
 #include "detect_stones.hpp"
 #include "overwrittenOpenCV.hpp"
+#include "SgLog.h"
+#include "SgMetrics.h"
+#include "SgTrace.h"
 
 #include <iostream>
 
@@ -10,17 +13,32 @@ namespace Go_Scanner {
 using namespace cv;
 using namespace std;
 
+namespace {
+SgMetricHistogram& scan_seconds_metric = SgMetrics::Global().Histogram(
+    "ag_scanner_scan_seconds", "Time to read and scan a camera frame");
+
+const char* const frames_metric_name = "ag_scanner_frames_total";
+const char* const frames_metric_help = "Camera frames handled by the scanner, by scan result";
+SgMetricCounter& success_frames_metric    = SgMetrics::Global().Counter(frames_metric_name, frames_metric_help, "result=\"success\"");
+SgMetricCounter& failed_frames_metric     = SgMetrics::Global().Counter(frames_metric_name, frames_metric_help, "result=\"failed\"");
+SgMetricCounter& no_camera_frames_metric  = SgMetrics::Global().Counter(frames_metric_name, frames_metric_help, "result=\"no_camera\"");
+}
+
 ScanResult Scanner::scanCamera(GoSetup& setup, int& board_size, Mat& out_image) {
+    SG_TRACE_ZONE("Scanner::scanCamera");
+    SgMetricTimer timer(scan_seconds_metric);
+
     Mat frame;
     if (!readCameraFrame(frame)) {
 #ifdef ENABLE_DEBUG_IMAGE
         frame = imread("res/textures/example.jpg", CV_LOAD_IMAGE_COLOR);
         if (frame.empty()) {
-            std::cout << "Failed to load debug image from filesystem!" << std::endl;
-            std::cout << "In " << __FUNCTION__ << std::endl;
+            SG_LOG(SG_LOG_ERROR) << "Failed to load debug image from filesystem!";
+            no_camera_frames_metric.Increment();
             return ScanResult::NoCamera;
         }
 #else
+        no_camera_frames_metric.Increment();
         return ScanResult::NoCamera;
 #endif
     }
@@ -28,10 +46,17 @@ ScanResult Scanner::scanCamera(GoSetup& setup, int& board_size, Mat& out_image)
     auto success = scanner_main(frame, setup, board_size, _setDebugImg);
     out_image = frame;
 
-    return success ? ScanResult::Success : ScanResult::Failed;
+    if (success) {
+        success_frames_metric.Increment();
+        return ScanResult::Success;
+    }
+    failed_frames_metric.Increment();
+    return ScanResult::Failed;
 }
 
 bool Scanner::readCameraFrame(Mat& frame) {
+    SG_TRACE_ZONE("readCameraFrame");
+
     if (!_camera.isOpened()) {
         // try opening camera 0
         // when one camera is connected, it will always have id 0
@@ -135,7 +160,7 @@ bool scanner_main(Mat& camera_frame, GoSetup& setup, int& board_size, bool& setD
     }
     imshow("Detected Stones and Intersections", paintedWarpedImg);
 
-    std::cout << ">>> Scanning finished <<<" << std::endl;
+    SG_LOG(SG_LOG_DEBUG) << "Scanning finished";
 
     return stoneResult;
 
@@ -6,6 +6,9 @@
 #include <algorithm>
 #include <numeric>
 
+#include "SgLog.h"
+#include "SgTrace.h"
+
 namespace Go_Scanner {
 
     const char* thresh_window = "Thresh";
@@ -134,7 +137,7 @@ namespace Go_Scanner {
         // automatic_warp failed and board wasn't found
         // if one of the points wasn't set
         if (p0 == Point2f()) {
-            cout << "!!ERROR >> Failed to automatically detect the go board!" << endl;
+            SG_LOG(SG_LOG_ERROR) << "Failed to automatically detect the go board!";
             ask_for_board_contour();
             return;
         }
@@ -531,6 +534,8 @@ namespace Go_Scanner {
 
     bool getWarpedImg(Mat& warpedImg)
     {
+        SG_TRACE_ZONE("getWarpedImg");
+
         img0 = warpedImg.clone();
 
         // only process the image if the user  selected the board with "ask_for_board_contour" or "do_auto_board_detection" once.
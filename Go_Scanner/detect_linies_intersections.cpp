@@ -1,5 +1,6 @@
 #include "detect_linies_intersections.hpp"
 #include "overwrittenOpenCV.hpp"
+#include "SgTrace.h"
 
 #include <cmath>
 
@@ -441,6 +442,8 @@ void getBetterDetectionImage(Mat& houghImg, bool createFakeLines, int board_size
 
 bool getBoardIntersections(Mat warpedImg, int thresholdValue, int board_size, vector<Point2f> &intersectionPoints, Mat& paintedWarpedImg)
 {
+    SG_TRACE_ZONE("getBoardIntersections");
+
     imgheight = warpedImg.rows;
     imgwidth = warpedImg.cols;
 
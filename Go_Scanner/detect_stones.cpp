@@ -1,5 +1,6 @@
 #include "detect_stones.hpp"
 #include "overwrittenOpenCV.hpp"
+#include "SgTrace.h"
 
 namespace Go_Scanner {
 
@@ -276,6 +277,8 @@ map<Point2f, SgPoint, lesserPoint2f> getBoardCoordMapFor(vector<Point2f> interse
 
 bool getStones(Mat srcWarpedImg, vector<Point2f> intersectionPoints, GoSetup& setup, int& board_size,Mat& paintedWarpedImg)
 {
+    SG_TRACE_ZONE("getStones");
+
     // Calc the minimum distance between the first intersection point to all others
     // The minimum distance is approximately the diameter of a stone
     vector<double> distances;
@@ -5,6 +5,31 @@
 #include "SgSystem.h"
 #include "GoAutoBook.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include "SgWrite.h"
+
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::max() is used below
+#endif
+#include <windows.h>
+#endif
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/** Identifies a binary book file (including the format version). */
+const char FILE_MAGIC[8] = { 'G', 'o', 'A', 'B', 'o', 'o', 'k', '1' };
+
+/** Written as a 32-bit integer to detect a different byte order. */
+const uint32_t FILE_BYTE_ORDER = 0x01020304;
+
+} // namespace
+
 //----------------------------------------------------------------------------
 
 GoAutoBookState::GoAutoBookState(const GoBoard& brd)
@@ -75,10 +100,234 @@ GoAutoBookParam::GoAutoBookParam()
 
 //----------------------------------------------------------------------------
 
+void GoAutoBookTable::Record::Get(SgBookNode& node) const
+{
+    node.m_heurValue = m_heurValue;
+    node.m_value = m_value;
+    node.m_priority = m_priority;
+    node.m_count = m_count;
+}
+
+void GoAutoBookTable::Record::Set(uint64_t key, const SgBookNode& node)
+{
+    m_key = key;
+    m_heurValue = node.m_heurValue;
+    m_value = node.m_value;
+    m_priority = node.m_priority;
+    m_count = node.m_count;
+}
+
+//----------------------------------------------------------------------------
+
+GoAutoBookTable::Iterator::Iterator(const GoAutoBookTable& table)
+    : m_table(table),
+      m_index(0),
+      m_current(0)
+{
+    FindNext();
+}
+
+void GoAutoBookTable::Iterator::operator++()
+{
+    ++m_index;
+    FindNext();
+}
+
+void GoAutoBookTable::Iterator::FindNext()
+{
+    const std::size_t nuSlots = m_table.m_slots.size();
+    for ( ; m_index < nuSlots; ++m_index)
+        if (m_table.m_slots[m_index].m_key != 0)
+        {
+            m_current = &m_table.m_slots[m_index];
+            return;
+        }
+    if (m_index == nuSlots)
+    {
+        if (m_table.m_hasZeroKey)
+        {
+            m_current = &m_table.m_zeroKey;
+            return;
+        }
+        ++m_index;
+    }
+    for ( ; m_index < nuSlots + 1 + m_table.m_nuBaseSlots; ++m_index)
+    {
+        const Record& record = m_table.m_baseSlots[m_index - nuSlots - 1];
+        if (record.m_key != 0 && m_table.FindOwn(record.m_key) == 0)
+        {
+            m_current = &record;
+            return;
+        }
+    }
+    m_current = 0;
+}
+
+//----------------------------------------------------------------------------
+
+GoAutoBookTable::GoAutoBookTable()
+    : m_nuSlotsUsed(0),
+      m_hasZeroKey(false),
+      m_baseSlots(0),
+      m_nuBaseSlots(0),
+      m_nuBaseNodes(0),
+      m_nuHidden(0)
+{
+}
+
+void GoAutoBookTable::Clear()
+{
+    std::vector<Record>().swap(m_slots);
+    m_nuSlotsUsed = 0;
+    m_hasZeroKey = false;
+    m_baseSlots = 0;
+    m_nuBaseSlots = 0;
+    m_nuBaseNodes = 0;
+    m_nuHidden = 0;
+}
+
+bool GoAutoBookTable::Contains(uint64_t key) const
+{
+    return FindOwn(key) != 0
+        || (key != 0 && Find(m_baseSlots, m_nuBaseSlots, key) != 0);
+}
+
+const GoAutoBookTable::Record* GoAutoBookTable::Find(const Record* slots,
+                                                     std::size_t nuSlots,
+                                                     uint64_t key)
+{
+    SG_ASSERT(key != 0);
+    if (nuSlots == 0)
+        return 0;
+    const std::size_t mask = nuSlots - 1;
+    for (std::size_t i = static_cast<std::size_t>(key) & mask; ;
+         i = (i + 1) & mask)
+    {
+        if (slots[i].m_key == key)
+            return &slots[i];
+        if (slots[i].m_key == 0)
+            return 0;
+    }
+}
+
+const GoAutoBookTable::Record* GoAutoBookTable::FindOwn(uint64_t key) const
+{
+    if (key == 0)
+        return m_hasZeroKey ? &m_zeroKey : 0;
+    return m_slots.empty() ? 0 : Find(&m_slots[0], m_slots.size(), key);
+}
+
+bool GoAutoBookTable::Get(uint64_t key, SgBookNode& node) const
+{
+    const Record* record = FindOwn(key);
+    if (record == 0 && key != 0)
+        record = Find(m_baseSlots, m_nuBaseSlots, key);
+    if (record == 0)
+        return false;
+    record->Get(node);
+    return true;
+}
+
+void GoAutoBookTable::Grow()
+{
+    std::vector<Record> old;
+    old.swap(m_slots);
+    Record empty;
+    std::memset(&empty, 0, sizeof(empty));
+    m_slots.resize(old.empty() ? 1024 : 2 * old.size(), empty);
+    m_nuSlotsUsed = 0;
+    for (std::vector<Record>::const_iterator it = old.begin();
+         it != old.end(); ++it)
+        if (it->m_key != 0)
+            Insert(*it);
+}
+
+bool GoAutoBookTable::Insert(const Record& record)
+{
+    SG_ASSERT(record.m_key != 0);
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = static_cast<std::size_t>(record.m_key) & mask; ;
+         i = (i + 1) & mask)
+    {
+        if (m_slots[i].m_key == record.m_key)
+        {
+            m_slots[i] = record;
+            return false;
+        }
+        if (m_slots[i].m_key == 0)
+        {
+            m_slots[i] = record;
+            ++m_nuSlotsUsed;
+            return true;
+        }
+    }
+}
+
+std::size_t GoAutoBookTable::NuSlotsFor(std::size_t nuNodes)
+{
+    std::size_t nuSlots = 1;
+    while (nuSlots * MAX_LOAD <= nuNodes * 100)
+        nuSlots *= 2;
+    return nuSlots;
+}
+
+void GoAutoBookTable::Put(uint64_t key, const SgBookNode& node)
+{
+    Record record;
+    record.Set(key, node);
+    bool isNew;
+    if (key == 0)
+    {
+        isNew = ! m_hasZeroKey;
+        m_hasZeroKey = true;
+        m_zeroKey = record;
+    }
+    else
+    {
+        if ((m_nuSlotsUsed + 1) * 100 > m_slots.size() * MAX_LOAD
+            && FindOwn(key) == 0)
+            Grow();
+        isNew = Insert(record);
+    }
+    if (isNew && key != 0 && Find(m_baseSlots, m_nuBaseSlots, key) != 0)
+        ++m_nuHidden;
+}
+
+void GoAutoBookTable::SetBase(const Record* slots, std::size_t nuSlots,
+                              std::size_t nuNodes)
+{
+    SG_ASSERT(NuOwnNodes() == 0);
+    SG_ASSERT((nuSlots & (nuSlots - 1)) == 0);
+    m_baseSlots = slots;
+    m_nuBaseSlots = nuSlots;
+    m_nuBaseNodes = nuNodes;
+    m_nuHidden = 0;
+}
+
+//----------------------------------------------------------------------------
+
+/** Header of a binary book file.
+    The header is followed by the hash table with m_nuSlots slots of type
+    GoAutoBookTable::Record, and by the log, which contains records until
+    the end of the file. */
+struct GoAutoBook::FileHeader
+{
+    char m_magic[8];
+
+    uint32_t m_byteOrder;
+
+    uint32_t m_reserved;
+
+    uint64_t m_nuSlots;
+
+    uint64_t m_nuNodes;
+};
+
 GoAutoBook::GoAutoBook(const std::string& filename,
                        const GoAutoBookParam& param)
     : m_param(param), 
-      m_filename(filename)
+      m_filename(filename),
+      m_canAppend(false)
 {
     std::ifstream is(filename.c_str());
     if (!is)
@@ -90,21 +339,8 @@ GoAutoBook::GoAutoBook(const std::string& filename,
     }
     else
     {
-        while (is)
-        {
-            std::string line;
-            std::getline(is, line);
-            if (line.size() < 19)
-                continue;
-            std::string str;
-            std::istringstream iss(line);
-            iss >> str;
-            SgHashCode hash;
-            hash.FromString(str);
-            SgBookNode node(line.substr(19));
-            m_data[hash] = node;
-        }
-        SgDebug() << "GoAutoBook: Parsed " << m_data.size() << " lines.\n";
+        is.close();
+        Load();
     }
 }
 
@@ -114,52 +350,263 @@ GoAutoBook::~GoAutoBook()
 
 bool GoAutoBook::Get(const GoAutoBookState& state, SgBookNode& node) const
 {
-    Map::const_iterator it = m_data.find(state.GetHashCode());
-    if (it != m_data.end())
+    return Get(state.GetHashCode(), node);
+}
+
+bool GoAutoBook::Get(const SgHashCode& hash, SgBookNode& node) const
+{
+    return m_data.Get(hash.Word64(), node);
+}
+
+void GoAutoBook::Load()
+{
+    m_data.Clear();
+    m_file.Close();
+    m_changed.clear();
+    m_canAppend = false;
+    if (! LoadBinary())
+        LoadText();
+}
+
+bool GoAutoBook::LoadBinary()
+{
+    if (! m_file.Open(m_filename))
+        throw SgException("Cannot read " + m_filename);
+    const char* begin = m_file.Begin();
+    const std::size_t size = m_file.Size();
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(begin);
+    if (size < sizeof(FileHeader)
+        || std::memcmp(header->m_magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+    {
+        m_file.Close();
+        return false;
+    }
+    const std::size_t recordSize = sizeof(GoAutoBookTable::Record);
+    if (header->m_byteOrder != FILE_BYTE_ORDER
+        || header->m_nuSlots == 0
+        || (header->m_nuSlots & (header->m_nuSlots - 1)) != 0
+        || header->m_nuNodes >= header->m_nuSlots
+        || size < sizeof(FileHeader) + header->m_nuSlots * recordSize)
+    {
+        m_file.Close();
+        throw SgException("Invalid book file " + m_filename);
+    }
+    const GoAutoBookTable::Record* slots =
+        reinterpret_cast<const GoAutoBookTable::Record*>(
+                                                begin + sizeof(FileHeader));
+    m_data.SetBase(slots, static_cast<std::size_t>(header->m_nuSlots),
+                   static_cast<std::size_t>(header->m_nuNodes));
+    const GoAutoBookTable::Record* logBegin = slots + header->m_nuSlots;
+    const std::size_t logSize =
+        size - sizeof(FileHeader) - header->m_nuSlots * recordSize;
+    const GoAutoBookTable::Record* logEnd = logBegin + logSize / recordSize;
+    SgBookNode node;
+    for (const GoAutoBookTable::Record* it = logBegin; it != logEnd; ++it)
+    {
+        it->Get(node);
+        m_data.Put(it->m_key, node);
+    }
+    // An incomplete record at the end of the log (interrupted flush) is
+    // ignored, but the log cannot be appended to anymore
+    m_canAppend = (logSize % recordSize == 0);
+    if (! m_canAppend)
+        SgWarning() << "GoAutoBook: incomplete record at end of "
+                    << m_filename << '\n';
+    SgDebug() << "GoAutoBook: Mapped " << header->m_nuNodes << " nodes, "
+              << "loaded " << (logEnd - logBegin) << " log records.\n";
+    return true;
+}
+
+void GoAutoBook::LoadText()
+{
+    std::ifstream is(m_filename.c_str());
+    std::size_t count = 0;
+    while (is)
     {
-        node = it->second;
-        return true;
+        std::string line;
+        std::getline(is, line);
+        if (line.size() < 19)
+            continue;
+        std::string str;
+        std::istringstream iss(line);
+        iss >> str;
+        SgHashCode hash;
+        hash.FromString(str);
+        SgBookNode node(line.substr(19));
+        m_data.Put(hash.Word64(), node);
+        ++count;
     }
-    return false;
+    SgDebug() << "GoAutoBook: Parsed " << count << " lines.\n";
+}
+
+std::size_t GoAutoBook::NuNodes() const
+{
+    return m_data.Size();
 }
 
 void GoAutoBook::Put(const GoAutoBookState& state, const SgBookNode& node)
 {
-    m_data[state.GetHashCode()] = node;
+    const uint64_t key = state.GetHashCode().Word64();
+    m_data.Put(key, node);
+    m_changed.push_back(key);
 }
 
 void GoAutoBook::Flush()
 {
-    Save(m_filename);
+    if (! m_canAppend)
+    {
+        Save(m_filename);
+        return;
+    }
+    std::sort(m_changed.begin(), m_changed.end());
+    m_changed.erase(std::unique(m_changed.begin(), m_changed.end()),
+                    m_changed.end());
+    std::vector<GoAutoBookTable::Record> records(m_changed.size());
+    for (std::size_t i = 0; i < m_changed.size(); ++i)
+    {
+        SgBookNode node;
+        m_data.Get(m_changed[i], node);
+        records[i].Set(m_changed[i], node);
+    }
+    std::ofstream out(m_filename.c_str(),
+                      std::ios::out | std::ios::binary | std::ios::app);
+    if (! records.empty())
+        out.write(reinterpret_cast<const char*>(&records[0]),
+                  records.size() * sizeof(GoAutoBookTable::Record));
+    if (! out)
+        throw SgException("Error writing " + m_filename);
+    m_changed.clear();
 }
 
-void GoAutoBook::Save(const std::string& filename) const
+void GoAutoBook::Save(const std::string& filename)
+{
+    if (filename != m_filename)
+    {
+        WriteBinary(filename);
+        return;
+    }
+    // Write a new file and replace the book file with it, so that the book
+    // file stays complete, if writing fails. The nodes are read again from
+    // the new file only after it replaced the book file.
+    const std::string tempFilename = filename + ".tmp";
+    try
+    {
+        WriteBinary(tempFilename);
+    }
+    catch (const SgException&)
+    {
+        std::remove(tempFilename.c_str());
+        throw;
+    }
+#ifdef WIN32
+    // A mapped file cannot be replaced on Windows
+    m_data.Clear();
+    m_file.Close();
+    if (! MoveFileExA(tempFilename.c_str(), filename.c_str(),
+                      MOVEFILE_REPLACE_EXISTING))
+    {
+        // The book file is unchanged, but only the new file has all nodes,
+        // continue with the new file
+        m_filename = tempFilename;
+        Load();
+        throw SgException("Cannot replace " + filename
+                          + ", the book is continued in " + tempFilename);
+    }
+#else
+    // rename() replaces the book file atomically, the old file stays mapped
+    // until Load() closes it
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+        throw SgException("Cannot rename " + tempFilename + " to "
+                          + filename);
+#endif
+    Load();
+}
+
+void GoAutoBook::SaveText(const std::string& filename) const
 {
     std::ofstream out(filename.c_str());
-    for (Map::const_iterator it = m_data.begin(); it != m_data.end(); ++it)
+    out.fill('0');
+    for (GoAutoBookTable::Iterator it(m_data); it; ++it)
+    {
+        SgBookNode node;
+        (*it).Get(node);
+        out << std::hex << std::setw(16) << (*it).m_key << std::dec << '\t' 
+            << node.ToString() << '\n';
+    }
+    out.close();
+}
+
+void GoAutoBook::WriteBinary(const std::string& filename) const
+{
+    const std::size_t nuNodes = m_data.Size();
+    const std::size_t nuSlots = GoAutoBookTable::NuSlotsFor(nuNodes);
+    GoAutoBookTable::Record empty;
+    std::memset(&empty, 0, sizeof(empty));
+    std::vector<GoAutoBookTable::Record> slots(nuSlots, empty);
+    std::vector<GoAutoBookTable::Record> log;
+    std::size_t nuTableNodes = 0;
+    for (GoAutoBookTable::Iterator it(m_data); it; ++it)
     {
-        out << it->first.ToString() << '\t' 
-            << it->second.ToString() << '\n';
+        // Key 0 marks empty slots, the node is stored in the log
+        if ((*it).m_key == 0)
+        {
+            log.push_back(*it);
+            continue;
+        }
+        std::size_t i = static_cast<std::size_t>((*it).m_key) & (nuSlots - 1);
+        while (slots[i].m_key != 0)
+            i = (i + 1) & (nuSlots - 1);
+        slots[i] = *it;
+        ++nuTableNodes;
     }
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.m_magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.m_byteOrder = FILE_BYTE_ORDER;
+    header.m_nuSlots = nuSlots;
+    header.m_nuNodes = nuTableNodes;
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&slots[0]),
+              slots.size() * sizeof(GoAutoBookTable::Record));
+    if (! log.empty())
+        out.write(reinterpret_cast<const char*>(&log[0]),
+                  log.size() * sizeof(GoAutoBookTable::Record));
     out.close();
+    if (! out)
+        throw SgException("Error writing " + filename);
+}
+
+void GoAutoBook::WriteInfo(std::ostream& out) const
+{
+    out << SgWriteLabel("Nodes") << m_data.Size() << '\n'
+        << SgWriteLabel("NodesInMemory") << m_data.NuOwnNodes() << '\n'
+        << SgWriteLabel("MemoryUsed") << m_data.MemoryUsed() << '\n'
+        << SgWriteLabel("MappedFileSize") << m_file.Size() << '\n'
+        << SgWriteLabel("Unflushed") << m_changed.size() << '\n';
 }
 
 void GoAutoBook::Merge(const GoAutoBook& other)
 {
     SgDebug() << "GoAutoBook::Merge()\n";
+    // Merging a book with itself does not change it
+    if (&other == this)
+        return;
     std::size_t newLeafs = 0;
     std::size_t newInternal = 0;
     std::size_t leafsInCommon = 0;
     std::size_t internalInCommon = 0;
     std::size_t leafToInternal = 0;
-    for (Map::const_iterator it = other.m_data.begin();
-         it != other.m_data.end(); ++it)
+    for (GoAutoBookTable::Iterator it(other.m_data); it; ++it)
     {
-        Map::iterator mine = m_data.find(it->first);
-        SgBookNode newNode(it->second);
-        if (mine == m_data.end())
+        const uint64_t key = (*it).m_key;
+        SgBookNode newNode;
+        (*it).Get(newNode);
+        SgBookNode oldNode;
+        if (! m_data.Get(key, oldNode))
         {
-            m_data[it->first] = it->second;
+            m_data.Put(key, newNode);
+            m_changed.push_back(key);
             if (newNode.IsLeaf())
                 newLeafs++;
             else
@@ -167,12 +614,12 @@ void GoAutoBook::Merge(const GoAutoBook& other)
         }
         else
         {
-            SgBookNode oldNode(mine->second);
             if (newNode.IsLeaf() && oldNode.IsLeaf())
             {
                 newNode.m_heurValue = 0.5f * (newNode.m_heurValue 
                                              + oldNode.m_heurValue);
-                m_data[it->first] = newNode;
+                m_data.Put(key, newNode);
+                m_changed.push_back(key);
                 leafsInCommon++;
             }
             else if (!newNode.IsLeaf())
@@ -185,7 +632,8 @@ void GoAutoBook::Merge(const GoAutoBook& other)
                 // accurate after the merge.  I don't think it matters
                 // that much.
                 newNode.m_count = std::max(newNode.m_count, oldNode.m_count);
-                m_data[it->first] = newNode;
+                m_data.Put(key, newNode);
+                m_changed.push_back(key);
                 if (!oldNode.IsLeaf())
                     internalInCommon++;
                 else 
@@ -259,16 +707,18 @@ void GoAutoBook::ImportHashValuePairs(std::istream& in)
         if (!in) 
             break;
         in >> value;
-        if (m_data.count(hash) == 0)
+        const uint64_t key = hash.Word64();
+        SgBookNode node;
+        if (! m_data.Get(key, node))
         {
             std::ostringstream os;
             os << "Unknown hash: " << hash << '\n';
             throw SgException(os.str());
         }
-        SgBookNode node(m_data[hash]);
         node.m_heurValue = value;
         node.m_value = value;
-        m_data[hash] = node;
+        m_data.Put(key, node);
+        m_changed.push_back(key);
         count++;
     }
     SgDebug() << "GoAutoBook::ImportHashValue: imported " 
@@ -10,7 +10,10 @@
 #include <fstream>
 #include <set>
 #include <map>
+#include <stdint.h>
+#include <vector>
 #include "SgBookBuilder.h"
+#include "SgMappedFile.h"
 #include "SgThreadedWorker.h"
 #include "GoBoard.h"
 #include "GoBoardSynchronizer.h"
@@ -83,11 +86,177 @@ struct GoAutoBookParam
 
 //----------------------------------------------------------------------------
 
-/** Simple text-based book format.
-    Entire book is loaded into memory. */
+/** Open-addressing hash table of book nodes.
+    Uses linear probing on the 64-bit hash code. Key 0 marks an empty slot,
+    a node with hash code 0 is stored separately.
+    The table can have a read-only base table with the same slot layout
+    (see SetBase()), usually the table of a memory-mapped book file. Nodes
+    that are put into the table are stored in the table's own slots and
+    hide the nodes of the base table with the same key. */
+class GoAutoBookTable
+{
+public:
+    /** Slot of the table.
+        Also the record of the binary book file, see GoAutoBook. */
+    struct Record
+    {
+        uint64_t m_key;
+
+        float m_heurValue;
+
+        float m_value;
+
+        float m_priority;
+
+        uint32_t m_count;
+
+        void Get(SgBookNode& node) const;
+
+        void Set(uint64_t key, const SgBookNode& node);
+    };
+
+    /** Iterates over all nodes, including the nodes of the base table that
+        are not hidden. */
+    class Iterator
+    {
+    public:
+        Iterator(const GoAutoBookTable& table);
+
+        const Record& operator*() const;
+
+        void operator++();
+
+        operator bool() const;
+
+    private:
+        const GoAutoBookTable& m_table;
+
+        /** Index in the slots of the table followed by the slot for key 0
+            and the slots of the base table. */
+        std::size_t m_index;
+
+        const Record* m_current;
+
+        void FindNext();
+    };
+
+    GoAutoBookTable();
+
+    /** Remove all nodes and the base table. */
+    void Clear();
+
+    bool Contains(uint64_t key) const;
+
+    /** Get a node.
+        @return false, if there is no node with this key. */
+    bool Get(uint64_t key, SgBookNode& node) const;
+
+    void Put(uint64_t key, const SgBookNode& node);
+
+    /** Number of nodes. */
+    std::size_t Size() const;
+
+    /** Number of nodes in the own slots of the table. */
+    std::size_t NuOwnNodes() const;
+
+    /** Memory used by the own slots in bytes. */
+    std::size_t MemoryUsed() const;
+
+    /** Set read-only base table.
+        @param slots The slots (not owned), the empty slots have key 0
+        @param nuSlots The number of slots, a power of two
+        @param nuNodes The number of non-empty slots */
+    void SetBase(const Record* slots, std::size_t nuSlots,
+                 std::size_t nuNodes);
+
+    /** Number of slots of a table with load factor at most MAX_LOAD for a
+        number of nodes. */
+    static std::size_t NuSlotsFor(std::size_t nuNodes);
+
+    /** Find the slot of a key in a table.
+        @return The slot or 0, if the key is not in the table */
+    static const Record* Find(const Record* slots, std::size_t nuSlots,
+                              uint64_t key);
+
+private:
+    friend class Iterator;
+
+    /** Maximum load factor in percent. */
+    static const std::size_t MAX_LOAD = 75;
+
+    std::vector<Record> m_slots;
+
+    /** Number of non-empty slots in m_slots. */
+    std::size_t m_nuSlotsUsed;
+
+    bool m_hasZeroKey;
+
+    Record m_zeroKey;
+
+    const Record* m_baseSlots;
+
+    std::size_t m_nuBaseSlots;
+
+    std::size_t m_nuBaseNodes;
+
+    /** Number of own nodes that hide a node of the base table. */
+    std::size_t m_nuHidden;
+
+    const Record* FindOwn(uint64_t key) const;
+
+    void Grow();
+
+    /** Insert into own slots without checking the load factor.
+        @return true, if the key was new */
+    bool Insert(const Record& record);
+};
+
+inline GoAutoBookTable::Iterator::operator bool() const
+{
+    return m_current != 0;
+}
+
+inline const GoAutoBookTable::Record&
+GoAutoBookTable::Iterator::operator*() const
+{
+    SG_ASSERT(m_current != 0);
+    return *m_current;
+}
+
+inline std::size_t GoAutoBookTable::MemoryUsed() const
+{
+    return m_slots.capacity() * sizeof(Record);
+}
+
+inline std::size_t GoAutoBookTable::NuOwnNodes() const
+{
+    return m_nuSlotsUsed + (m_hasZeroKey ? 1 : 0);
+}
+
+inline std::size_t GoAutoBookTable::Size() const
+{
+    return NuOwnNodes() + m_nuBaseNodes - m_nuHidden;
+}
+
+//----------------------------------------------------------------------------
+
+/** Book of SgBookBuilder nodes stored by hash code.
+    The book is kept in an open-addressing hash table (GoAutoBookTable).
+    Books can be read from the old text format (one line per node with the
+    hash code and SgBookNode::ToString()), but are saved in a binary format:
+    a header, a hash table that can be searched in place, and a log of
+    records appended by Flush(). Records in the log override records with
+    the same key in the table and in earlier parts of the log. When a binary
+    book is opened, the file is memory-mapped read-only and only the log is
+    loaded into memory, so lookups in large books need no loading time.
+    Save() to the file of the book compacts the log into the table.
+    The file uses the byte order of the machine. */
 class GoAutoBook
 {
 public:
+    /** Open a book file.
+        Creates an empty file, if the file does not exist.
+        @throws SgException if the file cannot be created or read */
     GoAutoBook(const std::string& filename,
                const GoAutoBookParam& param);
 
@@ -97,14 +266,35 @@ public:
         in the book, and false otherwise. */
     bool Get(const GoAutoBookState& state, SgBookNode& node) const;
 
+    /** Read the node with the given hash code (see
+        GoAutoBookState::GetHashCode()). */
+    bool Get(const SgHashCode& hash, SgBookNode& node) const;
+
     /** Store the node in the given state. */
     void Put(const GoAutoBookState& state, const SgBookNode& node);
 
-    /** Since there is no cache, same as Save(). */
+    /** Writes the nodes changed since the last flush to the book file.
+        Appends them to the log of a binary book file, otherwise same as
+        Save() to the file of the book. */
     void Flush();
 
-    /** Writes book to disk. */
-    void Save(const std::string& filename) const;
+    /** Writes book to disk in binary format.
+        If the file is the file of the book, a new file is written and
+        replaces the book file, then it is mapped again. If writing fails,
+        the book file and the nodes in memory are unchanged (on Windows, if
+        only replacing fails, the book continues with the new file
+        "filename.tmp").
+        @throws SgException if the file cannot be written or replaced */
+    void Save(const std::string& filename);
+
+    /** Writes book to disk in the old text format. */
+    void SaveText(const std::string& filename) const;
+
+    /** Number of nodes in the book. */
+    std::size_t NuNodes() const;
+
+    /** Write information about the size and memory use of the book. */
+    void WriteInfo(std::ostream& out) const;
 
     /** Helper function: calls FindBestChild() on the given board.*/
     SgMove LookupMove(const GoBoard& brd) const;
@@ -149,9 +339,10 @@ public:
     static std::vector< std::vector<SgMove> > ParseWorkList(std::istream& in);
 
 private:
-    typedef std::map<SgHashCode, SgBookNode> Map;
+    /** Header of a binary book file, see GoAutoBook.cpp */
+    struct FileHeader;
 
-    Map m_data;
+    GoAutoBookTable m_data;
 
     const GoAutoBookParam& m_param;
 
@@ -159,6 +350,27 @@ private:
 
     std::string m_filename;
 
+    SgMappedFile m_file;
+
+    /** The book file is a binary book file with a complete log, so that
+        Flush() can append to it. */
+    bool m_canAppend;
+
+    /** Keys of the nodes put since the last flush (can contain
+        duplicates). */
+    std::vector<uint64_t> m_changed;
+
+    /** Read the book file, see constructor. */
+    void Load();
+
+    /** Map a binary book file and load its log.
+        @return false, if the file is not a binary book file */
+    bool LoadBinary();
+
+    void LoadText();
+
+    void WriteBinary(const std::string& filename) const;
+
     void TruncateByDepth(int depth, GoAutoBookState& state, 
                          GoAutoBook& other, 
                          std::set<SgHashCode>& seen) const;
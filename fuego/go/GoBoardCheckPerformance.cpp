@@ -6,15 +6,621 @@
 #include "SgSystem.h"
 #include "GoBoardCheckPerformance.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <boost/random/mersenne_twister.hpp>
 #include "GoBoard.h"
 #include "GoBoardUtil.h"
+#include "GoIncrementalSafety.h"
+#include "GoLadder.h"
+#include "GoRegionBoard.h"
+#include "GoSafetySolver.h"
+#include "GoSetupUtil.h"
+#include "SgGameReader.h"
+#include "SgHash.h"
+#include "SgNode.h"
+#include "SgPointSet.h"
 #include "SgTime.h"
+#include "SgVector.h"
 
 using namespace std;
 
 //----------------------------------------------------------------------------
 
+namespace {
+
+/** Number of games in the corpus of each board size. */
+const int NU_CORPUS_GAMES = 4;
+
+/** Fixed positions of one board size, see
+    GoBoardCheckPerformance::RunBenchmarks() */
+class Corpus
+{
+public:
+    /** Generate the corpus.
+        Plays random games (the moves are tried in random order, starting
+        at a random point, and own single point eyes are not filled) with a
+        seed that depends only on the board size. A position is taken every
+        size * size / 4 moves. */
+    explicit Corpus(int size);
+
+    ~Corpus();
+
+    int Size() const;
+
+    /** An empty board for the benchmarks that play moves. */
+    GoBoard& Board();
+
+    /** An analyzer for the ladder benchmarks.
+        Its cache is cleared by ClearLadderCache() before each iteration. */
+    GoLadderAnalyzer& LadderAnalyzer();
+
+    const vector<vector<SgMove> >& Games() const;
+
+    const vector<GoBoard*>& Positions() const;
+
+    /** The games in SGF format. */
+    const string& Sgf() const;
+
+private:
+    int m_size;
+
+    GoBoard m_board;
+
+    GoLadderAnalyzer m_ladderAnalyzer;
+
+    vector<vector<SgMove> > m_games;
+
+    /** Owned. */
+    vector<GoBoard*> m_positions;
+
+    string m_sgf;
+
+    void WriteSgf(ostream& out, const vector<SgMove>& moves) const;
+
+    /** Not implemented */
+    Corpus(const Corpus&);
+
+    /** Not implemented */
+    Corpus& operator=(const Corpus&);
+};
+
+Corpus::Corpus(int size)
+    : m_size(size),
+      m_board(size)
+{
+    // Not SgRandom, the corpus must not depend on SgRandom::SetSeed()
+    boost::mt19937 random(size);
+    const size_t maxMoves = 2 * size * size;
+    const size_t positionInterval = size * size / 4;
+    ostringstream sgf;
+    vector<SgPoint> empty;
+    for (int i = 0; i < NU_CORPUS_GAMES; ++i)
+    {
+        GoBoard& bd = m_board;
+        vector<SgMove> moves;
+        int nuPasses = 0;
+        while (nuPasses < 2 && moves.size() < maxMoves)
+        {
+            empty.clear();
+            for (SgSetIterator it(bd.AllEmpty()); it; ++it)
+                empty.push_back(*it);
+            SgMove move = SG_PASS;
+            if (! empty.empty())
+            {
+                size_t start = random() % empty.size();
+                for (size_t j = 0; j < empty.size(); ++j)
+                {
+                    SgPoint p = empty[(start + j) % empty.size()];
+                    if (! GoBoardUtil::IsCompletelySurrounded(bd, p)
+                        && bd.IsLegal(p))
+                    {
+                        move = p;
+                        break;
+                    }
+                }
+            }
+            bd.Play(move);
+            moves.push_back(move);
+            nuPasses = (move == SG_PASS ? nuPasses + 1 : 0);
+            if (moves.size() % positionInterval == 0)
+                m_positions.push_back(
+                       new GoBoard(size, GoSetupUtil::CurrentPosSetup(bd)));
+        }
+        for (size_t j = 0; j < moves.size(); ++j)
+            bd.Undo();
+        WriteSgf(sgf, moves);
+        m_games.push_back(moves);
+    }
+    m_sgf = sgf.str();
+}
+
+Corpus::~Corpus()
+{
+    for (size_t i = 0; i < m_positions.size(); ++i)
+        delete m_positions[i];
+}
+
+inline GoBoard& Corpus::Board()
+{
+    return m_board;
+}
+
+inline GoLadderAnalyzer& Corpus::LadderAnalyzer()
+{
+    return m_ladderAnalyzer;
+}
+
+inline const vector<vector<SgMove> >& Corpus::Games() const
+{
+    return m_games;
+}
+
+inline const vector<GoBoard*>& Corpus::Positions() const
+{
+    return m_positions;
+}
+
+inline const string& Corpus::Sgf() const
+{
+    return m_sgf;
+}
+
+inline int Corpus::Size() const
+{
+    return m_size;
+}
+
+void Corpus::WriteSgf(ostream& out, const vector<SgMove>& moves) const
+{
+    out << "(;FF[4]GM[1]SZ[" << m_size << ']';
+    SgBlackWhite toPlay = SG_BLACK;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        out << ';' << (toPlay == SG_BLACK ? 'B' : 'W') << '[';
+        if (moves[i] != SG_PASS)
+            out << static_cast<char>('a' + SgPointUtil::Col(moves[i]) - 1)
+                << static_cast<char>('a' + m_size - SgPointUtil::Row(moves[i]));
+        out << ']';
+        if (i % 8 == 7)
+            out << '\n';
+        toPlay = SgOppBW(toPlay);
+    }
+    out << ")\n";
+}
+
+//----------------------------------------------------------------------------
+
+/** A benchmark.
+    Runs one iteration on the corpus and returns a checksum of the computed
+    values.
+    @param corpus
+    @param[out] nuOps The number of operations of an iteration, the unit of
+    the time per operation. */
+typedef long long (*BenchmarkFunction)(Corpus& corpus, long long& nuOps);
+
+/** Preparation of an iteration of a benchmark, e.g. clearing a cache.
+    Not included in the time of the benchmark. */
+typedef void (*BenchmarkSetup)(Corpus& corpus);
+
+/** Play and undo all moves of the games. One operation is a Play() and an
+    Undo(). */
+long long BenchmarkPlayUndo(Corpus& corpus, long long& nuOps)
+{
+    GoBoard& bd = corpus.Board();
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Games().size(); ++i)
+    {
+        const vector<SgMove>& moves = corpus.Games()[i];
+        for (size_t j = 0; j < moves.size(); ++j)
+        {
+            bd.Play(moves[j]);
+            sum += bd.TotalNumStones(SG_BLACK) - bd.TotalNumStones(SG_WHITE);
+        }
+        for (size_t j = 0; j < moves.size(); ++j)
+            bd.Undo();
+        nuOps += moves.size();
+    }
+    return sum;
+}
+
+/** IsLegal() for all empty points. */
+long long BenchmarkIsLegal(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        for (GoBoard::Iterator it(bd); it; ++it)
+            if (bd.IsEmpty(*it))
+            {
+                ++nuOps;
+                if (bd.IsLegal(*it, SG_BLACK))
+                    sum += *it;
+                if (bd.IsLegal(*it, SG_WHITE))
+                    sum -= *it;
+            }
+    }
+    return sum;
+}
+
+/** GoBlockIterator and the stones of each block. One operation is a
+    block. */
+long long BenchmarkBlockIterator(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        for (GoBlockIterator it(bd); it; ++it)
+        {
+            ++nuOps;
+            for (GoBoard::StoneIterator it2(bd, *it); it2; ++it2)
+                sum += *it2;
+        }
+    }
+    return sum;
+}
+
+/** The liberties of each block. One operation is a block. */
+long long BenchmarkLibertyIterator(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        for (GoBoard::Iterator it(bd); it; ++it)
+            if (bd.Occupied(*it) && bd.Anchor(*it) == *it)
+            {
+                ++nuOps;
+                for (GoBoard::LibertyIterator it2(bd, *it); it2; ++it2)
+                    sum += *it2;
+            }
+    }
+    return sum;
+}
+
+/** GoLadderUtil::LadderStatus() for the blocks with one or two
+    liberties. One operation is a block. */
+long long BenchmarkLadder(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        for (GoBlockIterator it(bd); it; ++it)
+            if (bd.NumLiberties(*it) <= 2)
+            {
+                ++nuOps;
+                sum += GoLadderUtil::LadderStatus(bd, *it) * (*it);
+            }
+    }
+    return sum;
+}
+
+/** Setup of the benchmarks with Corpus::LadderAnalyzer(). */
+void ClearLadderCache(Corpus& corpus)
+{
+    corpus.LadderAnalyzer().ClearCache();
+}
+
+/** GoLadderAnalyzer::Analyze() without results of the position in the
+    cache. The cache is cleared before each iteration; the positions of the
+    corpus are many moves apart, so they do not share any ladders. One
+    operation is a block with one or two liberties, so the time per
+    operation and the checksum can be compared with BenchmarkLadder(). */
+long long BenchmarkLadderAnalyzer(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    GoLadderAnalyzer& analyzer = corpus.LadderAnalyzer();
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        analyzer.Analyze(bd);
+        for (GoBlockIterator it(bd); it; ++it)
+            if (bd.NumLiberties(*it) <= 2)
+            {
+                ++nuOps;
+                sum += analyzer.Status(*it) * (*it);
+            }
+    }
+    return sum;
+}
+
+/** GoLadderUtil::LadderStatus() for the blocks with one or two liberties
+    after each move of the games, like a program that analyzes the ladders
+    of each position of a game. One operation is a move (including Play()
+    and Undo()). */
+long long BenchmarkLadderReplay(Corpus& corpus, long long& nuOps)
+{
+    GoBoard& bd = corpus.Board();
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Games().size(); ++i)
+    {
+        const vector<SgMove>& moves = corpus.Games()[i];
+        for (size_t j = 0; j < moves.size(); ++j)
+        {
+            bd.Play(moves[j]);
+            for (GoBlockIterator it(bd); it; ++it)
+                if (bd.NumLiberties(*it) <= 2)
+                    sum += GoLadderUtil::LadderStatus(bd, *it) * (*it);
+        }
+        for (size_t j = 0; j < moves.size(); ++j)
+            bd.Undo();
+        nuOps += moves.size();
+    }
+    return sum;
+}
+
+/** GoLadderAnalyzer::Analyze() after each move of the games. The cache is
+    cleared before each iteration and keeps the results of the earlier
+    moves of the iteration. One operation is a move, so the time per
+    operation and the checksum can be compared with
+    BenchmarkLadderReplay(). */
+long long BenchmarkLadderAnalyzerReplay(Corpus& corpus, long long& nuOps)
+{
+    GoBoard& bd = corpus.Board();
+    GoLadderAnalyzer& analyzer = corpus.LadderAnalyzer();
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Games().size(); ++i)
+    {
+        const vector<SgMove>& moves = corpus.Games()[i];
+        for (size_t j = 0; j < moves.size(); ++j)
+        {
+            bd.Play(moves[j]);
+            analyzer.Analyze(bd);
+            for (GoBlockIterator it(bd); it; ++it)
+                if (bd.NumLiberties(*it) <= 2)
+                    sum += analyzer.Status(*it) * (*it);
+        }
+        for (size_t j = 0; j < moves.size(); ++j)
+            bd.Undo();
+        nuOps += moves.size();
+    }
+    return sum;
+}
+
+/** GoSafetySolver with a new GoRegionBoard. One operation is a
+    position. */
+long long BenchmarkSafetySolver(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = corpus.Positions().size();
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        GoBoard& bd = *corpus.Positions()[i];
+        GoRegionBoard regions(bd);
+        GoSafetySolver solver(bd, &regions);
+        SgBWSet safe;
+        solver.FindSafePoints(&safe);
+        sum += safe[SG_BLACK].Size() * 1000 + safe[SG_WHITE].Size();
+    }
+    return sum;
+}
+
+/** GoIncrementalSafety during the games. One operation is a move and the
+    computation of the safe points after it, so the time per operation can
+    be compared with BenchmarkSafetySolver(). */
+long long BenchmarkIncrementalSafety(Corpus& corpus, long long& nuOps)
+{
+    GoBoard& bd = corpus.Board();
+    GoIncrementalSafety incremental(bd);
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Games().size(); ++i)
+    {
+        const vector<SgMove>& moves = corpus.Games()[i];
+        for (size_t j = 0; j < moves.size(); ++j)
+        {
+            bd.Play(moves[j]);
+            SgBWSet safe;
+            incremental.FindSafePoints(&safe);
+            sum += safe[SG_BLACK].Size() * 1000 + safe[SG_WHITE].Size();
+        }
+        for (size_t j = 0; j < moves.size(); ++j)
+            bd.Undo();
+        nuOps += moves.size();
+    }
+    return sum;
+}
+
+/** GoBoardUtil::ScorePosition() without dead stones. One operation is a
+    position. */
+long long BenchmarkScorePosition(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = corpus.Positions().size();
+    const SgPointSet deadStones;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        float score;
+        if (GoBoardUtil::ScorePosition(*corpus.Positions()[i], deadStones,
+                                       score))
+            sum += static_cast<long long>(score * 2);
+    }
+    return sum;
+}
+
+/** Typical SgPointSet operations of the safety and region code: border,
+    kernel, union, intersection and size. One operation is a position. */
+long long BenchmarkPointSet(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = corpus.Positions().size();
+    const int size = corpus.Size();
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        const SgPointSet& black = bd.All(SG_BLACK);
+        const SgPointSet& white = bd.All(SG_WHITE);
+        SgPointSet blackBorder = black.Border(size);
+        SgPointSet whiteBorder = white.Border(size);
+        sum += (blackBorder & whiteBorder).Size();
+        sum += (black | blackBorder).Kernel(size).Size();
+        sum += (bd.AllEmpty() & blackBorder & whiteBorder).Size();
+        sum += (white | whiteBorder).Kernel(size).Size();
+    }
+    return sum;
+}
+
+/** Zobrist hash code of the positions computed from scratch, as in
+    GoBoard::HashCode. One operation is a stone. */
+long long BenchmarkHash(Corpus& corpus, long long& nuOps)
+{
+    long long sum = 0;
+    nuOps = 0;
+    for (size_t i = 0; i < corpus.Positions().size(); ++i)
+    {
+        const GoBoard& bd = *corpus.Positions()[i];
+        SgHashCode hash;
+        hash.Clear();
+        for (GoBoard::Iterator it(bd); it; ++it)
+            if (bd.Occupied(*it))
+            {
+                ++nuOps;
+                SgHashUtil::XorZobrist(hash,
+                                       *it + bd.GetColor(*it) * SG_MAXPOINT);
+            }
+        sum += hash.Hash(1 << 20);
+    }
+    return sum;
+}
+
+/** SgGameReader on the games in SGF format. One operation is a node. */
+long long BenchmarkSgfReader(Corpus& corpus, long long& nuOps)
+{
+    istringstream in(corpus.Sgf());
+    SgGameReader reader(in, corpus.Size());
+    SgVectorOf<SgNode> games;
+    reader.ReadGames(&games);
+    nuOps = 0;
+    for (SgVectorIteratorOf<SgNode> it(games); it; ++it)
+    {
+        for (SgNode* node = *it; node != 0; node = node->LeftMostSon())
+            ++nuOps;
+        (*it)->DeleteTree();
+    }
+    return nuOps;
+}
+
+struct Benchmark
+{
+    const char* m_name;
+
+    BenchmarkFunction m_function;
+
+    /** Can be 0. */
+    BenchmarkSetup m_setup;
+};
+
+const Benchmark BENCHMARKS[] = {
+    { "play_undo", BenchmarkPlayUndo, 0 },
+    { "is_legal", BenchmarkIsLegal, 0 },
+    { "block_iterator", BenchmarkBlockIterator, 0 },
+    { "liberty_iterator", BenchmarkLibertyIterator, 0 },
+    { "ladder_status", BenchmarkLadder, 0 },
+    { "ladder_analyzer", BenchmarkLadderAnalyzer, ClearLadderCache },
+    { "ladder_replay", BenchmarkLadderReplay, 0 },
+    { "ladder_analyzer_replay", BenchmarkLadderAnalyzerReplay,
+      ClearLadderCache },
+    { "safety_solver", BenchmarkSafetySolver, 0 },
+    { "safety_incremental", BenchmarkIncrementalSafety, 0 },
+    { "score_position", BenchmarkScorePosition, 0 },
+    { "point_set", BenchmarkPointSet, 0 },
+    { "zobrist_hash", BenchmarkHash, 0 },
+    { "sgf_reader", BenchmarkSgfReader, 0 }
+};
+
+/** Time iterations of a benchmark without its setup.
+    @param[in,out] isStable Set to false if the checksum of an iteration
+    differs */
+double TimeIterations(const Benchmark& benchmark, Corpus& corpus,
+                      long long nuIterations, long long checksum,
+                      bool& isStable)
+{
+    double time = 0;
+    double startTime = SgTime::Get(SG_TIME_REAL);
+    for (long long i = 0; i < nuIterations; ++i)
+    {
+        if (benchmark.m_setup != 0)
+        {
+            time += SgTime::Get(SG_TIME_REAL) - startTime;
+            benchmark.m_setup(corpus);
+            startTime = SgTime::Get(SG_TIME_REAL);
+        }
+        long long nuOps;
+        if (benchmark.m_function(corpus, nuOps) != checksum)
+            isStable = false;
+    }
+    return time + SgTime::Get(SG_TIME_REAL) - startTime;
+}
+
+/** Run a benchmark and write its JSON object.
+    @return false if the checksum differed between iterations */
+bool RunBenchmark(const Benchmark& benchmark, Corpus& corpus,
+                  const GoBoardCheckPerformance::BenchmarkOptions& options,
+                  ostream& out)
+{
+    // The first iteration warms up the caches and chooses the number of
+    // iterations of a run
+    long long nuOps;
+    if (benchmark.m_setup != 0)
+        benchmark.m_setup(corpus);
+    double startTime = SgTime::Get(SG_TIME_REAL);
+    const long long checksum = benchmark.m_function(corpus, nuOps);
+    double time = SgTime::Get(SG_TIME_REAL) - startTime;
+    long long nuIterations =
+        max(1LL, static_cast<long long>(ceil(options.m_minTime
+                                             / max(time, 1e-9))));
+    bool isStable = true;
+    vector<double> nsPerOp;
+    for (int i = 0; i < options.m_runs; ++i)
+    {
+        time = TimeIterations(benchmark, corpus, nuIterations, checksum,
+                              isStable);
+        nsPerOp.push_back(1e9 * time
+                          / (double(nuIterations) * max(nuOps, 1LL)));
+    }
+    sort(nsPerOp.begin(), nsPerOp.end());
+    out << fixed << setprecision(2)
+        << "    { \"name\": \"" << benchmark.m_name << "\", "
+        << "\"size\": " << corpus.Size() << ", "
+        << "\"ops\": " << nuOps << ", "
+        << "\"iterations\": " << nuIterations << ", "
+        << "\"ns_per_op\": " << nsPerOp[nsPerOp.size() / 2] << ", "
+        << "\"min_ns_per_op\": " << nsPerOp.front() << ", "
+        << "\"max_ns_per_op\": " << nsPerOp.back() << ", "
+        << "\"checksum\": " << checksum << ", "
+        << "\"stable\": " << (isStable ? "true" : "false") << " }";
+    return isStable;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+GoBoardCheckPerformance::BenchmarkOptions::BenchmarkOptions()
+    : m_runs(5),
+      m_minTime(0.05)
+{
+    m_sizes.push_back(9);
+    m_sizes.push_back(13);
+    m_sizes.push_back(19);
+}
+
+//----------------------------------------------------------------------------
+
 void GoBoardCheckPerformance::CheckPerformance(const GoBoard& board,
                                                ostream& out)
 {
@@ -92,3 +698,175 @@ void GoBoardCheckPerformance::CheckPerformance(const GoBoard& board,
         << "Time4: " << time4 << " For 0..SG_MAXPOINT, no dependency\n"
         << "Time5: " << time5 << " First/LastBoardPoint, no dependency\n";
 }
+
+int GoBoardCheckPerformance::CheckLadderPerformance(const GoBoard& board,
+                                                    ostream& out)
+{
+    const int NUM_REPETITIONS = 100;
+    int numBlocks = 0;
+    for (GoBlockIterator it(board); it; ++it)
+        if (board.NumLiberties(*it) <= 2)
+            ++numBlocks;
+    if (numBlocks == 0)
+    {
+        out << "No blocks with one or two liberties\n";
+        return 0;
+    }
+    // Real time, because the calls with an empty cache are timed one by
+    // one, without clearing the cache
+    double startTime = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < NUM_REPETITIONS; ++i)
+        for (GoBlockIterator it(board); it; ++it)
+            if (board.NumLiberties(*it) <= 2)
+                GoLadderUtil::LadderStatus(board, *it);
+    double time1 = SgTime::Get(SG_TIME_REAL) - startTime;
+
+    GoLadderAnalyzer analyzer;
+    double time2 = 0;
+    for (int i = 0; i < NUM_REPETITIONS; ++i)
+    {
+        analyzer.ClearCache();
+        startTime = SgTime::Get(SG_TIME_REAL);
+        analyzer.Analyze(board);
+        time2 += SgTime::Get(SG_TIME_REAL) - startTime;
+    }
+
+    startTime = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < NUM_REPETITIONS; ++i)
+        analyzer.Analyze(board);
+    double time3 = SgTime::Get(SG_TIME_REAL) - startTime;
+
+    int numDifferent = 0;
+    for (GoBlockIterator it(board); it; ++it)
+        if (  board.NumLiberties(*it) <= 2
+           && analyzer.Status(*it) != GoLadderUtil::LadderStatus(board, *it)
+           )
+            ++numDifferent;
+
+    double numQueries = double(NUM_REPETITIONS) * numBlocks;
+    out << "Blocks: " << numBlocks << '\n'
+        << "Time1: " << time1 << " (" << numQueries / time1
+        << " queries/s) GoLadderUtil::LadderStatus\n"
+        << "Time2: " << time2 << " (" << numQueries / time2
+        << " queries/s) GoLadderAnalyzer, empty cache\n"
+        << "Time3: " << time3 << " (" << numQueries / time3
+        << " queries/s) GoLadderAnalyzer, same position\n"
+        << "Different: " << numDifferent << '\n';
+    return numDifferent;
+}
+
+int GoBoardCheckPerformance::CheckSafetyPerformance(const GoBoard& board,
+                                                    ostream& out)
+{
+    const int numMoves = board.MoveNumber();
+    if (numMoves == 0)
+    {
+        out << "No moves\n";
+        return 0;
+    }
+    GoBoard bd(board.Size(), board.Setup(), board.Rules());
+    GoIncrementalSafety incremental(bd);
+    double time1 = 0;
+    double time2 = 0;
+    int numDifferent = 0;
+    for (int i = 0; i < numMoves; ++i)
+    {
+        bd.Play(board.Move(i));
+        double startTime = SgTime::Get();
+        SgBWSet safe1;
+        {
+            GoRegionBoard regions(bd);
+            GoSafetySolver solver(bd, &regions);
+            solver.FindSafePoints(&safe1);
+        }
+        double endTime1 = SgTime::Get();
+        SgBWSet safe2;
+        incremental.FindSafePoints(&safe2);
+        double endTime2 = SgTime::Get();
+        time1 += endTime1 - startTime;
+        time2 += endTime2 - endTime1;
+        if (! (safe1 == safe2))
+            ++numDifferent;
+    }
+    out << "Moves: " << numMoves << '\n'
+        << "Time1: " << 1000 * time1 / numMoves
+        << " ms/move GoSafetySolver\n"
+        << "Time2: " << 1000 * time2 / numMoves
+        << " ms/move GoIncrementalSafety\n"
+        << "Different: " << numDifferent << '\n';
+    return numDifferent;
+}
+
+bool GoBoardCheckPerformance::RunChecks(const BenchmarkOptions& options,
+                                        ostream& out)
+{
+    bool isConsistent = true;
+    for (size_t i = 0; i < options.m_sizes.size(); ++i)
+    {
+        Corpus corpus(options.m_sizes[i]);
+        const vector<SgMove>& moves = corpus.Games().front();
+        // The middle of the game, at the end no blocks are left in atari
+        const size_t nuMoves = moves.size() / 2;
+        GoBoard bd(corpus.Size());
+        for (size_t j = 0; j < nuMoves; ++j)
+            bd.Play(moves[j]);
+        out << "Size " << corpus.Size() << ", " << nuMoves << " moves\n";
+        if (string("board").find(options.m_filter) != string::npos)
+        {
+            out << "CheckPerformance:\n";
+            CheckPerformance(bd, out);
+        }
+        if (string("ladder").find(options.m_filter) != string::npos)
+        {
+            out << "CheckLadderPerformance:\n";
+            if (CheckLadderPerformance(bd, out) != 0)
+                isConsistent = false;
+        }
+        if (string("safety").find(options.m_filter) != string::npos)
+        {
+            out << "CheckSafetyPerformance:\n";
+            if (CheckSafetyPerformance(bd, out) != 0)
+                isConsistent = false;
+        }
+    }
+    return isConsistent;
+}
+
+bool GoBoardCheckPerformance::RunBenchmarks(const BenchmarkOptions& options,
+                                            ostream& out)
+{
+    SG_ASSERT(options.m_runs > 0);
+    bool isStable = true;
+    bool isFirst = true;
+    out << "{\n"
+        << "  \"assertions\": "
+#ifdef NDEBUG
+        << "false"
+#else
+        << "true"
+#endif
+        << ",\n"
+        << "  \"runs\": " << options.m_runs << ",\n"
+        << "  \"min_time\": " << options.m_minTime << ",\n"
+        << "  \"benchmarks\": [";
+    for (size_t i = 0; i < options.m_sizes.size(); ++i)
+    {
+        Corpus corpus(options.m_sizes[i]);
+        for (size_t j = 0; j < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); ++j)
+        {
+            const Benchmark& benchmark = BENCHMARKS[j];
+            if (string(benchmark.m_name).find(options.m_filter)
+                == string::npos)
+                continue;
+            out << (isFirst ? "\n" : ",\n");
+            isFirst = false;
+            if (! RunBenchmark(benchmark, corpus, options, out))
+                isStable = false;
+            out.flush();
+        }
+    }
+    out << "\n  ]\n}\n";
+    return isStable;
+}
+
+//----------------------------------------------------------------------------
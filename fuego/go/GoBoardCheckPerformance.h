@@ -2,14 +2,17 @@
 /** @file GoBoardCheckPerformance.h
     Check performance of the GoBoard class.
 
-    @todo check performance on different kinds of positions.
-    check execute/undo move, full board repetition, etc. */
+    RunBenchmarks() is the benchmark suite of the hot paths and RunChecks()
+    runs the performance checks, both are run by the Go_Benchmark
+    executable. */
 //----------------------------------------------------------------------------
 
 #ifndef GO_BOARDCHECKPERFORMANCE_H
 #define GO_BOARDCHECKPERFORMANCE_H
 
 #include <iosfwd>
+#include <string>
+#include <vector>
 #include "GoBoard.h"
 
 //----------------------------------------------------------------------------
@@ -18,37 +21,80 @@ namespace GoBoardCheckPerformance
 {
 
 /** Performance check of class GoBoard.
-    Looping through all board points is fastest using board iterator for small
-    boards, and only slightly slower than if skipping dependency check for
-    19*19.
-
-    @verbatim
-    19*19
-    -----
-    Time1: 570 For 0..SG_MAXPOINT
-    Time2: 521 First/LastBoardPoint
-    Time3: 210 GoBoard::Iterator
-    Time4: 170 For 0..SG_MAXPOINT, no dependency
-    Time5: 150 First/LastBoardPoint, no dependency
-
-    13*13
-    -----
-    Time1: 561 For 0..SG_MAXPOINT
-    Time2: 341 First/LastBoardPoint
-    Time3: 90 GoBoard::Iterator
-    Time4: 160 For 0..SG_MAXPOINT, no dependency
-    Time5: 100 First/LastBoardPoint, no dependency
-
-    9*9
-    ---
-    Time1: 580 For 0..SG_MAXPOINT
-    Time2: 230 First/LastBoardPoint
-    Time3: 50 GoBoard::Iterator
-    Time4: 150 For 0..SG_MAXPOINT, no dependency
-    Time5: 60 First/LastBoardPoint, no dependency
-    @endverbatim */
+    Compares five ways of looping over all board points. See RunBenchmarks()
+    for the benchmarks of the other hot paths. */
 void CheckPerformance(const GoBoard& board, std::ostream& out);
 
+/** Performance check of the ladder analysis.
+    Reports ladder status queries per second for the blocks with one or two
+    liberties of the current position: with GoLadderUtil::LadderStatus(),
+    with GoLadderAnalyzer::Analyze() and an empty cache (cleared before each
+    call, not timed), and with GoLadderAnalyzer::Analyze() on the same
+    position again (all results in the cache).
+    @return The number of blocks, for which GoLadderAnalyzer::Analyze()
+    computed a different status than GoLadderUtil::LadderStatus() (should
+    be 0) */
+int CheckLadderPerformance(const GoBoard& board, std::ostream& out);
+
+/** Performance check of the incremental safety solver.
+    Replays the moves of the board and reports the time per move for
+    GoSafetySolver with a new GoRegionBoard and for GoIncrementalSafety.
+    @return The number of positions, in which the safe points differ
+    (should be 0) */
+int CheckSafetyPerformance(const GoBoard& board, std::ostream& out);
+
+/** Options of RunBenchmarks(). */
+struct BenchmarkOptions
+{
+    /** Board sizes of the position corpora. Default is 9, 13 and 19. */
+    std::vector<int> m_sizes;
+
+    /** Run only benchmarks whose name contains this string.
+        Default is empty (all benchmarks). */
+    std::string m_filter;
+
+    /** Number of timed runs of each benchmark. Default is 5. */
+    int m_runs;
+
+    /** Minimum time of a run in seconds. The number of iterations of a run
+        is chosen so that a run takes at least this time. Default is 0.05. */
+    double m_minTime;
+
+    BenchmarkOptions();
+};
+
+/** Run the performance checks on a position of each board size.
+    The position is the middle of the first game of the corpus of
+    RunBenchmarks(). Runs CheckPerformance(), CheckLadderPerformance() and
+    CheckSafetyPerformance(), if their names ("board", "ladder", "safety")
+    contain BenchmarkOptions::m_filter,
+    and writes their reports as text. BenchmarkOptions::m_runs and
+    BenchmarkOptions::m_minTime are not used.
+    @return false if a check found a difference */
+bool RunChecks(const BenchmarkOptions& options, std::ostream& out);
+
+/** Benchmark suite of the hot paths of the Go engine.
+    Times GoBoard::Play()/Undo(), GoBoard::IsLegal(), the block, stone and
+    liberty iterators, GoLadderUtil::LadderStatus() and GoLadderAnalyzer
+    (in the positions and after each move of the games),
+    GoSafetySolver, GoIncrementalSafety,
+    GoBoardUtil::ScorePosition(), SgPointSet operations, Zobrist hashing
+    and SgGameReader on a fixed corpus of positions for each board size.
+    The corpora are random games (no filling of own eyes), generated with a
+    fixed seed, so they do not depend on SgRandom::SetSeed() and are the
+    same on all platforms.
+
+    Each benchmark is run once to choose the number of iterations and then
+    timed in several runs (real time). The results are written as a JSON
+    object with one entry per benchmark and board size, containing the
+    number of operations per iteration, the median, minimum and maximum
+    time per operation in nanoseconds over the runs, and a checksum of the
+    computed values. The checksum depends only on the corpus and must be
+    the same in all runs and on all machines; a different checksum means
+    that the behavior of the benchmarked code changed.
+    @return false if the checksum of a benchmark differed between runs */
+bool RunBenchmarks(const BenchmarkOptions& options, std::ostream& out);
+
 } // namespace GoBoardCheckPerformance
 
 //----------------------------------------------------------------------------
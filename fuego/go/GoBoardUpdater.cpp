@@ -49,68 +49,70 @@ void GoBoardUpdater::Update(const SgNode* node, GoBoard& bd)
     bd.Init(size);
     for (vector<const SgNode*>::reverse_iterator it = m_nodes.rbegin();
          it != m_nodes.rend(); ++it)
+        UpdateNode(*it, bd);
+}
+
+void GoBoardUpdater::UpdateNode(const SgNode* node, GoBoard& bd)
+{
+    SgEmptyBlackWhite player = GetPlayer(node);
+    if (node->HasProp(SG_PROP_ADD_EMPTY)
+        || node->HasProp(SG_PROP_ADD_BLACK)
+        || node->HasProp(SG_PROP_ADD_WHITE))
     {
-        const SgNode* node = *it;
-        SgEmptyBlackWhite player = GetPlayer(node);
-        if (node->HasProp(SG_PROP_ADD_EMPTY)
-            || node->HasProp(SG_PROP_ADD_BLACK)
-            || node->HasProp(SG_PROP_ADD_WHITE))
+        // Compute the new initial setup position to re-initialize the
+        // board with
+        GoSetup setup = GoSetupUtil::CurrentPosSetup(bd);
+        if (player != SG_EMPTY)
+            setup.m_player = player;
+        if (node->HasProp(SG_PROP_ADD_BLACK))
         {
-            // Compute the new initial setup position to re-initialize the
-            // board with
-            GoSetup setup = GoSetupUtil::CurrentPosSetup(bd);
-            if (player != SG_EMPTY)
-                setup.m_player = player;
-            if (node->HasProp(SG_PROP_ADD_BLACK))
+            SgPropAddStone* prop =
+                dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_BLACK));
+            const SgVector<SgPoint>& addBlack = prop->Value();
+            for (SgVectorIterator<SgPoint> it2(addBlack); it2; ++it2)
             {
-                SgPropAddStone* prop =
-                  dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_BLACK));
-                const SgVector<SgPoint>& addBlack = prop->Value();
-                for (SgVectorIterator<SgPoint> it2(addBlack); it2; ++it2)
-                {
-                    SgPoint p = *it2;
-                    setup.m_stones[SG_WHITE].Exclude(p);
-                    if (! setup.m_stones[SG_BLACK].Contains(p))
-                        setup.AddBlack(p);
-                }
+                SgPoint p = *it2;
+                setup.m_stones[SG_WHITE].Exclude(p);
+                if (! setup.m_stones[SG_BLACK].Contains(p))
+                    setup.AddBlack(p);
             }
-            if (node->HasProp(SG_PROP_ADD_WHITE))
-            {
-                SgPropAddStone* prop =
-                  dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_WHITE));
-                const SgVector<SgPoint>& addWhite = prop->Value();
-                for (SgVectorIterator<SgPoint> it2(addWhite); it2; ++it2)
-                {
-                    SgPoint p = *it2;
-                    setup.m_stones[SG_BLACK].Exclude(p);
-                    if (! setup.m_stones[SG_WHITE].Contains(p))
-                        setup.AddWhite(p);
-                }
-            }
-            if (node->HasProp(SG_PROP_ADD_EMPTY))
+        }
+        if (node->HasProp(SG_PROP_ADD_WHITE))
+        {
+            SgPropAddStone* prop =
+                dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_WHITE));
+            const SgVector<SgPoint>& addWhite = prop->Value();
+            for (SgVectorIterator<SgPoint> it2(addWhite); it2; ++it2)
             {
-                SgPropAddStone* prop =
-                  dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_EMPTY));
-                const SgVector<SgPoint>& addEmpty = prop->Value();
-                for (SgVectorIterator<SgPoint> it2(addEmpty); it2; ++it2)
-                {
-                    SgPoint p = *it2;
-                    setup.m_stones[SG_BLACK].Exclude(p);
-                    setup.m_stones[SG_WHITE].Exclude(p);
-                }
+                SgPoint p = *it2;
+                setup.m_stones[SG_BLACK].Exclude(p);
+                if (! setup.m_stones[SG_WHITE].Contains(p))
+                    setup.AddWhite(p);
             }
-            bd.Init(bd.Size(), setup);
         }
-        else if (player != SG_EMPTY)
-            bd.SetToPlay(player);
-        if (node->HasProp(SG_PROP_MOVE))
+        if (node->HasProp(SG_PROP_ADD_EMPTY))
         {
-            SgPropMove* prop =
-                dynamic_cast<SgPropMove*>(node->Get(SG_PROP_MOVE));
-            SgPoint p = prop->Value();
-            if (p == SG_PASS || ! bd.Occupied(p))
-                bd.Play(p, prop->Player());
+            SgPropAddStone* prop =
+                dynamic_cast<SgPropAddStone*>(node->Get(SG_PROP_ADD_EMPTY));
+            const SgVector<SgPoint>& addEmpty = prop->Value();
+            for (SgVectorIterator<SgPoint> it2(addEmpty); it2; ++it2)
+            {
+                SgPoint p = *it2;
+                setup.m_stones[SG_BLACK].Exclude(p);
+                setup.m_stones[SG_WHITE].Exclude(p);
+            }
         }
+        bd.Init(bd.Size(), setup);
+    }
+    else if (player != SG_EMPTY)
+        bd.SetToPlay(player);
+    if (node->HasProp(SG_PROP_MOVE))
+    {
+        SgPropMove* prop =
+            dynamic_cast<SgPropMove*>(node->Get(SG_PROP_MOVE));
+        SgPoint p = prop->Value();
+        if (p == SG_PASS || ! bd.Occupied(p))
+            bd.Play(p, prop->Player());
     }
 }
 
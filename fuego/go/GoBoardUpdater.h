@@ -21,6 +21,12 @@ class GoBoardUpdater
 public:
     void Update(const SgNode* node, GoBoard& bd);
 
+    /** Apply the setup, player and move properties of a single node.
+        The board must be in the position of the father of the node. Can be
+        used to follow a line of nodes incrementally without updating from
+        scratch for each node. */
+    static void UpdateNode(const SgNode* node, GoBoard& bd);
+
 private:
     /** Local variable used in Update().
         Member variable for avoiding frequent new memory allocations. */
@@ -6,7 +6,9 @@
 #include "GoBook.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <sstream>
 #include "GoBoard.h"
 #include "GoBoardUtil.h"
@@ -59,10 +61,126 @@ vector<SgPoint> GetSequence(const GoBoard& bd)
     return result;
 }
 
+/** Identifies a compiled book (including the format version). */
+const char COMPILED_MAGIC[8] = { 'G', 'o', 'B', 'o', 'o', 'k', 'C', '1' };
+
+/** Written as a 32-bit integer to detect a different byte order. */
+const uint32_t COMPILED_BYTE_ORDER = 0x01020304;
+
+/** Finalizer of the SplitMix64 generator. */
+inline uint64_t Mix64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/** Hash keys of a position under all 8 rotations for compiled books.
+    The Zobrist hash codes of GoBoard are random numbers of the process, so
+    compiled books use their own keys, which depend only on the position.
+    keys[rot] is the key of the position transformed with
+    SgPointUtil::Rotate(rot, ...). */
+void CompiledKeys(const GoBoard& bd, uint64_t keys[8])
+{
+    const int size = bd.Size();
+    const uint64_t base =
+        Mix64((static_cast<uint64_t>(size) << 1)
+              | (bd.ToPlay() == SG_WHITE ? 1 : 0));
+    for (int rot = 0; rot < 8; ++rot)
+        keys[rot] = base;
+    for (GoBoard::Iterator it(bd); it; ++it)
+        if (bd.Occupied(*it))
+        {
+            const uint64_t color = (bd.GetColor(*it) == SG_BLACK ? 1 : 2);
+            for (int rot = 0; rot < 8; ++rot)
+            {
+                SgPoint p = SgPointUtil::Rotate(rot, *it, size);
+                keys[rot] ^= Mix64((color << 16)
+                                   | (SgPointUtil::Row(p) << 8)
+                                   | SgPointUtil::Col(p));
+            }
+        }
+}
+
+/** Key of the normalized position.
+    @param bd The position
+    @param[out] rotation The rotation that transforms the position into the
+    normalized position */
+uint64_t NormalizedKey(const GoBoard& bd, int& rotation)
+{
+    uint64_t keys[8];
+    CompiledKeys(bd, keys);
+    rotation = 0;
+    for (int rot = 1; rot < 8; ++rot)
+        if (keys[rot] < keys[rotation])
+            rotation = rot;
+    return keys[rotation];
+}
+
+/** Encode a point independent of SG_MAX_SIZE. */
+uint16_t EncodePoint(SgPoint p)
+{
+    if (p == SG_PASS)
+        return 0;
+    return static_cast<uint16_t>((SgPointUtil::Row(p) << 8)
+                                 | SgPointUtil::Col(p));
+}
+
+SgPoint DecodePoint(uint16_t code)
+{
+    if (code == 0)
+        return SG_PASS;
+    return SgPointUtil::Pt(code & 0xff, code >> 8);
+}
+
 } // namepsace
 
 //----------------------------------------------------------------------------
 
+/** Header of a compiled book.
+    The file contains the header, CompiledHeader::m_nuSlots slots and
+    CompiledHeader::m_nuMoves moves (encoded points as 16-bit integers). The
+    slots are a hash table with linear probing, indexed by the lowest bits of
+    the key of the normalized position. */
+struct GoBook::CompiledHeader
+{
+    char m_magic[8];
+
+    uint32_t m_byteOrder;
+
+    uint32_t m_nuEntries;
+
+    /** Size of hash table, a power of two. */
+    uint32_t m_nuSlots;
+
+    uint32_t m_nuMoves;
+};
+
+/** Hash table slot of a compiled book.
+    The moves are stored in the orientation of the original entry. */
+struct GoBook::CompiledSlot
+{
+    uint64_t m_key;
+
+    uint32_t m_firstMove;
+
+    /** Line number in the original file. */
+    uint32_t m_line;
+
+    uint16_t m_nuMoves;
+
+    /** Board size. 0 for an empty slot. */
+    uint8_t m_size;
+
+    /** Rotation that transforms the original entry into the normalized
+        position. */
+    uint8_t m_rotation;
+
+    uint32_t m_reserved;
+};
+
+//----------------------------------------------------------------------------
+
 void GoBook::Entry::ApplyTo(GoBoard& bd) const
 {
     if (bd.Size() != m_size)
@@ -78,8 +196,19 @@ void GoBook::Entry::ApplyTo(GoBoard& bd) const
 
 //----------------------------------------------------------------------------
 
+GoBook::GoBook()
+    : m_warningMaxSizeShown(false),
+      m_lineCount(0),
+      m_compiledHeader(0),
+      m_compiledSlots(0),
+      m_compiledMoves(0)
+{
+}
+
 void GoBook::Add(const GoBoard& bd, SgPoint move)
 {
+    if (IsCompiled())
+        throw SgException("cannot modify compiled book");
     if (move != SG_PASS && bd.Occupied(move))
         throw SgException("point is not empty");
     if (! bd.IsLegal(move))
@@ -108,10 +237,24 @@ void GoBook::Clear()
 {
     m_entries.clear();
     m_map.clear();
+    m_compiledFile.Close();
+    m_compiledHeader = 0;
+    m_compiledSlots = 0;
+    m_compiledMoves = 0;
+}
+
+SgPoint GoBook::CompiledMove(const CompiledSlot& slot, int i,
+                             int rotation) const
+{
+    SgPoint p = DecodePoint(m_compiledMoves[slot.m_firstMove + i]);
+    p = SgPointUtil::Rotate(slot.m_rotation, p, slot.m_size);
+    return SgPointUtil::Rotate(rotation, p, slot.m_size);
 }
 
 void GoBook::Delete(const GoBoard& bd, SgPoint move)
 {
+    if (IsCompiled())
+        throw SgException("cannot modify compiled book");
     const GoBook::MapEntry* mapEntry = LookupEntry(bd);
     if (mapEntry == 0)
         return;
@@ -196,6 +339,12 @@ void GoBook::InsertEntry(const vector<SgPoint>& sequence,
 
 int GoBook::Line(const GoBoard& bd) const
 {
+    if (IsCompiled())
+    {
+        int rotation;
+        const CompiledSlot* slot = LookupCompiled(bd, rotation);
+        return (slot == 0 ? 0 : static_cast<int>(slot->m_line));
+    }
     const GoBook::MapEntry* mapEntry = LookupEntry(bd);
     if (mapEntry == 0)
         return 0;
@@ -216,8 +365,57 @@ const GoBook::MapEntry* GoBook::LookupEntry(const GoBoard& bd) const
     return 0;
 }
 
+const GoBook::CompiledSlot* GoBook::LookupCompiled(const GoBoard& bd,
+                                                   int& rotation) const
+{
+    SG_ASSERT(IsCompiled());
+    int normRotation;
+    const uint64_t key = NormalizedKey(bd, normRotation);
+    rotation = SgPointUtil::InvRotation(normRotation);
+    const int size = bd.Size();
+    const uint32_t nuSlots = m_compiledHeader->m_nuSlots;
+    const uint32_t mask = nuSlots - 1;
+    uint32_t i = static_cast<uint32_t>(key) & mask;
+    // Written books always have empty slots (m_nuEntries < m_nuSlots is
+    // checked in ReadCompiled()), but a corrupt file might have none, so
+    // the probe is bounded by the table size
+    for (uint32_t nuProbes = 0; nuProbes < nuSlots;
+         ++nuProbes, i = (i + 1) & mask)
+    {
+        const CompiledSlot& slot = m_compiledSlots[i];
+        if (slot.m_size == 0)
+            return 0;
+        if (slot.m_key == key && slot.m_size == size)
+        {
+            if (slot.m_firstMove + slot.m_nuMoves
+                > m_compiledHeader->m_nuMoves)
+            {
+                SgWarning() << "invalid compiled book entry\n";
+                return 0;
+            }
+            return &slot;
+        }
+    }
+    SgWarning() << "invalid compiled book: no empty slot\n";
+    return 0;
+}
+
 SgPoint GoBook::LookupMove(const GoBoard& bd) const
 {
+    if (IsCompiled())
+    {
+        int rotation;
+        const CompiledSlot* slot = LookupCompiled(bd, rotation);
+        if (slot == 0 || slot->m_nuMoves == 0)
+            return SG_NULLMOVE;
+        for (int i = 0; i < slot->m_nuMoves; ++i)
+            if (! bd.IsLegal(CompiledMove(*slot, i, rotation)))
+            {
+                SgWarning() << "illegal book move (hash code collision?)\n";
+                return SG_NULLMOVE;
+            }
+        return CompiledMove(*slot, rand() % slot->m_nuMoves, rotation);
+    }
     vector<SgPoint> moves = LookupAllMoves(bd);
     size_t nuMoves = moves.size();
     if (nuMoves == 0)
@@ -229,6 +427,25 @@ SgPoint GoBook::LookupMove(const GoBoard& bd) const
 vector<SgPoint> GoBook::LookupAllMoves(const GoBoard& bd) const
 {
     vector<SgPoint> result;
+    if (IsCompiled())
+    {
+        int rotation;
+        const CompiledSlot* slot = LookupCompiled(bd, rotation);
+        if (slot == 0)
+            return result;
+        for (int i = 0; i < slot->m_nuMoves; ++i)
+        {
+            SgPoint p = CompiledMove(*slot, i, rotation);
+            if (! bd.IsLegal(p))
+            {
+                SgWarning() << "illegal book move (hash code collision?)\n";
+                result.clear();
+                break;
+            }
+            result.push_back(p);
+        }
+        return result;
+    }
     const GoBook::MapEntry* mapEntry = LookupEntry(bd);
     if (mapEntry == 0)
         return result;
@@ -294,12 +511,61 @@ void GoBook::Read(istream& in, const string& streamName)
 
 void GoBook::Read(const string& filename)
 {
-    ifstream in(filename.c_str());
+    ifstream in(filename.c_str(), ios::in | ios::binary);
+    if (! in)
+        throw SgException("Cannot find file " + filename);
+    char magic[sizeof(COMPILED_MAGIC)];
+    if (in.read(magic, sizeof(magic))
+        && memcmp(magic, COMPILED_MAGIC, sizeof(magic)) == 0)
+    {
+        in.close();
+        ReadCompiled(filename);
+        return;
+    }
+    in.close();
+    in.clear();
+    in.open(filename.c_str());
     if (! in)
         throw SgException("Cannot find file " + filename);
     Read(in, filename);
 }
 
+void GoBook::ReadCompiled(const string& filename)
+{
+    Clear();
+    m_streamName = filename;
+    if (! m_compiledFile.Open(filename))
+        throw SgException("Cannot map file " + filename);
+    const char* begin = m_compiledFile.Begin();
+    const size_t size = m_compiledFile.Size();
+    const CompiledHeader* header =
+        reinterpret_cast<const CompiledHeader*>(begin);
+    string error;
+    if (size < sizeof(CompiledHeader)
+        || memcmp(header->m_magic, COMPILED_MAGIC,
+                  sizeof(COMPILED_MAGIC)) != 0)
+        error = "not a compiled book";
+    else if (header->m_byteOrder != COMPILED_BYTE_ORDER)
+        error = "compiled book has different byte order";
+    else if (header->m_nuSlots == 0
+             || (header->m_nuSlots & (header->m_nuSlots - 1)) != 0
+             || header->m_nuEntries >= header->m_nuSlots
+             || size != sizeof(CompiledHeader)
+                        + header->m_nuSlots * sizeof(CompiledSlot)
+                        + header->m_nuMoves * sizeof(uint16_t))
+        error = "invalid compiled book";
+    if (! error.empty())
+    {
+        m_compiledFile.Close();
+        throw SgException(filename + ": " + error);
+    }
+    m_compiledHeader = header;
+    m_compiledSlots = reinterpret_cast<const CompiledSlot*>(
+                                          begin + sizeof(CompiledHeader));
+    m_compiledMoves = reinterpret_cast<const uint16_t*>(
+                       m_compiledSlots + header->m_nuSlots);
+}
+
 vector<SgPoint> GoBook::ReadPoints(istream& in) const
 {
     vector<SgPoint> result;
@@ -330,6 +596,8 @@ void GoBook::ThrowError(const string& message) const
 
 void GoBook::Write(ostream& out) const
 {
+    if (IsCompiled())
+        throw SgException("cannot write compiled book as text");
     for (vector<Entry>::const_iterator it = m_entries.begin();
          it != m_entries.end(); ++it)
     {
@@ -350,8 +618,91 @@ void GoBook::Write(ostream& out) const
     }
 }
 
+void GoBook::WriteCompiled(ostream& out) const
+{
+    if (IsCompiled())
+        throw SgException("book is already compiled");
+    size_t nuEntries = 0;
+    for (vector<Entry>::const_iterator it = m_entries.begin();
+         it != m_entries.end(); ++it)
+        if (! it->m_moves.empty())
+            ++nuEntries;
+    // Load factor at most 0.5, at least one empty slot to end the probing
+    uint32_t nuSlots = 1;
+    while (nuSlots <= 2 * nuEntries)
+        nuSlots *= 2;
+    CompiledSlot emptySlot;
+    memset(&emptySlot, 0, sizeof(emptySlot));
+    vector<CompiledSlot> slots(nuSlots, emptySlot);
+    vector<uint16_t> moves;
+    GoBoard tempBoard;
+    for (vector<Entry>::const_iterator it = m_entries.begin();
+         it != m_entries.end(); ++it)
+    {
+        if (it->m_moves.empty())
+            continue;
+        if (it->m_moves.size() > numeric_limits<uint16_t>::max())
+            throw SgException("too many moves in book entry");
+        tempBoard.Init(it->m_size);
+        for (vector<SgPoint>::const_iterator it2 = it->m_sequence.begin();
+             it2 != it->m_sequence.end(); ++it2)
+        {
+            if (! tempBoard.IsLegal(*it2))
+            {
+                ostringstream o;
+                o << "illegal move in book entry line " << it->m_line;
+                throw SgException(o.str());
+            }
+            tempBoard.Play(*it2);
+        }
+        CompiledSlot slot = emptySlot;
+        int rotation;
+        slot.m_key = NormalizedKey(tempBoard, rotation);
+        slot.m_rotation = static_cast<uint8_t>(rotation);
+        slot.m_size = static_cast<uint8_t>(it->m_size);
+        slot.m_line = it->m_line;
+        slot.m_firstMove = static_cast<uint32_t>(moves.size());
+        slot.m_nuMoves = static_cast<uint16_t>(it->m_moves.size());
+        for (vector<SgPoint>::const_iterator it2 = it->m_moves.begin();
+             it2 != it->m_moves.end(); ++it2)
+            moves.push_back(EncodePoint(*it2));
+        uint32_t i = static_cast<uint32_t>(slot.m_key) & (nuSlots - 1);
+        for ( ; slots[i].m_size != 0; i = (i + 1) & (nuSlots - 1))
+            if (slots[i].m_key == slot.m_key
+                && slots[i].m_size == slot.m_size)
+            {
+                ostringstream o;
+                o << "book entry line " << it->m_line
+                  << " duplicates line " << slots[i].m_line;
+                throw SgException(o.str());
+            }
+        slots[i] = slot;
+    }
+    CompiledHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC));
+    header.m_byteOrder = COMPILED_BYTE_ORDER;
+    header.m_nuEntries = static_cast<uint32_t>(nuEntries);
+    header.m_nuSlots = nuSlots;
+    header.m_nuMoves = static_cast<uint32_t>(moves.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&slots[0]),
+              slots.size() * sizeof(CompiledSlot));
+    if (! moves.empty())
+        out.write(reinterpret_cast<const char*>(&moves[0]),
+                  moves.size() * sizeof(uint16_t));
+}
+
 void GoBook::WriteInfo(ostream& out) const
 {
+    if (IsCompiled())
+    {
+        out << SgWriteLabel("NuCompiled") << m_compiledHeader->m_nuEntries
+            << '\n'
+            << SgWriteLabel("NuSlots") << m_compiledHeader->m_nuSlots << '\n'
+            << SgWriteLabel("NuMoves") << m_compiledHeader->m_nuMoves << '\n';
+        return;
+    }
     out << SgWriteLabel("NuBasic") << m_entries.size() << '\n'
         << SgWriteLabel("NuTransformed") << m_map.size() << '\n';
 }
@@ -370,6 +721,7 @@ void GoBookCommands::AddGoGuiAnalyzeCommands(GtpCommand& cmd)
     cmd <<
         "gfx/Book Add/book_add %p\n"
         "none/Book Clear/book_clear\n"
+        "none/Book Compile/book_compile %w\n"
         "gfx/Book Delete/book_delete %p\n"
         "hstring/Book Info/book_info\n"
         "none/Book Load/book_load %r\n"
@@ -402,6 +754,26 @@ void GoBookCommands::CmdClear(GtpCommand& cmd)
     m_book.Clear();
 }
 
+/** Write the current book in compiled format.
+    Arguments: file name <br>
+    The compiled book can be loaded with @c book_load.
+    @see GoBook::WriteCompiled() */
+void GoBookCommands::CmdCompile(GtpCommand& cmd)
+{
+    string fileName = cmd.Arg();
+    ofstream out(fileName.c_str(), ios::out | ios::binary);
+    try
+    {
+        m_book.WriteCompiled(out);
+    }
+    catch (const SgException& e)
+    {
+        throw GtpFailure() << "compiling opening book failed: " << e.what();
+    }
+    if (! out)
+        throw GtpFailure() << "error writing to file '" << fileName << "'";
+}
+
 /** Delete a move for the current position to the book.
     Arguments: point <br>
     Returns: Position information after the move deletion as in CmdPosition() */
@@ -472,6 +844,8 @@ void GoBookCommands::CmdSave(GtpCommand& cmd)
     if (m_engine.MpiSynchronizer()->IsRootProcess())
     {
     cmd.CheckArgNone();
+    if (m_book.IsCompiled())
+        throw GtpFailure("cannot save compiled book");
     if (m_fileName == "")
         throw GtpFailure("no filename associated with current book");
     ofstream out(m_fileName.c_str());
@@ -487,6 +861,8 @@ void GoBookCommands::CmdSaveAs(GtpCommand& cmd)
 {
     if (m_engine.MpiSynchronizer()->IsRootProcess())
     {
+        if (m_book.IsCompiled())
+            throw GtpFailure("cannot save compiled book");
         m_fileName = cmd.Arg();
         ofstream out(m_fileName.c_str());
         m_book.Write(out);
@@ -531,6 +907,7 @@ void GoBookCommands::Register(GtpEngine& e)
 {
     e.Register("book_add", &GoBookCommands::CmdAdd, this);
     e.Register("book_clear", &GoBookCommands::CmdClear, this);
+    e.Register("book_compile", &GoBookCommands::CmdCompile, this);
     e.Register("book_delete", &GoBookCommands::CmdDelete, this);
     e.Register("book_info", &GoBookCommands::CmdInfo, this);
     e.Register("book_load", &GoBookCommands::CmdLoad, this);
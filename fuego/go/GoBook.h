@@ -8,10 +8,12 @@
 
 #include <iosfwd>
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include "GtpEngine.h"
 #include "SgHash.h"
+#include "SgMappedFile.h"
 #include "SgPoint.h"
 
 class GoBoard;
@@ -32,7 +34,15 @@ class GoBoard;
     mirroring. If there are duplicates, because of sequences with move
     transpositions or rotating/mirroring, reading will throw an exception
     containing an error message with line number information of the
-    duplicates. */
+    duplicates.
+
+    A book can also be stored in a compiled binary format (see
+    WriteCompiled()), which is memory-mapped when it is read. The compiled
+    format contains an open-addressing hash index over the positions
+    normalized by rotation/mirroring and the move lists, but not the
+    sequences. Opening a compiled book needs no parsing and lookups need no
+    heap allocation, so it is meant for large books used by a player. A
+    compiled book is read-only. */
 
 class GoGtpEngine;
 
@@ -56,18 +66,23 @@ public:
         void ApplyTo(GoBoard& bd) const;
     };
 
+    GoBook();
+
     /** Add a book move to the current position.
         @throws SgException if move cannot be added (illegal or move sequence
-        to current position cannot be determined) */
+        to current position cannot be determined, or the book is
+        compiled) */
     void Add(const GoBoard& bd, SgPoint move);
 
     void Clear();
 
     /** Deletes a book move in the current position.
-        @throws SgException if the move is not a book move. */
+        @throws SgException if the move is not a book move or the book is
+        compiled. */
     void Delete(const GoBoard& bd, SgPoint move);
 
     /** Get an entry.
+        Not available for compiled books.
         @param index The index of the entry
         @see NuEntries() */
     const Entry& GetEntry(std::size_t index) const;
@@ -84,6 +99,12 @@ public:
 
     std::vector<SgPoint> LookupAllMoves(const GoBoard& bd) const;
 
+    /** Book was read from a compiled file.
+        @see ReadCompiled() */
+    bool IsCompiled() const;
+
+    /** Number of entries of a text book.
+        Returns 0 for compiled books, which do not store the entries. */
     std::size_t NuEntries() const;
 
     /** Read book from stream.
@@ -91,11 +112,26 @@ public:
         @param streamName Name used for error messages (e.g. file name) */
     void Read(std::istream& in, const std::string& streamName = "");
 
-    /** Read book from file. */
+    /** Read book from file.
+        Compiled books are detected and read with ReadCompiled(). */
     void Read(const std::string& filename);
 
+    /** Memory-map a book in compiled format.
+        @throws SgException if the file cannot be mapped or is not a valid
+        compiled book */
+    void ReadCompiled(const std::string& filename);
+
+    /** Write book in text format.
+        @throws SgException if the book is compiled */
     void Write(std::ostream& out) const;
 
+    /** Write book in compiled format.
+        The stream must be opened in binary mode. Entries without moves are
+        pruned as in Write(). The file uses the byte order of the machine.
+        @throws SgException if the book is compiled or contains an illegal
+        or duplicate position */
+    void WriteCompiled(std::ostream& out) const;
+
     void WriteInfo(std::ostream& out) const;
 
 private:
@@ -117,6 +153,12 @@ private:
 
     typedef std::multimap<SgHashCode,MapEntry> Map;
 
+    /** Header of a compiled book, see GoBook.cpp */
+    struct CompiledHeader;
+
+    /** Hash table slot of a compiled book, see GoBook.cpp */
+    struct CompiledSlot;
+
     bool m_warningMaxSizeShown;
 
     int m_lineCount;
@@ -128,17 +170,46 @@ private:
     /** Mapping hash key to entries. */
     Map m_map;
 
+    SgMappedFile m_compiledFile;
+
+    /** Points into m_compiledFile, 0 if the book is not compiled. */
+    const CompiledHeader* m_compiledHeader;
+
+    const CompiledSlot* m_compiledSlots;
+
+    const uint16_t* m_compiledMoves;
+
     void InsertEntry(const std::vector<SgPoint>& sequence,
                      const std::vector<SgPoint>& moves, int size,
                      GoBoard& tempBoard, int line);
 
     const GoBook::MapEntry* LookupEntry(const GoBoard& bd) const;
 
+    /** Find the position in a compiled book.
+        @param bd The position
+        @param[out] rotation The rotation that transforms the normalized
+        position into bd
+        @return The slot or 0, if the position is not in the book */
+    const CompiledSlot* LookupCompiled(const GoBoard& bd,
+                                       int& rotation) const;
+
+    /** Move i of a slot transformed into a move of the position.
+        @param slot
+        @param i
+        @param rotation As returned by LookupCompiled() */
+    SgPoint CompiledMove(const CompiledSlot& slot, int i, int rotation) const;
+
     void ParseLine(const std::string& line, GoBoard& tempBoard);
 
     std::vector<SgPoint> ReadPoints(std::istream& in) const;
 
     void ThrowError(const std::string& message) const;
+
+    /** Not implemented. */
+    GoBook(const GoBook&);
+
+    /** Not implemented. */
+    GoBook& operator=(const GoBook&);
 };
 
 inline const GoBook::Entry& GoBook::GetEntry(std::size_t index) const
@@ -147,6 +218,11 @@ inline const GoBook::Entry& GoBook::GetEntry(std::size_t index) const
     return m_entries[index];
 }
 
+inline bool GoBook::IsCompiled() const
+{
+    return m_compiledHeader != 0;
+}
+
 inline std::size_t GoBook::NuEntries() const
 {
     return m_entries.size();
@@ -167,6 +243,7 @@ public:
     /** @page gobookcommands GoBookCommands
         - @link CmdAdd() @c book_add @endlink
         - @link CmdClear() @c book_clear @endlink
+        - @link CmdCompile() @c book_compile @endlink
         - @link CmdDelete() @c book_delete @endlink
         - @link CmdInfo() @c book_info @endlink
         - @link CmdLoad() @c book_load @endlink
@@ -179,6 +256,7 @@ public:
     // The callback functions are documented in the cpp file
     void CmdAdd(GtpCommand& cmd);
     void CmdClear(GtpCommand& cmd);
+    void CmdCompile(GtpCommand& cmd);
     void CmdDelete(GtpCommand& cmd);
     void CmdInfo(GtpCommand& cmd);
     void CmdLoad(GtpCommand& cmd);
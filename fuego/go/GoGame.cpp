@@ -220,6 +220,12 @@ void GoGame::Init(int size, const GoRules& rules)
 }
 
 void GoGame::Init(SgNode* root)
+{
+    const GoRules& rules = m_board.Rules();
+    Init(root, GoRules(rules.Handicap(), rules.Komi()));
+}
+
+void GoGame::Init(SgNode* root, const GoRules& rules)
 {
     m_root->DeleteTree();
     m_root = root;
@@ -231,8 +237,7 @@ void GoGame::Init(SgNode* root)
         size = boardSizeProp->Value();
         ForceInRange(SG_MIN_SIZE, &size, SG_MAX_SIZE);
     }
-    const GoRules& rules = m_board.Rules();
-    m_board.Init(size, GoRules(rules.Handicap(), rules.Komi()));
+    m_board.Init(size, rules);
 
     // Add root property: Go game identifier.
     const int GAME_ID = 1;
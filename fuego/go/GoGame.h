@@ -42,6 +42,12 @@ public:
         Takes the ownership of the tree. */
     void Init(SgNode* root);
 
+    /** Init from an existing game tree with the given rules.
+        Same as Init(SgNode*), but uses all of the given rules instead of
+        only the handicap and komi of the current rules.
+        Takes the ownership of the tree. */
+    void Init(SgNode* root, const GoRules& rules);
+
     /** Delete the old game record and start with a fresh one.
         Init the board with the given parameters, and create a root node
         to start with. */
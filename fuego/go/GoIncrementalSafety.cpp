@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------------
+/** @file GoIncrementalSafety.cpp
+    See GoIncrementalSafety.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "GoIncrementalSafety.h"
+
+#include "GoBensonSolver.h"
+#include "GoSafetySolver.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+GoIncrementalSafety::GoIncrementalSafety(const GoBoard& bd)
+    : GoBoardSynchronizer(bd),
+      m_bd(bd.Size(), GoSetup(), bd.Rules()),
+      m_regions(m_bd)
+{
+    SetSubscriber(m_bd);
+}
+
+GoIncrementalSafety::~GoIncrementalSafety()
+{
+}
+
+void GoIncrementalSafety::FindBensonSafePoints(SgBWSet* safe)
+{
+    Update();
+    GoBensonSolver solver(m_bd, &m_regions);
+    solver.SetIncremental(true);
+    solver.FindSafePoints(safe);
+}
+
+void GoIncrementalSafety::FindSafePoints(SgBWSet* safe)
+{
+    Update();
+    GoSafetySolver solver(m_bd, &m_regions);
+    solver.SetIncremental(true);
+    solver.FindSafePoints(safe);
+}
+
+void GoIncrementalSafety::OnBoardChange()
+{
+    m_regions.Clear();
+}
+
+void GoIncrementalSafety::OnPlay(GoPlayerMove move)
+{
+    if (  m_bd.LastMoveInfo(GO_MOVEFLAG_SUICIDE)
+       || m_bd.LastMoveInfo(GO_MOVEFLAG_ILLEGAL)
+       )
+        // GoRegionBoard cannot handle these moves
+        m_regions.Clear();
+    else
+        m_regions.OnExecutedMove(move);
+}
+
+void GoIncrementalSafety::OnUndo()
+{
+    m_regions.OnUndoneMove();
+}
+
+void GoIncrementalSafety::PrePlay(GoPlayerMove move)
+{
+    SG_UNUSED(move);
+    m_regions.ExecuteMovePrologue();
+}
+
+void GoIncrementalSafety::Update()
+{
+    UpdateSubscriber();
+    // The solvers compute the same flags as with a new GoRegionBoard only
+    // if the regions are already up to date
+    m_regions.GenBlocksRegions();
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+//----------------------------------------------------------------------------
+/** @file GoIncrementalSafety.h
+    Safety solvers that follow the moves of a game incrementally. */
+//----------------------------------------------------------------------------
+
+#ifndef GO_INCREMENTALSAFETY_H
+#define GO_INCREMENTALSAFETY_H
+
+#include "GoBoard.h"
+#include "GoBoardSynchronizer.h"
+#include "GoRegionBoard.h"
+
+//----------------------------------------------------------------------------
+
+/** Safe points of the current position of a game board, updated
+    incrementally after each move.
+    Keeps a copy of the game board (see GoBoardSynchronizer) and a
+    GoRegionBoard, which is updated with GoRegionBoard::OnExecutedMove and
+    GoRegionBoard::OnUndoneMove for each move and undo of the game board.
+    The solvers run in incremental mode (see
+    GoStaticSafetySolver::Incremental): only the regions touched by the
+    moves since the last call compute their flags again. The result is the
+    same as the result of a solver with a new GoRegionBoard.
+    If the region board cannot follow a move (suicide, or undo of a move
+    played before the regions were generated), the blocks and regions are
+    generated from scratch in the next call. */
+class GoIncrementalSafety
+    : public GoBoardSynchronizer
+{
+public:
+    explicit GoIncrementalSafety(const GoBoard& bd);
+
+    ~GoIncrementalSafety();
+
+    /** Update to the position of the game board and compute the safe
+        points with GoSafetySolver. */
+    void FindSafePoints(SgBWSet* safe);
+
+    /** Update to the position of the game board and compute the safe
+        points with GoBensonSolver. */
+    void FindBensonSafePoints(SgBWSet* safe);
+
+    /** The regions of the position of the last computation. */
+    const GoRegionBoard& Regions() const;
+
+protected:
+    void OnBoardChange();
+
+    void PrePlay(GoPlayerMove move);
+
+    void OnPlay(GoPlayerMove move);
+
+    void OnUndo();
+
+private:
+    /** The copy of the game board */
+    GoBoard m_bd;
+
+    GoRegionBoard m_regions;
+
+    /** Update the board and the regions to the game board */
+    void Update();
+
+    /** Not implemented */
+    GoIncrementalSafety(const GoIncrementalSafety&);
+
+    /** Not implemented */
+    GoIncrementalSafety& operator=(const GoIncrementalSafety&);
+};
+
+inline const GoRegionBoard& GoIncrementalSafety::Regions() const
+{
+    return m_regions;
+}
+
+//----------------------------------------------------------------------------
+
+#endif // GO_INCREMENTALSAFETY_H
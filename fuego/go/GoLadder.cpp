@@ -10,6 +10,7 @@
 #include "GoBoard.h"
 #include "GoBoardUtil.h"
 #include "GoModBoard.h"
+#include "SgArray.h"
 #include "SgVector.h"
 #include "SgStack.h"
 
@@ -25,11 +26,137 @@ const int GOOD_FOR_PREY = 1000;
 
 const int GOOD_FOR_HUNTER = -1000;
 
+/** Random hash codes for the keys of GoLadderCache.
+    The key of a ladder is the hash code of the position xor'ed with the
+    code of the anchor of the prey and the code of the flags. */
+class LadderZobrist
+{
+public:
+    LadderZobrist();
+
+    const SgHashCode& Anchor(SgPoint anchor) const;
+
+    const SgHashCode& Flags(SgBlackWhite toPlay, bool twoLibIsEscape) const;
+
+private:
+    SgArray<SgHashCode,SG_MAXPOINT> m_anchor;
+
+    SgArray<SgHashCode,4> m_flags;
+};
+
+LadderZobrist::LadderZobrist()
+{
+    for (int i = 0; i < SG_MAXPOINT; ++i)
+        m_anchor[i] = SgHashCode::Random();
+    for (int i = 0; i < 4; ++i)
+        m_flags[i] = SgHashCode::Random();
+}
+
+inline const SgHashCode& LadderZobrist::Anchor(SgPoint anchor) const
+{
+    return m_anchor[anchor];
+}
+
+inline const SgHashCode& LadderZobrist::Flags(SgBlackWhite toPlay,
+                                              bool twoLibIsEscape) const
+{
+    return m_flags[(toPlay << 1) | (twoLibIsEscape ? 1 : 0)];
+}
+
+/** The codes are created on first use (thread-safe since C++11), not at
+    static initialization, because they are drawn from SgRandom::Global(). */
+const LadderZobrist& GetLadderZobrist()
+{
+    static const LadderZobrist s_zobrist;
+    return s_zobrist;
+}
+
+/** See GoLadderUtil::LadderStatus() */
+GoLadderStatus ComputeLadderStatus(GoLadder& ladder, const GoBoard& bd,
+                                   SgPoint prey, bool twoLibIsEscape,
+                                   SgPoint* toCapture, SgPoint* toEscape)
+{
+    SG_ASSERT(bd.IsValidPoint(prey));
+    SG_ASSERT(bd.Occupied(prey));
+#ifndef NDEBUG
+    SgHashCode oldHash = bd.GetHashCode();
+#endif
+    // Unsettled only if can capture when hunter plays first, and can escape
+    // if prey plays first.
+    SgBlackWhite preyColor = bd.GetStone(prey);
+    SgVector<SgPoint> captureSequence;
+    GoLadderStatus status = GO_LADDER_ESCAPED;
+    if (ladder.Ladder(bd, prey, SgOppBW(preyColor), &captureSequence,
+                      twoLibIsEscape) < 0)
+    {
+        SgVector<SgPoint> escapeSequence;
+        if (ladder.Ladder(bd, prey, preyColor, &escapeSequence,
+                          twoLibIsEscape) < 0)
+            status = GO_LADDER_CAPTURED;
+        else
+        {
+            status = GO_LADDER_UNSETTLED;
+            // Unsettled = ladder depends on who plays first, so there must
+            // be a move that can be played.
+            SG_ASSERT(captureSequence.NonEmpty());
+            // escapeSequence can be empty in 2 libs, prey to play case
+            SG_ASSERT(twoLibIsEscape || escapeSequence.NonEmpty());
+            if (toCapture)
+                *toCapture = captureSequence.Front();
+            if (toEscape)
+                *toEscape = escapeSequence.IsEmpty() ? SG_PASS :
+                                                       escapeSequence.Front();
+        }
+    }
+#ifndef NDEBUG
+    // Make sure Ladder didn't change the board position.
+    SG_ASSERT(oldHash == bd.GetHashCode());
+#endif
+    return status;
+}
+
 } // namespace
 
 //----------------------------------------------------------------------------
 
+GoLadderCache::GoLadderCache(size_t megabytes)
+    : m_table(megabytes)
+{
+}
+
+void GoLadderCache::Clear()
+{
+    m_table.Clear();
+}
+
+SgHashCode GoLadderCache::Key(const GoBoard& bd, SgPoint prey,
+                              SgBlackWhite toPlay, bool twoLibIsEscape)
+{
+    const LadderZobrist& zobrist = GetLadderZobrist();
+    SgHashCode code = bd.GetHashCode();
+    code.Xor(zobrist.Anchor(bd.Anchor(prey)));
+    code.Xor(zobrist.Flags(toPlay, twoLibIsEscape));
+    return code;
+}
+
+bool GoLadderCache::Lookup(const GoBoard& bd, SgPoint prey,
+                           SgBlackWhite toPlay, bool twoLibIsEscape,
+                           GoLadderHashData* data) const
+{
+    return m_table.Lookup(Key(bd, prey, toPlay, twoLibIsEscape), data);
+}
+
+void GoLadderCache::Store(const GoBoard& bd, SgPoint prey,
+                          SgBlackWhite toPlay, bool twoLibIsEscape,
+                          const GoLadderHashData& data)
+{
+    m_table.Store(Key(bd, prey, toPlay, twoLibIsEscape), data);
+}
+
+//----------------------------------------------------------------------------
+
 GoLadder::GoLadder()
+    : m_cache(0)
 {
 }
 
@@ -391,9 +518,34 @@ void GoLadder::ReduceToBlocks(GoPointList& stones)
     }
 }
 
-/** Main ladder routine */
 int GoLadder::Ladder(const GoBoard& bd, SgPoint prey, SgBlackWhite toPlay,
                      SgVector<SgPoint>* sequence, bool twoLibIsEscape)
+{
+    if (m_cache == 0 || ! bd.Occupied(prey))
+        return LadderSearch(bd, prey, toPlay, sequence, twoLibIsEscape);
+    if (sequence)
+        sequence->Clear();
+    GoLadderHashData data;
+    if (! m_cache->Lookup(bd, prey, toPlay, twoLibIsEscape, &data))
+    {
+        // Always get the sequence to store the first move
+        SgVector<SgPoint> ladderSequence;
+        int result = LadderSearch(bd, prey, toPlay, &ladderSequence,
+                                  twoLibIsEscape);
+        SG_ASSERT(result != 0);
+        data = GoLadderHashData(result > 0, ladderSequence.IsEmpty() ?
+                                SG_NULLMOVE : ladderSequence.Front());
+        m_cache->Store(bd, prey, toPlay, twoLibIsEscape, data);
+    }
+    if (sequence && data.Move() != SG_NULLMOVE)
+        sequence->PushBack(data.Move());
+    return data.IsGoodForPrey() ? GOOD_FOR_PREY : GOOD_FOR_HUNTER;
+}
+
+/** Main ladder routine */
+int GoLadder::LadderSearch(const GoBoard& bd, SgPoint prey,
+                           SgBlackWhite toPlay, SgVector<SgPoint>* sequence,
+                           bool twoLibIsEscape)
 {
     GoModBoard modBoard(bd);
     m_bd = &modBoard.Board();
@@ -534,6 +686,61 @@ bool GoLadder::IsSnapback(SgPoint prey)
 
 //----------------------------------------------------------------------------
 
+GoLadderAnalyzer::GoLadderAnalyzer(size_t cacheMegabytes)
+    : m_cache(cacheMegabytes),
+      m_nuQueries(0),
+      m_status(GO_LADDER_UNKNOWN),
+      m_toCapture(SG_NULLMOVE),
+      m_toEscape(SG_NULLMOVE)
+{
+    m_ladder.SetCache(&m_cache);
+}
+
+void GoLadderAnalyzer::Analyze(const GoBoard& bd, bool twoLibIsEscape)
+{
+    m_status.Fill(GO_LADDER_UNKNOWN);
+    m_toCapture.Fill(SG_NULLMOVE);
+    m_toEscape.Fill(SG_NULLMOVE);
+    for (GoBlockIterator it(bd); it; ++it)
+    {
+        SgPoint anchor = *it;
+        GoLadderStatus status = GO_LADDER_ESCAPED;
+        SgPoint toCapture = SG_NULLMOVE;
+        SgPoint toEscape = SG_NULLMOVE;
+        if (bd.NumLiberties(anchor) <= 2)
+            status = LadderStatus(bd, anchor, twoLibIsEscape, &toCapture,
+                                  &toEscape);
+        for (GoBoard::StoneIterator it2(bd, anchor); it2; ++it2)
+        {
+            m_status[*it2] = status;
+            m_toCapture[*it2] = toCapture;
+            m_toEscape[*it2] = toEscape;
+        }
+    }
+}
+
+void GoLadderAnalyzer::ClearCache()
+{
+    m_cache.Clear();
+}
+
+void GoLadderAnalyzer::ClearStatistics()
+{
+    m_nuQueries = 0;
+}
+
+GoLadderStatus GoLadderAnalyzer::LadderStatus(const GoBoard& bd, SgPoint prey,
+                                              bool twoLibIsEscape,
+                                              SgPoint* toCapture,
+                                              SgPoint* toEscape)
+{
+    ++m_nuQueries;
+    return ComputeLadderStatus(m_ladder, bd, prey, twoLibIsEscape,
+                               toCapture, toEscape);
+}
+
+//----------------------------------------------------------------------------
+
 bool GoLadderUtil::Ladder(const GoBoard& bd, SgPoint prey,
                           SgBlackWhite toPlay, bool twoLibIsEscape,
                           SgVector<SgPoint>* sequence)
@@ -563,44 +770,9 @@ GoLadderStatus GoLadderUtil::LadderStatus(const GoBoard& bd, SgPoint prey,
                                           SgPoint* toCapture,
                                           SgPoint* toEscape)
 {
-    SG_ASSERT(bd.IsValidPoint(prey));
-    SG_ASSERT(bd.Occupied(prey));
-#ifndef NDEBUG
-    SgHashCode oldHash = bd.GetHashCode();
-#endif
-    // Unsettled only if can capture when hunter plays first, and can escape
-    // if prey plays first.
     GoLadder ladder;
-    SgBlackWhite preyColor = bd.GetStone(prey);
-    SgVector<SgPoint> captureSequence;
-    GoLadderStatus status = GO_LADDER_ESCAPED;
-    if (ladder.Ladder(bd, prey, SgOppBW(preyColor), &captureSequence,
-                      twoLibIsEscape) < 0)
-    {
-        SgVector<SgPoint> escapeSequence;
-        if (ladder.Ladder(bd, prey, preyColor, &escapeSequence,
-                          twoLibIsEscape) < 0)
-            status = GO_LADDER_CAPTURED;
-        else
-        {
-            status = GO_LADDER_UNSETTLED;
-            // Unsettled = ladder depends on who plays first, so there must
-            // be a move that can be played.
-            SG_ASSERT(captureSequence.NonEmpty());
-            // escapeSequence can be empty in 2 libs, prey to play case
-            SG_ASSERT(twoLibIsEscape || escapeSequence.NonEmpty());
-            if (toCapture)
-                *toCapture = captureSequence.Front();
-            if (toEscape)
-                *toEscape = escapeSequence.IsEmpty() ? SG_PASS :
-                                                       escapeSequence.Front();
-        }
-    }
-#ifndef NDEBUG
-    // Make sure Ladder didn't change the board position.
-    SG_ASSERT(oldHash == bd.GetHashCode());
-#endif
-    return status;
+    return ComputeLadderStatus(ladder, bd, prey, twoLibIsEscape, toCapture,
+                               toEscape);
 }
 
 bool GoLadderUtil::IsProtectedLiberty(const GoBoard& bd, SgPoint liberty,
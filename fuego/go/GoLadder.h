@@ -10,10 +10,13 @@
 #ifndef GO_LADDER_H
 #define GO_LADDER_H
 
+#include <cstddef>
 #include "GoBoard.h"
 #include "SgBoardColor.h"
 #include "GoModBoard.h"
+#include "SgHashTable.h"
 #include "SgPoint.h"
+#include "SgPointArray.h"
 #include "SgPointSet.h"
 #include "SgVector.h"
 
@@ -36,6 +39,138 @@ enum GoLadderStatus
 
 //----------------------------------------------------------------------------
 
+/** Result of GoLadder::Ladder() stored in GoLadderCache. */
+class GoLadderHashData
+{
+public:
+    /** Construct invalid data. */
+    GoLadderHashData();
+
+    /** Constructor.
+        @param isGoodForPrey The result of the ladder
+        @param move The first move of the ladder sequence or SG_NULLMOVE, if
+        the sequence was empty */
+    GoLadderHashData(bool isGoodForPrey, SgPoint move);
+
+    bool IsGoodForPrey() const;
+
+    SgPoint Move() const;
+
+    /** @name Functions needed by SgHashTable */
+    // @{
+
+    /** Ladder results have no depth; always 0. */
+    int Depth() const;
+
+    /** Always true; a ladder result does not get better. */
+    bool IsBetterThan(const GoLadderHashData& data) const;
+
+    bool IsValid() const;
+
+    void Invalidate();
+
+    /** Does nothing; a ladder result does not depend on the search it was
+        computed in. */
+    void AgeData();
+
+    // @} // @name
+
+private:
+    SgPoint m_move;
+
+    bool m_isValid;
+
+    bool m_isGoodForPrey;
+};
+
+inline GoLadderHashData::GoLadderHashData()
+    : m_move(SG_NULLMOVE),
+      m_isValid(false),
+      m_isGoodForPrey(false)
+{
+}
+
+inline GoLadderHashData::GoLadderHashData(bool isGoodForPrey, SgPoint move)
+    : m_move(move),
+      m_isValid(true),
+      m_isGoodForPrey(isGoodForPrey)
+{
+}
+
+inline void GoLadderHashData::AgeData()
+{
+}
+
+inline int GoLadderHashData::Depth() const
+{
+    return 0;
+}
+
+inline void GoLadderHashData::Invalidate()
+{
+    m_isValid = false;
+}
+
+inline bool GoLadderHashData::IsBetterThan(const GoLadderHashData& data)
+    const
+{
+    SG_UNUSED(data);
+    return true;
+}
+
+inline bool GoLadderHashData::IsGoodForPrey() const
+{
+    return m_isGoodForPrey;
+}
+
+inline bool GoLadderHashData::IsValid() const
+{
+    return m_isValid;
+}
+
+inline SgPoint GoLadderHashData::Move() const
+{
+    return m_move;
+}
+
+//----------------------------------------------------------------------------
+
+/** Cache for the results of GoLadder::Ladder().
+    The results are stored under the hash code of the board combined with
+    the anchor of the prey, the color to play and the twoLibIsEscape
+    parameter. Ko and the move number limit of GoLadder are not part of the
+    key; ladders that depend on them are rare. */
+class GoLadderCache
+{
+public:
+    /** Constructor.
+        @param megabytes The size of the hash table, see SgHashTable */
+    explicit GoLadderCache(std::size_t megabytes = 1);
+
+    void Clear();
+
+    bool Lookup(const GoBoard& bd, SgPoint prey, SgBlackWhite toPlay,
+                bool twoLibIsEscape, GoLadderHashData* data) const;
+
+    void Store(const GoBoard& bd, SgPoint prey, SgBlackWhite toPlay,
+               bool twoLibIsEscape, const GoLadderHashData& data);
+
+    const SgHashTable<GoLadderHashData>& Table() const;
+
+private:
+    SgHashTable<GoLadderHashData> m_table;
+
+    static SgHashCode Key(const GoBoard& bd, SgPoint prey,
+                          SgBlackWhite toPlay, bool twoLibIsEscape);
+};
+
+inline const SgHashTable<GoLadderHashData>& GoLadderCache::Table() const
+{
+    return m_table;
+}
+
+//----------------------------------------------------------------------------
+
 /** This class contains all the ladder-specific stuff. */
 class GoLadder
 {
@@ -45,11 +180,18 @@ public:
     /** Main ladder routine.
         twoLibIsEscape: if prey is to play and has two libs, does it count as
         an immediate escape, or shall we keep trying to capture?
+        If a cache is set, the sequence contains only the first move.
         @return Positive value if ladder is good for prey, negative, if good
         for hunter. */
     int Ladder(const GoBoard& bd, SgPoint prey, SgBlackWhite toPlay,
                SgVector<SgPoint>* sequence, bool twoLibIsEscape = false);
 
+    /** Cache for the results of Ladder() (not owned).
+        The cache is also used for the ladders that Ladder() computes
+        recursively to find an escape for a prey with two liberties.
+        Default is 0 (no cache). */
+    void SetCache(GoLadderCache* cache);
+
 private:
     /** Maximum number of moves in ladder.
         If board has simple ko rule, ladders could not terminate. */
@@ -58,6 +200,8 @@ private:
     /** Maximum move number before ladder should be aborted. */
     int m_maxMoveNumber;
 
+    GoLadderCache* m_cache;
+
     GoBoard* m_bd;
 
     SgPointSet m_partOfPrey;
@@ -96,9 +240,122 @@ private:
     int HunterLadder(int depth, SgPoint lib1, SgPoint lib2,
                      const GoPointList& adjBlk, SgVector<SgPoint>* sequence);
 
+    /** Ladder() without cache. */
+    int LadderSearch(const GoBoard& bd, SgPoint prey, SgBlackWhite toPlay,
+                     SgVector<SgPoint>* sequence, bool twoLibIsEscape);
+
     void ReduceToBlocks(GoPointList& stones);
 };
 
+inline void GoLadder::SetCache(GoLadderCache* cache)
+{
+    m_cache = cache;
+}
+
+//----------------------------------------------------------------------------
+
+/** Ladder status of all blocks on the board.
+    Analyze() computes the status of all blocks with one or two liberties
+    in one call (blocks with more liberties are escaped). The ladders share
+    a GoLadderCache, so that a position that was already analyzed (e.g.
+    after a move was undone) or a ladder that was already read while
+    looking for an escape of another block is not searched again.
+    The key of the cache contains the hash code of the whole position, so
+    the results are only reused in the same position: after a new move,
+    all ladders are searched again, even if the move is far away from them.
+    For a sequence of new positions (e.g. after each move of a game),
+    Analyze() is not faster than GoLadderUtil::LadderStatus() for each
+    block. */
+class GoLadderAnalyzer
+{
+public:
+    /** Constructor.
+        @param cacheMegabytes The size of the cache, see GoLadderCache */
+    explicit GoLadderAnalyzer(std::size_t cacheMegabytes = 1);
+
+    /** Compute the ladder status of all blocks.
+        @param bd The board
+        @param twoLibIsEscape See GoLadder::Ladder() */
+    void Analyze(const GoBoard& bd, bool twoLibIsEscape = false);
+
+    /** Ladder status of the block at p in the last call of Analyze().
+        GO_LADDER_UNKNOWN for empty points. */
+    GoLadderStatus Status(SgPoint p) const;
+
+    /** Move that captures the block at p, if its status is
+        GO_LADDER_UNSETTLED, SG_NULLMOVE otherwise. */
+    SgPoint ToCapture(SgPoint p) const;
+
+    /** Move that lets the block at p escape, if its status is
+        GO_LADDER_UNSETTLED, SG_NULLMOVE otherwise. SG_PASS, if the block
+        has two liberties and twoLibIsEscape was set. */
+    SgPoint ToEscape(SgPoint p) const;
+
+    /** Ladder status of a single block using the cache.
+        Same as GoLadderUtil::LadderStatus(). If there are several moves
+        that capture or escape, the move can be a different one, because the
+        results of cached sub-ladders do not depend on the order of the
+        searches. */
+    GoLadderStatus LadderStatus(const GoBoard& bd, SgPoint prey,
+                                bool twoLibIsEscape = false,
+                                SgPoint* toCapture = 0,
+                                SgPoint* toEscape = 0);
+
+    void ClearCache();
+
+    const GoLadderCache& Cache() const;
+
+    /** Number of calls of LadderStatus() (including the calls by
+        Analyze()) since the last ClearStatistics(). */
+    std::size_t NuQueries() const;
+
+    void ClearStatistics();
+
+private:
+    GoLadderCache m_cache;
+
+    GoLadder m_ladder;
+
+    std::size_t m_nuQueries;
+
+    SgPointArray<GoLadderStatus> m_status;
+
+    SgPointArray<SgPoint> m_toCapture;
+
+    SgPointArray<SgPoint> m_toEscape;
+
+    /** Not implemented. */
+    GoLadderAnalyzer(const GoLadderAnalyzer&);
+
+    /** Not implemented. */
+    GoLadderAnalyzer& operator=(const GoLadderAnalyzer&);
+};
+
+inline const GoLadderCache& GoLadderAnalyzer::Cache() const
+{
+    return m_cache;
+}
+
+inline std::size_t GoLadderAnalyzer::NuQueries() const
+{
+    return m_nuQueries;
+}
+
+inline GoLadderStatus GoLadderAnalyzer::Status(SgPoint p) const
+{
+    return m_status[p];
+}
+
+inline SgPoint GoLadderAnalyzer::ToCapture(SgPoint p) const
+{
+    return m_toCapture[p];
+}
+
+inline SgPoint GoLadderAnalyzer::ToEscape(SgPoint p) const
+{
+    return m_toEscape[p];
+}
+
 //----------------------------------------------------------------------------
 
 namespace GoLadderUtil {
@@ -79,7 +79,9 @@ GoRegion::GoRegion(const GoBoard& board, const SgPointSet& points,
           m_eyes(),
           m_vitalPoint(SG_NULLMOVE),
           m_1vcDepth(0),
-          m_miaiStrategy(color)
+          m_miaiStrategy(color),
+          m_hasCachedFlags(false),
+          m_cachedMiaiStrategy(color)
 {
 #ifndef NDEBUG
     ++s_alloc;
@@ -648,6 +650,38 @@ void GoRegion::ReInitialize()
     m_flags.reset();
     m_miaiStrategy.Clear();
     ComputeBasicFlags();
+    m_cachedFlags = m_flags;
+    m_cachedComputedFlags = m_computedFlags;
+    m_cachedMiaiStrategy = m_miaiStrategy;
+    m_cachedArea = DependencyArea();
+    for (SgBWIterator it; it; ++it)
+        m_cachedStones[*it] = m_bd.All(*it) & m_cachedArea;
+    m_hasCachedFlags = true;
+}
+
+bool GoRegion::HasCachedFlags() const
+{
+    if (! m_hasCachedFlags)
+        return false;
+    const SgPointSet area = DependencyArea();
+    return    area == m_cachedArea
+           && (m_bd.All(SG_BLACK) & area) == m_cachedStones[SG_BLACK]
+           && (m_bd.All(SG_WHITE) & area) == m_cachedStones[SG_WHITE];
+}
+
+void GoRegion::ReInitializeFromCache()
+{
+    SG_ASSERT(HasCachedFlags());
+    m_flags = m_cachedFlags;
+    m_computedFlags = m_cachedComputedFlags;
+    m_miaiStrategy = m_cachedMiaiStrategy;
+}
+
+SgPointSet GoRegion::DependencyArea() const
+{
+    SgPointSet area(Points() | BlocksPoints());
+    area |= area.Border(m_bd.Size());
+    return area;
 }
 
 void GoRegion::WriteID(std::ostream& stream) const
@@ -1155,6 +1189,12 @@ void GoRegion::FindChains(const GoRegionBoard& ra)
     m_computedFlags.set(GO_REGION_COMPUTED_CHAINS);
 }
 
+void GoRegion::ClearChains()
+{
+    m_chains.Clear();
+    m_computedFlags.reset(GO_REGION_COMPUTED_CHAINS);
+}
+
 bool GoRegion::IsSurrounded(const SgVectorOf<GoBlock>& blocks) const
 {
     const int size = m_bd.Size();
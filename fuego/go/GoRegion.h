@@ -98,6 +98,28 @@ public:
     /** Clear all flags etc. to recompute region */
     void ReInitialize();
 
+    /** Are the flags computed by the last ReInitialize() still valid?
+        True, if nothing in DependencyArea() changed since then. The cached
+        flags are discarded, if the points or the blocks of the region
+        change (see ResetNonBlockFlags(), DiscardCachedFlags()). */
+    bool HasCachedFlags() const;
+
+    /** Same as ReInitialize(), but restores the flags computed by the last
+        ReInitialize() instead of computing them again.
+        Requires HasCachedFlags() */
+    void ReInitializeFromCache();
+
+    /** Discard the flags cached by ReInitialize() */
+    void DiscardCachedFlags()
+    {
+        m_hasCachedFlags = false;
+    }
+
+    /** All points that the flags computed by ReInitialize() depend on.
+        The points of the region, the stones of its blocks and their
+        neighbors, which include the liberties of the blocks. */
+    SgPointSet DependencyArea() const;
+
     /** For debugging */
     void CheckConsistency() const;
 
@@ -123,6 +145,10 @@ public:
         return m_chains;
     }
 
+    /** Remove all chains.
+        Used by GoRegionBoard before the chains are deleted. */
+    void ClearChains();
+
     /** Blocks of region */
     const SgVectorOf<GoBlock>& Blocks() const
     {
@@ -198,6 +224,7 @@ public:
         m_computedFlags.set(GO_REGION_COMPUTED_BLOCKS);
         m_eyes.Clear();
         Invalidate();
+        DiscardCachedFlags();
     }
 
     /** is region data valid? */
@@ -393,6 +420,24 @@ private:
     /** Miai strategy to keep region safe. */
     SgMiaiStrategy m_miaiStrategy;
 
+    /** Were the flags of the last ReInitialize() cached? */
+    bool m_hasCachedFlags;
+
+    /** m_flags after the last ReInitialize() */
+    GoRegionFlags m_cachedFlags;
+
+    /** m_computedFlags after the last ReInitialize() */
+    GoRegionFlags m_cachedComputedFlags;
+
+    /** m_miaiStrategy after the last ReInitialize() */
+    SgMiaiStrategy m_cachedMiaiStrategy;
+
+    /** DependencyArea() at the last ReInitialize() */
+    SgPointSet m_cachedArea;
+
+    /** Stones in m_cachedArea at the last ReInitialize() */
+    SgBWSet m_cachedStones;
+
     /** A simple test if all cuts between blocks are protected. 
         Works only for corridors (@see IsCorridor):
         If corridor, then opp. can get at most 2 libs (Opp2L).
@@ -72,7 +72,8 @@ GoRegionBoard::GoRegionBoard(const GoBoard& board)
       m_block(0),
       m_invalid(true),
       m_computedHealthy(false),
-      m_boardSize(board.Size())
+      m_boardSize(board.Size()),
+      m_nuReInitializedRegions(0)
 {
     m_code.Invalidate();
     m_chainsCode.Invalidate();
@@ -106,7 +107,7 @@ void GoRegionBoard::Clear()
     m_allRegions[SG_WHITE].Clear();
     m_allChains[SG_BLACK].Clear();
     m_allChains[SG_WHITE].Clear();
-    m_stack.Clear();
+    ClearStack();
     m_code.Invalidate();
     m_invalid = true;
     m_computedHealthy = false;
@@ -161,7 +162,10 @@ void GoRegionBoard::UpdateBlock(int move, SgBlackWhite moveColor)
         SgVectorOf<GoRegion> regions;
         RegionsAt(area, moveColor, &regions);
         for (SgVectorIteratorOf<GoRegion> it(regions); it; ++it)
+        {
             (*it)->BlocksNonConst().PushBack(b);
+            (*it)->DiscardCachedFlags();
+        }
     }
 }
 
@@ -244,7 +248,7 @@ void GoRegionBoard::OnExecutedUncodedMove(int move, SgBlackWhite moveColor)
             for (SgVectorIteratorOf<GoRegion> it(AllRegions(color)); it; ++it)
             {   GoRegion* r1 = *it;
                 if (! r1->IsValid())
-                    r1->ComputeBasicFlags();
+                    r1->ReInitialize();
             }
         }
     }
@@ -295,6 +299,39 @@ void GoRegionBoard::CheckConsistency() const
     }
 }
 
+void GoRegionBoard::ClearStack()
+{
+    while (! m_stack.IsEmpty())
+    {
+        const int val = m_stack.PopEvent();
+        switch (val)
+        {
+            case SG_NEXTMOVE:
+            break;
+            case REGION_REMOVE:
+                delete static_cast<GoRegion*>(m_stack.PopPtr());
+            break;
+            case REGION_REMOVE_BLOCK:
+            {   delete static_cast<GoBlock*>(m_stack.PopPtr());
+                for (int nu = m_stack.PopInt(); nu > 0; --nu)
+                    m_stack.PopPtr();
+            }
+            break;
+            case REGION_ADD:
+            case REGION_ADD_BLOCK:
+                m_stack.PopPtr();
+            break;
+            case REGION_ADD_STONE:
+            case REGION_ADD_STONE_TO_BLOCK:
+                m_stack.PopPtr();
+                m_stack.PopInt();
+            break;
+            default:
+                SG_ASSERT(false);
+        }
+    }
+}
+
 void GoRegionBoard::PushRegion(int type, GoRegion* r)
 {
     m_stack.PushPtrEvent(type, r);
@@ -330,7 +367,11 @@ void GoRegionBoard::RemoveRegion(GoRegion* r, bool isExecute)
         (*it)->RemoveRegion(r);
 
     if (isExecute)
+    {
+        // flags cached for the region are not valid when it is restored
+        r->DiscardCachedFlags();
         PushRegion(REGION_REMOVE, r);
+    }
     else // undo
         delete r;
 }
@@ -506,6 +547,12 @@ void GoRegionBoard::OnUndoneMove()
     if (DEBUG_REGION_BOARD)
         SgDebug() << "OnUndoneMove " << '\n';
 
+    if (m_stack.IsEmpty())
+    {
+        Clear();
+        return;
+    }
+
     const bool IS_UNDO = false;
     SgVectorOf<GoRegion> changed;
 
@@ -567,7 +614,7 @@ void GoRegionBoard::OnUndoneMove()
     for (SgVectorIteratorOf<GoRegion> it(changed); it; ++it)
     {
         (*it)->ResetNonBlockFlags();
-        (*it)->ComputeBasicFlags();
+        (*it)->ReInitialize();
     }
 
     if (HEAVYCHECK)
@@ -589,18 +636,30 @@ void GoRegionBoard::OnUndoneMove()
         CheckConsistency();
 }
 
-void GoRegionBoard::ReInitializeBlocksRegions()
+void GoRegionBoard::ReInitializeBlocksRegions(bool reuseUnchanged)
 {
     SG_ASSERT(UpToDate());
 
+    ClearChains();
+    m_nuReInitializedRegions = 0;
     for (SgBWIterator it; it; ++it)
     {
         SgBlackWhite color(*it);
         for (SgVectorIteratorOf<GoBlock> it(AllBlocks(color)); it; ++it)
             (*it)->ReInitialize();
         for (SgVectorIteratorOf<GoRegion> it2(AllRegions(color)); it2; ++it2)
-            (*it2)->ReInitialize();
+        {
+            GoRegion* r = *it2;
+            if (reuseUnchanged && r->HasCachedFlags())
+                r->ReInitializeFromCache();
+            else
+            {
+                r->ReInitialize();
+                ++m_nuReInitializedRegions;
+            }
+        }
     }
+    m_computedHealthy = false;
 }
 
 GoRegion* GoRegionBoard::GenRegion(const SgPointSet& area,
@@ -662,6 +721,8 @@ void GoRegionBoard::GenBlocksRegions()
 
     FindBlocksWithEye();
 
+    // the generated blocks and regions cannot be undone
+    ClearStack();
     m_code = Board().GetHashCode();
     m_invalid = false;
     if (HEAVYCHECK)
@@ -686,6 +747,20 @@ void GoRegionBoard::GenChains()
     m_chainsCode = Board().GetHashCode();
 }
 
+void GoRegionBoard::ClearChains()
+{
+    for (SgBWIterator it; it; ++it)
+    {
+        SgBlackWhite color(*it);
+        for (SgVectorIteratorOf<GoChain> it(AllChains(color)); it; ++it)
+            delete *it;
+        AllChains(color).Clear();
+        for (SgVectorIteratorOf<GoRegion> it(AllRegions(color)); it; ++it)
+            (*it)->ClearChains();
+    }
+    m_chainsCode.Invalidate();
+}
+
 void GoRegionBoard::WriteBlocks(std::ostream& stream) const
 {
     for (SgBWIterator it; it; ++it)
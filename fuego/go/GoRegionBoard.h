@@ -72,7 +72,9 @@ public:
     void OnExecutedUncodedMove(int move, SgBlackWhite moveColor);
 
     /** Called after a move has been undone.
-        The board is guaranteed to be in a legal state. */
+        The board is guaranteed to be in a legal state.
+        If there is no information about the move, because the blocks and
+        regions were generated after it was executed, calls Clear(). */
     void OnUndoneMove();
 
     /** All GoBlock's of given color */
@@ -141,8 +143,23 @@ public:
         and must be moved here. */
     void GenChains();
 
-    /** Clear all flags etc. to recompute regions and blocks */
-    void ReInitializeBlocksRegions();
+    /** Clear all flags etc. to recompute regions and blocks.
+        Deletes all chains, call GenChains() to compute them again.
+        @param reuseUnchanged Incremental mode: regions, for which nothing
+        in GoRegion::DependencyArea() changed since they were last
+        reinitialized, restore the flags computed then (see
+        GoRegion::ReInitializeFromCache) instead of computing them again. */
+    void ReInitializeBlocksRegions(bool reuseUnchanged = false);
+
+    /** Delete all chains */
+    void ClearChains();
+
+    /** Number of regions that computed their flags again in the last
+        ReInitializeBlocksRegions() */
+    int NuReInitializedRegions() const
+    {
+        return m_nuReInitializedRegions;
+    }
 
     /** mark all regions that the given attribute has been computed */
     void SetComputedFlagForAll(GoRegionFlag flag);
@@ -264,6 +281,9 @@ private:
     /** stores incremental state changes for execute/undo moves */
     SgIncrementalStack m_stack;
 
+    /** Clear m_stack and delete the removed blocks and regions on it */
+    void ClearStack();
+
     /** push on m_stack */
     void PushRegion(int type, GoRegion* r);
 
@@ -312,6 +332,9 @@ private:
     /** Boardsize is needed to avoid problems with resizing an empty board */
     int m_boardSize;
 
+    /** See NuReInitializedRegions() */
+    int m_nuReInitializedRegions;
+
     /** debugging bookkeeping. @todo do it in debug only */
     static int s_alloc, s_free;
 
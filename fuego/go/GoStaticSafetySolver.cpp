@@ -18,7 +18,8 @@ using GoSafetyUtil::AddToSafe;
 GoStaticSafetySolver::GoStaticSafetySolver(const GoBoard& board,
                                            GoRegionBoard* regions)
     : m_board(board),
-      m_allocRegion(! regions)
+      m_allocRegion(! regions),
+      m_incremental(false)
 {
     if (regions)
         m_regions = regions;
@@ -46,7 +47,9 @@ bool GoStaticSafetySolver::UpToDate() const
 
 void GoStaticSafetySolver::GenBlocksRegions()
 {
-    if (UpToDate())
+    if (m_incremental && Regions()->UpToDate())
+        Regions()->ReInitializeBlocksRegions(true);
+    else if (UpToDate())
         Regions()->ReInitializeBlocksRegions();
     else
     {
@@ -92,7 +95,12 @@ void GoStaticSafetySolver::TestAlive(SgVectorOf<GoBlock>* blocks,
                               SgBWSet* safe,
                               SgBlackWhite color)
 {
-    SgVectorOf<GoRegion> regions(Regions()->AllRegions(color));
+    // Only regions that are healthy for one of the blocks can provide a
+    // sure liberty or become safe
+    SgVectorOf<GoRegion> regions;
+    for (SgVectorIteratorOf<GoBlock> it(*blocks); it; ++it)
+        for (SgVectorIteratorOf<GoRegion> it2((*it)->Healthy()); it2; ++it2)
+            regions.Include(*it2);
     SgVectorOf<GoBlock> toDelete;
 
     bool changed = true;
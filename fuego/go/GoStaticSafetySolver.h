@@ -46,6 +46,18 @@ public:
 
     // @} // @name
 
+
+    /** Incremental mode.
+        If the regions are kept up to date with the moves on the board
+        (see GoRegionBoard::OnExecutedMove, GoRegionBoard::OnUndoneMove),
+        the regions not affected by the moves since the last computation
+        reuse their flags. See GoRegionBoard::ReInitializeBlocksRegions.
+        Default is false. */
+    bool Incremental() const;
+
+    /** See Incremental() */
+    void SetIncremental(bool enable);
+
 protected:
 
     /** our regions */
@@ -98,6 +110,9 @@ private:
     /** Did we allocate the GoRegionBoard or did the user supply it? */
     bool m_allocRegion;
 
+    /** See Incremental() */
+    bool m_incremental;
+
     /** not implemented */
     GoStaticSafetySolver(const GoStaticSafetySolver&);
 
@@ -111,6 +126,11 @@ inline const GoBoard& GoStaticSafetySolver::Board() const
     return m_board;
 }
 
+inline bool GoStaticSafetySolver::Incremental() const
+{
+    return m_incremental;
+}
+
 inline GoRegionBoard* GoStaticSafetySolver::Regions()
 {
     SG_ASSERT(m_regions);
@@ -123,6 +143,11 @@ inline const GoRegionBoard* GoStaticSafetySolver::Regions() const
     return m_regions;
 }
 
+inline void GoStaticSafetySolver::SetIncremental(bool enable)
+{
+    m_incremental = enable;
+}
+
 //----------------------------------------------------------------------------
 
 #endif // GO_STATICSAFETYSOLVER_H
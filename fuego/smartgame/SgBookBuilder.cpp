@@ -5,10 +5,14 @@
 #include "SgSystem.h"
 #include "SgBookBuilder.h"
 
+#include <map>
+#include <set>
 #include <sstream>
 #include <boost/numeric/conversion/bounds.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "SgDebug.h"
 #include "SgPoint.h"
+#include "SgThreadedWorker.h"
 #include "SgTimer.h"
 
 //----------------------------------------------------------------------------
@@ -53,17 +57,138 @@ void SgBookNode::FromString(const std::string& str)
 
 //----------------------------------------------------------------------------
 
+SgBookChildEvaluator::~SgBookChildEvaluator()
+{
+}
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+typedef std::vector<std::pair<SgMove, float> > Scores;
+
+/** Children of a position to be evaluated by a worker thread. */
+struct EvaluationJob
+{
+    /** Moves from the start position of the operation. */
+    std::vector<SgMove> m_sequence;
+
+    std::vector<SgMove> m_childrenToDo;
+};
+
+/** Runs the evaluator of a thread for SgThreadedWorker. */
+class EvaluationWorker
+{
+public:
+    EvaluationWorker(SgBookChildEvaluator* evaluator);
+
+    Scores operator()(const EvaluationJob& job);
+
+private:
+    SgBookChildEvaluator* m_evaluator;
+};
+
+EvaluationWorker::EvaluationWorker(SgBookChildEvaluator* evaluator)
+    : m_evaluator(evaluator)
+{
+}
+
+Scores EvaluationWorker::operator()(const EvaluationJob& job)
+{
+    Scores scores;
+    m_evaluator->EvaluateChildren(job.m_sequence, job.m_childrenToDo,
+                                  scores);
+    return scores;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+struct SgBookBuilder::ParallelState
+{
+    /** Evaluated children, not yet used by an iteration. */
+    struct Evaluation
+    {
+        std::vector<SgMove> m_childrenToDo;
+
+        Scores m_scores;
+    };
+
+    typedef std::map<std::vector<SgMove>, Evaluation> EvaluationMap;
+
+    std::vector<SgBookChildEvaluator*> m_evaluators;
+
+    std::vector<EvaluationWorker> m_workers;
+
+    boost::scoped_ptr<SgThreadedWorker<EvaluationJob,Scores,
+                                       EvaluationWorker> > m_threads;
+
+    /** Evaluations by the sequence of their position. */
+    EvaluationMap m_evaluations;
+
+    /** Positions selected for evaluation in the current batch. */
+    std::set<std::vector<SgMove> > m_claimed;
+
+    /** Internal nodes without leaves to select in the current batch. */
+    std::set<std::vector<SgMove> > m_exhausted;
+
+    std::size_t m_numBatches;
+
+    std::size_t m_numEvaluated;
+
+    std::size_t m_numUsed;
+
+    /** Evaluations needed by iterations, which were not predicted. */
+    std::size_t m_numNotPredicted;
+
+    ParallelState();
+
+    ~ParallelState();
+
+    bool IsClaimed(const std::vector<SgMove>& sequence) const;
+};
+
+SgBookBuilder::ParallelState::ParallelState()
+    : m_numBatches(0),
+      m_numEvaluated(0),
+      m_numUsed(0),
+      m_numNotPredicted(0)
+{
+}
+
+SgBookBuilder::ParallelState::~ParallelState()
+{
+    // Join the threads before deleting the evaluators
+    m_threads.reset(0);
+    for (std::size_t i = 0; i < m_evaluators.size(); ++i)
+        delete m_evaluators[i];
+}
+
+bool SgBookBuilder::ParallelState::IsClaimed(const std::vector<SgMove>&
+                                             sequence) const
+{
+    return m_claimed.count(sequence) > 0
+        || m_evaluations.count(sequence) > 0;
+}
+
+//----------------------------------------------------------------------------
+
 SgBookBuilder::SgBookBuilder()
     : m_alpha(50),
       m_useWidening(true),
       m_expandWidth(16),
       m_expandThreshold(1000),
-      m_flushIterations(100)
+      m_flushIterations(100),
+      m_numThreads(1),
+      m_parallel(0),
+      m_sequence(0)
 {
 }
 
 SgBookBuilder::~SgBookBuilder()
 {
+    delete m_parallel;
 }
 
 //----------------------------------------------------------------------------
@@ -98,6 +223,13 @@ void SgBookBuilder::Fini()
     // DEFAULT IMPLEMENTATION DOES NOTHING
 }
 
+SgBookChildEvaluator* SgBookBuilder::CreateChildEvaluator(std::size_t
+                                                          threadId)
+{
+    SG_UNUSED(threadId);
+    return 0;
+}
+
 void SgBookBuilder::Expand(int numExpansions)
 {
     m_numEvals = 0;
@@ -106,6 +238,7 @@ void SgBookBuilder::Expand(int numExpansions)
     SgTimer timer;
     Init();
     EnsureRootExists();
+    StartParallel();
     int num = 0;
     for (; num < numExpansions; ++num) 
     {
@@ -125,13 +258,19 @@ void SgBookBuilder::Expand(int numExpansions)
         }
         StartIteration();
         std::vector<SgMove> pv;
+        if (m_parallel != 0)
+            EvaluateInParallel(pv);
+        m_sequence = &pv;
         DoExpansion(pv);
+        m_sequence = 0;
         EndIteration();
 
         if (num && (num % m_flushIterations) == 0) 
             FlushBook();
     }
     FlushBook();
+    std::string parallelStatistics = ParallelStatistics();
+    EndParallel();
     Fini();
     timer.Stop();
     double elapsed = timer.GetTime();
@@ -145,7 +284,8 @@ void SgBookBuilder::Expand(int numExpansions)
        << "Evaluations    " << m_numEvals 
        << std::fixed << std::setprecision(2)
        << " (" << (double(m_numEvals) / elapsed) << "/s)\n"
-       << "Widenings      " << m_numWidenings << '\n';
+       << "Widenings      " << m_numWidenings << '\n'
+       << parallelStatistics;
     PrintMessage(os.str());
 }
 
@@ -157,6 +297,7 @@ void SgBookBuilder::Cover(int requiredExpansions, bool additive,
     std::size_t newLines = 0;
     SgTimer timer;
     Init();
+    StartParallel();
     int num = 0;
     for (std::size_t i = 0; i < lines.size(); ++i)
     {
@@ -191,8 +332,12 @@ void SgBookBuilder::Cover(int requiredExpansions, bool additive,
                 }
 
                 StartIteration();
-                std::vector<SgMove> pv;
+                std::vector<SgMove> pv(played);
+                if (m_parallel != 0)
+                    EvaluateInParallel(pv);
+                m_sequence = &pv;
                 DoExpansion(pv);
+                m_sequence = 0;
                 EndIteration();
 
                 num++;
@@ -215,6 +360,8 @@ void SgBookBuilder::Cover(int requiredExpansions, bool additive,
         }
     }
     FlushBook();
+    std::string parallelStatistics = ParallelStatistics();
+    EndParallel();
     Fini();
     timer.Stop();
     double elapsed = timer.GetTime();
@@ -229,7 +376,8 @@ void SgBookBuilder::Cover(int requiredExpansions, bool additive,
        << std::fixed << std::setprecision(2)
        << " (" << (double(m_numEvals) / elapsed) << "/s)\n"
        << "Widenings      " << m_numWidenings << '\n'
-       << "New Lines      " << newLines << '\n';
+       << "New Lines      " << newLines << '\n'
+       << parallelStatistics;
     PrintMessage(os.str());
 }
 
@@ -319,21 +467,14 @@ bool SgBookBuilder::ExpandChildren(std::size_t count)
         WriteNode(SgBookNode(value));
         return false;
     }
-    std::size_t limit = std::min(count, children.size());
     std::vector<SgMove> childrenToDo;
-    for (std::size_t i = 0; i < limit; ++i)
-    {
-        PlayMove(children[i]);
-        SgBookNode child;
-        if (!GetNode(child))
-            childrenToDo.push_back(children[i]);
-        UndoMove(children[i]);
-    }
+    ChildrenToEvaluate(children, count, childrenToDo);
     if (!childrenToDo.empty())
     {
         BeforeEvaluateChildren();
         std::vector<std::pair<SgMove, float> > scores;
-        EvaluateChildren(childrenToDo, scores);
+        if (!StoredEvaluation(childrenToDo, scores))
+            EvaluateChildren(childrenToDo, scores);
         AfterEvaluateChildren();
         for (std::size_t i = 0; i < scores.size(); ++i)
         {
@@ -349,6 +490,22 @@ bool SgBookBuilder::ExpandChildren(std::size_t count)
     return false;
 }
 
+/** The first count children that have not been created yet. */
+void SgBookBuilder::ChildrenToEvaluate(const std::vector<SgMove>& children,
+                                       std::size_t count,
+                                       std::vector<SgMove>& childrenToDo)
+{
+    std::size_t limit = std::min(count, children.size());
+    for (std::size_t i = 0; i < limit; ++i)
+    {
+        PlayMove(children[i]);
+        SgBookNode child;
+        if (!GetNode(child))
+            childrenToDo.push_back(children[i]);
+        UndoMove(children[i]);
+    }
+}
+
 std::size_t SgBookBuilder::NumChildren(const std::vector<SgMove>& legal)
 {
     std::size_t num = 0;
@@ -588,3 +745,210 @@ void SgBookBuilder::IncreaseWidth(bool root)
 }
 
 //----------------------------------------------------------------------------
+
+/** Start parallel expansion, if NumThreads() is greater than one and the
+    builder creates evaluators. */
+void SgBookBuilder::StartParallel()
+{
+    SG_ASSERT(m_parallel == 0);
+    if (m_numThreads <= 1)
+        return;
+    std::auto_ptr<ParallelState> parallel(new ParallelState());
+    for (std::size_t i = 0; i < m_numThreads; ++i)
+    {
+        SgBookChildEvaluator* evaluator = CreateChildEvaluator(i);
+        if (evaluator == 0)
+        {
+            PrintMessage("Parallel expansion not supported, "
+                         "using one thread\n");
+            return;
+        }
+        parallel->m_evaluators.push_back(evaluator);
+        parallel->m_workers.push_back(EvaluationWorker(evaluator));
+    }
+    parallel->m_threads.reset(new SgThreadedWorker<EvaluationJob,Scores,
+                                                   EvaluationWorker>(
+                                                     parallel->m_workers));
+    m_parallel = parallel.release();
+}
+
+void SgBookBuilder::EndParallel()
+{
+    delete m_parallel;
+    m_parallel = 0;
+}
+
+/** Evaluate the leaf that the next iteration expands and further leaves
+    in the worker threads, if the evaluation of this leaf is not already
+    stored.
+    @param pv The moves from the start position of the operation to the
+    current position
+    @ref bookparallel */
+void SgBookBuilder::EvaluateInParallel(std::vector<SgMove>& pv)
+{
+    ParallelState& parallel = *m_parallel;
+    std::vector<EvaluationJob> jobs;
+    parallel.m_claimed.clear();
+    parallel.m_exhausted.clear();
+    while (jobs.size() < m_numThreads)
+    {
+        EvaluationJob job;
+        job.m_sequence = pv;
+        // The first descent is the descent of the next iteration, the
+        // following descents skip the claimed leaves
+        const bool virtualVisits = ! parallel.m_claimed.empty();
+        if (!PredictExpansion(job.m_sequence, job.m_childrenToDo,
+                              virtualVisits))
+            break;
+        if (parallel.m_claimed.count(job.m_sequence) > 0)
+            break;
+        parallel.m_claimed.insert(job.m_sequence);
+        ParallelState::EvaluationMap::const_iterator it =
+            parallel.m_evaluations.find(job.m_sequence);
+        if (it != parallel.m_evaluations.end())
+        {
+            if (it->second.m_childrenToDo == job.m_childrenToDo)
+            {
+                if (jobs.empty())
+                    // The next iteration can use a stored evaluation
+                    return;
+                continue;
+            }
+            parallel.m_evaluations.erase(job.m_sequence);
+        }
+        jobs.push_back(job);
+    }
+    if (jobs.empty())
+        return;
+    std::vector<std::pair<EvaluationJob,Scores> > results;
+    parallel.m_threads->DoWork(jobs, results);
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        ParallelState::Evaluation& evaluation =
+            parallel.m_evaluations[results[i].first.m_sequence];
+        evaluation.m_childrenToDo = results[i].first.m_childrenToDo;
+        evaluation.m_scores = results[i].second;
+    }
+    ++parallel.m_numBatches;
+    parallel.m_numEvaluated += results.size();
+}
+
+/** Find the leaf that an iteration starting in the current position
+    expands and the children it evaluates.
+    Uses the same selection as DoExpansion(), but does not change the book.
+    Forced widenings of lost nodes are not predicted.
+    @param pv The moves to the current position; the moves to the leaf are
+    appended
+    @param childrenToDo The children to evaluate in the leaf
+    @param virtualVisits Skip leaves claimed in the current batch or
+    already evaluated
+    @return false, if no children would be evaluated */
+bool SgBookBuilder::PredictExpansion(std::vector<SgMove>& pv,
+                                     std::vector<SgMove>& childrenToDo,
+                                     bool virtualVisits)
+{
+    SgBookNode node;
+    if (!GetNode(node) || node.IsTerminal())
+        return false;
+    std::size_t width = 0;
+    if (node.IsLeaf())
+        width = m_expandWidth;
+    else if (m_useWidening && (node.m_count % m_expandThreshold == 0))
+        width = (node.m_count / m_expandThreshold + 1) * m_expandWidth;
+    // A claimed internal node is widened with the claimed evaluation,
+    // then the iteration continues below it
+    if (width > 0 && (node.IsLeaf() || ! virtualVisits
+                      || ! m_parallel->IsClaimed(pv)))
+    {
+        float value = 0;
+        std::vector<SgMove> children;
+        if (GenerateMoves(children, value))
+            return false;
+        ChildrenToEvaluate(children, width, childrenToDo);
+        return ! childrenToDo.empty();
+    }
+    std::vector<SgMove> legal;
+    GetAllLegalMoves(legal);
+    UpdateValue(node, legal);
+    if (IsLoss(Value(node)))
+        return false;
+    while (true)
+    {
+        float bestPriority = boost::numeric::bounds<float>::highest();
+        SgMove bestChild = SG_NULLMOVE;
+        for (std::size_t i = 0; i < legal.size(); ++i)
+        {
+            PlayMove(legal[i]);
+            SgBookNode child;
+            if (GetNode(child))
+            {
+                pv.push_back(legal[i]);
+                bool isSkipped = virtualVisits
+                    && ((child.IsLeaf() && m_parallel->IsClaimed(pv))
+                        || m_parallel->m_exhausted.count(pv) > 0);
+                pv.pop_back();
+                float priority = ComputePriority(node, Value(child),
+                                                 child.m_priority);
+                if (! isSkipped && priority < bestPriority)
+                {
+                    bestPriority = priority;
+                    bestChild = legal[i];
+                }
+            }
+            UndoMove(legal[i]);
+        }
+        if (bestChild == SG_NULLMOVE)
+            return false;
+        PlayMove(bestChild);
+        pv.push_back(bestChild);
+        bool result = PredictExpansion(pv, childrenToDo, virtualVisits);
+        UndoMove(bestChild);
+        if (result)
+            return true;
+        if (! virtualVisits)
+        {
+            pv.pop_back();
+            return false;
+        }
+        // No leaf to claim below this child, try the next best child
+        m_parallel->m_exhausted.insert(pv);
+        pv.pop_back();
+    }
+}
+
+/** Get the evaluation of the children of the current position stored by
+    the parallel expansion.
+    @return false, if there is no stored evaluation for these children */
+bool SgBookBuilder::StoredEvaluation(const std::vector<SgMove>& childrenToDo,
+                          std::vector<std::pair<SgMove, float> >& scores)
+{
+    if (m_parallel == 0 || m_sequence == 0)
+        return false;
+    ParallelState::EvaluationMap::iterator it =
+        m_parallel->m_evaluations.find(*m_sequence);
+    if (it == m_parallel->m_evaluations.end()
+        || it->second.m_childrenToDo != childrenToDo)
+    {
+        ++m_parallel->m_numNotPredicted;
+        return false;
+    }
+    scores.swap(it->second.m_scores);
+    m_parallel->m_evaluations.erase(it);
+    ++m_parallel->m_numUsed;
+    return true;
+}
+
+std::string SgBookBuilder::ParallelStatistics() const
+{
+    if (m_parallel == 0)
+        return "";
+    std::ostringstream os;
+    os << "Threads        " << m_numThreads << '\n'
+       << "Batches        " << m_parallel->m_numBatches << '\n'
+       << "Parallel Evals " << m_parallel->m_numEvaluated << '\n'
+       << "Used           " << m_parallel->m_numUsed << '\n'
+       << "Not Predicted  " << m_parallel->m_numNotPredicted << '\n';
+    return os.str();
+}
+
+//----------------------------------------------------------------------------
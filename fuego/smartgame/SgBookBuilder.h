@@ -150,6 +150,55 @@ inline std::ostream& operator<<(std::ostream& os, const SgBookNode& node)
 
     A book refresh should be performed after this operation. */
 
+/** @page bookparallel Parallel Expansion
+    @ingroup sgopeningbook
+
+    If SgBookBuilder::NumThreads() is greater than one and the builder
+    creates evaluators with SgBookBuilder::CreateChildEvaluator(),
+    Expand() and Cover() evaluate children in worker threads.
+
+    Before an iteration, the builder determines the leaf that the
+    iteration will expand, by descending the book as in the iteration. If
+    the evaluation of this leaf is not available yet, further leaves are
+    selected by descending again, while leaves already selected are claimed
+    and skipped in the selection (a virtual visit). The children of the
+    selected leaves are evaluated concurrently by the worker threads, each
+    with its own evaluator. The iterations themselves, including all book
+    reads, writes and the back-propagation, are run in the main thread as
+    in the sequential algorithm; they use the stored evaluations instead of
+    calling EvaluateChildren(). Evaluations that are not used by an
+    iteration are kept until the end of the operation, because a later
+    iteration often expands the same leaf.
+
+    Therefore, the book is identical to the book built by the sequential
+    algorithm, if the evaluation of the children of a position does not
+    depend on the previous evaluations. Children that are needed but not
+    predicted (e.g. in forced widenings) are evaluated in the main thread
+    with EvaluateChildren(). */
+
+//----------------------------------------------------------------------------
+
+/** Evaluator of a worker thread for the parallel expansion.
+    The evaluators of different threads are used concurrently, so each
+    evaluator needs its own state, e.g. its own board.
+    @ref bookparallel
+    @ingroup sgopeningbook */
+class SgBookChildEvaluator
+{
+public:
+    virtual ~SgBookChildEvaluator();
+
+    /** Evaluate the children of a position.
+        @param sequence The moves leading from the position, in which the
+        evaluator was created, to the position
+        @param childrenToDo The moves to evaluate
+        @param scores The values of the children in the same format as in
+        SgBookBuilder::EvaluateChildren() */
+    virtual void EvaluateChildren(const std::vector<SgMove>& sequence,
+                                  const std::vector<SgMove>& childrenToDo,
+                       std::vector<std::pair<SgMove, float> >& scores) = 0;
+};
+
 //----------------------------------------------------------------------------
 
 /** Base class for automated book building.
@@ -216,6 +265,14 @@ public:
     /** See UseWidening() */
     void SetExpandThreshold(std::size_t threshold);
 
+    /** Number of threads used to evaluate children in Expand() and
+        Cover().
+        Default is 1. @ref bookparallel */
+    std::size_t NumThreads() const;
+
+    /** See NumThreads() */
+    void SetNumThreads(std::size_t numThreads);
+
     //---------------------------------------------------------------------    
 
     /** Computes the expansion priority for the child using Alpha(),
@@ -310,6 +367,14 @@ protected:
 
     virtual void AfterEvaluateChildren();
 
+    /** Create the evaluator of a worker thread for parallel expansion.
+        Called at the start of Expand() and Cover() for each thread, if
+        NumThreads() is greater than one. The evaluator must be in the
+        current state of the builder. The builder deletes the evaluators
+        at the end of the operation. The default implementation returns 0,
+        which disables the parallel expansion. */
+    virtual SgBookChildEvaluator* CreateChildEvaluator(std::size_t threadId);
+
     virtual void ClearAllVisited() = 0;
 
     virtual void MarkAsVisited() = 0;
@@ -317,6 +382,19 @@ protected:
     virtual bool HasBeenVisited() = 0;
 
 private:
+    /** Evaluations of the parallel expansion, see SgBookBuilder.cpp */
+    struct ParallelState;
+
+    std::size_t m_numThreads;
+
+    /** State of parallel expansion, 0 if the operation is sequential. */
+    ParallelState* m_parallel;
+
+    /** The moves from the start position of the operation to the current
+        position during an iteration of Expand() and Cover().
+        0 outside of these iterations. */
+    const std::vector<SgMove>* m_sequence;
+
     std::size_t m_numEvals;
 
     std::size_t m_numWidenings;
@@ -348,6 +426,31 @@ private:
     void IncreaseWidth(bool root);
     
     bool ExpandChildren(std::size_t count);
+
+    void ChildrenToEvaluate(const std::vector<SgMove>& children,
+                            std::size_t count,
+                            std::vector<SgMove>& childrenToDo);
+
+    bool StoredEvaluation(const std::vector<SgMove>& childrenToDo,
+                          std::vector<std::pair<SgMove, float> >& scores);
+
+    void StartParallel();
+
+    void EndParallel();
+
+    void EvaluateInParallel(std::vector<SgMove>& pv);
+
+    bool PredictExpansion(std::vector<SgMove>& pv,
+                          std::vector<SgMove>& childrenToDo,
+                          bool virtualVisits);
+
+    std::string ParallelStatistics() const;
+
+    /** Not implemented. */
+    SgBookBuilder(const SgBookBuilder&);
+
+    /** Not implemented. */
+    SgBookBuilder& operator=(const SgBookBuilder&);
 };
 
 //----------------------------------------------------------------------------
@@ -392,6 +495,16 @@ inline void SgBookBuilder::SetExpandThreshold(std::size_t threshold)
     m_expandThreshold = threshold;
 }
 
+inline std::size_t SgBookBuilder::NumThreads() const
+{
+    return m_numThreads;
+}
+
+inline void SgBookBuilder::SetNumThreads(std::size_t numThreads)
+{
+    m_numThreads = numThreads;
+}
+
 //----------------------------------------------------------------------------
 
 #endif // SG_BOOKBUILDER_HPP
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include "SgLog.h"
 
 using namespace std;
 
@@ -55,6 +56,11 @@ void SgDebugToFile(const char* filename)
     g_debugStrPtr = s_fileStream.get();
 }
 
+void SgDebugToLog()
+{
+    g_debugStrPtr = &SgLogStream();
+}
+
 void SgDebugToNull()
 {
     g_debugStrPtr = &s_nullStream;
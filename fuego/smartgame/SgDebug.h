@@ -25,6 +25,11 @@ std::ostream& SgWarning();
 /** Set logging stream to file. */
 void SgDebugToFile(const char* filename);
 
+/** Send logging stream to the asynchronous logger.
+    The text is written by the background thread of the logger, so writing
+    to SgDebug() does not wait for a slow console. See SgLog.h */
+void SgDebugToLog();
+
 /** Set logging stream to null stream.
     Discards everything written to SgDebug(). */
 void SgDebugToNull();
@@ -57,13 +57,14 @@ bool SgGameReader::GetIntProp(const SgGameReader::RawProperties& properties,
     node properties to parse points correctly. */
 void SgGameReader::HandleProperties(SgNode* node,
                                     const RawProperties& properties,
-                                    int& boardSize, SgPropPointFmt& fmt)
+                                    int& boardSize, SgPropPointFmt& fmt,
+                                    Warnings& warnings)
 {
     int value;
     if (GetIntProp(properties, "SZ", value))
     {
        if (value < SG_MIN_SIZE || value > SG_MAX_SIZE)
-           m_warnings.set(INVALID_BOARDSIZE);
+           warnings.set(INVALID_BOARDSIZE);
        else
            boardSize = value;
     }
@@ -75,7 +76,7 @@ void SgGameReader::HandleProperties(SgNode* node,
         const string& label = it->first;
         const vector<string>& values = it->second;
         if (values.size() == 0)
-            m_warnings.set(PROPERTY_WITHOUT_VALUE);
+            warnings.set(PROPERTY_WITHOUT_VALUE);
         SgProp* prop;
         SgPropID id = SgProp::GetIDOfLabel(label);
         if (id != SG_PROP_NONE)
@@ -90,7 +91,11 @@ void SgGameReader::HandleProperties(SgNode* node,
 
 void SgGameReader::PrintWarnings(ostream& out) const
 {
-    Warnings warnings = m_warnings;
+    PrintWarnings(out, m_warnings);
+}
+
+void SgGameReader::PrintWarnings(ostream& out, Warnings warnings)
+{
     // Print more severe warnings first, less severe warnings later
     PrintWarning(out, warnings, INVALID_BOARDSIZE, "Invalid board size");
     PrintWarning(out, warnings, PROPERTY_WITHOUT_VALUE,
@@ -170,7 +175,7 @@ SgNode* SgGameReader::ReadSubtree(SgNode* node, int boardSize,
         {
             if (node)
             {
-                HandleProperties(node, properties, boardSize, fmt);
+                HandleProperties(node, properties, boardSize, fmt, m_warnings);
                 properties.clear();
                 node = node->NewRightMostSon();
             }
@@ -179,12 +184,12 @@ SgNode* SgGameReader::ReadSubtree(SgNode* node, int boardSize,
         }
         else if (c == '(')
         {
-            HandleProperties(node, properties, boardSize, fmt);
+            HandleProperties(node, properties, boardSize, fmt, m_warnings);
             properties.clear();
             ReadSubtree(node, boardSize, fmt);
         }
     }
-    HandleProperties(node, properties, boardSize, fmt);
+    HandleProperties(node, properties, boardSize, fmt, m_warnings);
     return node;
 }
 
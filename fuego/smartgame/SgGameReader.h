@@ -43,6 +43,9 @@ public:
     /** Warnings that occurred during reading. */
     typedef std::bitset<NU_WARNING_FLAGS> Warnings;
 
+    /** Map label to values (unparsed) */
+    typedef std::map<std::string, std::vector<std::string> > RawProperties;
+
     /** Create reader from an input stream.
         @param in The input stream.
         @param defaultSize The (game-dependent) default board size, if file
@@ -57,6 +60,17 @@ public:
         Prints the warnings as human readable text. */
     void PrintWarnings(std::ostream& out) const;
 
+    /** Print warnings as human readable text. */
+    static void PrintWarnings(std::ostream& out, Warnings warnings);
+
+    /** Create SgProp instances and add them to node.
+        Also used by SgMappedGameReader, so that both readers create
+        identical trees. */
+    static void HandleProperties(SgNode* node,
+                                 const RawProperties& properties,
+                                 int& boardSize, SgPropPointFmt& fmt,
+                                 Warnings& warnings);
+
     /** Read next game tree from file.
         @return Root node or 0 if there is no next game. */
     SgNode* ReadGame();
@@ -66,9 +80,6 @@ public:
     void ReadGames(SgVectorOf<SgNode>* rootList);
 
 private:
-    /** Map label to values (unparsed) */
-    typedef std::map<std::string, std::vector<std::string> > RawProperties;
-
     std::istream& m_in;
 
     const int m_defaultSize;
@@ -87,9 +98,6 @@ private:
     static bool GetIntProp(const RawProperties& properties,
                            const std::string& label, int& value);
 
-    void HandleProperties(SgNode* node, const RawProperties& properties,
-                          int& boardSize, SgPropPointFmt& fmt);
-
     SgNode* ReadGame(bool resetWarnings);
 
     std::string ReadLabel(int c);
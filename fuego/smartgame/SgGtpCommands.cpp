@@ -8,12 +8,19 @@
 
 #include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <vector>
 #if ! WIN32
 #include <unistd.h>
 #endif
 #include "SgDebug.h"
+#include "SgGtpPipelinedClient.h"
+#if ! WIN32
+#include "SgProcess.h"
+#endif
 #include "SgRandom.h"
 #include "SgTime.h"
+#include "SgWrite.h"
 
 using namespace std;
 
@@ -170,6 +177,83 @@ void SgGtpCommands::CmdDebugger(GtpCommand& cmd)
 #endif
 }
 
+/** Compare the latency of SgGtpClient and SgGtpPipelinedClient.
+    Arguments: number [window [program...]] <br>
+    Starts the program (default: this program) and sends it the given
+    number of echo commands, first with SgGtpClient (one round trip per
+    command), then with SgGtpPipelinedClient::SendAsync() and
+    SgGtpPipelinedClient::SendAll() with the given maximum number of commands
+    in flight (default 16). Returns the commands per second and the average
+    time per command in real time. Not implemented on Windows. */
+void SgGtpCommands::CmdGtpClientBenchmark(GtpCommand& cmd)
+{
+#if WIN32
+    throw GtpFailure("command not implemented on Windows");
+#else
+    int number = cmd.ArgMin<int>(0, 1);
+    size_t window = 16;
+    if (cmd.NuArg() > 1)
+        window = cmd.ArgMin<size_t>(1, 1);
+    string program;
+    if (cmd.NuArg() > 2)
+        program = cmd.RemainingLine(1);
+    else if (m_programPath != 0)
+        program = m_programPath;
+    else
+        throw GtpFailure("location of executable unknown");
+    vector<string> commands;
+    for (int i = 0; i < number; ++i)
+    {
+        ostringstream command;
+        command << "echo " << i;
+        commands.push_back(command.str());
+    }
+    double timeSequential;
+    double timePipelined;
+    double timeBatch;
+    try
+    {
+        SgProcess process(program);
+        {
+            SgGtpClient client(process.Input(), process.Output());
+            // Wait until the program is started
+            client.Send("echo");
+            double start = SgTime::Get(SG_TIME_REAL);
+            for (int i = 0; i < number; ++i)
+                client.Send(commands[i]);
+            timeSequential = SgTime::Get(SG_TIME_REAL) - start;
+        }
+        SgGtpPipelinedClient client(process.Input(), process.Output(),
+                                    window);
+        double start = SgTime::Get(SG_TIME_REAL);
+        vector<future<string> > responses;
+        for (int i = 0; i < number; ++i)
+            responses.push_back(client.SendAsync(commands[i]));
+        for (int i = 0; i < number; ++i)
+            if (client.Get(responses[i]) != commands[i].substr(5))
+                throw GtpFailure() << "wrong response to " << commands[i];
+        timePipelined = SgTime::Get(SG_TIME_REAL) - start;
+        start = SgTime::Get(SG_TIME_REAL);
+        client.SendAll(commands);
+        timeBatch = SgTime::Get(SG_TIME_REAL) - start;
+    }
+    catch (const SgException& e)
+    {
+        throw GtpFailure() << "error running " << program << ": " << e.what();
+    }
+    cmd << SgWriteLabel("Commands") << number << '\n'
+        << SgWriteLabel("Window") << window << '\n';
+    const char* labels[] = { "Sequential", "Pipelined", "SendAll" };
+    double times[] = { timeSequential, timePipelined, timeBatch };
+    for (int i = 0; i < 3; ++i)
+        cmd << SgWriteLabel(labels[i]) << fixed << setprecision(0)
+            << number / max(times[i], 1e-9) << " cmd/s, "
+            << setprecision(1) << times[i] / number * 1e6 << " us/cmd\n";
+    cmd << SgWriteLabel("Speedup") << setprecision(2)
+        << timeSequential / max(timePipelined, 1e-9);
+#endif
+}
+
 /** Echo command argument line as response.
     This command is compatible with GNU Go's 'echo' command. */
 void SgGtpCommands::CmdEcho(GtpCommand& cmd)
@@ -205,6 +289,54 @@ void SgGtpCommands::CmdGetRandomSeed(GtpCommand& cmd)
     cmd << SgRandom::Seed();
 }
 
+/** Compare the throughput of SgRandom and SgFastRandom.
+    Arguments: [number] <br>
+    Draws the given number of random integers (default 10000000) with
+    Int(), Int(range) and Fill() and returns millions of numbers per
+    second in real time. */
+void SgGtpCommands::CmdRandomBenchmark(GtpCommand& cmd)
+{
+    cmd.CheckNuArgLessEqual(1);
+    int number = 10000000;
+    if (cmd.NuArg() > 0)
+        number = cmd.ArgMin<int>(0, 1);
+    // Ranges of typical playout draws (number of empty points)
+    const int range = 361;
+    // Sum of all numbers, so that the compiler does not remove the loops
+    unsigned int sum = 0;
+    SgRandom random;
+    SgFastRandom fastRandom;
+    vector<unsigned int> values(number);
+    double times[5];
+    double start = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < number; ++i)
+        sum += random.Int();
+    times[0] = SgTime::Get(SG_TIME_REAL) - start;
+    start = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < number; ++i)
+        sum += random.Int(range);
+    times[1] = SgTime::Get(SG_TIME_REAL) - start;
+    start = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < number; ++i)
+        sum += fastRandom.Int();
+    times[2] = SgTime::Get(SG_TIME_REAL) - start;
+    start = SgTime::Get(SG_TIME_REAL);
+    for (int i = 0; i < number; ++i)
+        sum += fastRandom.Int(range);
+    times[3] = SgTime::Get(SG_TIME_REAL) - start;
+    start = SgTime::Get(SG_TIME_REAL);
+    fastRandom.Fill(&values[0], values.size());
+    times[4] = SgTime::Get(SG_TIME_REAL) - start;
+    sum += values.back();
+    const char* labels[] = { "SgRandom::Int()", "SgRandom::Int(361)",
+                             "SgFastRandom::Int()", "SgFastRandom::Int(361)",
+                             "SgFastRandom::Fill()" };
+    for (int i = 0; i < 5; ++i)
+        cmd << SgWriteLabel(labels[i]) << fixed << setprecision(1)
+            << number / max(times[i], 1e-9) / 1e6 << " M/s\n";
+    cmd << SgWriteLabel("Checksum") << sum;
+}
+
 /** Set global parameters used in module SmartGame.
     Parameters:
     @arg @c time_mode cpu|real See SgTime */
@@ -272,7 +404,11 @@ void SgGtpCommands::Register(GtpEngine& engine)
     engine.Register("sg_compare_float", &SgGtpCommands::CmdCompareFloat, this);
     engine.Register("sg_compare_int", &SgGtpCommands::CmdCompareInt, this);
     engine.Register("sg_exec", &SgGtpCommands::CmdExec, this);
+    engine.Register("sg_gtp_client_benchmark",
+                    &SgGtpCommands::CmdGtpClientBenchmark, this);
     engine.Register("sg_param", &SgGtpCommands::CmdParam, this);
+    engine.Register("sg_random_benchmark",
+                    &SgGtpCommands::CmdRandomBenchmark, this);
     engine.Register("quiet", &SgGtpCommands::CmdQuiet, this);
 }
 
@@ -43,7 +43,9 @@ public:
         - @link CmdCompareInt() @c sg_compare_int @endlink
         - @link CmdDebugger() @c sg_debugger @endlink
         - @link CmdExec() @c sg_exec @endlink
+        - @link CmdGtpClientBenchmark() @c sg_gtp_client_benchmark @endlink
         - @link CmdParam() @c sg_param @endlink
+        - @link CmdRandomBenchmark() @c sg_random_benchmark @endlink
         - @link CmdQuiet() @c quiet @endlink */
     /** @name Command Callbacks */
     // @{
@@ -56,8 +58,10 @@ public:
     virtual void CmdEchoErr(GtpCommand&);
     virtual void CmdExec(GtpCommand&);
     virtual void CmdGetRandomSeed(GtpCommand&);
+    virtual void CmdGtpClientBenchmark(GtpCommand&);
     virtual void CmdParam(GtpCommand&);
     virtual void CmdPid(GtpCommand&);
+    virtual void CmdRandomBenchmark(GtpCommand&);
     virtual void CmdSetRandomSeed(GtpCommand&);
     virtual void CmdQuiet(GtpCommand&);
     // @} // @name
@@ -0,0 +1,414 @@
+//----------------------------------------------------------------------------
+/** @file SgGtpPipelinedClient.cpp
+    See SgGtpPipelinedClient.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgGtpPipelinedClient.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include "SgDebug.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/** Maximum time of each wait in the destructor in seconds. */
+const double CLOSE_TIMEOUT = 10;
+
+/** Duration of a time in seconds.
+    Milliseconds with a 64-bit count, because a count of microseconds in a
+    long overflows after 36 minutes where long has 32 bits (Windows). */
+boost::posix_time::time_duration Duration(double seconds)
+{
+    return boost::posix_time::milliseconds(
+                                 static_cast<boost::int64_t>(seconds * 1e3));
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+struct SgGtpPipelinedClient::Pending
+{
+    /** Called instead of setting the promise, if not empty. */
+    Callback m_callback;
+
+    promise<string> m_promise;
+
+    void Complete(bool success, const string& response);
+};
+
+void SgGtpPipelinedClient::Pending::Complete(bool success,
+                                             const string& response)
+{
+    if (m_callback)
+        m_callback(success, response);
+    else if (success)
+        m_promise.set_value(response);
+    else
+        m_promise.set_exception(make_exception_ptr(SgGtpFailure(response)));
+}
+
+//----------------------------------------------------------------------------
+
+/** The reader thread passes the responses to the client through the link.
+    If the destructor detaches the reader thread, it sets m_client to 0;
+    the thread then stops at the next response. */
+struct SgGtpPipelinedClient::ReaderLink
+{
+    /** Held while the reader thread passes a response to the client. */
+    boost::mutex m_mutex;
+
+    SgGtpPipelinedClient* m_client;
+};
+
+//----------------------------------------------------------------------------
+
+SgGtpPipelinedClient::SgGtpPipelinedClient(istream& in, ostream& out,
+                                           size_t maxInFlight, bool verbose)
+    : m_verbose(verbose),
+      m_out(out),
+      m_maxInFlight(maxInFlight),
+      m_timeout(0),
+      m_nextId(1),
+      m_isBroken(false),
+      m_readerLink(new ReaderLink())
+{
+    SG_ASSERT(maxInFlight > 0);
+    m_readerLink->m_client = this;
+    m_reader = boost::thread(boost::bind(&SgGtpPipelinedClient::ReadResponses,
+                                         m_readerLink, boost::ref(in),
+                                         verbose));
+}
+
+SgGtpPipelinedClient::~SgGtpPipelinedClient()
+{
+    if (! m_reader.joinable())
+        return;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (m_timeout <= 0 || m_timeout > CLOSE_TIMEOUT)
+            m_timeout = CLOSE_TIMEOUT;
+    }
+    SendQuit();
+    if (m_reader.timed_join(Duration(CLOSE_TIMEOUT)))
+        return;
+    SgWarning() << "SgGtpPipelinedClient: engine did not close its output\n";
+    {
+        boost::mutex::scoped_lock lock(m_readerLink->m_mutex);
+        m_readerLink->m_client = 0;
+    }
+    FailAll("GTP connection is closed");
+    m_reader.detach();
+}
+
+void SgGtpPipelinedClient::Answer(bool hasId, unsigned int id, bool success,
+                                  const string& response)
+{
+    Pending* pending;
+    map<unsigned int, Pending*>::iterator it;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        it = (hasId ? m_pending.find(id) : m_pending.begin());
+        if (it == m_pending.end())
+        {
+            if (m_verbose)
+                SgDebug() << "SgGtpPipelinedClient: ignoring response to "
+                    "unknown command\n";
+            return;
+        }
+        pending = it->second;
+    }
+    // The command stays in the window until its callback returned, so that
+    // WaitAll() also waits for the callbacks. Only this thread removes
+    // commands from m_pending, so the iterator stays valid.
+    pending->Complete(success, response);
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_pending.erase(it);
+    }
+    m_answered.notify_all();
+    delete pending;
+}
+
+void SgGtpPipelinedClient::Close()
+{
+    if (! m_reader.joinable())
+        return;
+    SendQuit();
+    m_reader.join();
+}
+
+boost::system_time SgGtpPipelinedClient::Deadline() const
+{
+    return boost::get_system_time() + Duration(m_timeout);
+}
+
+void SgGtpPipelinedClient::FailAll(const string& message)
+{
+    map<unsigned int, Pending*> pending;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_isBroken = true;
+        pending.swap(m_pending);
+    }
+    m_answered.notify_all();
+    for (map<unsigned int, Pending*>::iterator it = pending.begin();
+         it != pending.end(); ++it)
+    {
+        it->second->Complete(false, message);
+        delete it->second;
+    }
+}
+
+void SgGtpPipelinedClient::Flush()
+{
+    m_out.flush();
+    if (! m_out)
+        throw SgGtpFailure("GTP write connection is broken");
+}
+
+string SgGtpPipelinedClient::Get(future<string>& response) const
+{
+    const double timeout = Timeout();
+    if (timeout > 0
+        && response.wait_for(chrono::duration<double>(timeout))
+           == future_status::timeout)
+        throw SgGtpFailure("timeout waiting for GTP response");
+    return response.get();
+}
+
+bool SgGtpPipelinedClient::IsBroken() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_isBroken;
+}
+
+size_t SgGtpPipelinedClient::MaxInFlight() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_maxInFlight;
+}
+
+size_t SgGtpPipelinedClient::NuInFlight() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_pending.size();
+}
+
+bool SgGtpPipelinedClient::ReadResponse(istream& in, bool verbose,
+                                        bool& hasId, unsigned int& id,
+                                        bool& success, string& response)
+{
+    string line;
+    // Some engines write additional empty lines between responses
+    while (line.empty())
+    {
+        getline(in, line);
+        if (! in)
+            return false;
+    }
+    if (verbose)
+        SgDebug() << ">> " << line << '\n';
+    if (line[0] != '=' && line[0] != '?')
+    {
+        response = "Invalid response: '" + line + "'";
+        return false;
+    }
+    success = (line[0] == '=');
+    size_t pos = 1;
+    while (pos < line.size() && isdigit(static_cast<unsigned char>(line[pos])))
+        ++pos;
+    hasId = (pos > 1);
+    id = (hasId ? strtoul(line.substr(1, pos - 1).c_str(), 0, 10) : 0);
+    if (pos < line.size() && line[pos] != ' ')
+    {
+        response = "Invalid response: '" + line + "'";
+        return false;
+    }
+    ostringstream text;
+    if (pos < line.size())
+        text << line.substr(pos + 1);
+    while (true)
+    {
+        getline(in, line);
+        if (! in)
+            return false;
+        if (verbose)
+            SgDebug() << ">> " << line << '\n';
+        if (line.empty())
+            break;
+        text << '\n' << line;
+    }
+    response = text.str();
+    return true;
+}
+
+void SgGtpPipelinedClient::ReadResponses(boost::shared_ptr<ReaderLink> link,
+                                         istream& in, bool verbose)
+{
+    string response;
+    bool hasId;
+    unsigned int id;
+    bool success;
+    while (true)
+    {
+        const bool isValid =
+            ReadResponse(in, verbose, hasId, id, success, response);
+        boost::mutex::scoped_lock lock(link->m_mutex);
+        if (link->m_client == 0)
+            return;
+        if (! isValid)
+        {
+            link->m_client->FailAll(in ? response
+                                    : "GTP read connection is broken");
+            return;
+        }
+        link->m_client->Answer(hasId, id, success, response);
+    }
+}
+
+void SgGtpPipelinedClient::SendQuit()
+{
+    try
+    {
+        if (! IsBroken())
+            Send("quit");
+    }
+    catch (const SgGtpFailure& e)
+    {
+        if (m_verbose)
+            SgDebug() << "SgGtpPipelinedClient: quit failed: " << e.what()
+                      << '\n';
+    }
+}
+
+string SgGtpPipelinedClient::Send(const string& command)
+{
+    future<string> response = SendAsync(command);
+    return Get(response);
+}
+
+vector<string> SgGtpPipelinedClient::SendAll(const vector<string>& commands)
+{
+    vector<future<string> > responses;
+    responses.reserve(commands.size());
+    for (vector<string>::const_iterator it = commands.begin();
+         it != commands.end(); ++it)
+    {
+        Pending* pending = new Pending();
+        responses.push_back(pending->m_promise.get_future());
+        Write(*it, pending, false);
+    }
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        Flush();
+    }
+    vector<string> result;
+    result.reserve(responses.size());
+    for (size_t i = 0; i < responses.size(); ++i)
+        result.push_back(Get(responses[i]));
+    return result;
+}
+
+future<string> SgGtpPipelinedClient::SendAsync(const string& command)
+{
+    Pending* pending = new Pending();
+    future<string> response = pending->m_promise.get_future();
+    Write(command, pending, true);
+    return response;
+}
+
+void SgGtpPipelinedClient::SendAsync(const string& command,
+                                     const Callback& callback)
+{
+    Pending* pending = new Pending();
+    pending->m_callback = callback;
+    Write(command, pending, true);
+}
+
+void SgGtpPipelinedClient::SetMaxInFlight(size_t maxInFlight)
+{
+    SG_ASSERT(maxInFlight > 0);
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_maxInFlight = maxInFlight;
+    m_answered.notify_all();
+}
+
+void SgGtpPipelinedClient::SetTimeout(double seconds)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_timeout = seconds;
+}
+
+double SgGtpPipelinedClient::Timeout() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_timeout;
+}
+
+void SgGtpPipelinedClient::WaitAll()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    Flush();
+    boost::system_time deadline = Deadline();
+    while (! m_pending.empty())
+    {
+        if (m_timeout <= 0)
+            m_answered.wait(lock);
+        else if (! m_answered.timed_wait(lock, deadline)
+                 && ! m_pending.empty())
+            throw SgGtpFailure("timeout waiting for GTP responses");
+    }
+}
+
+void SgGtpPipelinedClient::Write(const string& command, Pending* pending,
+                                 bool flush)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    try
+    {
+        boost::system_time deadline = Deadline();
+        while (! m_isBroken && m_pending.size() >= m_maxInFlight)
+        {
+            // Commands written without flush must reach the engine,
+            // otherwise the window never gets free
+            Flush();
+            if (m_timeout <= 0)
+                m_answered.wait(lock);
+            else if (! m_answered.timed_wait(lock, deadline)
+                     && m_pending.size() >= m_maxInFlight)
+                throw SgGtpFailure("timeout waiting for GTP responses");
+        }
+        if (m_isBroken)
+            throw SgGtpFailure("GTP connection is broken or closed");
+    }
+    catch (...)
+    {
+        delete pending;
+        throw;
+    }
+    unsigned int id = m_nextId++;
+    m_pending[id] = pending;
+    m_out << id << ' ' << command << '\n';
+    if (m_verbose)
+        SgDebug() << "<< " << id << ' ' << command << '\n';
+    if (flush)
+        Flush();
+    else if (! m_out)
+        throw SgGtpFailure("GTP write connection is broken");
+    // If writing failed, the command stays pending; the engine is usually
+    // gone and the reader thread fails it when it gets the end of the input
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,236 @@
+//----------------------------------------------------------------------------
+/** @file SgGtpPipelinedClient.h
+    Client connection to a GTP engine with several commands in flight. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_GTPPIPELINEDCLIENT_H
+#define SG_GTPPIPELINEDCLIENT_H
+
+#include <cstddef>
+#include <future>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "SgGtpClient.h"
+
+//----------------------------------------------------------------------------
+
+/** Client connection to an external GTP engine that does not wait for the
+    response of a command before sending the next one.
+    SgGtpClient::Send() pays a full round trip (write, switch to the engine,
+    response, switch back) per command. A GTP engine executes its commands
+    one after the other anyway, so this client writes each command with a
+    numeric id as soon as it is sent and a reader thread matches the
+    responses to the pending commands by their id. Setting up a position
+    with a sequence of play commands and several queries then costs about
+    one round trip instead of one per command.
+
+    SendAsync() returns a future or calls a callback with the response;
+    Send() and SendAll() wait for the responses. At most MaxInFlight()
+    commands are pending at the same time, SendAsync() blocks while the
+    window is full. Engines that do not echo the ids are supported, their
+    responses are assigned to the oldest pending command.
+
+    Timeouts: all waits of the client (for a free slot in the window, for a
+    response in Send(), Get() and WaitAll()) throw SgGtpFailure after
+    Timeout() seconds. The command that timed out stays pending, its slot in
+    the window is only freed when the engine responds to it, because the
+    engine still works on it.
+
+    If the connection breaks, all pending and future commands fail with
+    SgGtpFailure.
+    Usage example:
+@code
+    SgProcess process("fuego");
+    SgGtpPipelinedClient gtp(process.Input(), process.Output());
+    gtp.Send("boardsize 9");
+    gtp.SendAsync("play b e5");
+    gtp.SendAsync("play w c3");
+    future<string> score = gtp.SendAsync("final_score");
+    future<string> status = gtp.SendAsync("final_status_list dead");
+    SgDebug() << gtp.Get(score) << ' ' << gtp.Get(status) << '\n';
+@endcode */
+class SgGtpPipelinedClient
+{
+public:
+    /** Function called with the response of a command.
+        Called by the reader thread, so it should return quickly and must not
+        wait for other responses of the same client.
+        @param success false if the command failed or the connection broke
+        @param response The response (without status character and id) or
+        error message */
+    typedef boost::function<void(bool success, const std::string& response)>
+        Callback;
+
+    /** Constructor.
+        Starts the reader thread.
+        @param in Input stream (the output of the engine).
+        @param out Output stream (the input of the engine).
+        @param maxInFlight See MaxInFlight()
+        @param verbose Log stream to SgDebug() */
+    SgGtpPipelinedClient(std::istream& in, std::ostream& out,
+                         std::size_t maxInFlight = 16, bool verbose = false);
+
+    /** Like Close(), but does not wait forever.
+        Waits at most 10 seconds (or Timeout(), if shorter) for the response
+        to quit and then at most 10 seconds for the engine to close its
+        output. If the engine does not close its output, the pending
+        commands fail and the reader thread is detached. The detached thread
+        still reads the input stream until the engine closes it, so the
+        stream must stay valid until then. */
+    ~SgGtpPipelinedClient();
+
+    /** Send a command without waiting for the response.
+        Blocks only while MaxInFlight() commands are pending.
+        @return Future of the response. Contains an SgGtpFailure if the
+        command fails or the connection breaks.
+        @throws SgGtpFailure If the window stays full for Timeout() seconds
+        or the connection is broken. */
+    std::future<std::string> SendAsync(const std::string& command);
+
+    /** Send a command and call a function with its response.
+        @throws SgGtpFailure As SendAsync(const std::string&) */
+    void SendAsync(const std::string& command, const Callback& callback);
+
+    /** Send a command and wait for the response.
+        Commands sent earlier with SendAsync() are still answered before.
+        @throws SgGtpFailure If command fails, connection is broken or no
+        response arrives within Timeout() seconds. */
+    std::string Send(const std::string& command);
+
+    /** Send several commands and wait for all responses.
+        The commands are written with a single flush (if they fit in the
+        window), so the engine can process them without waiting for the
+        client.
+        @throws SgGtpFailure With the response of the first command that
+        failed. The remaining commands are still executed by the engine. */
+    std::vector<std::string>
+    SendAll(const std::vector<std::string>& commands);
+
+    /** Wait for a response returned by SendAsync().
+        @throws SgGtpFailure If the command failed or no response arrives
+        within Timeout() seconds. */
+    std::string Get(std::future<std::string>& response) const;
+
+    /** Wait until all pending commands have been answered.
+        @throws SgGtpFailure On timeout. */
+    void WaitAll();
+
+    /** Send quit, wait for the engine to close its output and stop the
+        reader thread.
+        Does nothing if already closed. The engine must exit (or at least
+        close its output) after quit, otherwise this function blocks. */
+    void Close();
+
+    /** Maximum number of commands that were sent and not answered yet.
+        Default is 16. Larger windows save round trips only if the engine
+        reads ahead; the limit keeps a slow engine from buffering an
+        unbounded number of commands in the pipe. */
+    std::size_t MaxInFlight() const;
+
+    /** See MaxInFlight() */
+    void SetMaxInFlight(std::size_t maxInFlight);
+
+    /** Number of commands that were sent and not answered yet. */
+    std::size_t NuInFlight() const;
+
+    /** Maximum time in seconds to wait for a response or a free slot.
+        Default is 0 (no timeout). */
+    double Timeout() const;
+
+    /** See Timeout() */
+    void SetTimeout(double seconds);
+
+    /** True if the connection is broken or closed. */
+    bool IsBroken() const;
+
+private:
+    /** A command that was sent and not answered yet, see
+        SgGtpPipelinedClient.cpp */
+    struct Pending;
+
+    /** Connection of the reader thread to the client, see
+        SgGtpPipelinedClient.cpp */
+    struct ReaderLink;
+
+    bool m_verbose;
+
+    std::ostream& m_out;
+
+    /** Protects all members below and the writes to m_out. */
+    mutable boost::mutex m_mutex;
+
+    std::size_t m_maxInFlight;
+
+    double m_timeout;
+
+    /** Notified when a command is answered or the connection breaks. */
+    boost::condition m_answered;
+
+    /** Pending commands by id. */
+    std::map<unsigned int, Pending*> m_pending;
+
+    unsigned int m_nextId;
+
+    /** Set by the reader thread at the end of the input. */
+    bool m_isBroken;
+
+    boost::shared_ptr<ReaderLink> m_readerLink;
+
+    boost::thread m_reader;
+
+    /** Register a pending command and write it.
+        Waits for a free slot in the window; before waiting, unflushed
+        commands are flushed.
+        @param flush Flush the output stream after writing the command. */
+    void Write(const std::string& command, Pending* pending, bool flush);
+
+    /** Flush the output stream. Requires a lock on m_mutex.
+        @throws SgGtpFailure If the connection is broken. */
+    void Flush();
+
+    /** Main function of the reader thread.
+        Uses only the input stream and the link, so that it can outlive the
+        client, see destructor. */
+    static void ReadResponses(boost::shared_ptr<ReaderLink> link,
+                              std::istream& in, bool verbose);
+
+    /** Read a response.
+        @return false if the connection is broken or the response is
+        invalid. */
+    static bool ReadResponse(std::istream& in, bool verbose, bool& hasId,
+                             unsigned int& id, bool& success,
+                             std::string& response);
+
+    /** Remove the pending command for a response and complete it. */
+    void Answer(bool hasId, unsigned int id, bool success,
+                const std::string& response);
+
+    /** Fail all pending commands after the connection broke. */
+    void FailAll(const std::string& message);
+
+    /** Send quit, if the connection is not broken.
+        A failure is only logged. */
+    void SendQuit();
+
+    /** Time when a wait that starts now times out.
+        Requires a lock on m_mutex. Only used if m_timeout is positive. */
+    boost::system_time Deadline() const;
+
+    /** Not implemented */
+    SgGtpPipelinedClient(const SgGtpPipelinedClient&);
+
+    /** Not implemented */
+    SgGtpPipelinedClient& operator=(const SgGtpPipelinedClient&);
+};
+
+//----------------------------------------------------------------------------
+
+#endif // SG_GTPPIPELINEDCLIENT_H
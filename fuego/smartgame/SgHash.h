@@ -15,6 +15,7 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdint.h>
 #include "SgArray.h"
 #include "SgException.h"
 #include "SgRandom.h"
@@ -65,6 +66,11 @@ public:
         details. */
     unsigned int Code2() const;
 
+    /** The lowest 64 bits of the hash code.
+        Used by hash tables that store the code in a single word (see
+        SgHashEntry). */
+    uint64_t Word64() const;
+
     /** Return a random hash code.
         @return A random hash code, which is not zero. */
     static SgHash Random();
@@ -257,6 +263,17 @@ std::string SgHash<N>::ToString() const
     return buffer.str();
 }
 
+template<int N>
+uint64_t SgHash<N>::Word64() const
+{
+    static const std::bitset<N> mask(0xffffffffUL);
+    uint64_t word = (m_code & mask).to_ulong();
+    if (N > 32)
+        word |= static_cast<uint64_t>(((m_code >> 32) & mask).to_ulong())
+            << 32;
+    return word;
+}
+
 template<int N>
 void SgHash<N>::Xor(const SgHash& code)
 {
@@ -6,45 +6,119 @@
 #ifndef SG_HASHTABLE_H
 #define SG_HASHTABLE_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <cstring>
+#include <stdint.h>
 #include "SgHash.h"
 #include "SgWrite.h"
 
 //----------------------------------------------------------------------------
 
-/** Entry in a HashTable: code and data */
+/** Entry in a HashTable: key and data.
+    An entry can be read and written by several threads without locking.
+    The data is stored as 64-bit words and the key is stored xor'ed with
+    the data words. If a thread reads an entry while another thread writes
+    it, the key computed by Get() does not match, so that a torn entry
+    looks like an entry for a different position (R. Hyatt, T. Mann: A
+    lock-less transposition table implementation for parallel search chess
+    engines. ICGA Journal 25(1), 2002).
+    DATA must be copyable with memcpy. */
 template <class DATA>
-struct SgHashEntry
+class SgHashEntry
 {
-    SgHashEntry()
-        : m_hash(),
-          m_data()
-    { }
+public:
+    /** Get the data and the key stored in the entry.
+        @param[out] key The key; a random value, if the entry is torn
+        @param[out] data */
+    void Get(uint64_t& key, DATA& data) const;
+
+    void Set(uint64_t key, const DATA& data);
 
-    SgHashEntry(const SgHashCode& code, const DATA& data)
-        : m_hash(code),
-          m_data(data)
-    { }
+private:
+    static const std::size_t NU_WORDS = (sizeof(DATA) + 7) / 8;
 
-    SgHashCode m_hash;
+    /** Key xor'ed with all data words */
+    std::atomic<uint64_t> m_check;
 
-    DATA m_data;
+    std::atomic<uint64_t> m_data[NU_WORDS];
 };
 
+template <class DATA>
+void SgHashEntry<DATA>::Get(uint64_t& key, DATA& data) const
+{
+    uint64_t words[NU_WORDS];
+    uint64_t check = m_check.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < NU_WORDS; ++i)
+    {
+        words[i] = m_data[i].load(std::memory_order_relaxed);
+        check ^= words[i];
+    }
+    std::memcpy(&data, words, sizeof(DATA));
+    key = check;
+}
+
+template <class DATA>
+void SgHashEntry<DATA>::Set(uint64_t key, const DATA& data)
+{
+    uint64_t words[NU_WORDS];
+    words[NU_WORDS - 1] = 0;
+    std::memcpy(words, &data, sizeof(DATA));
+    uint64_t check = key;
+    for (std::size_t i = 0; i < NU_WORDS; ++i)
+    {
+        m_data[i].store(words[i], std::memory_order_relaxed);
+        check ^= words[i];
+    }
+    m_check.store(check, std::memory_order_relaxed);
+}
+
 //----------------------------------------------------------------------------
 
-/** HashTable implements an array of DATA */
+/** Hash table of DATA with buckets of several entries.
+    A hash code selects a bucket of BUCKET_SIZE entries, which fills one
+    cache line for DATA of up to 8 bytes (e.g. SgSearchHashData). Store()
+    replaces the entry of the same position, if the new data is better,
+    otherwise an invalid entry, otherwise the entry that was stored the
+    most searches ago (see Age()) and, among those, the entry with the
+    smallest depth.
+
+    Store() and Lookup() can be called by several threads at the same time
+    without locking (see SgHashEntry), e.g. by the threads of
+    SgParallelSearch. The statistics are atomic counters.
+
+    The entries store the lowest 64 bits of the hash code. The bits that
+    are implied by the bucket are used for the number of the search, in
+    which the entry was stored, modulo 256. To keep entries that were not
+    replaced for 256 searches from looking new again, Age() limits the age
+    of all entries every AGE_SWEEP_INTERVAL calls.
+
+    DATA must be copyable with memcpy and provide IsValid(), Invalidate(),
+    IsBetterThan(), AgeData() and Depth(); the default constructor must
+    create invalid data. */
 template <class DATA>
 class SgHashTable
 {
 public:
-    /** Create a hash table with 'maxHash' entries. */
-    explicit SgHashTable(int maxHash);
+    static const int BUCKET_SIZE = 4;
+
+    /** Create a hash table that uses about the given memory.
+        The number of buckets is the largest power of two that fits into
+        the memory.
+        @param megabytes The memory in MB; must be at least 1 */
+    explicit SgHashTable(std::size_t megabytes);
 
     ~SgHashTable();
 
-    /** Leaves the positions in the hash table, but set all depths to zero, so
-        that only the best move is valid, not the value. The hash entries will
-        easily be replaced by fresh information. */
+    /** Mark the data in the hash table as stored in a previous search.
+        Leaves the positions in the hash table, but Lookup() returns aged
+        data (see SgSearchHashData::AgeData()), so that only the best move
+        is valid, not the value. The hash entries will easily be replaced by
+        fresh information. Takes constant time, except every
+        AGE_SWEEP_INTERVAL calls, which visit all entries to limit their
+        age. Must not be called during a search. */
     void Age();
 
     /** Clear the hash table by marking all entries as invalid. */
@@ -54,142 +128,301 @@ public:
         none stored. */
     bool Lookup(const SgHashCode& code, DATA* data) const;
 
-    /** Size of hash table. */
-    int MaxHash() const;
+    /** Number of entries of the hash table. */
+    std::size_t MaxHash() const;
+
+    /** Memory used by the entries in bytes. */
+    std::size_t MemoryUsed() const;
 
     /** Try to store 'data' under the hash code 'code'.
         Return whether the data was stored. The only reason for not storing
-        it would be some 'better' data already hashing to the same hash code. */
+        it would be some 'better' data already stored for the same hash
+        code. */
     bool Store(const SgHashCode& code, const DATA& data);
 
-    /** number of collisions on store */
-    int NuCollisions() const
-    {
-        return m_nuCollisions;
-    }
+    /** Fraction of the entries that were stored in the current search.
+        Estimated from the first 1000 buckets. */
+    double Usage() const;
+
+    /** Number of stores that replaced the valid entry of another position.
+        Includes entries of previous searches. */
+    std::size_t NuCollisions() const;
 
     /** total number of stores attempted */
-    int NuStores() const
-    {
-        return m_nuStores;
-    }
+    std::size_t NuStores() const;
 
     /** total number of lookups attempted */
-    int NuLookups() const
-    {
-        return m_nuLookups;
-    }
+    std::size_t NuLookups() const;
 
     /** number of successful lookups */
-    int NuFound() const
-    {
-        return m_nuFound;
-    }
+    std::size_t NuFound() const;
+
+    /** NuFound() / NuLookups() */
+    double HitRate() const;
+
+    void ClearStatistics();
 
 private:
-    /** complete hash code for each entry */
-    SgHashEntry<DATA>* m_entry;
+    static const uint64_t GENERATION_MASK = 0xff;
 
-    /** size of hash table */
-    int m_maxHash;
+    /** Number of calls of Age() between two limitations of the age of the
+        entries.
+        After a limitation, the age of an entry is at most
+        GENERATION_MASK - AGE_SWEEP_INTERVAL, so it cannot wrap around to
+        zero before the next limitation. */
+    static const uint64_t AGE_SWEEP_INTERVAL = 128;
 
-    // AR: the following statistics can be made debug only
-    // AR: pass a HashStatistics class to the HashTable when constructed
+    struct Bucket
+    {
+        SgHashEntry<DATA> m_entry[BUCKET_SIZE];
+    };
 
-    /** number of collisions on store */
-    mutable int m_nuCollisions;
+    /** Memory block of the buckets. */
+    char* m_memory;
 
-    /** total number of stores attempted */
-    mutable int m_nuStores;
+    /** Buckets aligned to the cache line size. */
+    Bucket* m_bucket;
 
-    /** total number of lookups attempted */
-    mutable int m_nuLookups;
+    /** Number of buckets minus one. */
+    uint64_t m_mask;
 
-    /** number of successful lookups */
-    mutable int m_nuFound;
+    /** Number of calls of Age() modulo 256. */
+    uint64_t m_generation;
+
+    mutable std::atomic<std::size_t> m_nuCollisions;
+
+    mutable std::atomic<std::size_t> m_nuStores;
+
+    mutable std::atomic<std::size_t> m_nuLookups;
+
+    mutable std::atomic<std::size_t> m_nuFound;
 
     /** not implemented */
     SgHashTable(const SgHashTable&);
 
     /** not implemented */
     SgHashTable& operator=(const SgHashTable&);
+
+    Bucket& GetBucket(uint64_t key) const;
 };
 
 template <class DATA>
-SgHashTable<DATA>::SgHashTable(int maxHash)
- : m_entry(0),
-   m_maxHash(maxHash),
+SgHashTable<DATA>::SgHashTable(std::size_t megabytes)
+ : m_memory(0),
+   m_bucket(0),
+   m_mask(0),
+   m_generation(0),
    m_nuCollisions(0),
    m_nuStores(0),
    m_nuLookups(0),
    m_nuFound(0)
 {
-    m_entry = new SgHashEntry<DATA>[m_maxHash];
+    SG_ASSERT(megabytes >= 1);
+    // At least 256 buckets, so that the lowest 8 bits of the keys are
+    // implied by the bucket (see GENERATION_MASK)
+    std::size_t nuBuckets = 256;
+    while (2 * nuBuckets * sizeof(Bucket) <= megabytes * 1024 * 1024)
+        nuBuckets *= 2;
+    m_mask = nuBuckets - 1;
+    const std::size_t lineSize = 64;
+    m_memory = new char[nuBuckets * sizeof(Bucket) + lineSize - 1];
+    std::size_t offset = reinterpret_cast<std::size_t>(m_memory) % lineSize;
+    m_bucket = reinterpret_cast<Bucket*>(m_memory + (offset == 0 ? 0 :
+                                                     lineSize - offset));
+    for (std::size_t i = 0; i < nuBuckets; ++i)
+        new (m_bucket + i) Bucket;
     Clear();
 }
 
 template <class DATA>
 SgHashTable<DATA>::~SgHashTable()
 {
-    delete[] m_entry;
+    delete[] m_memory;
 }
 
 template <class DATA>
 void SgHashTable<DATA>::Age()
 {
-    for (int i = m_maxHash-1; i >= 0; --i)
-    {
-        m_entry[i].m_data.AgeData();
-    }
+    m_generation = (m_generation + 1) & GENERATION_MASK;
+    if (m_generation % AGE_SWEEP_INTERVAL != 0)
+        return;
+    const uint64_t maxAge = GENERATION_MASK - AGE_SWEEP_INTERVAL;
+    const uint64_t oldest = (m_generation - maxAge) & GENERATION_MASK;
+    for (uint64_t i = 0; i <= m_mask; ++i)
+        for (int j = 0; j < BUCKET_SIZE; ++j)
+        {
+            SgHashEntry<DATA>& entry = m_bucket[i].m_entry[j];
+            uint64_t entryKey;
+            DATA entryData;
+            entry.Get(entryKey, entryData);
+            if (  entryData.IsValid()
+               && ((m_generation - entryKey) & GENERATION_MASK) > maxAge
+               )
+                entry.Set((entryKey & ~GENERATION_MASK) | oldest, entryData);
+        }
 }
 
 template <class DATA>
 void SgHashTable<DATA>::Clear()
 {
-    for (int i = m_maxHash-1; i >= 0; --i)
-    {
-        m_entry[i].m_data.Invalidate();
-    }
+    DATA data;
+    data.Invalidate();
+    for (uint64_t i = 0; i <= m_mask; ++i)
+        for (int j = 0; j < BUCKET_SIZE; ++j)
+            m_bucket[i].m_entry[j].Set(0, data);
+}
+
+template <class DATA>
+void SgHashTable<DATA>::ClearStatistics()
+{
+    m_nuCollisions = 0;
+    m_nuStores = 0;
+    m_nuLookups = 0;
+    m_nuFound = 0;
+}
+
+template <class DATA>
+inline typename SgHashTable<DATA>::Bucket&
+SgHashTable<DATA>::GetBucket(uint64_t key) const
+{
+    return m_bucket[key & m_mask];
 }
 
 template <class DATA>
-int SgHashTable<DATA>::MaxHash() const
+double SgHashTable<DATA>::HitRate() const
 {
-    return m_maxHash;
+    std::size_t nuLookups = NuLookups();
+    return nuLookups == 0 ? 0 : double(NuFound()) / double(nuLookups);
+}
+
+template <class DATA>
+std::size_t SgHashTable<DATA>::MaxHash() const
+{
+    return (m_mask + 1) * BUCKET_SIZE;
+}
+
+template <class DATA>
+std::size_t SgHashTable<DATA>::MemoryUsed() const
+{
+    return (m_mask + 1) * sizeof(Bucket);
+}
+
+template <class DATA>
+inline std::size_t SgHashTable<DATA>::NuCollisions() const
+{
+    return m_nuCollisions.load(std::memory_order_relaxed);
+}
+
+template <class DATA>
+inline std::size_t SgHashTable<DATA>::NuFound() const
+{
+    return m_nuFound.load(std::memory_order_relaxed);
+}
+
+template <class DATA>
+inline std::size_t SgHashTable<DATA>::NuLookups() const
+{
+    return m_nuLookups.load(std::memory_order_relaxed);
+}
+
+template <class DATA>
+inline std::size_t SgHashTable<DATA>::NuStores() const
+{
+    return m_nuStores.load(std::memory_order_relaxed);
 }
 
 template <class DATA>
 bool SgHashTable<DATA>::Store(const SgHashCode& code, const DATA& data)
 {
-    ++m_nuStores;
-    int h = code.Hash(m_maxHash);
-    SgHashEntry<DATA>& entry = m_entry[h];
-    if (entry.m_data.IsValid() && code != entry.m_hash)
-        ++m_nuCollisions;
-    if (! entry.m_data.IsValid() || data.IsBetterThan(entry.m_data))
+    m_nuStores.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t key = code.Word64() & ~GENERATION_MASK;
+    Bucket& bucket = GetBucket(code.Word64());
+    int replace = -1;
+    uint64_t replaceAge = 0;
+    int replaceDepth = 0;
+    for (int i = 0; i < BUCKET_SIZE; ++i)
     {
-        entry.m_hash = code;
-        entry.m_data = data;
-        return true;
+        uint64_t entryKey;
+        DATA entryData;
+        bucket.m_entry[i].Get(entryKey, entryData);
+        if (! entryData.IsValid())
+        {
+            if (replaceAge <= GENERATION_MASK)
+            {
+                replace = i;
+                // Invalid entries are replaced before all valid entries
+                replaceAge = GENERATION_MASK + 1;
+            }
+            continue;
+        }
+        uint64_t age = (m_generation - entryKey) & GENERATION_MASK;
+        if ((entryKey & ~GENERATION_MASK) == key)
+        {
+            if (age != 0)
+                entryData.AgeData();
+            if (! data.IsBetterThan(entryData))
+                return false;
+            bucket.m_entry[i].Set(key | m_generation, data);
+            return true;
+        }
+        if (  replace < 0
+           || age > replaceAge
+           || (age == replaceAge && entryData.Depth() < replaceDepth)
+           )
+        {
+            replace = i;
+            replaceAge = age;
+            replaceDepth = entryData.Depth();
+        }
     }
-    return false;
+    if (replaceAge <= GENERATION_MASK)
+        m_nuCollisions.fetch_add(1, std::memory_order_relaxed);
+    bucket.m_entry[replace].Set(key | m_generation, data);
+    return true;
 }
 
 template <class DATA>
 bool SgHashTable<DATA>::Lookup(const SgHashCode& code, DATA* data) const
 {
-    ++m_nuLookups;
-    int h = code.Hash(m_maxHash);
-    const SgHashEntry<DATA>& entry = m_entry[h];
-    if (entry.m_data.IsValid() && entry.m_hash == code)
+    m_nuLookups.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t key = code.Word64() & ~GENERATION_MASK;
+    const Bucket& bucket = GetBucket(code.Word64());
+    for (int i = 0; i < BUCKET_SIZE; ++i)
     {
-        *data = entry.m_data;
-        ++m_nuFound;
-        return true;
+        uint64_t entryKey;
+        DATA entryData;
+        bucket.m_entry[i].Get(entryKey, entryData);
+        if (entryData.IsValid() && (entryKey & ~GENERATION_MASK) == key)
+        {
+            if ((entryKey & GENERATION_MASK) != m_generation)
+                entryData.AgeData();
+            *data = entryData;
+            m_nuFound.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
     }
     return false;
 }
 
+template <class DATA>
+double SgHashTable<DATA>::Usage() const
+{
+    const uint64_t nuBuckets = std::min(m_mask + 1, uint64_t(1000));
+    std::size_t nuUsed = 0;
+    for (uint64_t i = 0; i < nuBuckets; ++i)
+        for (int j = 0; j < BUCKET_SIZE; ++j)
+        {
+            uint64_t entryKey;
+            DATA entryData;
+            m_bucket[i].m_entry[j].Get(entryKey, entryData);
+            if (  entryData.IsValid()
+               && (entryKey & GENERATION_MASK) == m_generation
+               )
+                ++nuUsed;
+        }
+    return double(nuUsed) / double(nuBuckets * BUCKET_SIZE);
+}
+
 //----------------------------------------------------------------------------
 
 /** Writes statistics on hash table use (not the content) */
@@ -197,9 +430,12 @@ template <class DATA>
 std::ostream& operator<<(std::ostream& out, const SgHashTable<DATA>& hash)
 {    
     out << "HashTableStatistics:\n"
+        << SgWriteLabel("Entries") << hash.MaxHash() << '\n'
+        << SgWriteLabel("Usage") << hash.Usage() << '\n'
         << SgWriteLabel("Stores") << hash.NuStores() << '\n'
         << SgWriteLabel("LookupAttempt") << hash.NuLookups() << '\n'
         << SgWriteLabel("LookupSuccess") << hash.NuFound() << '\n'
+        << SgWriteLabel("HitRate") << hash.HitRate() << '\n'
         << SgWriteLabel("Collisions") << hash.NuCollisions() << '\n';
     return out;
 }
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include "SgException.h"
+#include "SgLog.h"
 #include "SgMemCheck.h"
 #include "SgProp.h"
 
@@ -27,6 +28,7 @@ void SgFini()
 {
     SgProp::Fini();
     SgMemCheck();
+    SgLogFlush();
     s_isSgInitialized = false;
 }
 
@@ -0,0 +1,547 @@
+//----------------------------------------------------------------------------
+/** @file SgLog.cpp
+    See SgLog.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <vector>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/** Maximum number of messages of a thread that are not written yet. */
+const unsigned long long QUEUE_SIZE = 1024;
+
+/** Number of counters for the rate limit; call sites with the same hash
+    share a counter. */
+const size_t NU_RATE_LIMIT_SLOTS = 256;
+
+/** Time between two rounds of the background thread. */
+const long FLUSH_INTERVAL_MS = 10;
+
+struct Entry
+{
+    SgLogLevel m_level;
+
+    /** Text of SgLogStream(), written without prefix. */
+    bool m_isRaw;
+
+    const char* m_file;
+
+    int m_line;
+
+    /** Global number of the message, used to restore the order of the
+        messages of different threads. */
+    unsigned long long m_sequence;
+
+    chrono::system_clock::time_point m_time;
+
+    string m_text;
+};
+
+/** Messages of a thread that were not written yet.
+    Single producer (the owning thread), single consumer (the background
+    thread). */
+struct ThreadQueue
+{
+    /** False after the owning thread finished; the queue is then reused by
+        the next new thread. Protected by g_mutex. */
+    bool m_isUsed;
+
+    /** Incomplete line written to SgLogStream() by the owning thread. */
+    string m_line;
+
+    /** Number of messages read by the background thread. */
+    atomic<unsigned long long> m_head;
+
+    /** Number of messages written by the owning thread. */
+    atomic<unsigned long long> m_tail;
+
+    atomic<unsigned int> m_nuDropped;
+
+    Entry m_entries[QUEUE_SIZE];
+
+    ThreadQueue();
+
+    /** Called by the owning thread. Takes the text of the entry.
+        @return false if the queue is full. */
+    bool Push(Entry& entry);
+
+    /** Number of messages not read yet. Called by the owning thread. */
+    unsigned long long NuPending() const;
+
+    /** Called by the background thread. */
+    void PopAll(vector<Entry>& entries);
+};
+
+ThreadQueue::ThreadQueue()
+    : m_isUsed(false),
+      m_head(0),
+      m_tail(0),
+      m_nuDropped(0)
+{ }
+
+unsigned long long ThreadQueue::NuPending() const
+{
+    return m_tail.load(memory_order_relaxed)
+        - m_head.load(memory_order_acquire);
+}
+
+void ThreadQueue::PopAll(vector<Entry>& entries)
+{
+    unsigned long long head = m_head.load(memory_order_relaxed);
+    unsigned long long tail = m_tail.load(memory_order_acquire);
+    for ( ; head != tail; ++head)
+    {
+        // Swapped, not copied, so that the text is not copied; Push()
+        // overwrites all members of the slot
+        entries.push_back(Entry());
+        swap(entries.back(), m_entries[head % QUEUE_SIZE]);
+    }
+    m_head.store(head, memory_order_release);
+}
+
+bool ThreadQueue::Push(Entry& entry)
+{
+    unsigned long long tail = m_tail.load(memory_order_relaxed);
+    if (tail - m_head.load(memory_order_acquire) >= QUEUE_SIZE)
+    {
+        m_nuDropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    Entry& slot = m_entries[tail % QUEUE_SIZE];
+    slot.m_level = entry.m_level;
+    slot.m_isRaw = entry.m_isRaw;
+    slot.m_file = entry.m_file;
+    slot.m_line = entry.m_line;
+    slot.m_sequence = entry.m_sequence;
+    slot.m_time = entry.m_time;
+    slot.m_text.swap(entry.m_text);
+    m_tail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+struct RateLimitSlot
+{
+    /** Second of the counts. */
+    atomic<long long> m_second;
+
+    atomic<int> m_count;
+
+    atomic<int> m_nuSuppressed;
+};
+
+class LogStreamBuf
+    : public streambuf
+{
+protected:
+    int overflow(int c);
+
+    streamsize xsputn(const char* s, streamsize n);
+
+    int sync();
+};
+
+atomic<int> g_minLevel(SG_LOG_INFO);
+
+atomic<int> g_rateLimit(20);
+
+atomic<unsigned long long> g_nuMessages(0);
+
+RateLimitSlot g_rateLimitSlots[NU_RATE_LIMIT_SLOTS];
+
+/** Protects g_queues, the state of the background thread and the members
+    of the queues that are marked as protected. */
+boost::mutex g_mutex;
+
+/** Wakes up the background thread before the end of its interval. */
+boost::condition g_wakeUp;
+
+/** Notified by the background thread after each round. */
+boost::condition g_roundFinished;
+
+/** All queues ever created. They are never deleted, so that the background
+    thread can read the queues without a lock. */
+vector<ThreadQueue*> g_queues;
+
+bool g_isRunning = false;
+
+bool g_stop = false;
+
+unsigned long long g_nuFlushRequests = 0;
+
+/** Number of flush requests handled by the background thread. */
+unsigned long long g_nuFlushed = 0;
+
+boost::thread g_flusher;
+
+/** Protects the output. */
+boost::mutex g_outputMutex;
+
+ostream* g_output = &cerr;
+
+auto_ptr<ofstream> g_fileStream;
+
+LogStreamBuf g_streamBuf;
+
+ostream g_stream(&g_streamBuf);
+
+const char* BaseName(const char* file)
+{
+    const char* name = file;
+    for (const char* p = file; *p != 0; ++p)
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    return name;
+}
+
+const char* LevelName(SgLogLevel level)
+{
+    switch (level)
+    {
+    case SG_LOG_DEBUG:
+        return "DEBUG";
+    case SG_LOG_INFO:
+        return "INFO";
+    case SG_LOG_WARNING:
+        return "WARNING";
+    default:
+        return "ERROR";
+    }
+}
+
+void Write(ostream& out, const Entry& entry)
+{
+    if (entry.m_isRaw)
+    {
+        out << entry.m_text;
+        return;
+    }
+    time_t time = chrono::system_clock::to_time_t(entry.m_time);
+    tm local;
+#if WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    long long milliseconds = chrono::duration_cast<chrono::milliseconds>(
+                                 entry.m_time.time_since_epoch()).count();
+    out << setfill('0') << setw(2) << local.tm_hour << ':'
+        << setw(2) << local.tm_min << ':' << setw(2) << local.tm_sec << '.'
+        << setw(3) << milliseconds % 1000 << setfill(' ') << ' '
+        << LevelName(entry.m_level) << ' ' << BaseName(entry.m_file) << ':'
+        << entry.m_line << ": " << entry.m_text << '\n';
+}
+
+bool CompareSequence(const Entry& entry1, const Entry& entry2)
+{
+    return entry1.m_sequence < entry2.m_sequence;
+}
+
+/** Main function of the background thread. */
+void WriteMessages()
+{
+    vector<ThreadQueue*> queues;
+    vector<Entry> entries;
+    while (true)
+    {
+        bool stop;
+        unsigned long long nuFlushRequests;
+        {
+            boost::mutex::scoped_lock lock(g_mutex);
+            if (! g_stop && g_nuFlushRequests == g_nuFlushed)
+                g_wakeUp.timed_wait(lock, boost::get_system_time()
+                        + boost::posix_time::milliseconds(FLUSH_INTERVAL_MS));
+            stop = g_stop;
+            nuFlushRequests = g_nuFlushRequests;
+            queues = g_queues;
+        }
+        unsigned int nuDropped = 0;
+        for (vector<ThreadQueue*>::const_iterator it = queues.begin();
+             it != queues.end(); ++it)
+        {
+            (*it)->PopAll(entries);
+            nuDropped += (*it)->m_nuDropped.exchange(0, memory_order_relaxed);
+        }
+        if (! entries.empty() || nuDropped > 0)
+        {
+            sort(entries.begin(), entries.end(), CompareSequence);
+            boost::mutex::scoped_lock lock(g_outputMutex);
+            for (vector<Entry>::const_iterator it = entries.begin();
+                 it != entries.end(); ++it)
+                Write(*g_output, *it);
+            if (nuDropped > 0)
+                *g_output << "SgLog: " << nuDropped
+                          << " messages dropped, output too slow\n";
+            g_output->flush();
+            entries.clear();
+        }
+        {
+            boost::mutex::scoped_lock lock(g_mutex);
+            g_nuFlushed = nuFlushRequests;
+        }
+        g_roundFinished.notify_all();
+        if (stop)
+            break;
+    }
+}
+
+/** Stops the background thread at the end of the program, after writing
+    the remaining messages. */
+class Shutdown
+{
+public:
+    ~Shutdown();
+};
+
+Shutdown::~Shutdown()
+{
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+        if (! g_isRunning)
+            return;
+        g_stop = true;
+    }
+    g_wakeUp.notify_all();
+    g_flusher.join();
+}
+
+/** Defined after the state of the background thread, so that it is
+    destroyed before. */
+Shutdown g_shutdown;
+
+void Log(ThreadQueue& queue, SgLogLevel level, bool isRaw, const char* file,
+         int line, string& text)
+{
+    Entry entry;
+    entry.m_level = level;
+    entry.m_isRaw = isRaw;
+    entry.m_file = file;
+    entry.m_line = line;
+    entry.m_sequence = g_nuMessages.fetch_add(1, memory_order_relaxed);
+    entry.m_time = chrono::system_clock::now();
+    entry.m_text.swap(text);
+    // Wake up the background thread early if a burst of messages fills the
+    // queue faster than the flush interval
+    if (queue.Push(entry) && queue.NuPending() == QUEUE_SIZE / 2)
+        g_wakeUp.notify_all();
+}
+
+void ReleaseQueue(ThreadQueue* queue)
+{
+    if (! queue->m_line.empty())
+        Log(*queue, SG_LOG_INFO, true, "", 0, queue->m_line);
+    boost::mutex::scoped_lock lock(g_mutex);
+    queue->m_isUsed = false;
+}
+
+/** Queue of the current thread.
+    The cleanup function only marks the queue as unused, it is not
+    deleted. */
+boost::thread_specific_ptr<ThreadQueue> g_threadQueue(ReleaseQueue);
+
+ThreadQueue* AcquireQueue()
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+    ThreadQueue* queue = 0;
+    for (vector<ThreadQueue*>::const_iterator it = g_queues.begin();
+         it != g_queues.end(); ++it)
+        if (! (*it)->m_isUsed)
+        {
+            queue = *it;
+            break;
+        }
+    if (queue == 0)
+    {
+        queue = new ThreadQueue();
+        g_queues.push_back(queue);
+    }
+    queue->m_isUsed = true;
+    queue->m_line.clear();
+    if (! g_isRunning && ! g_stop)
+    {
+        g_flusher = boost::thread(WriteMessages);
+        g_isRunning = true;
+    }
+    return queue;
+}
+
+ThreadQueue& GetQueue()
+{
+    ThreadQueue* queue = g_threadQueue.get();
+    if (queue == 0)
+    {
+        queue = AcquireQueue();
+        g_threadQueue.reset(queue);
+    }
+    return *queue;
+}
+
+/** Count a message of a call site.
+    @param[out] nuSuppressed Number of messages of the call site that were
+    suppressed since the last message that passed.
+    @return false if the message exceeds the rate limit. */
+bool PassRateLimit(const char* file, int line, int& nuSuppressed)
+{
+    nuSuppressed = 0;
+    int maxPerSecond = g_rateLimit.load(memory_order_relaxed);
+    if (maxPerSecond <= 0)
+        return true;
+    size_t hash = (reinterpret_cast<size_t>(file) >> 3)
+        ^ (static_cast<size_t>(line) * 2654435761u);
+    RateLimitSlot& slot = g_rateLimitSlots[hash % NU_RATE_LIMIT_SLOTS];
+    long long second = chrono::duration_cast<chrono::seconds>(
+                     chrono::steady_clock::now().time_since_epoch()).count();
+    long long oldSecond = slot.m_second.load(memory_order_relaxed);
+    if (oldSecond != second
+        && slot.m_second.compare_exchange_strong(oldSecond, second))
+        slot.m_count.store(0, memory_order_relaxed);
+    if (slot.m_count.fetch_add(1, memory_order_relaxed) >= maxPerSecond)
+    {
+        slot.m_nuSuppressed.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    nuSuppressed = slot.m_nuSuppressed.exchange(0, memory_order_relaxed);
+    return true;
+}
+
+int LogStreamBuf::overflow(int c)
+{
+    if (c != traits_type::eof())
+    {
+        char ch = traits_type::to_char_type(c);
+        xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int LogStreamBuf::sync()
+{
+    ThreadQueue& queue = GetQueue();
+    if (! queue.m_line.empty())
+        Log(queue, SG_LOG_INFO, true, "", 0, queue.m_line);
+    return 0;
+}
+
+streamsize LogStreamBuf::xsputn(const char* s, streamsize n)
+{
+    ThreadQueue& queue = GetQueue();
+    const char* end = s + n;
+    while (s != end)
+    {
+        const char* newLine = find(s, end, '\n');
+        if (newLine == end)
+        {
+            queue.m_line.append(s, end);
+            break;
+        }
+        queue.m_line.append(s, newLine + 1);
+        Log(queue, SG_LOG_INFO, true, "", 0, queue.m_line);
+        queue.m_line.clear();
+        s = newLine + 1;
+    }
+    return n;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+SgLogMessage::SgLogMessage(SgLogLevel level, const char* file, int line)
+    : m_level(level),
+      m_file(file),
+      m_line(line)
+{ }
+
+SgLogMessage::~SgLogMessage()
+{
+    int nuSuppressed;
+    if (! PassRateLimit(m_file, m_line, nuSuppressed))
+        return;
+    if (nuSuppressed > 0)
+        m_stream << " (" << nuSuppressed << " similar messages suppressed)";
+    string text = m_stream.str();
+    Log(GetQueue(), m_level, false, m_file, m_line, text);
+}
+
+//----------------------------------------------------------------------------
+
+void SgLogFlush()
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+    if (! g_isRunning || g_stop)
+        return;
+    unsigned long long request = ++g_nuFlushRequests;
+    g_wakeUp.notify_all();
+    while (g_nuFlushed < request)
+        g_roundFinished.wait(lock);
+}
+
+bool SgLogIsEnabled(SgLogLevel level)
+{
+    return level >= g_minLevel.load(memory_order_relaxed);
+}
+
+SgLogLevel SgLogMinLevel()
+{
+    return static_cast<SgLogLevel>(g_minLevel.load(memory_order_relaxed));
+}
+
+int SgLogRateLimit()
+{
+    return g_rateLimit.load(memory_order_relaxed);
+}
+
+void SgLogSetMinLevel(SgLogLevel level)
+{
+    g_minLevel.store(level, memory_order_relaxed);
+}
+
+void SgLogSetOutput(ostream& out)
+{
+    boost::mutex::scoped_lock lock(g_outputMutex);
+    g_output = &out;
+    g_fileStream.reset(0);
+}
+
+void SgLogSetRateLimit(int maxPerSecond)
+{
+    g_rateLimit.store(maxPerSecond, memory_order_relaxed);
+}
+
+ostream& SgLogStream()
+{
+    return g_stream;
+}
+
+bool SgLogToFile(const string& fileName)
+{
+    auto_ptr<ofstream> file(new ofstream(fileName.c_str(), ios::app));
+    if (! *file)
+        return false;
+    boost::mutex::scoped_lock lock(g_outputMutex);
+    g_output = file.get();
+    g_fileStream = file;
+    return true;
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+//----------------------------------------------------------------------------
+/** @file SgLog.h
+    Asynchronous logging with levels and rate limiting.
+
+    Messages are written with the macro SG_LOG:
+@code
+    SG_LOG(SG_LOG_WARNING) << "GoSetup contains invalid stones";
+@endcode
+    The message is formatted in the calling thread and put into a queue of
+    the thread. A background thread collects the messages of all threads
+    every few milliseconds and writes them to the output (std::cerr by
+    default). The messages of a thread are written in the order in which
+    they were logged, the messages of different threads only within one
+    round of the background thread: a message that was put into its queue
+    just after a round can be written after later messages of other
+    threads. Logging never waits
+    for the output or for other threads: if the queue of a thread is full
+    because the output cannot keep up, the message is dropped and the number
+    of dropped messages is reported later.
+
+    Each call site of SG_LOG writes at most SgLogRateLimit() messages per
+    second, further messages of the same second are counted and reported
+    with the next message of the call site.
+
+    SgDebugToLog() (see SgDebug.h) sends the text written to SgDebug() through
+    the logger as well; such text is written without a prefix and is not
+    rate limited. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_LOG_H
+#define SG_LOG_H
+
+#include <iosfwd>
+#include <sstream>
+#include <string>
+
+//----------------------------------------------------------------------------
+
+enum SgLogLevel
+{
+    /** Diagnostic output of per-frame code paths. */
+    SG_LOG_DEBUG,
+
+    SG_LOG_INFO,
+
+    SG_LOG_WARNING,
+
+    SG_LOG_ERROR
+};
+
+/** Collects one message and passes it to the logger in the destructor.
+    Use the macro SG_LOG instead of creating objects of this class. */
+class SgLogMessage
+{
+public:
+    SgLogMessage(SgLogLevel level, const char* file, int line);
+
+    ~SgLogMessage();
+
+    std::ostream& Stream();
+
+private:
+    SgLogLevel m_level;
+
+    const char* m_file;
+
+    int m_line;
+
+    std::ostringstream m_stream;
+
+    /** Not implemented */
+    SgLogMessage(const SgLogMessage&);
+
+    /** Not implemented */
+    SgLogMessage& operator=(const SgLogMessage&);
+};
+
+inline std::ostream& SgLogMessage::Stream()
+{
+    return m_stream;
+}
+
+/** Turns the stream expression of SG_LOG into void, so that it can be used
+    in a conditional expression. */
+struct SgLogVoidify
+{
+    void operator&(std::ostream&) { }
+};
+
+/** Write a message with the given level.
+    The arguments of operator<< are not evaluated if the level is below
+    SgLogMinLevel(). The macro is an expression, so it can be used in an if
+    statement without braces. */
+#define SG_LOG(level) \
+    ! SgLogIsEnabled(level) ? static_cast<void>(0) \
+    : SgLogVoidify() & SgLogMessage(level, __FILE__, __LINE__).Stream()
+
+//----------------------------------------------------------------------------
+
+/** Check if messages of a level are written. */
+bool SgLogIsEnabled(SgLogLevel level);
+
+/** Minimum level of the messages that are written.
+    Default is SG_LOG_INFO. */
+SgLogLevel SgLogMinLevel();
+
+/** See SgLogMinLevel() */
+void SgLogSetMinLevel(SgLogLevel level);
+
+/** Maximum number of messages per second and call site.
+    Default is 20, 0 means no limit. */
+int SgLogRateLimit();
+
+/** See SgLogRateLimit() */
+void SgLogSetRateLimit(int maxPerSecond);
+
+/** Set the output of the logger.
+    The stream is only used by the background thread and must exist until
+    another output is set. Must not be SgDebug() if SgDebug() is sent to the
+    logger. */
+void SgLogSetOutput(std::ostream& out);
+
+/** Append the output of the logger to a file.
+    @return false if the file could not be opened, the output is not changed
+    in this case. */
+bool SgLogToFile(const std::string& fileName);
+
+/** Wait until all messages logged before the call were written. */
+void SgLogFlush();
+
+/** Stream whose text is written by the logger.
+    Each line is passed to the logger when it is complete or when the
+    stream is flushed, the lines of different threads are not mixed. */
+std::ostream& SgLogStream();
+
+//----------------------------------------------------------------------------
+
+#endif // SG_LOG_H
@@ -0,0 +1,81 @@
+//----------------------------------------------------------------------------
+/** @file SgMappedFile.cpp
+    See SgMappedFile.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgMappedFile.h"
+
+#include <fstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "SgException.h"
+
+using namespace std;
+using boost::interprocess::file_mapping;
+using boost::interprocess::interprocess_exception;
+using boost::interprocess::mapped_region;
+using boost::interprocess::read_only;
+
+//----------------------------------------------------------------------------
+
+SgMappedFile::SgMappedFile()
+    : m_isOpen(false),
+      m_begin(0),
+      m_size(0)
+{
+}
+
+SgMappedFile::SgMappedFile(const string& fileName)
+    : m_isOpen(false),
+      m_begin(0),
+      m_size(0)
+{
+    if (! Open(fileName))
+        throw SgException("Could not map file " + fileName);
+}
+
+SgMappedFile::~SgMappedFile()
+{
+}
+
+void SgMappedFile::Close()
+{
+    m_region.reset(0);
+    m_mapping.reset(0);
+    m_begin = 0;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+bool SgMappedFile::Open(const string& fileName)
+{
+    Close();
+    // mapped_region cannot map zero bytes, so check the size first
+    ifstream in(fileName.c_str(), ios::in | ios::binary | ios::ate);
+    if (! in)
+        return false;
+    const streamoff size = in.tellg();
+    in.close();
+    if (size < 0)
+        return false;
+    if (size > 0)
+    {
+        try
+        {
+            m_mapping.reset(new file_mapping(fileName.c_str(), read_only));
+            m_region.reset(new mapped_region(*m_mapping, read_only));
+        }
+        catch (const interprocess_exception&)
+        {
+            Close();
+            return false;
+        }
+        m_begin = static_cast<const char*>(m_region->get_address());
+        m_size = m_region->get_size();
+    }
+    m_isOpen = true;
+    return true;
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+//----------------------------------------------------------------------------
+/** @file SgMappedFile.h
+    Read-only memory mapping of files. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_MAPPEDFILE_H
+#define SG_MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace boost {
+namespace interprocess {
+    class file_mapping;
+    class mapped_region;
+}
+}
+
+//----------------------------------------------------------------------------
+
+/** Maps a whole file read-only into memory.
+    Uses boost::interprocess, so it works on POSIX systems and on Windows.
+    An empty file can be opened, but Begin() and End() are both 0 then. */
+class SgMappedFile
+{
+public:
+    /** Construct without a mapped file. */
+    SgMappedFile();
+
+    /** Construct and map a file.
+        @throws SgException if the file cannot be opened or mapped */
+    explicit SgMappedFile(const std::string& fileName);
+
+    ~SgMappedFile();
+
+    /** Map a file. A previously mapped file is unmapped first.
+        @return false, if the file cannot be opened or mapped */
+    bool Open(const std::string& fileName);
+
+    void Close();
+
+    bool IsOpen() const;
+
+    const char* Begin() const;
+
+    const char* End() const;
+
+    std::size_t Size() const;
+
+private:
+    bool m_isOpen;
+
+    const char* m_begin;
+
+    std::size_t m_size;
+
+    std::auto_ptr<boost::interprocess::file_mapping> m_mapping;
+
+    std::auto_ptr<boost::interprocess::mapped_region> m_region;
+
+    /** Not implemented. */
+    SgMappedFile(const SgMappedFile&);
+
+    /** Not implemented. */
+    SgMappedFile& operator=(const SgMappedFile&);
+};
+
+inline const char* SgMappedFile::Begin() const
+{
+    return m_begin;
+}
+
+inline const char* SgMappedFile::End() const
+{
+    return m_begin + m_size;
+}
+
+inline bool SgMappedFile::IsOpen() const
+{
+    return m_isOpen;
+}
+
+inline std::size_t SgMappedFile::Size() const
+{
+    return m_size;
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_MAPPEDFILE_H
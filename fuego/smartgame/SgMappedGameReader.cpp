@@ -0,0 +1,315 @@
+//----------------------------------------------------------------------------
+/** @file SgMappedGameReader.cpp
+    See SgMappedGameReader.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgMappedGameReader.h"
+
+#include <cstring>
+#include "SgMappedFile.h"
+#include "SgNode.h"
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SG_MAPPEDGAMEREADER_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/** Characters that are not ignored by SgMappedGameReader::ReadSubtree. */
+class TokenTable
+{
+public:
+    TokenTable()
+    {
+        memset(m_isToken, 0, sizeof(m_isToken));
+        for (int c = 'A'; c <= 'Z'; ++c)
+            m_isToken[c] = true;
+        m_isToken[static_cast<unsigned char>(';')] = true;
+        m_isToken[static_cast<unsigned char>('(')] = true;
+        m_isToken[static_cast<unsigned char>(')')] = true;
+    }
+
+    bool IsToken(char c) const
+    {
+        return m_isToken[static_cast<unsigned char>(c)];
+    }
+
+private:
+    bool m_isToken[256];
+};
+
+const TokenTable g_tokenTable;
+
+inline bool IsLabelChar(char c)
+{
+    return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z')
+        || ('0' <= c && c <= '9');
+}
+
+/** Same characters as std::ws skips in the classic locale. */
+inline bool IsWhiteSpace(char c)
+{
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+#ifdef SG_MAPPEDGAMEREADER_SSE2
+
+inline int FirstSetBit(int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, static_cast<unsigned long>(mask));
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(static_cast<unsigned int>(mask));
+#endif
+}
+
+#endif // SG_MAPPEDGAMEREADER_SSE2
+
+/** Find the first character inside a property value that needs special
+    handling: the closing bracket, an escape character, a newline or a
+    carriage return.
+    Tests 16 characters at a time, if SSE2 is available.
+    @return Pointer to the character or end. */
+inline const char* FindValueSpecial(const char* p, const char* end)
+{
+#ifdef SG_MAPPEDGAMEREADER_SSE2
+    const __m128i close = _mm_set1_epi8(']');
+    const __m128i escape = _mm_set1_epi8('\\');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    while (end - p >= 16)
+    {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i match =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, close),
+                                      _mm_cmpeq_epi8(chunk, escape)),
+                         _mm_or_si128(_mm_cmpeq_epi8(chunk, newline),
+                                      _mm_cmpeq_epi8(chunk,
+                                                     carriageReturn)));
+        const int mask = _mm_movemask_epi8(match);
+        if (mask != 0)
+            return p + FirstSetBit(mask);
+        p += 16;
+    }
+#endif
+    while (p != end && *p != ']' && *p != '\\' && *p != '\n'
+           && *p != '\r')
+        ++p;
+    return p;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+SgMappedGameReader::SgMappedGameReader(const char* begin, const char* end,
+                                       int defaultSize)
+    : m_pos(begin),
+      m_end(end),
+      m_defaultSize(defaultSize),
+      m_mainLineOnly(false)
+{
+}
+
+SgMappedGameReader::SgMappedGameReader(const SgMappedFile& file,
+                                       int defaultSize)
+    : m_pos(file.Begin()),
+      m_end(file.End()),
+      m_defaultSize(defaultSize),
+      m_mainLineOnly(false)
+{
+}
+
+SgNode* SgMappedGameReader::ReadGame(bool resetWarnings, bool mainLineOnly)
+{
+    if (resetWarnings)
+        m_warnings.reset();
+    m_mainLineOnly = mainLineOnly;
+    SgNode* root = 0;
+    while (m_pos != m_end)
+    {
+        const void* start = memchr(m_pos, '(', m_end - m_pos);
+        if (start == 0)
+        {
+            m_pos = m_end;
+            break;
+        }
+        m_pos = static_cast<const char*>(start) + 1;
+        root = ReadSubtree(0, m_defaultSize, SG_PROPPOINTFMT_GO);
+        if (root)
+            root = root->Root();
+        if (root)
+            break;
+    }
+    return root;
+}
+
+void SgMappedGameReader::ReadGames(SgVectorOf<SgNode>* rootList)
+{
+    m_warnings.reset();
+    SG_ASSERT(rootList);
+    rootList->Clear();
+    while (true)
+    {
+        SgNode* root = ReadGame(false, false);
+        if (root)
+            rootList->PushBack(root);
+        else
+            break;
+    }
+}
+
+void SgMappedGameReader::ReadLabel(string& label)
+{
+    // Precondition: m_pos is at the first letter of a property label,
+    // in range 'A'..'Z'. Same as SgGameReader::ReadLabel, lower case letters
+    // and digits are included in the label.
+    const char* start = m_pos;
+    ++m_pos;
+    while (m_pos != m_end && IsLabelChar(*m_pos))
+        ++m_pos;
+    label.assign(start, m_pos);
+}
+
+SgNode* SgMappedGameReader::ReadSubtree(SgNode* node, int boardSize,
+                                        SgPropPointFmt fmt)
+{
+    SgGameReader::RawProperties properties;
+    string label;
+    string value;
+    bool hasVariation = false;
+    while (m_pos != m_end)
+    {
+        const char c = *m_pos;
+        if (! g_tokenTable.IsToken(c))
+        {
+            ++m_pos;
+            continue;
+        }
+        if (c == ')')
+        {
+            ++m_pos;
+            break;
+        }
+        if ('A' <= c && c <= 'Z')
+        {
+            ReadLabel(label);
+            SkipWhiteSpace();
+            while (ReadValue(&value))
+                properties[label].push_back(value);
+            continue;
+        }
+        ++m_pos;
+        if (c == ';')
+        {
+            if (node)
+            {
+                SgGameReader::HandleProperties(node, properties, boardSize,
+                                               fmt, m_warnings);
+                properties.clear();
+                node = node->NewRightMostSon();
+            }
+            else
+                node = new SgNode(); // first node
+        }
+        else // c == '('
+        {
+            SgGameReader::HandleProperties(node, properties, boardSize, fmt,
+                                           m_warnings);
+            properties.clear();
+            if (m_mainLineOnly && hasVariation)
+                SkipSubtree();
+            else
+                ReadSubtree(node, boardSize, fmt);
+            hasVariation = true;
+        }
+    }
+    SgGameReader::HandleProperties(node, properties, boardSize, fmt,
+                                   m_warnings);
+    return node;
+}
+
+bool SgMappedGameReader::ReadValue(string* value)
+{
+    SkipWhiteSpace();
+    if (value)
+        value->clear();
+    if (m_pos == m_end || *m_pos != '[')
+        return false;
+    const char* p = m_pos + 1;
+    while (true)
+    {
+        const char* special = FindValueSpecial(p, m_end);
+        if (value)
+            value->append(p, special);
+        if (special == m_end)
+        {
+            p = m_end;
+            break;
+        }
+        const char c = *special;
+        p = special + 1;
+        if (c == ']')
+            break;
+        if (c == '\\')
+        {
+            // Escape characters are kept in the value, same as in
+            // SgGameReader::ReadValue
+            if (value)
+                *value += c;
+            if (p == m_end)
+                break;
+            if (*p != '\n' && *p != '\r' && value)
+                *value += *p;
+            ++p;
+        }
+        // Newlines and carriage returns are dropped
+    }
+    m_pos = p;
+    return true;
+}
+
+void SgMappedGameReader::SkipSubtree()
+{
+    int depth = 1;
+    while (m_pos != m_end)
+    {
+        const char c = *m_pos;
+        if ('A' <= c && c <= 'Z')
+        {
+            ++m_pos;
+            while (m_pos != m_end && IsLabelChar(*m_pos))
+                ++m_pos;
+            while (ReadValue(0))
+            {
+            }
+            continue;
+        }
+        ++m_pos;
+        if (c == '(')
+            ++depth;
+        else if (c == ')' && --depth == 0)
+            break;
+    }
+}
+
+void SgMappedGameReader::SkipWhiteSpace()
+{
+    while (m_pos != m_end && IsWhiteSpace(*m_pos))
+        ++m_pos;
+}
+
+//----------------------------------------------------------------------------
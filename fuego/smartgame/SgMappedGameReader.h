@@ -0,0 +1,131 @@
+//----------------------------------------------------------------------------
+/** @file SgMappedGameReader.h
+    Fast reader for SGF data in memory or in memory-mapped files. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_MAPPEDGAMEREADER_H
+#define SG_MAPPEDGAMEREADER_H
+
+#include <string>
+#include "SgGameReader.h"
+#include "SgProp.h"
+#include "SgVector.h"
+
+class SgMappedFile;
+class SgNode;
+
+//----------------------------------------------------------------------------
+
+/** Read SGF data from a memory buffer, usually a memory-mapped file.
+    Parses exactly like SgGameReader and creates identical trees, but scans
+    the buffer directly instead of reading characters one by one from a
+    stream, which makes it much faster for large game collections.
+    ReadMainLine() skips all variations without creating nodes or
+    properties for them, if only the main line of a game is needed.
+    Carriage returns in property values are dropped like newlines, so files
+    with CRLF line endings give the same trees as SgGameReader on a stream
+    opened in text mode on Windows.
+    The buffer must stay valid while the reader is used.
+    @see SgMappedFile */
+class SgMappedGameReader
+{
+public:
+    typedef SgGameReader::Warnings Warnings;
+
+    /** Create reader for the buffer [begin, end).
+        @param begin Start of the SGF data
+        @param end End of the SGF data
+        @param defaultSize The (game-dependent) default board size, if the
+        data contains no SZ property. */
+    SgMappedGameReader(const char* begin, const char* end,
+                       int defaultSize = 19);
+
+    /** Create reader for the contents of a mapped file. */
+    SgMappedGameReader(const SgMappedFile& file, int defaultSize = 19);
+
+    /** Get warnings of last ReadGame, ReadMainLine or ReadGames. */
+    Warnings GetWarnings() const;
+
+    /** Print warnings of last ReadGame, ReadMainLine or ReadGames to
+        stream.
+        Prints the warnings as human readable text. */
+    void PrintWarnings(std::ostream& out) const;
+
+    /** Read next game tree.
+        @return Root node or 0 if there is no next game. */
+    SgNode* ReadGame();
+
+    /** Read only the main line of the next game tree.
+        All variations except the first one at each node are skipped.
+        @return Root node or 0 if there is no next game. */
+    SgNode* ReadMainLine();
+
+    /** Read all game trees.
+        Return a list with the root of each game tree. */
+    void ReadGames(SgVectorOf<SgNode>* rootList);
+
+    /** True, if all data has been read. */
+    bool AtEnd() const;
+
+private:
+    const char* m_pos;
+
+    const char* const m_end;
+
+    const int m_defaultSize;
+
+    /** Skip variations other than the first one in ReadSubtree. */
+    bool m_mainLineOnly;
+
+    Warnings m_warnings;
+
+    /** Not implemented. */
+    SgMappedGameReader(const SgMappedGameReader&);
+
+    /** Not implemented. */
+    SgMappedGameReader& operator=(const SgMappedGameReader&);
+
+    SgNode* ReadGame(bool resetWarnings, bool mainLineOnly);
+
+    void ReadLabel(std::string& label);
+
+    SgNode* ReadSubtree(SgNode* node, int boardSize, SgPropPointFmt fmt);
+
+    /** Read a property value.
+        @param value The value or 0, if the value should be skipped. */
+    bool ReadValue(std::string* value);
+
+    /** Skip a subtree after its opening bracket. */
+    void SkipSubtree();
+
+    void SkipWhiteSpace();
+};
+
+inline bool SgMappedGameReader::AtEnd() const
+{
+    return m_pos == m_end;
+}
+
+inline SgMappedGameReader::Warnings SgMappedGameReader::GetWarnings() const
+{
+    return m_warnings;
+}
+
+inline void SgMappedGameReader::PrintWarnings(std::ostream& out) const
+{
+    SgGameReader::PrintWarnings(out, m_warnings);
+}
+
+inline SgNode* SgMappedGameReader::ReadGame()
+{
+    return ReadGame(true, false);
+}
+
+inline SgNode* SgMappedGameReader::ReadMainLine()
+{
+    return ReadGame(true, true);
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_MAPPEDGAMEREADER_H
@@ -0,0 +1,501 @@
+//----------------------------------------------------------------------------
+/** @file SgMetrics.cpp
+    See SgMetrics.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgMetrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "SgException.h"
+#include "SgLog.h"
+
+#if ! WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+void WriteDouble(ostream& out, double value)
+{
+    if (value != value)
+        out << "NaN";
+    else if (value == numeric_limits<double>::infinity())
+        out << "+Inf";
+    else if (value == -numeric_limits<double>::infinity())
+        out << "-Inf";
+    else
+    {
+        streamsize precision = out.precision(12);
+        out << value;
+        out.precision(precision);
+    }
+}
+
+/** Write the name of a sample with the labels of the metric and an
+    optional additional label. */
+void WriteSampleName(ostream& out, const string& name, const string& suffix,
+                     const string& labels, const string& extraLabel = "")
+{
+    out << name << suffix;
+    if (labels.empty() && extraLabel.empty())
+        return;
+    out << '{' << labels;
+    if (! labels.empty() && ! extraLabel.empty())
+        out << ',';
+    out << extraLabel << '}';
+}
+
+void WriteHelp(ostream& out, const string& help)
+{
+    for (string::const_iterator it = help.begin(); it != help.end(); ++it)
+        if (*it == '\\')
+            out << "\\\\";
+        else if (*it == '\n')
+            out << "\\n";
+        else
+            out << *it;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+SgMetricCounter::SgMetricCounter()
+    : m_value(0)
+{ }
+
+//----------------------------------------------------------------------------
+
+SgMetricGauge::SgMetricGauge()
+    : m_value(0)
+{ }
+
+void SgMetricGauge::Add(double value)
+{
+    double oldValue = m_value.load(memory_order_relaxed);
+    while (! m_value.compare_exchange_weak(oldValue, oldValue + value,
+                                           memory_order_relaxed))
+        ;
+}
+
+//----------------------------------------------------------------------------
+
+SgMetricHistogram::SgMetricHistogram(const vector<double>& upperBounds)
+    : m_upperBounds(upperBounds),
+      m_counts(new atomic<unsigned long long>[upperBounds.size() + 1]),
+      m_sum(0)
+{
+    SG_ASSERT(is_sorted(upperBounds.begin(), upperBounds.end()));
+    for (int i = 0; i < Bins(); ++i)
+        m_counts[i].store(0, memory_order_relaxed);
+}
+
+SgMetricHistogram::~SgMetricHistogram()
+{
+    delete[] m_counts;
+}
+
+void SgMetricHistogram::Add(double value)
+{
+    // Bins are upper-inclusive as in Prometheus
+    size_t i = lower_bound(m_upperBounds.begin(), m_upperBounds.end(), value)
+        - m_upperBounds.begin();
+    m_counts[i].fetch_add(1, memory_order_relaxed);
+    double oldSum = m_sum.load(memory_order_relaxed);
+    while (! m_sum.compare_exchange_weak(oldSum, oldSum + value,
+                                         memory_order_relaxed))
+        ;
+}
+
+unsigned long long SgMetricHistogram::Count() const
+{
+    unsigned long long count = 0;
+    for (int i = 0; i < Bins(); ++i)
+        count += Count(i);
+    return count;
+}
+
+const vector<double>& SgMetricHistogram::LatencyBounds()
+{
+    static const double bounds[] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                     0.1, 0.25, 0.5, 1, 2.5 };
+    static const vector<double> s_bounds(bounds,
+                                         bounds + sizeof(bounds)
+                                                  / sizeof(bounds[0]));
+    return s_bounds;
+}
+
+//----------------------------------------------------------------------------
+
+SgMetricTimer::SgMetricTimer(SgMetricHistogram& histogram)
+    : m_histogram(histogram),
+      m_start(chrono::steady_clock::now())
+{ }
+
+SgMetricTimer::~SgMetricTimer()
+{
+    m_histogram.Add(chrono::duration<double>(chrono::steady_clock::now()
+                                             - m_start).count());
+}
+
+//----------------------------------------------------------------------------
+
+SgMetricRate::SgMetricRate(SgMetricGauge& gauge)
+    : m_gauge(gauge),
+      m_hasTicked(false),
+      m_rate(0)
+{ }
+
+void SgMetricRate::Tick()
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (m_hasTicked)
+    {
+        double seconds = chrono::duration<double>(now - m_lastTick).count();
+        if (seconds > 0)
+        {
+            // Weight of the newest interval; about the last 10 events count
+            const double weight = 0.1;
+            double rate = 1 / seconds;
+            m_rate = (m_rate == 0 ? rate
+                                  : (1 - weight) * m_rate + weight * rate);
+            m_gauge.Set(m_rate);
+        }
+    }
+    m_hasTicked = true;
+    m_lastTick = now;
+}
+
+//----------------------------------------------------------------------------
+
+struct SgMetrics::Family
+{
+    string m_help;
+
+    /** Prometheus type name. */
+    const char* m_type;
+
+    /** Metrics by labels, only the map of m_type is used. */
+    map<string, SgMetricCounter*> m_counters;
+
+    map<string, SgMetricGauge*> m_gauges;
+
+    map<string, SgMetricHistogram*> m_histograms;
+
+    ~Family();
+};
+
+SgMetrics::Family::~Family()
+{
+    for (map<string, SgMetricCounter*>::iterator it = m_counters.begin();
+         it != m_counters.end(); ++it)
+        delete it->second;
+    for (map<string, SgMetricGauge*>::iterator it = m_gauges.begin();
+         it != m_gauges.end(); ++it)
+        delete it->second;
+    for (map<string, SgMetricHistogram*>::iterator it = m_histograms.begin();
+         it != m_histograms.end(); ++it)
+        delete it->second;
+}
+
+SgMetrics::SgMetrics()
+{ }
+
+SgMetrics::~SgMetrics()
+{
+    for (map<string, Family*>::iterator it = m_families.begin();
+         it != m_families.end(); ++it)
+        delete it->second;
+}
+
+SgMetricCounter& SgMetrics::Counter(const string& name, const string& help,
+                                    const string& labels)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    SgMetricCounter*& counter =
+        GetFamily(name, help, "counter").m_counters[labels];
+    if (counter == 0)
+        counter = new SgMetricCounter();
+    return *counter;
+}
+
+SgMetricGauge& SgMetrics::Gauge(const string& name, const string& help,
+                                const string& labels)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    SgMetricGauge*& gauge = GetFamily(name, help, "gauge").m_gauges[labels];
+    if (gauge == 0)
+        gauge = new SgMetricGauge();
+    return *gauge;
+}
+
+SgMetrics::Family& SgMetrics::GetFamily(const string& name,
+                                        const string& help, const char* type)
+{
+    Family*& family = m_families[name];
+    if (family == 0)
+    {
+        family = new Family();
+        family->m_help = help;
+        family->m_type = type;
+    }
+    else if (strcmp(family->m_type, type) != 0)
+        throw SgException("metric " + name + " is a " + family->m_type
+                          + ", not a " + type);
+    return *family;
+}
+
+SgMetrics& SgMetrics::Global()
+{
+    // Created on first use, so that metrics can be registered during the
+    // initialization of global variables in other files
+    static SgMetrics s_global;
+    return s_global;
+}
+
+SgMetricHistogram& SgMetrics::Histogram(const string& name,
+                                        const string& help,
+                                        const vector<double>& upperBounds,
+                                        const string& labels)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    SgMetricHistogram*& histogram =
+        GetFamily(name, help, "histogram").m_histograms[labels];
+    if (histogram == 0)
+        histogram = new SgMetricHistogram(upperBounds);
+    return *histogram;
+}
+
+void SgMetrics::WritePrometheus(ostream& out) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (map<string, Family*>::const_iterator it = m_families.begin();
+         it != m_families.end(); ++it)
+    {
+        const string& name = it->first;
+        const Family& family = *it->second;
+        out << "# HELP " << name << ' ';
+        WriteHelp(out, family.m_help);
+        out << "\n# TYPE " << name << ' ' << family.m_type << '\n';
+        for (map<string, SgMetricCounter*>::const_iterator
+                 c = family.m_counters.begin();
+             c != family.m_counters.end(); ++c)
+        {
+            WriteSampleName(out, name, "", c->first);
+            out << ' ' << c->second->Value() << '\n';
+        }
+        for (map<string, SgMetricGauge*>::const_iterator
+                 g = family.m_gauges.begin();
+             g != family.m_gauges.end(); ++g)
+        {
+            WriteSampleName(out, name, "", g->first);
+            out << ' ';
+            WriteDouble(out, g->second->Value());
+            out << '\n';
+        }
+        for (map<string, SgMetricHistogram*>::const_iterator
+                 h = family.m_histograms.begin();
+             h != family.m_histograms.end(); ++h)
+        {
+            const SgMetricHistogram& histogram = *h->second;
+            // Buckets are cumulative in the exposition format
+            unsigned long long count = 0;
+            for (int i = 0; i < histogram.Bins(); ++i)
+            {
+                count += histogram.Count(i);
+                ostringstream le;
+                le << "le=\"";
+                if (i < histogram.Bins() - 1)
+                    WriteDouble(le, histogram.UpperBound(i));
+                else
+                    le << "+Inf";
+                le << '"';
+                WriteSampleName(out, name, "_bucket", h->first, le.str());
+                out << ' ' << count << '\n';
+            }
+            WriteSampleName(out, name, "_sum", h->first);
+            out << ' ';
+            WriteDouble(out, histogram.Sum());
+            out << '\n';
+            WriteSampleName(out, name, "_count", h->first);
+            out << ' ' << count << '\n';
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+
+SgMetricsExporter::SgMetricsExporter(const SgMetrics& metrics)
+    : m_metrics(metrics),
+      m_interval(5),
+      m_socket(-1),
+      m_stop(false)
+{ }
+
+SgMetricsExporter::~SgMetricsExporter()
+{
+    Stop();
+}
+
+void SgMetricsExporter::ExportFile()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (! m_stop)
+    {
+        lock.unlock();
+        WriteFile();
+        lock.lock();
+        boost::system_time deadline = boost::get_system_time()
+            + boost::posix_time::microseconds(
+                                    static_cast<long>(m_interval * 1e6));
+        while (! m_stop && m_stopRequested.timed_wait(lock, deadline))
+            ;
+    }
+    lock.unlock();
+    WriteFile();
+}
+
+void SgMetricsExporter::ExportSocket()
+{
+#if ! WIN32
+    while (true)
+    {
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (m_stop)
+                return;
+        }
+        // Poll with a timeout, so that Stop() is noticed
+        pollfd fd;
+        fd.fd = m_socket;
+        fd.events = POLLIN;
+        if (poll(&fd, 1, 200) <= 0)
+            continue;
+        int client = accept(m_socket, 0, 0);
+        if (client < 0)
+            continue;
+        ostringstream text;
+        m_metrics.WritePrometheus(text);
+        const string s = text.str();
+        size_t written = 0;
+        while (written < s.size())
+        {
+#ifdef MSG_NOSIGNAL
+            ssize_t n = send(client, s.data() + written, s.size() - written,
+                             MSG_NOSIGNAL);
+#else
+            ssize_t n = send(client, s.data() + written, s.size() - written,
+                             0);
+#endif
+            if (n <= 0)
+                break;
+            written += static_cast<size_t>(n);
+        }
+        close(client);
+    }
+#endif
+}
+
+void SgMetricsExporter::Start(const string& target, double interval)
+{
+    Stop();
+    m_target = target;
+    m_interval = interval;
+    m_stop = false;
+    const string prefix = "unix:";
+    if (target.compare(0, prefix.size(), prefix) != 0)
+    {
+        m_thread = boost::thread(boost::bind(&SgMetricsExporter::ExportFile,
+                                             this));
+        return;
+    }
+#if WIN32
+    throw SgException("Unix sockets are not supported on this platform");
+#else
+    const string path = target.substr(prefix.size());
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw SgException("invalid socket path: " + path);
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket < 0)
+        throw SgException(string("cannot create socket: ") + strerror(errno));
+    // Remove the socket of a previous run
+    unlink(path.c_str());
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0
+        || listen(m_socket, 8) != 0)
+    {
+        string message = "cannot listen on " + path + ": " + strerror(errno);
+        close(m_socket);
+        m_socket = -1;
+        throw SgException(message);
+    }
+    m_thread = boost::thread(boost::bind(&SgMetricsExporter::ExportSocket,
+                                         this));
+#endif
+}
+
+void SgMetricsExporter::Stop()
+{
+    if (! m_thread.joinable())
+        return;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_stopRequested.notify_all();
+    m_thread.join();
+#if ! WIN32
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+        m_socket = -1;
+        unlink(m_target.substr(5).c_str());
+    }
+#endif
+}
+
+void SgMetricsExporter::WriteFile()
+{
+    ostringstream text;
+    m_metrics.WritePrometheus(text);
+    const string temp = m_target + ".tmp";
+    {
+        ofstream out(temp.c_str());
+        out << text.str();
+        out.close();
+        if (! out)
+        {
+            SG_LOG(SG_LOG_WARNING) << "cannot write metrics to " << temp;
+            return;
+        }
+    }
+    boost::system::error_code error;
+    boost::filesystem::rename(temp, m_target, error);
+    if (error)
+        SG_LOG(SG_LOG_WARNING) << "cannot write metrics to " << m_target
+                               << ": " << error.message();
+}
+
+//----------------------------------------------------------------------------
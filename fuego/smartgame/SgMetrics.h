@@ -0,0 +1,342 @@
+//----------------------------------------------------------------------------
+/** @file SgMetrics.h
+    Counters, gauges and latency histograms with export in the Prometheus
+    text format.
+
+    Metrics are created once by name in a registry, usually SgMetrics::Global(),
+    and updated with relaxed atomic operations, so they can be updated from
+    the scan, backend and gui threads without locks:
+@code
+    SgMetricCounter& s_failedFrames = SgMetrics::Global().Counter(
+        "ag_scanner_frames_total", "Frames read by the scanner",
+        "result=\"failed\"");
+    ...
+    s_failedFrames.Increment();
+@endcode
+    Objects returned by the registry live until the end of the program.
+    SgMetricsExporter writes the metrics of a registry periodically to a file
+    or answers requests on a local Unix socket. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_METRICS_H
+#define SG_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+//----------------------------------------------------------------------------
+
+/** Value that only increases, e.g.\ number of processed frames. */
+class SgMetricCounter
+{
+public:
+    SgMetricCounter();
+
+    void Increment(unsigned long long n = 1);
+
+    unsigned long long Value() const;
+
+private:
+    std::atomic<unsigned long long> m_value;
+
+    /** Not implemented */
+    SgMetricCounter(const SgMetricCounter&);
+
+    /** Not implemented */
+    SgMetricCounter& operator=(const SgMetricCounter&);
+};
+
+inline void SgMetricCounter::Increment(unsigned long long n)
+{
+    m_value.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline unsigned long long SgMetricCounter::Value() const
+{
+    return m_value.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+
+/** Value that can go up and down, e.g.\ the current frame rate. */
+class SgMetricGauge
+{
+public:
+    SgMetricGauge();
+
+    void Set(double value);
+
+    void Add(double value);
+
+    double Value() const;
+
+private:
+    std::atomic<double> m_value;
+
+    /** Not implemented */
+    SgMetricGauge(const SgMetricGauge&);
+
+    /** Not implemented */
+    SgMetricGauge& operator=(const SgMetricGauge&);
+};
+
+inline void SgMetricGauge::Set(double value)
+{
+    m_value.store(value, std::memory_order_relaxed);
+}
+
+inline double SgMetricGauge::Value() const
+{
+    return m_value.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+
+/** Distribution of a value, e.g.\ the latency of a frame in seconds.
+    Like SgHistogram, but can be updated concurrently and has bins of
+    arbitrary width, defined by their upper bounds (latencies are usually
+    binned exponentially). Values above the last bound are counted in an
+    additional bin. */
+class SgMetricHistogram
+{
+public:
+    /** Constructor.
+        @param upperBounds Upper bounds of the bins in increasing order. */
+    explicit SgMetricHistogram(const std::vector<double>& upperBounds);
+
+    ~SgMetricHistogram();
+
+    void Add(double value);
+
+    /** Number of bins including the bin above the last bound. */
+    int Bins() const;
+
+    /** Upper bound of a bin, not defined for the last bin. */
+    double UpperBound(int i) const;
+
+    /** Get count in a certain bin. */
+    unsigned long long Count(int i) const;
+
+    /** Total count. */
+    unsigned long long Count() const;
+
+    /** Sum of all added values. */
+    double Sum() const;
+
+    /** Bounds from 1 ms to 2.5 s, suitable for frame latencies in
+        seconds. */
+    static const std::vector<double>& LatencyBounds();
+
+private:
+    std::vector<double> m_upperBounds;
+
+    std::atomic<unsigned long long>* m_counts;
+
+    std::atomic<double> m_sum;
+
+    /** Not implemented */
+    SgMetricHistogram(const SgMetricHistogram&);
+
+    /** Not implemented */
+    SgMetricHistogram& operator=(const SgMetricHistogram&);
+};
+
+inline int SgMetricHistogram::Bins() const
+{
+    return static_cast<int>(m_upperBounds.size()) + 1;
+}
+
+inline unsigned long long SgMetricHistogram::Count(int i) const
+{
+    return m_counts[i].load(std::memory_order_relaxed);
+}
+
+inline double SgMetricHistogram::Sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+inline double SgMetricHistogram::UpperBound(int i) const
+{
+    return m_upperBounds[i];
+}
+
+//----------------------------------------------------------------------------
+
+/** Adds the lifetime of the object in seconds to a histogram. */
+class SgMetricTimer
+{
+public:
+    explicit SgMetricTimer(SgMetricHistogram& histogram);
+
+    ~SgMetricTimer();
+
+private:
+    SgMetricHistogram& m_histogram;
+
+    std::chrono::steady_clock::time_point m_start;
+
+    /** Not implemented */
+    SgMetricTimer(const SgMetricTimer&);
+
+    /** Not implemented */
+    SgMetricTimer& operator=(const SgMetricTimer&);
+};
+
+//----------------------------------------------------------------------------
+
+/** Sets a gauge to the frequency of an event, e.g.\ frames per second.
+    The frequency is smoothed exponentially over the last events. Tick()
+    must always be called by the same thread. */
+class SgMetricRate
+{
+public:
+    explicit SgMetricRate(SgMetricGauge& gauge);
+
+    /** Record an event and update the gauge. */
+    void Tick();
+
+private:
+    SgMetricGauge& m_gauge;
+
+    bool m_hasTicked;
+
+    double m_rate;
+
+    std::chrono::steady_clock::time_point m_lastTick;
+
+    /** Not implemented */
+    SgMetricRate(const SgMetricRate&);
+
+    /** Not implemented */
+    SgMetricRate& operator=(const SgMetricRate&);
+};
+
+//----------------------------------------------------------------------------
+
+/** Registry of named metrics.
+    A metric is identified by its name and its labels (a comma separated
+    list of name="value" pairs in Prometheus syntax, may be empty). Metrics
+    with the same name and different labels must have the same type and are
+    exported as one metric family. */
+class SgMetrics
+{
+public:
+    SgMetrics();
+
+    ~SgMetrics();
+
+    /** Registry of the program. */
+    static SgMetrics& Global();
+
+    /** Get or create a counter.
+        @throws SgException If the name is already used by a metric of
+        another type. */
+    SgMetricCounter& Counter(const std::string& name, const std::string& help,
+                             const std::string& labels = "");
+
+    /** Get or create a gauge.
+        @throws SgException See Counter() */
+    SgMetricGauge& Gauge(const std::string& name, const std::string& help,
+                         const std::string& labels = "");
+
+    /** Get or create a histogram.
+        The bounds are only used if the histogram is created.
+        @throws SgException See Counter() */
+    SgMetricHistogram& Histogram(const std::string& name,
+                                 const std::string& help,
+                                 const std::vector<double>& upperBounds
+                                     = SgMetricHistogram::LatencyBounds(),
+                                 const std::string& labels = "");
+
+    /** Write all metrics in the Prometheus text exposition format. */
+    void WritePrometheus(std::ostream& out) const;
+
+private:
+    /** Metrics with the same name, see SgMetrics.cpp */
+    struct Family;
+
+    mutable boost::mutex m_mutex;
+
+    std::map<std::string, Family*> m_families;
+
+    Family& GetFamily(const std::string& name, const std::string& help,
+                      const char* type);
+
+    /** Not implemented */
+    SgMetrics(const SgMetrics&);
+
+    /** Not implemented */
+    SgMetrics& operator=(const SgMetrics&);
+};
+
+//----------------------------------------------------------------------------
+
+/** Exports the metrics of a registry in a background thread.
+    Two kinds of targets are supported:
+    - A file name: the file is rewritten every interval (via a temporary
+      file, so readers never see a partially written file), e.g. for the
+      textfile collector of the Prometheus node exporter.
+    - "unix:" followed by a path: listens on a local Unix socket and writes
+      the current metrics to each client that connects, e.g.
+      <tt>socat - UNIX-CONNECT:/tmp/augmented-go.sock</tt>. Not available on
+      Windows. */
+class SgMetricsExporter
+{
+public:
+    explicit SgMetricsExporter(const SgMetrics& metrics = SgMetrics::Global());
+
+    /** Calls Stop(). */
+    ~SgMetricsExporter();
+
+    /** Start exporting.
+        Stops the previous export.
+        @param target See class description
+        @param interval Seconds between two writes of a file
+        @throws SgException If the socket cannot be created. */
+    void Start(const std::string& target, double interval = 5);
+
+    /** Stop the background thread. Writes a file target a last time. */
+    void Stop();
+
+private:
+    const SgMetrics& m_metrics;
+
+    std::string m_target;
+
+    double m_interval;
+
+    /** Listening socket, -1 for file targets. */
+    int m_socket;
+
+    boost::mutex m_mutex;
+
+    boost::condition m_stopRequested;
+
+    bool m_stop;
+
+    boost::thread m_thread;
+
+    void ExportFile();
+
+    void ExportSocket();
+
+    void WriteFile();
+
+    /** Not implemented */
+    SgMetricsExporter(const SgMetricsExporter&);
+
+    /** Not implemented */
+    SgMetricsExporter& operator=(const SgMetricsExporter&);
+};
+
+//----------------------------------------------------------------------------
+
+#endif // SG_METRICS_H
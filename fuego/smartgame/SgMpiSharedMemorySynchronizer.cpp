@@ -0,0 +1,606 @@
+//----------------------------------------------------------------------------
+/** @file SgMpiSharedMemorySynchronizer.cpp
+    See SgMpiSharedMemorySynchronizer.h
+
+    The shared memory segment contains a SegmentHeader followed by one
+    ProcessSlot per process. The header is written by the root process, a
+    slot only by its own process. */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgMpiSharedMemorySynchronizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <boost/format.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/thread/thread.hpp>
+#include "SgDebug.h"
+#include "SgException.h"
+#include "SgWrite.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+using boost::format;
+using namespace boost::interprocess;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/** Maximum number of root children of a process in the segment.
+    Statistics of further children are not exchanged. */
+const uint32_t MAX_ROOT_MOVES = 512;
+
+/** Maximum time in seconds ReadWithSequence() retries.
+    A process that died during a write leaves its sequence number odd
+    forever. */
+const double MAX_READ_TIME = 0.01;
+
+/** Copy data written with WriteWithSequence().
+    Retries until the sequence number is even and did not change during the
+    copy, but at most MAX_READ_TIME.
+    @return false if there was no consistent copy in time; target is then
+    undefined */
+template<typename T>
+bool ReadWithSequence(const atomic<uint32_t>& sequence, const T& source,
+                      T& target)
+{
+    SgTimer timer;
+    while (true)
+    {
+        uint32_t s = sequence.load(memory_order_acquire);
+        if ((s & 1) == 0)
+        {
+            memcpy(&target, &source, sizeof(T));
+            atomic_thread_fence(memory_order_acquire);
+            if (sequence.load(memory_order_relaxed) == s)
+                return true;
+        }
+        if (timer.GetTime() > MAX_READ_TIME)
+            return false;
+        boost::this_thread::yield();
+    }
+}
+
+/** Write data with a sequence number that is odd during the write.
+    Requires that there is only one writer for the sequence number. */
+template<typename T>
+void WriteWithSequence(atomic<uint32_t>& sequence, T& target,
+                       const T& source)
+{
+    uint32_t s = sequence.load(memory_order_relaxed);
+    sequence.store(s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&target, &source, sizeof(T));
+    sequence.store(s + 2, memory_order_release);
+}
+
+void SleepMilliSeconds(int milliSeconds)
+{
+    boost::this_thread::sleep(boost::posix_time::milliseconds(milliSeconds));
+}
+
+/** Synchronize function of a broadcast. */
+enum BroadcastFunction
+{
+    BROADCAST_EARLY_PASS_POSSIBLE = 1,
+
+    BROADCAST_MOVE,
+
+    BROADCAST_PASS_WINS,
+
+    BROADCAST_SEARCH_STATUS,
+
+    BROADCAST_USER_ABORT,
+
+    BROADCAST_VALUE
+};
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+/** Data of a call of a Synchronize function in the root process. */
+struct SgMpiSharedMemorySynchronizer::Broadcast
+{
+    /** Number of the call (see m_nuBroadcasts). */
+    uint64_t m_number;
+
+    /** The Synchronize function of the call (see BroadcastFunction). */
+    uint32_t m_function;
+
+    /** Move or flag. */
+    int64_t m_int;
+
+    double m_value;
+
+    double m_value2;
+};
+
+struct SgMpiSharedMemorySynchronizer::SegmentHeader
+{
+    /** Number of processes.
+        Zero until the root process has initialized the segment. */
+    atomic<uint32_t> m_nuProcesses;
+
+    atomic<uint32_t> m_broadcastSequence;
+
+    Broadcast m_broadcast;
+};
+
+struct SgMpiSharedMemorySynchronizer::RootMoveStatistics
+{
+    int32_t m_move;
+
+    /** Number of games of the process with this move. */
+    double m_count;
+
+    double m_mean;
+};
+
+struct SgMpiSharedMemorySynchronizer::SlotData
+{
+    /** Position key of the search of the process. */
+    uint64_t m_positionKey;
+
+    uint32_t m_nuMoves;
+
+    RootMoveStatistics m_moves[MAX_ROOT_MOVES];
+};
+
+struct SgMpiSharedMemorySynchronizer::ProcessSlot
+{
+    /** Number of the last broadcast the process has read or given up
+        waiting for.
+        The root process does not overwrite a broadcast before all other
+        processes have acknowledged it (or a timeout). */
+    atomic<uint64_t> m_acknowledged;
+
+    atomic<uint32_t> m_sequence;
+
+    SlotData m_data;
+};
+
+//----------------------------------------------------------------------------
+
+SgMpiSharedMemorySynchronizer::Results::Results()
+    : m_count(0),
+      m_sum(0)
+{
+}
+
+//----------------------------------------------------------------------------
+
+SgMpiSharedMemorySynchronizer::SgMpiSharedMemorySynchronizer(
+                                                      const string& name,
+                                                      int nuProcesses,
+                                                      int rank)
+    : m_name(name),
+      m_nuProcesses(nuProcesses),
+      m_rank(rank),
+      m_positionKey(0),
+      m_syncInterval(0.05),
+      m_broadcastTimeout(2),
+      m_nuBroadcasts(0),
+      m_nuMerges(0),
+      m_mergedGames(0),
+      m_merged(nuProcesses),
+      m_slotData(new SlotData()),
+      m_header(0)
+{
+    if (nuProcesses < 1 || rank < 0 || rank >= nuProcesses)
+        throw SgException(format("SgMpiSharedMemorySynchronizer: "
+                                 "invalid rank %1% of %2% processes")
+                          % rank % nuProcesses);
+    const size_t size =
+        sizeof(SegmentHeader) + nuProcesses * sizeof(ProcessSlot);
+    try
+    {
+        if (IsRootProcess())
+        {
+            shared_memory_object::remove(name.c_str());
+            m_segment.reset(new shared_memory_object(create_only,
+                                                     name.c_str(),
+                                                     read_write));
+            m_segment->truncate(size);
+            m_region.reset(new mapped_region(*m_segment, read_write));
+            // A new segment is filled with zeros, the constructors only
+            // make the objects in it explicit
+            m_header = new (m_region->get_address()) SegmentHeader();
+            for (int i = 0; i < nuProcesses; ++i)
+                new (&Slot(i)) ProcessSlot();
+            m_header->m_nuProcesses.store(nuProcesses, memory_order_release);
+        }
+        else
+        {
+            // Wait until the root process has created and initialized the
+            // segment
+            SgTimer timer;
+            while (m_header == 0
+                   || m_header->m_nuProcesses.load(memory_order_acquire) == 0)
+            {
+                if (m_region.get() == 0)
+                {
+                    try
+                    {
+                        m_segment.reset(new shared_memory_object(open_only,
+                                                                 name.c_str(),
+                                                                 read_write));
+                        offset_t segmentSize;
+                        if (m_segment->get_size(segmentSize)
+                            && segmentSize >= static_cast<offset_t>(size))
+                        {
+                            m_region.reset(new mapped_region(*m_segment,
+                                                             read_write));
+                            m_header = static_cast<SegmentHeader*>(
+                                                   m_region->get_address());
+                            continue;
+                        }
+                    }
+                    catch (const interprocess_exception&)
+                    {
+                        // Not yet created
+                    }
+                }
+                if (timer.GetTime() > m_broadcastTimeout)
+                    throw SgException(format("SgMpiSharedMemorySynchronizer: "
+                                             "shared memory segment %1% "
+                                             "not created by root process")
+                                      % name);
+                SleepMilliSeconds(10);
+            }
+            if (m_header->m_nuProcesses.load() !=
+                static_cast<uint32_t>(nuProcesses))
+                throw SgException(format("SgMpiSharedMemorySynchronizer: "
+                                         "segment %1% is used by %2% "
+                                         "processes, not %3%")
+                                  % name % m_header->m_nuProcesses.load()
+                                  % nuProcesses);
+        }
+    }
+    catch (const interprocess_exception& e)
+    {
+        throw SgException(format("SgMpiSharedMemorySynchronizer: "
+                                 "shared memory segment %1%: %2%")
+                          % name % e.what());
+    }
+}
+
+SgMpiSharedMemorySynchronizer::~SgMpiSharedMemorySynchronizer()
+{
+    m_region.reset(0);
+    m_segment.reset(0);
+    if (IsRootProcess())
+        shared_memory_object::remove(m_name.c_str());
+}
+
+void SgMpiSharedMemorySynchronizer::BroadcastData(Broadcast& data)
+{
+    SG_ASSERT(data.m_function != 0);
+    ++m_nuBroadcasts;
+    if (IsRootProcess())
+    {
+        // Wait until the other processes have read the previous broadcast
+        SgTimer timer;
+        for (int rank = 1; rank < m_nuProcesses; ++rank)
+            while (Slot(rank).m_acknowledged.load(memory_order_acquire) + 1
+                   < m_nuBroadcasts)
+            {
+                if (timer.GetTime() > m_broadcastTimeout)
+                {
+                    SgDebug() << "SgMpiSharedMemorySynchronizer: timeout "
+                        "waiting for process " << rank << '\n';
+                    break;
+                }
+                SleepMilliSeconds(1);
+            }
+        data.m_number = m_nuBroadcasts;
+        WriteWithSequence(m_header->m_broadcastSequence,
+                          m_header->m_broadcast, data);
+        return;
+    }
+    SgTimer timer;
+    Broadcast received;
+    while (true)
+    {
+        // If the read fails, the root process is writing (or died while
+        // writing) the broadcast; try again until the timeout
+        if (ReadWithSequence(m_header->m_broadcastSequence,
+                             m_header->m_broadcast, received))
+        {
+            if (received.m_number == m_nuBroadcasts)
+            {
+                if (received.m_function == data.m_function)
+                    data = received;
+                else
+                    SgDebug() << "SgMpiSharedMemorySynchronizer: call "
+                              << m_nuBroadcasts << " is a different "
+                        "function in the root process, using own value\n";
+                break;
+            }
+            if (received.m_number > m_nuBroadcasts)
+            {
+                // The root process timed out waiting for this process and
+                // overwrote the call; the data of a later call must not be
+                // used
+                SgDebug() << "SgMpiSharedMemorySynchronizer: missed call "
+                          << m_nuBroadcasts << " of root process, "
+                    "using own value\n";
+                break;
+            }
+        }
+        if (timer.GetTime() > m_broadcastTimeout)
+        {
+            SgDebug() << "SgMpiSharedMemorySynchronizer: timeout waiting "
+                "for root process, using own value\n";
+            break;
+        }
+        SleepMilliSeconds(1);
+    }
+    Slot(m_rank).m_acknowledged.store(m_nuBroadcasts, memory_order_release);
+}
+
+SgMpiSynchronizerHandle SgMpiSharedMemorySynchronizer::Create(
+                                                       const string& name,
+                                                       int nuProcesses,
+                                                       int rank)
+{
+    return SgMpiSynchronizerHandle(
+               new SgMpiSharedMemorySynchronizer(name, nuProcesses, rank));
+}
+
+#ifndef WIN32
+
+int SgMpiSharedMemorySynchronizer::ForkProcesses(const string& name,
+                                                 int nuProcesses)
+{
+    shared_memory_object::remove(name.c_str());
+    for (int rank = 1; rank < nuProcesses; ++rank)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+            throw SgException("SgMpiSharedMemorySynchronizer: fork failed");
+        if (pid == 0)
+            return rank;
+    }
+    return 0;
+}
+
+#endif // ifndef WIN32
+
+bool SgMpiSharedMemorySynchronizer::IsRootProcess() const
+{
+    return m_rank == 0;
+}
+
+void SgMpiSharedMemorySynchronizer::OnEndPonder()
+{
+}
+
+void SgMpiSharedMemorySynchronizer::OnEndSearch(SgUctSearch &search)
+{
+    if (m_nuProcesses > 1)
+        Synchronize(search);
+}
+
+void SgMpiSharedMemorySynchronizer::OnSearchIteration(SgUctSearch &search,
+                                                      SgUctValue gameNumber,
+                                                      int threadId,
+                                                      const SgUctGameInfo&
+                                                      info)
+{
+    SG_UNUSED(gameNumber);
+    SG_UNUSED(info);
+    if (threadId != 0 || m_nuProcesses == 1)
+        return;
+    if (m_syncTimer.IsTimeOut(m_syncInterval))
+    {
+        Synchronize(search);
+        m_syncTimer = SgTimer();
+    }
+}
+
+void SgMpiSharedMemorySynchronizer::OnStartPonder()
+{
+}
+
+void SgMpiSharedMemorySynchronizer::OnStartSearch(SgUctSearch &search)
+{
+    SG_UNUSED(search);
+    for (vector<map<SgMove,Results> >::iterator it = m_merged.begin();
+         it != m_merged.end(); ++it)
+        it->clear();
+    m_mergedTotal.clear();
+    m_nuMerges = 0;
+    m_mergedGames = 0;
+    m_slotData->m_positionKey = m_positionKey;
+    m_slotData->m_nuMoves = 0;
+    ProcessSlot& slot = Slot(m_rank);
+    WriteWithSequence(slot.m_sequence, slot.m_data, *m_slotData);
+    m_syncTimer = SgTimer();
+}
+
+void SgMpiSharedMemorySynchronizer::OnThreadEndSearch(SgUctSearch &search,
+                                                      SgUctThreadState &state)
+{
+    SG_UNUSED(search);
+    SG_UNUSED(state);
+}
+
+void SgMpiSharedMemorySynchronizer::OnThreadStartSearch(SgUctSearch &search,
+                                                       SgUctThreadState &state)
+{
+    SG_UNUSED(search);
+    SG_UNUSED(state);
+}
+
+SgMpiSharedMemorySynchronizer::ProcessSlot&
+SgMpiSharedMemorySynchronizer::Slot(int rank)
+{
+    SG_ASSERT(rank >= 0 && rank < m_nuProcesses);
+    char* start = reinterpret_cast<char*>(m_header) + sizeof(SegmentHeader);
+    return reinterpret_cast<ProcessSlot*>(start)[rank];
+}
+
+void SgMpiSharedMemorySynchronizer::Synchronize(SgUctSearch& search)
+{
+    const SgUctTree& tree = search.Tree();
+    SlotData& data = *m_slotData;
+
+    // Publish the results of the own games, without the results of the
+    // other processes added before
+    map<SgMove,const SgUctNode*> children;
+    data.m_positionKey = m_positionKey;
+    data.m_nuMoves = 0;
+    for (SgUctChildIterator it(tree, tree.Root()); it; ++it)
+    {
+        const SgUctNode& child = *it;
+        children[child.Move()] = &child;
+        if (data.m_nuMoves == MAX_ROOT_MOVES || ! child.HasMean())
+            continue;
+        double count = child.MoveCount();
+        double sum = child.Mean() * count;
+        map<SgMove,Results>::const_iterator merged =
+            m_mergedTotal.find(child.Move());
+        if (merged != m_mergedTotal.end())
+        {
+            count -= merged->second.m_count;
+            sum -= merged->second.m_sum;
+        }
+        if (count <= 0)
+            continue;
+        RootMoveStatistics& statistics = data.m_moves[data.m_nuMoves++];
+        statistics.m_move = child.Move();
+        statistics.m_count = count;
+        statistics.m_mean = sum / count;
+    }
+    ProcessSlot& ownSlot = Slot(m_rank);
+    WriteWithSequence(ownSlot.m_sequence, ownSlot.m_data, data);
+
+    // Add the new results of the other processes
+    for (int rank = 0; rank < m_nuProcesses; ++rank)
+    {
+        if (rank == m_rank)
+            continue;
+        ProcessSlot& slot = Slot(rank);
+        // A slot that cannot be read is unavailable in this merge (the
+        // process is writing it or died while writing it); its new results
+        // are added in a later merge, if any
+        if (! ReadWithSequence(slot.m_sequence, slot.m_data, data)
+            || data.m_positionKey != m_positionKey)
+            continue;
+        const uint32_t nuMoves = min(data.m_nuMoves, MAX_ROOT_MOVES);
+        for (uint32_t i = 0; i < nuMoves; ++i)
+        {
+            const RootMoveStatistics& statistics = data.m_moves[i];
+            map<SgMove,const SgUctNode*>::const_iterator child =
+                children.find(statistics.m_move);
+            if (child == children.end())
+                continue;
+            Results& merged = m_merged[rank][statistics.m_move];
+            double count = statistics.m_count - merged.m_count;
+            // A smaller count than before means that the other process
+            // restarted its search; its old results are kept
+            if (count <= 0)
+                continue;
+            double sum =
+                statistics.m_count * statistics.m_mean - merged.m_sum;
+            search.AddRootChildResults(*child->second,
+                                       SgUctValue(sum / count),
+                                       SgUctValue(count));
+            merged.m_count += count;
+            merged.m_sum += sum;
+            Results& total = m_mergedTotal[statistics.m_move];
+            total.m_count += count;
+            total.m_sum += sum;
+            m_mergedGames += count;
+        }
+    }
+    ++m_nuMerges;
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizeEarlyPassPossible(bool &flag)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_EARLY_PASS_POSSIBLE;
+    data.m_int = flag;
+    BroadcastData(data);
+    flag = (data.m_int != 0);
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizeMove(SgMove &move)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_MOVE;
+    data.m_int = move;
+    BroadcastData(data);
+    move = static_cast<SgMove>(data.m_int);
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizePassWins(bool &flag)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_PASS_WINS;
+    data.m_int = flag;
+    BroadcastData(data);
+    flag = (data.m_int != 0);
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizeSearchStatus(
+                                                  SgUctValue &value,
+                                                  bool &earlyAbort,
+                                                  SgUctValue &rootMoveCount)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_SEARCH_STATUS;
+    data.m_int = earlyAbort;
+    data.m_value = value;
+    data.m_value2 = rootMoveCount;
+    BroadcastData(data);
+    earlyAbort = (data.m_int != 0);
+    value = SgUctValue(data.m_value);
+    rootMoveCount = SgUctValue(data.m_value2);
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizeUserAbort(bool &flag)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_USER_ABORT;
+    data.m_int = flag;
+    BroadcastData(data);
+    flag = (data.m_int != 0);
+}
+
+void SgMpiSharedMemorySynchronizer::SynchronizeValue(SgUctValue &value)
+{
+    Broadcast data = Broadcast();
+    data.m_function = BROADCAST_VALUE;
+    data.m_value = value;
+    BroadcastData(data);
+    value = SgUctValue(data.m_value);
+}
+
+string SgMpiSharedMemorySynchronizer::ToNodeFilename(const string &filename)
+    const
+{
+    if (IsRootProcess())
+        return filename;
+    return (format("%1%.%2%") % filename % m_rank).str();
+}
+
+void SgMpiSharedMemorySynchronizer::WriteStatistics(ostream& out) const
+{
+    out << SgWriteLabel("Processes") << m_nuProcesses
+        << " (rank " << m_rank << ")\n"
+        << SgWriteLabel("Merges") << m_nuMerges << '\n'
+        << SgWriteLabel("MergedGames") << m_mergedGames << '\n';
+}
+
+//----------------------------------------------------------------------------
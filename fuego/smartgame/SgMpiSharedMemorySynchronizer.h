@@ -0,0 +1,294 @@
+//----------------------------------------------------------------------------
+/** @file SgMpiSharedMemorySynchronizer.h
+    Root-parallel search with several processes on one machine. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_MPISHAREDMEMORYSYNCHRONIZER_H
+#define SG_MPISHAREDMEMORYSYNCHRONIZER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "SgMpiSynchronizer.h"
+#include "SgTimer.h"
+
+namespace boost {
+namespace interprocess {
+    class shared_memory_object;
+    class mapped_region;
+}
+}
+
+//----------------------------------------------------------------------------
+
+/** Synchronizer for root-parallel search of several processes on one
+    machine.
+    Each process runs its own SgUctSearch with its own tree on the same
+    position. The processes periodically exchange the statistics of the
+    children of the root node through a shared memory segment: each process
+    publishes the statistics of its own games in a slot of the segment and
+    adds the new games of the other processes to the children of its root
+    node (see SgUctSearch::AddRootChildResults()). This avoids the global
+    mutex and the allocator contention of a single process with many
+    threads, and needs no MPI or network.
+
+    The processes are created with ForkProcesses() or started separately
+    with the same segment name and a distinct rank. All processes must get
+    the same commands (e.g. from a driver that sends the same GTP commands to
+    each of them); only the root process (rank 0) should generate output.
+    Before each search, all processes must set the same position key with
+    SetPositionKey(); statistics of processes with a different key are
+    ignored, so that processes that are not yet (or no longer) at the same
+    position do not disturb each other.
+
+    The Synchronize functions are collective like broadcasts in MPI: the
+    i'th call in a non-root process receives the value of the i'th call of
+    the root process, if it is a call of the same function. The root process
+    writes a call only after all other processes have read the previous one.
+    Both wait at most BroadcastTimeout() for each other; a non-root process
+    keeps its own value if it timed out, missed the call or the call was a
+    different function, and continues with the next call.
+
+    The segment uses std::atomic variables for the synchronization between
+    the processes, which requires that they are lock-free and address-free
+    (true on all supported platforms). The data in the slots is protected by
+    sequence numbers (each slot is written only by its own process), so
+    readers never block writers. A reader gives up on a slot after a short
+    time, so that a process that died during a write does not block the
+    others. The root process creates the segment and
+    removes it in its destructor. */
+class SgMpiSharedMemorySynchronizer
+    : public SgMpiSynchronizer
+{
+public:
+    /** Constructor.
+        The root process creates the shared memory segment (replacing a
+        segment with the same name left over from a previous run), the other
+        processes wait at most BroadcastTimeout() until it is created.
+        @param name The name of the shared memory segment; must be the same
+        for all processes of a search and different for other searches on
+        the machine
+        @param nuProcesses The number of processes
+        @param rank The number of this process (0 for the root process)
+        @throws SgException if the segment cannot be created or opened */
+    SgMpiSharedMemorySynchronizer(const std::string& name, int nuProcesses,
+                                  int rank);
+
+    virtual ~SgMpiSharedMemorySynchronizer();
+
+    /** See constructor. */
+    static SgMpiSynchronizerHandle Create(const std::string& name,
+                                          int nuProcesses, int rank);
+
+#ifndef WIN32
+    /** Create nuProcesses - 1 child processes with fork().
+        Must be called before any threads are started. Removes a segment with
+        the given name left over from a previous run, so that the child
+        processes cannot open it before the root process replaces it.
+        @return The rank of the calling process: 0 in the parent process,
+        1..nuProcesses - 1 in the child processes
+        @throws SgException if a process cannot be created */
+    static int ForkProcesses(const std::string& name, int nuProcesses);
+#endif
+
+    int NuProcesses() const;
+
+    int Rank() const;
+
+    /** Key of the position of the next search.
+        Usually the hash code of the position. Default is 0. */
+    uint64_t PositionKey() const;
+
+    /** See PositionKey() */
+    void SetPositionKey(uint64_t key);
+
+    /** Time in seconds between two merges of the root statistics.
+        Default is 0.05. */
+    double SyncInterval() const;
+
+    /** See SyncInterval() */
+    void SetSyncInterval(double interval);
+
+    /** Maximum time in seconds a non-root process waits for the root
+        process.
+        Default is 2. */
+    double BroadcastTimeout() const;
+
+    /** See BroadcastTimeout() */
+    void SetBroadcastTimeout(double timeout);
+
+    /** Number of merges in the current (or last) search. */
+    std::size_t NuMerges() const;
+
+    /** Number of games of other processes added to the root children in
+        the current (or last) search. */
+    double MergedGames() const;
+
+    virtual std::string ToNodeFilename(const std::string &filename) const;
+
+    virtual bool IsRootProcess() const;
+
+    virtual void OnStartSearch(SgUctSearch &search);
+
+    virtual void OnEndSearch(SgUctSearch &search);
+
+    virtual void OnThreadStartSearch(SgUctSearch &search,
+                                     SgUctThreadState &state);
+
+    virtual void OnThreadEndSearch(SgUctSearch &search,
+                                   SgUctThreadState &state);
+
+    virtual void OnSearchIteration(SgUctSearch &search, SgUctValue gameNumber,
+                                   int threadId, const SgUctGameInfo& info);
+
+    virtual void OnStartPonder();
+
+    virtual void OnEndPonder();
+
+    virtual void WriteStatistics(std::ostream& out) const;
+
+    virtual void SynchronizeUserAbort(bool &flag);
+
+    virtual void SynchronizePassWins(bool &flag);
+
+    virtual void SynchronizeEarlyPassPossible(bool &flag);
+
+    virtual void SynchronizeMove(SgMove &move);
+
+    virtual void SynchronizeValue(SgUctValue &value);
+
+    virtual void SynchronizeSearchStatus(SgUctValue &value, bool &earlyAbort,
+                                         SgUctValue &rootMoveCount);
+
+private:
+    // Parts of the shared memory segment, see SgMpiSharedMemorySynchronizer.cpp
+    struct SegmentHeader;
+
+    struct Broadcast;
+
+    struct ProcessSlot;
+
+    struct RootMoveStatistics;
+
+    struct SlotData;
+
+    /** Count and sum of game results of a move. */
+    struct Results
+    {
+        double m_count;
+
+        double m_sum;
+
+        Results();
+    };
+
+    std::string m_name;
+
+    int m_nuProcesses;
+
+    int m_rank;
+
+    uint64_t m_positionKey;
+
+    double m_syncInterval;
+
+    double m_broadcastTimeout;
+
+    /** Number of calls of the Synchronize functions since construction. */
+    uint64_t m_nuBroadcasts;
+
+    /** Number of merges in the current search. */
+    std::size_t m_nuMerges;
+
+    /** Number of games of other processes added in the current search. */
+    double m_mergedGames;
+
+    SgTimer m_syncTimer;
+
+    /** Results of other processes already added to the root children in
+        the current search, by process and move. */
+    std::vector<std::map<SgMove,Results> > m_merged;
+
+    /** Sum of m_merged over all processes by move. */
+    std::map<SgMove,Results> m_mergedTotal;
+
+    /** Local copy of the data of a slot. */
+    std::auto_ptr<SlotData> m_slotData;
+
+    std::auto_ptr<boost::interprocess::shared_memory_object> m_segment;
+
+    std::auto_ptr<boost::interprocess::mapped_region> m_region;
+
+    SegmentHeader* m_header;
+
+    /** Not implemented. */
+    SgMpiSharedMemorySynchronizer(const SgMpiSharedMemorySynchronizer&);
+
+    /** Not implemented. */
+    SgMpiSharedMemorySynchronizer&
+    operator=(const SgMpiSharedMemorySynchronizer&);
+
+    void BroadcastData(Broadcast& data);
+
+    ProcessSlot& Slot(int rank);
+
+    /** Publish the statistics of this process and add the new results of
+        the other processes to the root children of the search. */
+    void Synchronize(SgUctSearch& search);
+};
+
+inline int SgMpiSharedMemorySynchronizer::NuProcesses() const
+{
+    return m_nuProcesses;
+}
+
+inline uint64_t SgMpiSharedMemorySynchronizer::PositionKey() const
+{
+    return m_positionKey;
+}
+
+inline double SgMpiSharedMemorySynchronizer::MergedGames() const
+{
+    return m_mergedGames;
+}
+
+inline std::size_t SgMpiSharedMemorySynchronizer::NuMerges() const
+{
+    return m_nuMerges;
+}
+
+inline int SgMpiSharedMemorySynchronizer::Rank() const
+{
+    return m_rank;
+}
+
+inline double SgMpiSharedMemorySynchronizer::BroadcastTimeout() const
+{
+    return m_broadcastTimeout;
+}
+
+inline void SgMpiSharedMemorySynchronizer::SetBroadcastTimeout(double timeout)
+{
+    m_broadcastTimeout = timeout;
+}
+
+inline void SgMpiSharedMemorySynchronizer::SetPositionKey(uint64_t key)
+{
+    m_positionKey = key;
+}
+
+inline void SgMpiSharedMemorySynchronizer::SetSyncInterval(double interval)
+{
+    m_syncInterval = interval;
+}
+
+inline double SgMpiSharedMemorySynchronizer::SyncInterval() const
+{
+    return m_syncInterval;
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_MPISHAREDMEMORYSYNCHRONIZER_H
@@ -723,9 +723,9 @@ int SgNode::CountNodes(bool fSetPropOnThisNode)
 }
 
 #ifndef NDEBUG
-int SgNode::s_alloc = 0;
+std::atomic<int> SgNode::s_alloc(0);
 
-int SgNode::s_free = 0;
+std::atomic<int> SgNode::s_free(0);
 
 void SgNode::GetStatistics(int* numAlloc, int* numUsed)
 {
@@ -26,6 +26,9 @@
 #define SG_NODE_H
 
 #include <string>
+#ifndef NDEBUG
+#include <atomic>
+#endif
 #include "SgProp.h"
 #include "SgPointSet.h"
 #include "SgVector.h"
@@ -380,9 +383,10 @@ private:
     SgNode& operator=(const SgNode&);
 
 #ifndef NDEBUG
-    static int s_alloc;
+    /** Atomic, because trees may be read on several threads at once. */
+    static std::atomic<int> s_alloc;
 
-    static int s_free;
+    static std::atomic<int> s_free;
 #endif
 };
 
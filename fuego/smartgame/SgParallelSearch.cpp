@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------
+/** @file SgParallelSearch.cpp
+    See SgParallelSearch.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgParallelSearch.h"
+
+#include <iostream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "SgHashTable.h"
+#include "SgSearchControl.h"
+#include "SgTimer.h"
+#include "SgWrite.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+struct SgParallelSearch::ThreadResult
+{
+    int m_value;
+
+    SgVector<SgMove> m_sequence;
+
+    int m_depthCompleted;
+
+    bool m_aborted;
+
+    ThreadResult();
+};
+
+SgParallelSearch::ThreadResult::ThreadResult()
+    : m_value(0),
+      m_depthCompleted(0),
+      m_aborted(false)
+{
+}
+
+//----------------------------------------------------------------------------
+
+/** Stops a thread when another thread ended its search.
+    Forwards to the search control set with
+    SgParallelSearch::SetSearchControl() in the main thread. */
+class SgParallelSearch::ThreadControl
+    : public SgSearchControl
+{
+public:
+    /** Constructor.
+        @param stop The flag of SgParallelSearch
+        @param control The search control to forward to or 0 */
+    ThreadControl(const atomic<bool>& stop, SgSearchControl* control);
+
+    virtual bool Abort(double elapsedTime, int numNodes);
+
+    virtual bool StartNextIteration(int depth, double elapsedTime,
+                                    int numNodes);
+
+private:
+    const atomic<bool>& m_stop;
+
+    SgSearchControl* m_control;
+};
+
+SgParallelSearch::ThreadControl::ThreadControl(const atomic<bool>& stop,
+                                               SgSearchControl* control)
+    : m_stop(stop),
+      m_control(control)
+{
+}
+
+bool SgParallelSearch::ThreadControl::Abort(double elapsedTime, int numNodes)
+{
+    return m_stop.load(memory_order_relaxed)
+        || (m_control != 0 && m_control->Abort(elapsedTime, numNodes));
+}
+
+bool SgParallelSearch::ThreadControl::StartNextIteration(int depth,
+                                                         double elapsedTime,
+                                                         int numNodes)
+{
+    return ! m_stop.load(memory_order_relaxed)
+        && (m_control == 0
+            || m_control->StartNextIteration(depth, elapsedTime, numNodes));
+}
+
+//----------------------------------------------------------------------------
+
+SgParallelSearch::SgParallelSearch(const vector<SgSearch*>& searches,
+                                   SgSearchHashTable* hash)
+    : m_searches(searches),
+      m_hash(hash),
+      m_control(0),
+      m_stop(false),
+      m_depthOffset(1),
+      m_depthCompleted(0),
+      m_resultThread(0),
+      m_threadStat(searches.size())
+{
+    SG_ASSERT(! searches.empty());
+    for (size_t i = 0; i < searches.size(); ++i)
+        searches[i]->SetHashTable(hash);
+}
+
+SgParallelSearch::~SgParallelSearch()
+{
+}
+
+int SgParallelSearch::IteratedSearch(int depthMin, int depthMax,
+                                     int boundLo, int boundHi,
+                                     SgVector<SgMove>* sequence,
+                                     bool clearHash)
+{
+    SG_ASSERT(sequence);
+    SgTimer timer;
+    // The threads must not clear the shared hash table, so it is cleared and
+    // seeded here, as SgSearch::IteratedSearch() would do
+    if (clearHash && m_hash != 0)
+    {
+        m_hash->Clear();
+        m_searches[0]->AddSequenceToHash(*sequence, 0);
+    }
+    m_stop = false;
+    vector<ThreadResult> results(m_searches.size());
+    for (size_t i = 0; i < results.size(); ++i)
+        results[i].m_sequence = *sequence;
+    boost::thread_group threads;
+    for (int i = 1; i < NuThreads(); ++i)
+        threads.create_thread(boost::bind(&SgParallelSearch::SearchThread,
+                                          this, i, &results[i],
+                                          depthMin, depthMax, boundLo,
+                                          boundHi));
+    SearchThread(0, &results[0], depthMin, depthMax, boundLo, boundHi);
+    threads.join_all();
+
+    m_resultThread = 0;
+    for (int i = 1; i < NuThreads(); ++i)
+    {
+        const ThreadResult& best = results[m_resultThread];
+        const ThreadResult& result = results[i];
+        if (result.m_aborted != best.m_aborted)
+        {
+            if (! result.m_aborted)
+                m_resultThread = i;
+        }
+        else if (result.m_depthCompleted > best.m_depthCompleted)
+            m_resultThread = i;
+    }
+    const ThreadResult& best = results[m_resultThread];
+    m_depthCompleted = best.m_depthCompleted;
+    *sequence = best.m_sequence;
+    m_stat.Clear();
+    for (int i = 0; i < NuThreads(); ++i)
+        m_stat += m_threadStat[i];
+    m_stat.SetTimeUsed(timer.GetTime());
+    return best.m_value;
+}
+
+void SgParallelSearch::SearchThread(int threadId, ThreadResult* result,
+                                    int depthMin, int depthMax, int boundLo,
+                                    int boundHi)
+{
+    SgSearch& search = *m_searches[threadId];
+    ThreadControl control(m_stop, threadId == 0 ? m_control : 0);
+    search.SetSearchControl(&control);
+    search.SetRootMoveRotation(threadId);
+    int depth = depthMin + threadId % (m_depthOffset + 1);
+    result->m_value = search.IteratedSearch(min(depth, depthMax), depthMax,
+                                            boundLo, boundHi,
+                                            &result->m_sequence, false);
+    result->m_depthCompleted = search.IteratedSearchDepthCompleted();
+    result->m_aborted = search.Aborted();
+    // The first thread that ends its search ends the search of the others
+    m_stop = true;
+    search.SetSearchControl(0);
+    search.SetRootMoveRotation(0);
+    search.GetStatistics(&m_threadStat[threadId]);
+}
+
+void SgParallelSearch::WriteStatistics(ostream& out) const
+{
+    out << SgWriteLabel("Threads") << NuThreads() << '\n'
+        << SgWriteLabel("ResultThread") << m_resultThread << '\n'
+        << SgWriteLabel("DepthCompleted") << m_depthCompleted << '\n'
+        << SgWriteLabel("Nodes") << m_stat.NumNodes() << '\n'
+        << SgWriteLabel("Time") << m_stat.TimeUsed() << '\n'
+        << SgWriteLabel("Nodes/s") << m_stat.NumNodesPerSecond() << '\n';
+    for (int i = 0; i < NuThreads(); ++i)
+    {
+        const SgSearchStatistics& stat = m_threadStat[i];
+        ostringstream label;
+        label << "Thread" << i;
+        out << SgWriteLabel(label.str()) << stat.NumNodes() << " nodes, "
+            << "depth " << stat.DepthReached() << ", "
+            << stat.NumNodesPerSecond() << " nodes/s\n";
+    }
+}
+
+//----------------------------------------------------------------------------
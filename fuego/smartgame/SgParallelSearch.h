@@ -0,0 +1,181 @@
+//----------------------------------------------------------------------------
+/** @file SgParallelSearch.h
+    Parallel iterative deepening with several instances of SgSearch. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_PARALLELSEARCH_H
+#define SG_PARALLELSEARCH_H
+
+#include <atomic>
+#include <iosfwd>
+#include <vector>
+#include "SgSearch.h"
+#include "SgSearchStatistics.h"
+
+//----------------------------------------------------------------------------
+
+/** Parallel alpha-beta search with shared hash table ("Lazy SMP").
+    Each thread runs SgSearch::IteratedSearch() on its own search object,
+    which must be in the same position as the others (usually a search on
+    its own copy of the board). The threads communicate only through the
+    shared hash table: a thread that reaches a position already searched by
+    another thread finds the value or at least the best move in the table.
+    To make the threads search different parts of the tree, the helper
+    threads (all threads except the first) start at an increased depth and
+    rotate the moves at the root (see SgSearch::SetRootMoveRotation()).
+
+    The search ends when the first thread ends its iterated search without
+    being aborted (exact value, depth limit or bounds reached), or when the
+    main thread (the first thread) is aborted by the search control. The
+    result is the result of the thread that ended without being aborted, if
+    there is one, otherwise the result of the thread that completed the
+    deepest iteration; the main thread wins a tie.
+    During the search, the search controls and the root move rotations of
+    the search objects are replaced; they are reset to 0 after the
+    search. */
+class SgParallelSearch
+{
+public:
+    /** Constructor.
+        @param searches The search objects, one per thread (not owned). The
+        first is the search of the main thread.
+        @param hash The hash table shared by the threads or 0 (not owned).
+        Set as the hash table of all searches. */
+    SgParallelSearch(const std::vector<SgSearch*>& searches,
+                     SgSearchHashTable* hash);
+
+    ~SgParallelSearch();
+
+    /** Run SgSearch::IteratedSearch in all threads and return the
+        combined result.
+        The parameters are the same as in SgSearch::IteratedSearch. If
+        clearHash is true, the hash table is cleared and seeded with the
+        sequence before the threads start. */
+    int IteratedSearch(int depthMin, int depthMax, int boundLo, int boundHi,
+                       SgVector<SgMove>* sequence, bool clearHash = true);
+
+    /** Call IteratedSearch with window [-SG_INFINITY,+SG_INFINITY] */
+    int IteratedSearch(int depthMin, int depthMax, SgVector<SgMove>* sequence,
+                       bool clearHash = true);
+
+    int NuThreads() const;
+
+    /** The search control of the main thread (not owned).
+        Default is 0. Only the main thread calls the search control; the
+        helper threads stop when the main thread stops. Node limits refer to
+        the nodes of the main thread. */
+    void SetSearchControl(SgSearchControl* control);
+
+    /** Depth increment of the helper threads.
+        Helper thread i starts its iterated search at depthMin +
+        (i % (DepthOffset() + 1)). Default is 1. */
+    int DepthOffset() const;
+
+    /** See DepthOffset() */
+    void SetDepthOffset(int offset);
+
+    /** The depth of the iteration that the result was taken from. */
+    int DepthCompleted() const;
+
+    /** The thread that the result was taken from. */
+    int ResultThread() const;
+
+    /** Statistics of the last search summed over all threads.
+        The time is the wall-clock time of the search. */
+    const SgSearchStatistics& Statistics() const;
+
+    /** Statistics of a thread in the last search. */
+    const SgSearchStatistics& ThreadStatistics(int threadId) const;
+
+    /** Write the statistics of the last search, including nodes per second
+        of each thread. */
+    void WriteStatistics(std::ostream& out) const;
+
+private:
+    /** Result of a thread, see SgParallelSearch.cpp */
+    struct ThreadResult;
+
+    /** Search control of the threads, see SgParallelSearch.cpp */
+    class ThreadControl;
+
+    std::vector<SgSearch*> m_searches;
+
+    SgSearchHashTable* m_hash;
+
+    SgSearchControl* m_control;
+
+    /** Set when the first thread ends its search. */
+    std::atomic<bool> m_stop;
+
+    int m_depthOffset;
+
+    int m_depthCompleted;
+
+    int m_resultThread;
+
+    SgSearchStatistics m_stat;
+
+    std::vector<SgSearchStatistics> m_threadStat;
+
+    void SearchThread(int threadId, ThreadResult* result, int depthMin,
+                      int depthMax, int boundLo, int boundHi);
+
+    /** Not implemented */
+    SgParallelSearch(const SgParallelSearch&);
+
+    /** Not implemented */
+    SgParallelSearch& operator=(const SgParallelSearch&);
+};
+
+inline int SgParallelSearch::DepthCompleted() const
+{
+    return m_depthCompleted;
+}
+
+inline int SgParallelSearch::DepthOffset() const
+{
+    return m_depthOffset;
+}
+
+inline int SgParallelSearch::IteratedSearch(int depthMin, int depthMax,
+                                            SgVector<SgMove>* sequence,
+                                            bool clearHash)
+{
+    return IteratedSearch(depthMin, depthMax, -SgSearch::SG_INFINITY,
+                          SgSearch::SG_INFINITY, sequence, clearHash);
+}
+
+inline int SgParallelSearch::NuThreads() const
+{
+    return static_cast<int>(m_searches.size());
+}
+
+inline int SgParallelSearch::ResultThread() const
+{
+    return m_resultThread;
+}
+
+inline void SgParallelSearch::SetDepthOffset(int offset)
+{
+    m_depthOffset = offset;
+}
+
+inline void SgParallelSearch::SetSearchControl(SgSearchControl* control)
+{
+    m_control = control;
+}
+
+inline const SgSearchStatistics& SgParallelSearch::Statistics() const
+{
+    return m_stat;
+}
+
+inline const SgSearchStatistics&
+SgParallelSearch::ThreadStatistics(int threadId) const
+{
+    return m_threadStat[threadId];
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_PARALLELSEARCH_H
@@ -12,6 +12,28 @@
 
 //----------------------------------------------------------------------------
 
+namespace {
+
+/** Seed of SgFastRandom if no seed was set (same as the default seed of
+    boost::mt19937). */
+const uint64_t FAST_RANDOM_DEFAULT_SEED = 5489;
+
+/** SplitMix64, used to derive the states of SgFastRandom from a seed.
+    Recommended by the authors of xoshiro for seeding, because similar seeds
+    give uncorrelated states. */
+uint64_t SplitMix64(uint64_t& x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = x;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
 SgRandom::GlobalData::GlobalData()
 {
     m_seed = 0;
@@ -21,13 +43,17 @@ SgRandom::GlobalData::GlobalData()
 
 SgRandom::SgRandom()
 {
+    GlobalData& data = GetGlobalData();
+    boost::mutex::scoped_lock lock(data.m_mutex);
     SetSeed();
-    GetGlobalData().m_allGenerators.push_back(this);
+    data.m_allGenerators.push_back(this);
 }
 
 SgRandom::~SgRandom()
 {
-    GetGlobalData().m_allGenerators.remove(this);
+    GlobalData& data = GetGlobalData();
+    boost::mutex::scoped_lock lock(data.m_mutex);
+    data.m_allGenerators.remove(this);
 }
 
 SgRandom& SgRandom::Global()
@@ -68,14 +94,109 @@ void SgRandom::SetSeed(int seed)
     else
         GetGlobalData().m_seed = seed;
     SgDebug() << "SgRandom::SetSeed: " << GetGlobalData().m_seed << '\n';
+    boost::mutex::scoped_lock lock(GetGlobalData().m_mutex);
     for_each(GetGlobalData().m_allGenerators.begin(),
              GetGlobalData().m_allGenerators.end(),
              std::mem_fun(&SgRandom::SetSeed));
+    for_each(GetGlobalData().m_allFastGenerators.begin(),
+             GetGlobalData().m_allFastGenerators.end(),
+             std::mem_fun(&SgFastRandom::SetSeed));
     srand(GetGlobalData().m_seed);
 }
 
 //----------------------------------------------------------------------------
 
+SgFastRandom::SgFastRandom(unsigned int stream)
+    : m_stream(stream)
+{
+    SgRandom::GlobalData& data = SgRandom::GetGlobalData();
+    boost::mutex::scoped_lock lock(data.m_mutex);
+    SetSeed();
+    data.m_allFastGenerators.push_back(this);
+}
+
+SgFastRandom::~SgFastRandom()
+{
+    SgRandom::GlobalData& data = SgRandom::GetGlobalData();
+    boost::mutex::scoped_lock lock(data.m_mutex);
+    data.m_allFastGenerators.remove(this);
+}
+
+void SgFastRandom::Fill(unsigned int* values, std::size_t n)
+{
+    // Local copies of the lane states, so that the compiler knows that they
+    // do not alias the values and can keep them in vector registers
+    uint32_t s0[NU_LANES];
+    uint32_t s1[NU_LANES];
+    uint32_t s2[NU_LANES];
+    uint32_t s3[NU_LANES];
+    std::copy(m_laneState[0], m_laneState[0] + NU_LANES, s0);
+    std::copy(m_laneState[1], m_laneState[1] + NU_LANES, s1);
+    std::copy(m_laneState[2], m_laneState[2] + NU_LANES, s2);
+    std::copy(m_laneState[3], m_laneState[3] + NU_LANES, s3);
+    // Numbers of the last block that do not fit into values are discarded
+    uint32_t tail[NU_LANES];
+    for (std::size_t i = 0; i < n; i += NU_LANES)
+    {
+        uint32_t* result = (i + NU_LANES <= n ? values + i : tail);
+        for (int j = 0; j < NU_LANES; ++j)
+        {
+            result[j] = RotateLeft(s0[j] + s3[j], 7) + s0[j];
+            const uint32_t t = s1[j] << 9;
+            s2[j] ^= s0[j];
+            s3[j] ^= s1[j];
+            s1[j] ^= s2[j];
+            s0[j] ^= s3[j];
+            s2[j] ^= t;
+            s3[j] = RotateLeft(s3[j], 11);
+        }
+        if (result == tail)
+            std::copy(tail, tail + (n - i), values + i);
+    }
+    std::copy(s0, s0 + NU_LANES, m_laneState[0]);
+    std::copy(s1, s1 + NU_LANES, m_laneState[1]);
+    std::copy(s2, s2 + NU_LANES, m_laneState[2]);
+    std::copy(s3, s3 + NU_LANES, m_laneState[3]);
+}
+
+void SgFastRandom::Fill(int* values, std::size_t n, int range)
+{
+    SG_ASSERT(range > 0);
+    unsigned int* u = reinterpret_cast<unsigned int*>(values);
+    Fill(u, n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        uint64_t m = static_cast<uint64_t>(u[i]) * static_cast<uint32_t>(range);
+        if (static_cast<uint32_t>(m) < static_cast<uint32_t>(range))
+            values[i] = static_cast<int>(RejectBiased(range, m));
+        else
+            values[i] = static_cast<int>(m >> 32);
+    }
+}
+
+void SgFastRandom::SetSeed()
+{
+    uint64_t seed = SgRandom::GetGlobalData().m_seed;
+    if (seed == 0)
+        seed = FAST_RANDOM_DEFAULT_SEED;
+    uint64_t x = (seed << 32) ^ m_stream;
+    for (int i = 0; i < 4; i += 2)
+    {
+        uint64_t z = SplitMix64(x);
+        m_state[i] = static_cast<uint32_t>(z);
+        m_state[i + 1] = static_cast<uint32_t>(z >> 32);
+    }
+    for (int i = 0; i < 4; i += 2)
+        for (int j = 0; j < NU_LANES; ++j)
+        {
+            uint64_t z = SplitMix64(x);
+            m_laneState[i][j] = static_cast<uint32_t>(z);
+            m_laneState[i + 1][j] = static_cast<uint32_t>(z >> 32);
+        }
+}
+
+//----------------------------------------------------------------------------
+
 float SgRandomFloat(float min, float max)
 {
     return (max - min) * static_cast<float>(std::rand())
@@ -7,10 +7,15 @@
 #define SG_RANDOM_H
 
 #include <algorithm>
+#include <cstddef>
 #include <list>
+#include <stdint.h>
 #include <boost/random/mersenne_twister.hpp>
+#include <boost/thread/mutex.hpp>
 #include "SgArray.h"
 
+class SgFastRandom;
+
 //----------------------------------------------------------------------------
 
 /** Random number generator.
@@ -19,9 +24,14 @@
     high quality ones. All random generators are internally registered to
     make it possible to change the random seed for all of them.
 
-    SgRandom is thread-safe (w.r.t. different instances) after construction
-    (the constructor is not thread-safe, because it uses a global variable
-    for registration). */
+    SgRandom is thread-safe (w.r.t. different instances). The registration
+    in the constructor and destructor is protected by a mutex, SetSeed(int)
+    is not thread-safe.
+
+    The sequence of SgRandom::Global() must stay the same for a given seed,
+    because the Zobrist hash codes (SgHashZobrist) are drawn from it, and
+    opening books store these hash codes. Code that needs many random
+    numbers, like playouts, should use SgFastRandom. */
 class SgRandom
 {
 public:
@@ -91,14 +101,21 @@ public:
     bool RandomEvent(unsigned int threshold);
 
 private:
+    friend class SgFastRandom;
+
     struct GlobalData
     {
         /** The random seed.
             Zero means not to set a random seed. */
         boost::mt19937::result_type m_seed;
 
+        /** Protects the lists of generators. */
+        boost::mutex m_mutex;
+
         std::list<SgRandom*> m_allGenerators;
 
+        std::list<SgFastRandom*> m_allFastGenerators;
+
         GlobalData();
     };
 
@@ -174,6 +191,210 @@ inline std::size_t SgRandom::SmallInt(std::size_t range)
 
 //----------------------------------------------------------------------------
 
+/** Fast random number generator with small state.
+    Uses xoshiro128++ by Blackman and Vigna (16 bytes of state, a few
+    arithmetic instructions per number) instead of the Mersenne Twister of
+    SgRandom (2.5 KB of state). Has the same interface as SgRandom, so that
+    code can switch by changing the type of its generator.
+
+    Each generator is a stream, identified by a number (for example the
+    thread id in SgUctThreadState). The state of a stream is derived from the
+    global seed (see SgRandom::SetSeed(int)) and the stream number, so the
+    random numbers of a thread are deterministic for a given seed,
+    independent of the other threads. Like SgRandom, all generators are
+    registered and reseeded by SgRandom::SetSeed(int). If no seed was set, a
+    fixed default seed is used.
+
+    Bounded integers are unbiased and computed with a multiplication instead
+    of a modulo (Lemire's method, a division is needed only in the rare case
+    of a rejection). Fill() generates many numbers at once with four
+    interleaved generators, which the compiler can vectorize.
+
+    SgFastRandom is thread-safe w.r.t. different instances, the constructor
+    is thread-safe. */
+class SgFastRandom
+{
+public:
+    /** Constructor.
+        @param stream The stream number. Generators with different stream
+        numbers produce different sequences. */
+    explicit SgFastRandom(unsigned int stream = 0);
+
+    ~SgFastRandom();
+
+    unsigned int Stream() const;
+
+    /** Get a random integer. */
+    unsigned int Int();
+
+    /** Get a random integer in an interval.
+        Unbiased for all ranges.
+        @param range The upper limit of the interval (exclusive)
+        @pre range > 0
+        @return An integer in <tt> [0..range - 1]</tt> */
+    int Int(int range);
+
+    /** See SgFastRandom::Int(int) */
+    std::size_t Int(std::size_t range);
+
+    /** Same as Int(int), for compatibility with SgRandom. */
+    int SmallInt(int range);
+
+    /** See SgFastRandom::SmallInt(int) */
+    std::size_t SmallInt(std::size_t range);
+
+    /** Get a random integer in [min, max - 1] */
+    int Range(int min, int max);
+
+    /** Get a random float in [0, 1). */
+    float Float();
+
+    /** Maximum value. */
+    unsigned int Max();
+
+    /** See SgRandom::PercentageThreshold() */
+    unsigned int PercentageThreshold(int percentage);
+
+    /** return true if random number Int() <= threshold */
+    bool RandomEvent(unsigned int threshold);
+
+    /** Fill an array with random integers.
+        Faster than calling Int() for each element if n is large. Uses
+        separate generators, so the numbers differ from those returned by
+        Int(), but are deterministic for a given seed and stream. */
+    void Fill(unsigned int* values, std::size_t n);
+
+    /** Fill an array with random integers in <tt> [0..range - 1]</tt>.
+        @pre range > 0 */
+    void Fill(int* values, std::size_t n, int range);
+
+private:
+    friend class SgRandom;
+
+    /** Number of interleaved generators used by Fill(). */
+    static const int NU_LANES = 4;
+
+    unsigned int m_stream;
+
+    uint32_t m_state[4];
+
+    /** States of the generators used by Fill(), stored by state word, so
+        that the same word of all lanes is updated together. */
+    uint32_t m_laneState[4][NU_LANES];
+
+    /** Seed from the global seed and the stream number. */
+    void SetSeed();
+
+    /** Lemire's method maps x to the upper 32 bits of x * range. This is
+        biased, because some results are produced by one value of x more
+        than others; the extra values are those whose lower 32 bits are
+        smaller than 2^32 mod range. They are rejected and replaced by a new
+        number. Called only if the lower 32 bits are smaller than range, so
+        the modulo is computed only in about range / 2^32 of all calls.
+        See D. Lemire: Fast Random Integer Generation in an Interval, 2019.
+        Inline, because a call would force the state out of the registers. */
+    unsigned int RejectBiased(unsigned int range, uint64_t m);
+
+    static uint32_t RotateLeft(uint32_t x, int k);
+
+    /** Not implemented */
+    SgFastRandom(const SgFastRandom&);
+
+    /** Not implemented */
+    SgFastRandom& operator=(const SgFastRandom&);
+};
+
+inline unsigned int SgFastRandom::Int()
+{
+    uint32_t* s = m_state;
+    const uint32_t result = RotateLeft(s[0] + s[3], 7) + s[0];
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = RotateLeft(s[3], 11);
+    return result;
+}
+
+inline int SgFastRandom::Int(int range)
+{
+    SG_ASSERT(range > 0);
+    uint64_t m = static_cast<uint64_t>(Int()) * static_cast<uint32_t>(range);
+    if (static_cast<uint32_t>(m) < static_cast<uint32_t>(range))
+        return static_cast<int>(RejectBiased(range, m));
+    int i = static_cast<int>(m >> 32);
+    SG_ASSERTRANGE(i, 0, range - 1);
+    return i;
+}
+
+inline std::size_t SgFastRandom::Int(std::size_t range)
+{
+    SG_ASSERT(range > 0);
+    SG_ASSERT(range <= Max());
+    uint64_t m = static_cast<uint64_t>(Int()) * static_cast<uint32_t>(range);
+    if (static_cast<uint32_t>(m) < static_cast<uint32_t>(range))
+        return RejectBiased(static_cast<unsigned int>(range), m);
+    return static_cast<std::size_t>(m >> 32);
+}
+
+inline float SgFastRandom::Float()
+{
+    return static_cast<float>(Int() >> 8) * (1.0f / 16777216.0f);
+}
+
+inline unsigned int SgFastRandom::Max()
+{
+    return 0xffffffffU;
+}
+
+inline unsigned int SgFastRandom::PercentageThreshold(int percentage)
+{
+    return (Max() / 100) * percentage;
+}
+
+inline bool SgFastRandom::RandomEvent(unsigned int threshold)
+{
+    return Int() <= threshold;
+}
+
+inline int SgFastRandom::Range(int min, int max)
+{
+    return min + Int(max - min);
+}
+
+inline unsigned int SgFastRandom::RejectBiased(unsigned int range,
+                                               uint64_t m)
+{
+    const uint32_t threshold = (0U - range) % range;
+    while (static_cast<uint32_t>(m) < threshold)
+        m = static_cast<uint64_t>(Int()) * range;
+    return static_cast<unsigned int>(m >> 32);
+}
+
+inline uint32_t SgFastRandom::RotateLeft(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+inline int SgFastRandom::SmallInt(int range)
+{
+    return Int(range);
+}
+
+inline std::size_t SgFastRandom::SmallInt(std::size_t range)
+{
+    return Int(range);
+}
+
+inline unsigned int SgFastRandom::Stream() const
+{
+    return m_stream;
+}
+
+//----------------------------------------------------------------------------
+
 /** Get a random float in [min, max].
     Used std::rand() */
 float SgRandomFloat(float min, float max);
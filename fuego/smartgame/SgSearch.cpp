@@ -128,11 +128,14 @@ SgSearch::SgSearch(SgSearchHashTable* hash)
     : m_hash(hash),
       m_tracer(0),
       m_currentDepth(0),
+      m_depthLimit(0),
+      m_depthCompleted(0),
       m_useScout(false),
       m_useKillers(false),
       m_useOpponentBest(0),
       m_useNullMove(0),
       m_nullMoveDepth(2),
+      m_rootMoveRotation(0),
       m_aborted(false),
       m_foundNewBest(false),
       m_reachedDepthLimit(false),
@@ -432,6 +435,7 @@ int SgSearch::IteratedSearch(int depthMin, int depthMax, int boundLo,
 
     int value = 0;
     m_depthLimit = depthMin;
+    m_depthCompleted = 0;
     // done in DFS, but that's too late, is tested after StartOfDepth
     m_aborted = false;
 
@@ -481,6 +485,7 @@ int SgSearch::IteratedSearch(int depthMin, int depthMax, int boundLo,
                 PrintPV(*this, m_depthLimit, value, *sequence, isExactValue);
             m_prevValue = value;
             m_prevSequence = *sequence;
+            m_depthCompleted = m_depthLimit;
         }
 
         // Stop iteration as soon as exact result or a bounding value found.
@@ -794,6 +799,13 @@ int SgSearch::SearchEngine(int depth, int alpha, int beta,
         if (! foundCutoff && ! m_aborted)
         {
             CallGenerate(&moves, depth);
+            if (m_rootMoveRotation != 0 && m_currentDepth == 0
+                && moves.Length() > 1)
+            {
+                vector<SgMove>& v = moves.Vector();
+                rotate(v.begin(), v.begin() + m_rootMoveRotation % v.size(),
+                       v.end());
+            }
             // Iterate through all the moves to find the best move and
             // correct value for this position.
             for (SgVectorIterator<SgMove> it(moves); it && ! foundCutoff; ++it)
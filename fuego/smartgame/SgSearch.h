@@ -82,8 +82,6 @@ public:
                      bool isOnlyLowerBound = false,
                      bool isExactValue = false);
 
-    ~SgSearchHashData();
-
     int Depth() const;
 
     int Value() const;
@@ -153,10 +151,6 @@ inline SgSearchHashData::SgSearchHashData(int depth, signed value,
     SG_ASSERT(m_value == value);
 }
 
-inline SgSearchHashData::~SgSearchHashData()
-{
-}
-
 inline int SgSearchHashData::Depth() const
 {
     return static_cast<int> (m_depth);
@@ -330,6 +324,10 @@ public:
         depth that's being searched to. */
     int IteratedSearchDepthLimit() const;
 
+    /** The depth of the last iteration that IteratedSearch completed.
+        0, if no iteration was completed. */
+    int IteratedSearchDepthCompleted() const;
+
     /** Called at start of each depth level of IteratedSearch.
         Can be overridden to adapt search (or instrumentation) to current
         depth. Must call inherited. */
@@ -354,6 +352,13 @@ public:
 
     void SetNullMoveDepth(int depth);
 
+    /** Rotate the moves generated at the root by the given number of
+        positions.
+        Used by SgParallelSearch to start the helper threads with different
+        moves. The move from the hash table is still tried first.
+        Default is 0. */
+    void SetRootMoveRotation(int rotation);
+
     /** Get the current statistics. Can be called during search. */
     void GetStatistics(SgSearchStatistics* stat);
 
@@ -453,6 +458,9 @@ public:
     
     void SetAbortFrequency(int value);
 
+    /** Seed the hash table with the given sequence. */
+    void AddSequenceToHash(const SgVector<SgMove>& sequence, int depth);
+
     /** Core Alpha-beta search. Usually not called directly -
         call DepthFirstSearch or IteratedSearch instead. */
     int SearchEngine(int depth, int alpha, int beta, SgSearchStack& stack,
@@ -470,6 +478,9 @@ private:
 
     int m_depthLimit;
 
+    /** See IteratedSearchDepthCompleted() */
+    int m_depthCompleted;
+
     /** Stack of all moves executed in search. Used by PrevMove() */
     SgVector<SgMove> m_moveStack;
 
@@ -486,6 +497,9 @@ private:
     /** How much less deep to search during null move pruning */
     int m_nullMoveDepth;
 
+    /** See SetRootMoveRotation() */
+    int m_rootMoveRotation;
+
     /** True if search is in the process of being aborted. */
     bool m_aborted;
 
@@ -531,9 +545,6 @@ private:
     void StoreHash(int depth, int value, SgMove move, bool isUpperBound,
                    bool isLowerBound, bool isExact);
 
-    /** Seed the hash table with the given sequence. */
-    void AddSequenceToHash(const SgVector<SgMove>& sequence, int depth);
-
     /** Evaluate current position; possibly write debug output */
     int CallEvaluate(int depth, bool* isExact);
 
@@ -602,6 +613,11 @@ inline int SgSearch::IteratedSearchDepthLimit() const
     return m_depthLimit;
 }
 
+inline int SgSearch::IteratedSearchDepthCompleted() const
+{
+    return m_depthCompleted;
+}
+
 inline int SgSearch::IteratedSearch(int depthMin, int depthMax,
                                     SgVector<SgMove>* sequence, 
                                     bool clearHash,
@@ -656,6 +672,11 @@ inline void SgSearch::SetOpponentBest(bool flag)
     m_useOpponentBest = flag;
 }
 
+inline void SgSearch::SetRootMoveRotation(int rotation)
+{
+    m_rootMoveRotation = rotation;
+}
+
 inline void SgSearch::SetScout(bool flag)
 {
     m_useScout = flag;
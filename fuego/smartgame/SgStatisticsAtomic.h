@@ -0,0 +1,272 @@
+//----------------------------------------------------------------------------
+/** @file SgStatisticsAtomic.h
+    Version of SgStatisticsBase with atomic member variables for statistics
+    that are updated concurrently without locking (see
+    @ref sguctsearchlockfree). Replaces the classes in SgStatisticsVlt.h
+    used in previous versions, which relied on volatile members and on the
+    memory model of the IA-32 and Intel-64 architectures. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_STATISTICSATOMIC_H
+#define SG_STATISTICSATOMIC_H
+
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include "SgException.h"
+
+//----------------------------------------------------------------------------
+
+/** Statistics with atomic count and mean.
+    Add() and Remove() update the count and the mean with compare-and-swap
+    loops, so that concurrent updates of the count are never lost. The count
+    and the mean are still two separate atomic variables, so a reader can see
+    a mean that does not yet contain the last update of the count. This
+    error is small and is intentionally ignored by the lock-free search.
+    The mean is written before the count with release order; Count() and
+    IsDefined() read the count with acquire order, so that the mean is valid,
+    if the count read before is greater zero.
+    @see SgStatisticsAtomic.h SgStatisticsBase */
+template<typename VALUE, typename COUNT>
+class SgStatisticsAtomicBase
+{
+public:
+    SgStatisticsAtomicBase();
+
+    /** Create statistics initialized with values.
+        Note that value must be initialized to 0 if count is 0.
+        Equivalent to creating a statistics and calling @c count times
+        Add(val) */
+    SgStatisticsAtomicBase(VALUE val, COUNT count);
+
+    /** Copy the current values.
+        Not atomic as a whole; only used if no other thread writes to
+        @c statistics. */
+    SgStatisticsAtomicBase(const SgStatisticsAtomicBase& statistics);
+
+    /** See copy constructor. */
+    SgStatisticsAtomicBase& operator=(const SgStatisticsAtomicBase&
+                                      statistics);
+
+    void Add(VALUE val);
+
+    void Remove(VALUE val);
+
+    /** Add a value n times */
+    void Add(VALUE val, COUNT n);
+
+    /** Remove a value n times. */
+    void Remove(VALUE val, COUNT n);
+
+    void Clear();
+
+    COUNT Count() const;
+
+    /** Initialize with values.
+        Equivalent to calling Clear() and calling @c count times
+        Add(val) */
+    void Initialize(VALUE val, COUNT count);
+
+    /** Check if the mean value is defined.
+        The mean value is defined, if the count if greater than zero. The
+        result of this function is equivalent to <tt>Count() > 0</tt>, for
+        integer count types and <tt>Count() > epsilon()</tt> for floating
+        point count types. */
+    bool IsDefined() const;
+
+    VALUE Mean() const;
+
+    /** Write in human readable format. */
+    void Write(std::ostream& out) const;
+
+    /** Save in a compact platform-independent text format.
+        The data is written in a single line, without trailing newline. */
+    void SaveAsText(std::ostream& out) const;
+
+    /** Load from text format.
+        See SaveAsText() */
+    void LoadFromText(std::istream& in);
+
+private:
+    std::atomic<COUNT> m_count;
+
+    std::atomic<VALUE> m_mean;
+
+    /** Add a value with a weight to the mean with a compare-and-swap loop.
+        @param val The value
+        @param weight The number of times the value is added (negative for
+        removing)
+        @param count The count including the update */
+    void AddToMean(VALUE val, VALUE weight, COUNT count);
+
+    static bool IsPositive(COUNT count);
+};
+
+template<typename VALUE, typename COUNT>
+inline SgStatisticsAtomicBase<VALUE,COUNT>::SgStatisticsAtomicBase()
+    : m_count(0),
+      m_mean(0)
+{
+}
+
+template<typename VALUE, typename COUNT>
+inline SgStatisticsAtomicBase<VALUE,COUNT>::SgStatisticsAtomicBase(VALUE val,
+                                                                  COUNT count)
+    : m_count(count),
+      m_mean(val)
+{
+}
+
+template<typename VALUE, typename COUNT>
+inline SgStatisticsAtomicBase<VALUE,COUNT>::SgStatisticsAtomicBase(
+                               const SgStatisticsAtomicBase& statistics)
+    : m_count(statistics.m_count.load(std::memory_order_acquire)),
+      m_mean(statistics.m_mean.load(std::memory_order_relaxed))
+{
+}
+
+template<typename VALUE, typename COUNT>
+inline SgStatisticsAtomicBase<VALUE,COUNT>&
+SgStatisticsAtomicBase<VALUE,COUNT>::operator=(
+                                   const SgStatisticsAtomicBase& statistics)
+{
+    COUNT count = statistics.m_count.load(std::memory_order_acquire);
+    m_mean.store(statistics.m_mean.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+    m_count.store(count, std::memory_order_release);
+    return *this;
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::AddToMean(VALUE val, VALUE weight,
+                                                    COUNT count)
+{
+    VALUE mean = m_mean.load(std::memory_order_relaxed);
+    VALUE newMean;
+    do
+        newMean = mean + weight * (val - mean) / VALUE(count);
+    while (! m_mean.compare_exchange_weak(mean, newMean,
+                                          std::memory_order_relaxed));
+}
+
+template<typename VALUE, typename COUNT>
+inline void SgStatisticsAtomicBase<VALUE,COUNT>::Add(VALUE val)
+{
+    Add(val, 1);
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::Add(VALUE val, COUNT n)
+{
+    // Write order dependency: SgUctSearch in lock-free mode assumes that
+    // m_mean is valid, if m_count is greater zero. The mean is updated with
+    // the weight of the count read before, then the count is incremented
+    // with release order.
+    COUNT count = m_count.load(std::memory_order_relaxed);
+    SG_ASSERT(! std::numeric_limits<COUNT>::is_exact
+              || count + n > 0); // overflow
+    AddToMean(val, VALUE(n), count + n);
+    while (! m_count.compare_exchange_weak(count, count + n,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+        ;
+}
+
+template<typename VALUE, typename COUNT>
+inline void SgStatisticsAtomicBase<VALUE,COUNT>::Remove(VALUE val)
+{
+    Remove(val, 1);
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::Remove(VALUE val, COUNT n)
+{
+    COUNT count = m_count.load(std::memory_order_relaxed);
+    do
+    {
+        if (count <= n)
+        {
+            Clear();
+            return;
+        }
+    }
+    while (! m_count.compare_exchange_weak(count, count - n,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+    // Removing a value is the inverse of adding it with a negative weight:
+    // mean' = mean + n * (mean - val) / (count - n)
+    AddToMean(val, -VALUE(n), count - n);
+}
+
+template<typename VALUE, typename COUNT>
+inline void SgStatisticsAtomicBase<VALUE,COUNT>::Clear()
+{
+    m_count.store(0, std::memory_order_relaxed);
+    m_mean.store(0, std::memory_order_relaxed);
+}
+
+template<typename VALUE, typename COUNT>
+inline COUNT SgStatisticsAtomicBase<VALUE,COUNT>::Count() const
+{
+    return m_count.load(std::memory_order_acquire);
+}
+
+template<typename VALUE, typename COUNT>
+inline void SgStatisticsAtomicBase<VALUE,COUNT>::Initialize(VALUE val,
+                                                            COUNT count)
+{
+    SG_ASSERT(count > 0);
+    m_mean.store(val, std::memory_order_relaxed);
+    m_count.store(count, std::memory_order_release);
+}
+
+template<typename VALUE, typename COUNT>
+inline bool SgStatisticsAtomicBase<VALUE,COUNT>::IsDefined() const
+{
+    return IsPositive(m_count.load(std::memory_order_acquire));
+}
+
+template<typename VALUE, typename COUNT>
+inline bool SgStatisticsAtomicBase<VALUE,COUNT>::IsPositive(COUNT count)
+{
+    if (std::numeric_limits<COUNT>::is_exact)
+        return count > 0;
+    else
+        return count > std::numeric_limits<COUNT>::epsilon();
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::LoadFromText(std::istream& in)
+{
+    COUNT count;
+    VALUE mean;
+    in >> count >> mean;
+    m_mean.store(mean, std::memory_order_relaxed);
+    m_count.store(count, std::memory_order_release);
+}
+
+template<typename VALUE, typename COUNT>
+inline VALUE SgStatisticsAtomicBase<VALUE,COUNT>::Mean() const
+{
+    SG_ASSERT(IsDefined());
+    return m_mean.load(std::memory_order_relaxed);
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::Write(std::ostream& out) const
+{
+    if (IsDefined())
+        out << Mean();
+    else
+        out << '-';
+}
+
+template<typename VALUE, typename COUNT>
+void SgStatisticsAtomicBase<VALUE,COUNT>::SaveAsText(std::ostream& out) const
+{
+    out << Count() << ' ' << m_mean.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_STATISTICSATOMIC_H
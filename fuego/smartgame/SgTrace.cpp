@@ -0,0 +1,315 @@
+//----------------------------------------------------------------------------
+/** @file SgTrace.cpp
+    See SgTrace.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/** A recorded zone.
+    The members are atomic, because SgTraceWriteChrome() may read a slot
+    while the owning thread overwrites it. */
+struct Event
+{
+    atomic<const char*> m_name;
+
+    atomic<long long> m_start;
+
+    atomic<long long> m_duration;
+};
+
+/** Ring buffer with the zones of a thread.
+    Only the owning thread writes the events and the counters. A zone is
+    written in three steps: m_nuStarted is incremented, the slot is written,
+    m_nuWritten is incremented. A reader that copied slots between reading
+    m_nuWritten and m_nuStarted knows which of them could have been
+    overwritten in between. */
+struct ThreadBuffer
+{
+    /** Id of the thread in the trace. Protected by g_mutex. */
+    int m_id;
+
+    /** Protected by g_mutex. */
+    string m_name;
+
+    /** False after the owning thread finished; the buffer is then reused by
+        the next new thread. Protected by g_mutex. */
+    bool m_isUsed;
+
+    /** Number of the first zone that is exported. Zones before were
+        cleared or belong to a previous thread. Protected by g_mutex. */
+    unsigned long long m_first;
+
+    atomic<unsigned long long> m_nuStarted;
+
+    atomic<unsigned long long> m_nuWritten;
+
+    Event m_events[SG_TRACE_BUFFER_SIZE];
+
+    ThreadBuffer();
+};
+
+ThreadBuffer::ThreadBuffer()
+    : m_id(0),
+      m_isUsed(false),
+      m_first(0),
+      m_nuStarted(0),
+      m_nuWritten(0)
+{ }
+
+/** Copy of a zone for writing the trace. */
+struct EventCopy
+{
+    int m_thread;
+
+    const char* m_name;
+
+    long long m_start;
+
+    long long m_duration;
+};
+
+const Clock::time_point g_epoch = Clock::now();
+
+atomic<bool> g_enabled(true);
+
+/** Protects g_buffers, g_nextId and the members of the buffers that are
+    marked as protected. */
+boost::mutex g_mutex;
+
+/** All buffers ever created. They are never deleted, so that the zones of
+    finished threads can still be written. */
+vector<ThreadBuffer*> g_buffers;
+
+int g_nextId = 1;
+
+void ReleaseBuffer(ThreadBuffer* buffer)
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+    buffer->m_isUsed = false;
+}
+
+/** Buffer of the current thread.
+    The cleanup function only marks the buffer as unused, it is not
+    deleted. */
+boost::thread_specific_ptr<ThreadBuffer> g_threadBuffer(ReleaseBuffer);
+
+ThreadBuffer* AcquireBuffer()
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+    ThreadBuffer* buffer = 0;
+    for (vector<ThreadBuffer*>::const_iterator it = g_buffers.begin();
+         it != g_buffers.end(); ++it)
+        if (! (*it)->m_isUsed)
+        {
+            buffer = *it;
+            break;
+        }
+    if (buffer == 0)
+    {
+        buffer = new ThreadBuffer();
+        g_buffers.push_back(buffer);
+    }
+    buffer->m_isUsed = true;
+    buffer->m_id = g_nextId++;
+    buffer->m_name.clear();
+    buffer->m_first = buffer->m_nuStarted.load(memory_order_relaxed);
+    return buffer;
+}
+
+ThreadBuffer& GetBuffer()
+{
+    ThreadBuffer* buffer = g_threadBuffer.get();
+    if (buffer == 0)
+    {
+        buffer = AcquireBuffer();
+        g_threadBuffer.reset(buffer);
+    }
+    return *buffer;
+}
+
+/** Time in nanoseconds since the start of the program. */
+long long Now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now()
+                                                      - g_epoch).count();
+}
+
+/** Copy the zones of a buffer that were not overwritten during the copy.
+    Requires a lock on g_mutex. */
+void CopyEvents(const ThreadBuffer& buffer, vector<EventCopy>& events)
+{
+    const unsigned long long size = SG_TRACE_BUFFER_SIZE;
+    unsigned long long end = buffer.m_nuWritten.load(memory_order_acquire);
+    unsigned long long begin = max(buffer.m_first, end > size ? end - size
+                                                              : 0);
+    size_t oldSize = events.size();
+    for (unsigned long long i = begin; i < end; ++i)
+    {
+        const Event& event = buffer.m_events[i % size];
+        EventCopy copy;
+        copy.m_thread = buffer.m_id;
+        copy.m_name = event.m_name.load(memory_order_relaxed);
+        copy.m_start = event.m_start.load(memory_order_relaxed);
+        copy.m_duration = event.m_duration.load(memory_order_relaxed);
+        events.push_back(copy);
+    }
+    // Zone i was possibly overwritten if zone i + size was started
+    atomic_thread_fence(memory_order_acquire);
+    unsigned long long started = buffer.m_nuStarted.load(memory_order_relaxed);
+    if (started > begin + size)
+    {
+        size_t nuOverwritten =
+            static_cast<size_t>(min(started - size, end) - begin);
+        events.erase(events.begin() + oldSize,
+                     events.begin() + oldSize + nuOverwritten);
+    }
+}
+
+void WriteString(ostream& out, const string& s)
+{
+    out << '"';
+    for (string::const_iterator it = s.begin(); it != s.end(); ++it)
+    {
+        unsigned char c = static_cast<unsigned char>(*it);
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c < 0x20)
+            out << "\\u00" << hex << setw(2) << setfill('0')
+                << static_cast<int>(c) << dec << setfill(' ');
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+/** Write nanoseconds as microseconds, the time unit of the trace format. */
+void WriteMicroseconds(ostream& out, long long nanoseconds)
+{
+    out << nanoseconds / 1000 << '.' << setw(3) << setfill('0')
+        << nanoseconds % 1000 << setfill(' ');
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+SgTraceZone::SgTraceZone(const char* name)
+    : m_name(g_enabled.load(memory_order_relaxed) ? name : 0),
+      m_start(m_name == 0 ? 0 : Now())
+{ }
+
+SgTraceZone::~SgTraceZone()
+{
+    if (m_name == 0)
+        return;
+    long long end = Now();
+    ThreadBuffer& buffer = GetBuffer();
+    unsigned long long n = buffer.m_nuWritten.load(memory_order_relaxed);
+    buffer.m_nuStarted.store(n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    Event& event = buffer.m_events[n % SG_TRACE_BUFFER_SIZE];
+    event.m_name.store(m_name, memory_order_relaxed);
+    event.m_start.store(m_start, memory_order_relaxed);
+    event.m_duration.store(end - m_start, memory_order_relaxed);
+    buffer.m_nuWritten.store(n + 1, memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+
+void SgTraceClear()
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+    for (vector<ThreadBuffer*>::const_iterator it = g_buffers.begin();
+         it != g_buffers.end(); ++it)
+        (*it)->m_first = (*it)->m_nuStarted.load(memory_order_relaxed);
+}
+
+bool SgTraceIsEnabled()
+{
+    return g_enabled.load(memory_order_relaxed);
+}
+
+void SgTraceSetEnabled(bool enable)
+{
+    g_enabled.store(enable, memory_order_relaxed);
+}
+
+void SgTraceSetThreadName(const string& name)
+{
+    ThreadBuffer& buffer = GetBuffer();
+    boost::mutex::scoped_lock lock(g_mutex);
+    buffer.m_name = name;
+}
+
+void SgTraceWriteChrome(ostream& out)
+{
+    vector<EventCopy> events;
+    vector<pair<int, string> > threadNames;
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+        for (vector<ThreadBuffer*>::const_iterator it = g_buffers.begin();
+             it != g_buffers.end(); ++it)
+        {
+            CopyEvents(**it, events);
+            if (! (*it)->m_name.empty())
+                threadNames.push_back(make_pair((*it)->m_id, (*it)->m_name));
+        }
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool isFirst = true;
+    for (vector<pair<int, string> >::const_iterator it = threadNames.begin();
+         it != threadNames.end(); ++it)
+    {
+        out << (isFirst ? "\n" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << it->first << ",\"args\":{\"name\":";
+        WriteString(out, it->second);
+        out << "}}";
+        isFirst = false;
+    }
+    for (vector<EventCopy>::const_iterator it = events.begin();
+         it != events.end(); ++it)
+    {
+        out << (isFirst ? "\n" : ",\n") << "{\"name\":";
+        WriteString(out, it->m_name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << it->m_thread
+            << ",\"ts\":";
+        WriteMicroseconds(out, it->m_start);
+        out << ",\"dur\":";
+        WriteMicroseconds(out, it->m_duration);
+        out << '}';
+        isFirst = false;
+    }
+    out << "\n]}\n";
+}
+
+bool SgTraceWriteChromeFile(const string& fileName)
+{
+    ofstream out(fileName.c_str());
+    if (! out)
+        return false;
+    SgTraceWriteChrome(out);
+    out.close();
+    return ! out.fail();
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------
+/** @file SgTrace.h
+    Low-overhead timing of scoped code zones with export to the Chrome trace
+    event format.
+
+    A zone is the lifetime of a local object created with SG_TRACE_ZONE:
+@code
+    bool Scanner::readCameraFrame(Mat& frame)
+    {
+        SG_TRACE_ZONE("readCameraFrame");
+        ...
+    }
+@endcode
+    When the zone ends, its name, start time and duration are written to a
+    ring buffer of the current thread. No lock is taken and no memory is
+    allocated (apart from the buffer at the first zone of a thread), so zones
+    can be placed in per-frame code. Each thread keeps its last
+    SG_TRACE_BUFFER_SIZE zones.
+
+    SgTraceWriteChrome() writes the zones of all threads in the JSON format
+    of the Chrome trace viewer (chrome://tracing, or ui.perfetto.dev) at any
+    time, while the other threads keep recording.
+
+    SG_TRACE_ZONE expands to nothing unless SG_TRACE is defined, the functions
+    can be called in both cases (the trace is empty without SG_TRACE). */
+//----------------------------------------------------------------------------
+
+#ifndef SG_TRACE_H
+#define SG_TRACE_H
+
+#include <iosfwd>
+#include <string>
+
+//----------------------------------------------------------------------------
+
+/** Number of zones kept per thread. */
+const int SG_TRACE_BUFFER_SIZE = 4096;
+
+/** Records the lifetime of the object as a zone.
+    Use the macro SG_TRACE_ZONE instead of creating objects of this class. */
+class SgTraceZone
+{
+public:
+    /** Constructor.
+        @param name Name of the zone. Only the pointer is stored, so it must
+        be a string literal or live until the trace was written. */
+    explicit SgTraceZone(const char* name);
+
+    ~SgTraceZone();
+
+private:
+    /** Null if tracing was disabled when the zone started. */
+    const char* m_name;
+
+    /** Start time in nanoseconds since the start of the trace clock. */
+    long long m_start;
+
+    /** Not implemented */
+    SgTraceZone(const SgTraceZone&);
+
+    /** Not implemented */
+    SgTraceZone& operator=(const SgTraceZone&);
+};
+
+#define SG_TRACE_CONCAT2(x, y) x ## y
+#define SG_TRACE_CONCAT(x, y) SG_TRACE_CONCAT2(x, y)
+
+#ifdef SG_TRACE
+/** Record the rest of the enclosing scope as a zone with the given name. */
+#define SG_TRACE_ZONE(name) \
+    SgTraceZone SG_TRACE_CONCAT(sgTraceZone, __LINE__)(name)
+#else
+#define SG_TRACE_ZONE(name) static_cast<void>(0)
+#endif
+
+//----------------------------------------------------------------------------
+
+/** Enable or disable recording of zones at runtime.
+    Enabled by default. Disabled zones cost one relaxed atomic load. */
+void SgTraceSetEnabled(bool enable);
+
+bool SgTraceIsEnabled();
+
+/** Name of the current thread in the exported trace.
+    Threads without a name are shown with their trace thread id. */
+void SgTraceSetThreadName(const std::string& name);
+
+/** Discard all recorded zones. */
+void SgTraceClear();
+
+/** Write the recorded zones of all threads in the Chrome trace event format.
+    Zones that are overwritten by their thread while the trace is written
+    are left out. */
+void SgTraceWriteChrome(std::ostream& out);
+
+/** Write the trace to a file.
+    @return false if the file could not be written. */
+bool SgTraceWriteChromeFile(const std::string& fileName);
+
+//----------------------------------------------------------------------------
+
+#endif // SG_TRACE_H
@@ -0,0 +1,99 @@
+//----------------------------------------------------------------------------
+/** @file SgUctBatchEvaluator.cpp
+    See SgUctBatchEvaluator.h */
+//----------------------------------------------------------------------------
+
+#include "SgSystem.h"
+#include "SgUctBatchEvaluator.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+
+SgUctEvaluationRequest::SgUctEvaluationRequest()
+    : m_state(0),
+      m_sequence(0),
+      m_node(0),
+      m_value(0),
+      m_hasPriors(false),
+      m_isEvaluated(false)
+{
+}
+
+//----------------------------------------------------------------------------
+
+SgUctBatchEvaluator::~SgUctBatchEvaluator()
+{
+}
+
+//----------------------------------------------------------------------------
+
+SgUctBatchQueue::SgUctBatchQueue()
+    : m_evaluator(0),
+      m_batchSize(1),
+      m_maxLatency(0.001),
+      m_nuBatches(0),
+      m_nuRequests(0)
+{
+}
+
+void SgUctBatchQueue::ClearStatistics()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_nuBatches = 0;
+    m_nuRequests = 0;
+}
+
+void SgUctBatchQueue::Evaluate(SgUctEvaluationRequest& request)
+{
+    SG_ASSERT(m_evaluator != 0);
+    boost::mutex::scoped_lock lock(m_mutex);
+    request.m_isEvaluated = false;
+    if (m_pending.empty())
+        m_deadline = boost::get_system_time()
+            + boost::posix_time::microseconds(
+                               static_cast<long>(m_maxLatency * 1e6));
+    m_pending.push_back(&request);
+    if (m_pending.size() >= m_batchSize)
+    {
+        EvaluatePending(lock);
+        return;
+    }
+    while (! request.m_isEvaluated)
+    {
+        // If the waiting time of the current batch is over, evaluate it,
+        // even if the own request is already evaluated by another thread
+        if (! m_pending.empty() && boost::get_system_time() >= m_deadline)
+            EvaluatePending(lock);
+        else if (m_pending.empty())
+            m_evaluated.wait(lock);
+        else
+            m_evaluated.timed_wait(lock, m_deadline);
+    }
+}
+
+void SgUctBatchQueue::EvaluatePending(boost::mutex::scoped_lock& lock)
+{
+    vector<SgUctEvaluationRequest*> batch;
+    batch.swap(m_pending);
+    lock.unlock();
+    {
+        boost::mutex::scoped_lock evaluatorLock(m_evaluatorMutex);
+        m_evaluator->Evaluate(batch);
+    }
+    lock.lock();
+    for (vector<SgUctEvaluationRequest*>::const_iterator it = batch.begin();
+         it != batch.end(); ++it)
+        (*it)->m_isEvaluated = true;
+    ++m_nuBatches;
+    m_nuRequests += batch.size();
+    m_evaluated.notify_all();
+}
+
+void SgUctBatchQueue::SetBatchSize(size_t size)
+{
+    SG_ASSERT(size > 0);
+    m_batchSize = size;
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,198 @@
+//----------------------------------------------------------------------------
+/** @file SgUctBatchEvaluator.h
+    Evaluation of the leaves of SgUctSearch in batches. */
+//----------------------------------------------------------------------------
+
+#ifndef SG_UCTBATCHEVALUATOR_H
+#define SG_UCTBATCHEVALUATOR_H
+
+#include <cstddef>
+#include <vector>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "SgMove.h"
+#include "SgUctTree.h"
+
+class SgUctThreadState;
+
+//----------------------------------------------------------------------------
+
+/** Request for the evaluation of a leaf of the search tree.
+    See SgUctBatchEvaluator.
+    @ingroup sguctgroup */
+struct SgUctEvaluationRequest
+{
+    /** The thread state of the search thread.
+        The state is in the position of the leaf while the request is
+        evaluated, because the search thread waits for the result. */
+    const SgUctThreadState* m_state;
+
+    /** The moves from the root to the leaf. */
+    const std::vector<SgMove>* m_sequence;
+
+    /** The leaf. */
+    const SgUctNode* m_node;
+
+    /** The children of the node that was expanded in this game.
+        The expanded node is the father of the leaf. Empty if no node was
+        expanded. Only the moves are set; the evaluator can set prior values
+        and counts (and RAVE values and counts) for the children, with the
+        same convention as SgUctThreadState::GenerateAllMoves(). The priors
+        are added to the children before the result of the game is backed
+        up. */
+    std::vector<SgUctMoveInfo> m_children;
+
+    /** Result: the value of the position for the player to move.
+        Same convention as SgUctThreadState::Evaluate(). */
+    SgUctValue m_value;
+
+    /** Result: the evaluator set priors in m_children. */
+    bool m_hasPriors;
+
+    /** Set by SgUctBatchQueue, when the request is evaluated. */
+    bool m_isEvaluated;
+
+    SgUctEvaluationRequest();
+};
+
+//----------------------------------------------------------------------------
+
+/** Evaluator for the leaves of SgUctSearch, which is more efficient if it
+    gets several positions at once.
+    For example a pattern or linear evaluator, or an evaluator in another
+    process. If an evaluator is set with SgUctSearch::SetBatchEvaluator(),
+    the search evaluates the leaves of the in-tree phase with it instead of
+    playing playouts. Evaluate() is called by one of the search threads, but
+    never concurrently.
+    @ingroup sguctgroup */
+class SgUctBatchEvaluator
+{
+public:
+    virtual ~SgUctBatchEvaluator();
+
+    /** Evaluate a batch of requests.
+        Must set SgUctEvaluationRequest::m_value of each request; can set
+        the priors of the children. */
+    virtual void Evaluate(const std::vector<SgUctEvaluationRequest*>&
+                          requests) = 0;
+};
+
+//----------------------------------------------------------------------------
+
+/** Collects the evaluation requests of the search threads into batches.
+    A batch is evaluated when it has BatchSize() requests or when its first
+    request has waited for MaxLatency() seconds. The batch is evaluated by
+    the thread that completes it (or whose waiting time runs out), the other
+    threads wait until their request is evaluated. While a batch is
+    evaluated, the next batch is already collected.
+    @ingroup sguctgroup */
+class SgUctBatchQueue
+{
+public:
+    SgUctBatchQueue();
+
+    /** The evaluator (not owned). */
+    SgUctBatchEvaluator* Evaluator() const;
+
+    /** See Evaluator() */
+    void SetEvaluator(SgUctBatchEvaluator* evaluator);
+
+    std::size_t BatchSize() const;
+
+    void SetBatchSize(std::size_t size);
+
+    /** Maximum time in seconds the first request of a batch waits for the
+        batch to become full. */
+    double MaxLatency() const;
+
+    /** See MaxLatency() */
+    void SetMaxLatency(double seconds);
+
+    /** Add a request to the current batch and wait until it is evaluated.
+        Requires: Evaluator() != 0 */
+    void Evaluate(SgUctEvaluationRequest& request);
+
+    /** Number of evaluated batches since the last ClearStatistics(). */
+    std::size_t NuBatches() const;
+
+    /** Number of evaluated requests since the last ClearStatistics(). */
+    std::size_t NuRequests() const;
+
+    void ClearStatistics();
+
+private:
+    SgUctBatchEvaluator* m_evaluator;
+
+    std::size_t m_batchSize;
+
+    double m_maxLatency;
+
+    std::size_t m_nuBatches;
+
+    std::size_t m_nuRequests;
+
+    /** The requests of the batch that is currently collected. */
+    std::vector<SgUctEvaluationRequest*> m_pending;
+
+    /** Time, at which the batch that is currently collected is evaluated,
+        if it is not full before. */
+    boost::system_time m_deadline;
+
+    /** Protects all members except m_evaluator. */
+    boost::mutex m_mutex;
+
+    /** Serializes the calls of SgUctBatchEvaluator::Evaluate(). */
+    boost::mutex m_evaluatorMutex;
+
+    boost::condition m_evaluated;
+
+    /** Evaluate the pending requests.
+        @param lock A lock of m_mutex; unlocked during the evaluation. */
+    void EvaluatePending(boost::mutex::scoped_lock& lock);
+
+    /** Not implemented. */
+    SgUctBatchQueue(const SgUctBatchQueue&);
+
+    /** Not implemented. */
+    SgUctBatchQueue& operator=(const SgUctBatchQueue&);
+};
+
+inline std::size_t SgUctBatchQueue::BatchSize() const
+{
+    return m_batchSize;
+}
+
+inline SgUctBatchEvaluator* SgUctBatchQueue::Evaluator() const
+{
+    return m_evaluator;
+}
+
+inline double SgUctBatchQueue::MaxLatency() const
+{
+    return m_maxLatency;
+}
+
+inline std::size_t SgUctBatchQueue::NuBatches() const
+{
+    return m_nuBatches;
+}
+
+inline std::size_t SgUctBatchQueue::NuRequests() const
+{
+    return m_nuRequests;
+}
+
+inline void SgUctBatchQueue::SetEvaluator(SgUctBatchEvaluator* evaluator)
+{
+    m_evaluator = evaluator;
+}
+
+inline void SgUctBatchQueue::SetMaxLatency(double seconds)
+{
+    m_maxLatency = seconds;
+}
+
+//----------------------------------------------------------------------------
+
+#endif // SG_UCTBATCHEVALUATOR_H
@@ -18,7 +18,6 @@
 #include "SgWrite.h"
 
 using namespace std;
-using boost::barrier;
 using boost::condition;
 using boost::format;
 using boost::mutex;
@@ -34,6 +33,11 @@ namespace {
 
 const bool DEBUG_THREADS = false;
 
+/** Number of times an idle thread checks for new work before it blocks.
+    Searches that are started during this time start without any system
+    call. */
+const int POOL_SPIN_COUNT = 2000;
+
 /** Get a default value for lock-free mode.
     Lock-free mode works only on IA-32/Intel-64 architectures or if the macro
     ENABLE_CACHE_SYNC from Fuego's configure script is defined. The
@@ -80,6 +84,8 @@ size_t GetMaxNodesDefault()
 
 void Notify(mutex& aMutex, condition& aCondition)
 {
+    // Locking the mutex ensures that a thread that checked its wait
+    // condition, but is not yet waiting, does not miss the notification
     mutex::scoped_lock lock(aMutex);
     aCondition.notify_all();
 }
@@ -111,7 +117,8 @@ void SgUctGameInfo::Clear(std::size_t numberPlayouts)
 SgUctThreadState::SgUctThreadState(unsigned int threadId, int moveRange)
     : m_threadId(threadId),
       m_isSearchInitialized(false),
-      m_isTreeOutOfMem(false)
+      m_isTreeOutOfMem(false),
+      m_expandedNode(0)
 {
     if (moveRange > 0)
     {
@@ -166,23 +173,18 @@ SgUctSearch::Thread::Thread(SgUctSearch& search,
                             auto_ptr<SgUctThreadState> state)
     : m_state(state),
       m_search(search),
-      m_quit(false),
-      m_threadReady(2),
-      m_playFinishedLock(m_playFinishedMutex),
 #if BOOST_VERSION_MAJOR == 1 && BOOST_VERSION_MINOR <= 34
       m_globalLock(search.m_globalMutex, false),
 #else
       m_globalLock(search.m_globalMutex, boost::defer_lock),
 #endif
+      m_generation(search.m_playGeneration.load()),
       m_thread(Function(*this))
 {
-    m_threadReady.wait();
 }
 
 SgUctSearch::Thread::~Thread()
 {
-    m_quit = true;
-    StartPlay();
     m_thread.join();
 }
 
@@ -191,31 +193,19 @@ void SgUctSearch::Thread::operator()()
     if (DEBUG_THREADS)
         SgDebug() << "SgUctSearch::Thread: starting thread "
                   << m_state->m_threadId << '\n';
-    mutex::scoped_lock lock(m_startPlayMutex);
-    m_threadReady.wait();
     while (true)
     {
-        m_startPlay.wait(lock);
-        if (m_quit)
+        m_generation = m_search.WaitForPlay(m_generation);
+        if (m_search.m_quitThreads.load(std::memory_order_acquire))
             break;
         m_search.SearchLoop(*m_state, &m_globalLock);
-        Notify(m_playFinishedMutex, m_playFinished);
+        m_search.FinishPlay();
     }
     if (DEBUG_THREADS)
         SgDebug() << "SgUctSearch::Thread: finishing thread "
                   << m_state->m_threadId << '\n';
 }
 
-void SgUctSearch::Thread::StartPlay()
-{
-    Notify(m_startPlayMutex, m_startPlay);
-}
-
-void SgUctSearch::Thread::WaitPlayFinished()
-{
-    m_playFinished.wait(m_playFinishedLock);
-}
-
 //----------------------------------------------------------------------------
 
 void SgUctSearchStat::Clear()
@@ -252,6 +242,14 @@ SgUctSearch::SgUctSearch(SgUctThreadStateFactory* threadStateFactory,
       m_logGames(false),
       m_rave(false),
       m_knowledgeThreshold(),
+      m_aborted(false),
+      m_isTreeOutOfMemory(false),
+      m_playGeneration(0),
+      m_threadsPlaying(0),
+      m_threadsInGameLoop(0),
+      m_sleepingThreads(0),
+      m_isWaitingForPlay(false),
+      m_quitThreads(false),
       m_moveSelect(SG_UCTMOVESELECT_COUNT),
       m_raveCheckSame(false),
       m_randomizeRaveFrequency(20),
@@ -263,6 +261,7 @@ SgUctSearch::SgUctSearch(SgUctThreadStateFactory* threadStateFactory,
       m_numberPlayouts(1),
       m_maxNodes(GetMaxNodesDefault()),
       m_pruneMinCount(16),
+      m_pruneHighWaterMark(0.95),
       m_moveRange(moveRange),
       m_maxGameLength(numeric_limits<size_t>::max()),
       m_expandThreshold(numeric_limits<SgUctValue>::is_integer ? (SgUctValue)1 : numeric_limits<SgUctValue>::epsilon()),
@@ -271,6 +270,7 @@ SgUctSearch::SgUctSearch(SgUctThreadStateFactory* threadStateFactory,
       m_raveWeightInitial(0.9f),
       m_raveWeightFinal(20000),
       m_virtualLoss(false),
+      m_batchSize(16),
       m_logFileName("uctsearch.log"),
       m_fastLog(10),
       m_mpiSynchronizer(SgMpiNullSynchronizer::Create())
@@ -338,9 +338,11 @@ bool SgUctSearch::CheckAbortSearch(SgUctThreadState& state)
         m_wasEarlyAbort = true;
         return true;
     }
-    if (m_numberGames >= m_nextCheckTime)
+    const size_t numberGames = m_numberGames.load(memory_order_relaxed);
+    if (numberGames >= m_nextCheckTime.load(memory_order_relaxed))
     {
-        m_nextCheckTime = m_numberGames + m_checkTimeInterval;
+        m_nextCheckTime.store(numberGames + m_checkTimeInterval,
+                              memory_order_relaxed);
         double time = m_timer.GetTime();
         if (time > m_maxTime)
         {
@@ -423,8 +425,6 @@ void SgUctSearch::CreateThreads()
     }
     m_tree.CreateAllocators(m_numberThreads);
     m_tree.SetMaxNodes(m_maxNodes);
-
-    m_searchLoopFinished.reset(new barrier(m_numberThreads));
 }
 
 /** Write a debugging line of text from within a thread.
@@ -448,25 +448,121 @@ void SgUctSearch::Debug(const SgUctThreadState& state,
 
 void SgUctSearch::DeleteThreads()
 {
+    if (m_threads.empty())
+        return;
+    m_quitThreads.store(true);
+    StartPlay();
     m_threads.clear();
+    m_quitThreads.store(false);
+}
+
+/** Evaluate the leaf of the in-tree phase with the batch evaluator.
+    Replaces the playout phase of PlayGame(), if BatchEvaluator() is set.
+    All playouts of the game get the value of the leaf.
+    @param state
+    @param abort The in-tree phase was aborted
+    @param isTerminal The leaf is a terminal position; it is evaluated with
+    SgUctThreadState::Evaluate() */
+void SgUctSearch::EvaluateInBatch(SgUctThreadState& state, bool abort,
+                                  bool isTerminal)
+{
+    SgUctGameInfo& info = state.m_gameInfo;
+    const size_t nuMovesInTree = info.m_inTreeSequence.size();
+    SgUctValue eval;
+    if (abort)
+        eval = UnknownEval();
+    else if (isTerminal)
+        eval = state.Evaluate();
+    else
+    {
+        SgUctEvaluationRequest& request = state.m_evaluationRequest;
+        request.m_state = &state;
+        request.m_sequence = &info.m_inTreeSequence;
+        request.m_node = info.m_nodes.back();
+        request.m_children.clear();
+        request.m_hasPriors = false;
+        const SgUctNode* expandedNode = state.m_expandedNode;
+        if (expandedNode != 0)
+            for (SgUctChildIterator it(m_tree, *expandedNode); it; ++it)
+                request.m_children.push_back(SgUctMoveInfo((*it).Move()));
+        m_batchQueue.Evaluate(request);
+        eval = request.m_value;
+        if (request.m_hasPriors)
+        {
+            // The children can already have priors from GenerateAllMoves()
+            // or results of other threads, so the priors of the evaluator
+            // are added to them instead of replacing them
+            vector<SgUctMoveInfo>::const_iterator prior =
+                request.m_children.begin();
+            for (SgUctChildIterator it(m_tree, *expandedNode);
+                 it && prior != request.m_children.end(); ++it, ++prior)
+            {
+                const SgUctNode& child = *it;
+                if (child.Move() != prior->m_move)
+                    continue;
+                if (prior->m_count > 0)
+                {
+                    if (child.MoveCount() == 0)
+                        m_tree.InitializeValue(child, prior->m_value,
+                                               prior->m_count);
+                    else
+                        m_tree.AddGameResults(child, 0, prior->m_value,
+                                              prior->m_count);
+                }
+                if (prior->m_raveCount > 0 && ! child.HasRaveValue())
+                    m_tree.InitializeRaveValue(child, prior->m_raveValue,
+                                               prior->m_raveCount);
+            }
+            if (expandedNode->KnowledgeCount() < expandedNode->MoveCount())
+                m_tree.SetKnowledgeCount(*expandedNode,
+                                         expandedNode->MoveCount());
+        }
+    }
+    if (nuMovesInTree % 2 != 0)
+        eval = InverseEval(eval);
+    for (size_t i = 0; i < m_numberPlayouts; ++i)
+    {
+        info.m_sequence[i] = info.m_inTreeSequence;
+        info.m_skipRaveUpdate[i].assign(nuMovesInTree, false);
+        info.m_aborted[i] = abort;
+        info.m_eval[i] = eval;
+    }
 }
 
 /** Expand a node.
     @param state The thread state with state.m_moves already computed.
     @param node The node to expand. */
 void SgUctSearch::ExpandNode(SgUctThreadState& state, const SgUctNode& node)
+{
+    if (! CheckTreeCapacity(state, state.m_moves.size()))
+        return;
+    m_tree.CreateChildren(state.m_threadId, node, state.m_moves);
+}
+
+bool SgUctSearch::CheckTreeCapacity(SgUctThreadState& state, std::size_t n)
 {
     unsigned int threadId = state.m_threadId;
-    if (! m_tree.HasCapacity(threadId, state.m_moves.size()))
+    if (! m_tree.HasCapacity(threadId, n))
     {
         Debug(state, str(format("SgUctSearch: maximum tree size %1% reached")
                          % m_tree.MaxNodes()));
         state.m_isTreeOutOfMem = true;
         m_isTreeOutOfMemory = true;
-        SgSynchronizeThreadMemory();
-        return;
+        return false;
+    }
+    if (m_pruneFullTree && m_pruneHighWaterMark < 1)
+    {
+        // Still create the nodes, but stop the search for pruning
+        size_t reserve = static_cast<size_t>((1 - m_pruneHighWaterMark)
+                                   * double(m_tree.MaxNodes() / NumberThreads()));
+        if (! m_tree.HasCapacity(threadId, n + reserve))
+        {
+            Debug(state, "SgUctSearch: tree size reached high water mark");
+            state.m_isTreeOutOfMem = true;
+            m_isTreeOutOfMemory = true;
+        }
     }
-    m_tree.CreateChildren(threadId, node, state.m_moves);
+    return true;
 }
 
 const SgUctNode*
@@ -740,17 +836,10 @@ void SgUctSearch::CreateChildren(SgUctThreadState& state,
                                  const SgUctNode& node,
                                  bool deleteChildTrees)
 {
-    unsigned int threadId = state.m_threadId;
-    if (! m_tree.HasCapacity(threadId, state.m_moves.size()))
-    {
-        Debug(state, str(format("SgUctSearch: maximum tree size %1% reached")
-                         % m_tree.MaxNodes()));
-        state.m_isTreeOutOfMem = true;
-        m_isTreeOutOfMemory = true;
-        SgSynchronizeThreadMemory();
+    if (! CheckTreeCapacity(state, state.m_moves.size()))
         return;
-    }
-    m_tree.MergeChildren(threadId, node, state.m_moves, deleteChildTrees);
+    m_tree.MergeChildren(state.m_threadId, node, state.m_moves,
+                         deleteChildTrees);
 }
 
 bool SgUctSearch::NeedToComputeKnowledge(const SgUctNode* current)
@@ -870,6 +959,9 @@ void SgUctSearch::PlayGame(SgUctThreadState& state, GlobalLock* lock)
             info.m_eval[i] = eval;
         }
     }
+    else if (m_batchQueue.Evaluator() != 0)
+        EvaluateInBatch(state, abortInTree || state.m_isTreeOutOfMem,
+                        isTerminal);
     else 
     {
         state.StartPlayouts();
@@ -951,7 +1043,8 @@ bool SgUctSearch::PlayInTree(SgUctThreadState& state, bool& isTerminal)
     vector<const SgUctNode*>& nodes = state.m_gameInfo.m_nodes;
     const SgUctNode* root = &m_tree.Root();
     const SgUctNode* current = root;
-    if (m_virtualLoss && m_numberThreads > 1)
+    state.m_expandedNode = 0;
+    if (UseVirtualLoss())
         m_tree.AddVirtualLoss(*current);
     nodes.push_back(current);
     bool breakAfterSelect = false;
@@ -1022,8 +1115,10 @@ bool SgUctSearch::PlayInTree(SgUctThreadState& state, bool& isTerminal)
             if (! deepenTree)
                 breakAfterSelect = true;
         }
+        if (breakAfterSelect)
+            state.m_expandedNode = current;
         current = &SelectChild(state.m_randomizeCounter, *current);
-        if (m_virtualLoss && m_numberThreads > 1)
+        if (UseVirtualLoss())
             m_tree.AddVirtualLoss(*current);
         nodes.push_back(current);
         SgMove move = current->Move();
@@ -1087,11 +1182,10 @@ SgUctValue SgUctSearch::Search(SgUctValue maxGames, double maxTime,
     while (true)
     {
         m_isTreeOutOfMemory = false;
-        SgSynchronizeThreadMemory();
-        for (size_t i = 0; i < m_threads.size(); ++i)
-            m_threads[i]->StartPlay();
-        for (size_t i = 0; i < m_threads.size(); ++i)
-            m_threads[i]->WaitPlayFinished();
+        m_threadsPlaying.store(static_cast<unsigned int>(m_threads.size()));
+        m_threadsInGameLoop.store(static_cast<unsigned int>(m_threads.size()));
+        StartPlay();
+        WaitPlayFinished();
         if (m_aborted || ! m_pruneFullTree)
             break;
         else
@@ -1100,18 +1194,17 @@ SgUctValue SgUctSearch::Search(SgUctValue maxGames, double maxTime,
             SgDebug() << "SgUctSearch: pruning nodes with count < "
                   << pruneMinCount << " (at time " << fixed << setprecision(1)
                   << startPruneTime << ")\n";
-            SgUctTree& tempTree = GetTempTree();
-            m_tree.CopyPruneLowCount(tempTree, pruneMinCount, true);
-            int prunedSizePercentage =
-                static_cast<int>(tempTree.NuNodes() * 100 / m_tree.NuNodes());
-            SgDebug() << "SgUctSearch: pruned size: " << tempTree.NuNodes()
+            size_t nuNodes = m_tree.NuNodes();
+            m_tree.PruneLowCount(pruneMinCount);
+            int prunedSizePercentage = (nuNodes == 0 ? 0 :
+                static_cast<int>(m_tree.NuNodes() * 100 / nuNodes));
+            SgDebug() << "SgUctSearch: pruned size: " << m_tree.NuNodes()
                       << " (" << prunedSizePercentage << "%) time: "
                       << (m_timer.GetTime() - startPruneTime) << "\n";
             if (prunedSizePercentage > 50)
                 pruneMinCount *= 2;
             else
                  pruneMinCount = m_pruneMinCount; 
-            m_tree.Swap(tempTree);
         }
     }
     EndSearch();
@@ -1141,28 +1234,90 @@ void SgUctSearch::SearchLoop(SgUctThreadState& state, GlobalLock* lock)
     while (! state.m_isTreeOutOfMem)
     {
         PlayGame(state, lock);
-        OnSearchIteration(m_numberGames + 1, state.m_threadId,
-                          state.m_gameInfo);
+        const size_t gameNumber =
+            m_numberGames.fetch_add(1, memory_order_relaxed) + 1;
+        OnSearchIteration(static_cast<SgUctValue>(gameNumber),
+                          state.m_threadId, state.m_gameInfo);
         if (m_logGames)
             m_log << SummaryLine(state.m_gameInfo) << '\n';
-        ++m_numberGames;
-        if (m_isTreeOutOfMemory)
+        if (m_isTreeOutOfMemory.load(memory_order_relaxed))
             break;
-        if (m_aborted || CheckAbortSearch(state))
+        if (m_aborted.load(memory_order_relaxed) || CheckAbortSearch(state))
         {
             m_aborted = true;
-            SgSynchronizeThreadMemory();
             break;
         }
     }
     if (lock != 0)
         lock->unlock();
 
-    m_searchLoopFinished->wait();
+    // Wait until all threads left the loop, the end of search callbacks may
+    // depend on the final tree. The threads stop within one game of each
+    // other, so they don't need to block.
+    m_threadsInGameLoop.fetch_sub(1);
+    while (m_threadsInGameLoop.load() > 0)
+        boost::this_thread::yield();
     if (m_aborted || ! m_pruneFullTree)
         OnThreadEndSearch(state);
 }
 
+/** Start SearchLoop() in all threads.
+    Does not need a system call, if all threads are still spinning in
+    WaitForPlay(). */
+void SgUctSearch::StartPlay()
+{
+    m_playGeneration.fetch_add(1);
+    // Sequentially consistent order of the increment and this load, and of
+    // the increment of m_sleepingThreads and the load of m_playGeneration
+    // in WaitForPlay(), ensures that no thread misses the new generation
+    if (m_sleepingThreads.load() > 0)
+        Notify(m_poolMutex, m_playStarted);
+}
+
+/** Wait in a thread until StartPlay() is called.
+    @param generation The last generation the thread has played.
+    @return The new generation. */
+unsigned int SgUctSearch::WaitForPlay(unsigned int generation)
+{
+    for (int i = 0; i < POOL_SPIN_COUNT; ++i)
+    {
+        const unsigned int current =
+            m_playGeneration.load(memory_order_acquire);
+        if (current != generation)
+            return current;
+        boost::this_thread::yield();
+    }
+    mutex::scoped_lock lock(m_poolMutex);
+    ++m_sleepingThreads;
+    while (m_playGeneration.load() == generation)
+        m_playStarted.wait(lock);
+    --m_sleepingThreads;
+    return m_playGeneration.load();
+}
+
+/** Signal the end of SearchLoop() in a thread. */
+void SgUctSearch::FinishPlay()
+{
+    if (m_threadsPlaying.fetch_sub(1) == 1 && m_isWaitingForPlay.load())
+        Notify(m_poolMutex, m_playFinished);
+}
+
+/** Wait in the main thread until all threads finished SearchLoop(). */
+void SgUctSearch::WaitPlayFinished()
+{
+    for (int i = 0; i < POOL_SPIN_COUNT; ++i)
+    {
+        if (m_threadsPlaying.load(memory_order_acquire) == 0)
+            return;
+        boost::this_thread::yield();
+    }
+    mutex::scoped_lock lock(m_poolMutex);
+    m_isWaitingForPlay.store(true);
+    while (m_threadsPlaying.load() > 0)
+        m_playFinished.wait(lock);
+    m_isWaitingForPlay.store(false);
+}
+
 void SgUctSearch::OnThreadStartSearch(SgUctThreadState& state)
 {
     m_mpiSynchronizer->OnThreadStartSearch(*this, state);
@@ -1340,6 +1495,10 @@ void SgUctSearch::StartSearch(const vector<SgMove>& rootFilter,
                 "root filter not applied (tree reached maximum size)\n";
     }
     m_statistics.Clear();
+    m_batchQueue.SetBatchSize(max(min(m_batchSize,
+                                      static_cast<size_t>(m_numberThreads)),
+                                  static_cast<size_t>(1)));
+    m_batchQueue.ClearStatistics();
     m_aborted = false;
     m_wasEarlyAbort = false;
     m_checkTimeInterval = 1;
@@ -1528,7 +1687,7 @@ void SgUctSearch::UpdateTree(const SgUctGameInfo& info)
         m_tree.AddGameResults(node, father, i % 2 == 0 ? eval : inverseEval,
                               count);
         // Remove the virtual loss
-        if (m_virtualLoss && m_numberThreads > 1)
+        if (UseVirtualLoss())
             m_tree.RemoveVirtualLoss(node);
     }
 }
@@ -1544,6 +1703,11 @@ void SgUctSearch::WriteStatistics(ostream& out) const
             << m_statistics.m_knowledge * 100.0 / m_tree.Root().MoveCount()
             << "%)\n";
     m_statistics.Write(out);
+    if (m_batchQueue.Evaluator() != 0 && m_batchQueue.NuBatches() > 0)
+        out << SgWriteLabel("Batches") << m_batchQueue.NuBatches()
+            << " (size " << fixed << setprecision(1)
+            << static_cast<double>(m_batchQueue.NuRequests())
+               / static_cast<double>(m_batchQueue.NuBatches()) << ")\n";
     m_mpiSynchronizer->WriteStatistics(out);
 }
 
@@ -6,11 +6,11 @@
 #ifndef SG_UCTSEARCH_H
 #define SG_UCTSEARCH_H
 
+#include <atomic>
 #include <fstream>
 #include <vector>
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/thread/barrier.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
@@ -18,6 +18,7 @@
 #include "SgBlackWhite.h"
 #include "SgBWArray.h"
 #include "SgTimer.h"
+#include "SgUctBatchEvaluator.h"
 #include "SgUctTree.h"
 #include "SgMpiSynchronizer.h"
 
@@ -84,13 +85,16 @@ thread will be used in future simulations. It can also happen that some of the
 children that are lost already received value updates; these updates will be
 lost.
 
-The child information of a node consists of two variables: a pointer to the
-first child in the array, and the number of children. To avoid that another
-thread sees an inconsistent state of these variables, all threads assume that
-the number of children is valid if the pointer to the first child is not null.
-Linking a parent to a new set of children requires first writing the number of
-children, then the pointer to the first child. The compiler is prevented from
-reordering the writes by declaring these variables as volatile.
+The child information of a node consists of two atomic variables: a pointer
+to the first child in the array, and the number of children. Linking a parent
+to a new set of children (SgUctNode::SetChildren()) stores the variable that
+is written last with release order: if the number of children grows, the
+pointer to the first child is written first; otherwise the number of children
+is written first. Readers (SgUctNode::Children(), used by SgUctChildIterator)
+read the number of children with acquire order, then the pointer with acquire
+order, then the number of children again, and use the minimum of both counts.
+This guarantees that a reader never sees more children than the array at the
+pointer it reads contains, and that the children are fully initialized.
 
 @section sguctsearchlockfreevalues Updating Values
 
@@ -104,6 +108,11 @@ sees an erroneous state that exists only temporarily. In practice, these
 faulty updates occur with a low probability and will have only a small effect
 on the counts and mean values. They are intentionally ignored.
 
+The counts and mean values are atomic variables (see SgStatisticsAtomicBase),
+which are updated with compare-and-swap loops. Therefore no updates of the
+counts are lost; only the mean can temporarily miss the update belonging to a
+count, because count and mean are not updated as a single atomic operation.
+
 The only problematic case is if a count is zero, because the mean value is
 undefined if the count is zero, and this case has a special meaning at several
 places in the search. For example, the computation of the values for the
@@ -114,20 +123,19 @@ only the RAVE mean is used, and if both counts are zero, a configurable
 constant value, the first play urgency, is used. To avoid this problem, all
 threads assume that a mean value is only valid if the corresponding count is
 non-zero. Updating a value requires first writing the new mean value, then the
-new count. The compiler is prevented from reordering the writes by declaring
-the counts and mean values as volatile.
+new count with release order; the count is read with acquire order.
 
 @section sguctsearchlockfreeplatform Platform Requirements
 
-There are some requirements on the memory model of the platform to make the
-lock-free search algorithm work. Writes of certain basic types (size_t, int,
-float, pointers) must be atomic. Writes by one thread must be seen by other
-threads in the same order. The IA-32 and Intel-64 CPU architectures, which are
-used in most modern standard computers, guarantee these assumptions. They also
-synchronize CPU caches after writes. (See
-<a href="http://download.intel.com/design/processor/manuals/253668.pdf">
-Intel 64 and IA-32 Architectures Software Developer's Manual</a>, chapter
-7.1 Locked Atomic Operations and 7.2 Memory Ordering). */
+The lock-free search only relies on the C++11 memory model. All other
+variables of a node (position count, virtual loss count, knowledge count,
+proven type) are atomic and accessed with relaxed order, they are
+independent of each other. Previous versions used volatile variables and
+relied on the memory model of the IA-32 and Intel-64 CPU architectures.
+On these architectures, the atomic variables of a node have the same size as
+the volatile ones, and relaxed or acquire loads and release stores compile to
+plain moves; only the compare-and-swap loops of the updates are more
+expensive. */
 
 /** @page sguctsearchweights Estimator weights in SgUctSearch
     The weights of the estimators (move value, RAVE value) are chosen by
@@ -304,6 +312,15 @@ public:
     /** Thread's counter for Randomized Rave in SgUctSearch::SelectChild(). */
     int m_randomizeCounter;
 
+    /** Local variable for SgUctSearch::PlayInTree().
+        The node expanded in the in-tree phase of the current game, 0 if no
+        node was expanded. */
+    const SgUctNode* m_expandedNode;
+
+    /** Local variable for SgUctSearch::EvaluateInBatch().
+        Reused for efficiency. */
+    SgUctEvaluationRequest m_evaluationRequest;
+
     SgUctThreadState(unsigned int threadId, int moveRange = 0);
 
     virtual ~SgUctThreadState();
@@ -789,7 +806,8 @@ public:
     /** See WeightRaveUpdates() */
     void SetWeightRaveUpdates(bool enable);
 
-    /** Whether search uses virtual loss. */
+    /** Whether search uses virtual loss.
+        Virtual loss is always used with a BatchEvaluator(). */
     bool VirtualLoss() const;
 
     /** See VirtualLoss() */
@@ -799,8 +817,11 @@ public:
         This will prune nodes below a minimum count, if the tree gets full
         during a search. The minimum count is PruneMinCount() at the beginning
         of the search and is doubled every time a pruning operation does not
-        reduce the tree by at least a factor of 2. The creation of the pruned
-        tree uses the temporary tree (see GetTempTree()). */
+        reduce the tree by at least a factor of 2. The tree is pruned in place
+        (see SgUctTree::PruneLowCount()), so no second tree is needed. The
+        search stops all threads for pruning as soon as the node allocator
+        of one thread reaches PruneHighWaterMark(), and continues after the
+        pruning. */
     bool PruneFullTree() const;
 
     /** See PruneFullTree() */
@@ -812,6 +833,46 @@ public:
     /** See PruneFullTree() */
     void SetPruneMinCount(SgUctValue n);
 
+    /** Fraction of the nodes of a thread at which the tree is pruned.
+        Only used if PruneFullTree() is enabled. Pruning before the tree is
+        completely full avoids that threads can no longer expand nodes
+        while the other threads finish their games. Default is 0.95. */
+    double PruneHighWaterMark() const;
+
+    /** See PruneHighWaterMark() */
+    void SetPruneHighWaterMark(double fraction);
+
+    /** Evaluator for the leaves of the in-tree phase.
+        If an evaluator is set, the search does not play playouts. Each
+        thread descends the tree with virtual loss, adds its leaf to a queue
+        and waits until the leaf is evaluated in a batch together with the
+        leaves of other threads (see SgUctBatchQueue). The evaluator can
+        also set priors for the children of the node expanded in the game.
+        The batches can only be as large as the number of threads, so the
+        search should use more threads than cores with a batch evaluator.
+        Leaves at the end of the game are still evaluated with
+        SgUctThreadState::Evaluate(). The evaluator is not owned by the
+        search. Default is 0. */
+    SgUctBatchEvaluator* BatchEvaluator() const;
+
+    /** See BatchEvaluator() */
+    void SetBatchEvaluator(SgUctBatchEvaluator* evaluator);
+
+    /** Maximum number of leaves evaluated in one batch.
+        Only used with a BatchEvaluator(). The size of the batches is also
+        limited by NumberThreads(). Default is 16. */
+    std::size_t BatchSize() const;
+
+    /** See BatchSize() */
+    void SetBatchSize(std::size_t size);
+
+    /** Maximum time in seconds a leaf waits for its batch to become full.
+        Only used with a BatchEvaluator(). Default is 0.001. */
+    double BatchLatency() const;
+
+    /** See BatchLatency() */
+    void SetBatchLatency(double seconds);
+
     /** Terminate the search if the counts can no longer be represented
         precisely by SgUctValue.
         Default is true. */
@@ -826,6 +887,16 @@ public:
 
     const SgMpiSynchronizerHandle MpiSynchronizer() const;
 
+    /** Add game results of another search to a child of the root node.
+        Used by synchronizers that merge the root statistics of searches in
+        other processes (see SgMpiSharedMemorySynchronizer). Can be called
+        during the search from the synchronizer's OnSearchIteration().
+        @param child A child of the root node
+        @param eval The mean of the game results
+        @param count The number of game results */
+    void AddRootChildResults(const SgUctNode& child, SgUctValue eval,
+                             SgUctValue count);
+
     // @} // name
 
 
@@ -867,12 +938,10 @@ private:
 
         Thread(SgUctSearch& search, std::auto_ptr<SgUctThreadState> state);
 
+        /** Waits for the thread to finish.
+            The thread must have been told to quit, see DeleteThreads(). */
         ~Thread();
 
-        void StartPlay();
-
-        void WaitPlayFinished();
-
     private:
         /** Copyable function object that invokes Thread::operator().
             Needed because the the constructor of boost::thread copies the
@@ -892,30 +961,19 @@ private:
 
         SgUctSearch& m_search;
 
-        bool m_quit;
-
-        boost::barrier m_threadReady;
-
-        boost::mutex m_startPlayMutex;
-
-        boost::mutex m_playFinishedMutex;
-
-        boost::condition m_startPlay;
-
-        boost::condition m_playFinished;
-
-        boost::mutex::scoped_lock m_playFinishedLock;
-
         GlobalLock m_globalLock;
 
+        /** Last value of SgUctSearch::m_playGeneration seen by the thread.
+            Initialized before the thread starts, so that it cannot miss a
+            search that is started right after the construction. */
+        unsigned int m_generation;
+
         /** The thread.
             Order dependency: must be constructed as the last member, because
             the constructor starts the thread. */
         boost::thread m_thread;
 
         void operator()();
-
-        void PlayGames();
     };
 
     std::auto_ptr<SgUctThreadStateFactory> m_threadStateFactory;
@@ -930,12 +988,48 @@ private:
     std::vector<SgUctValue> m_knowledgeThreshold;
 
     /** Flag indicating that the search was terminated because the maximum
-        time or number of games was reached. */
-    volatile bool m_aborted;
+        time or number of games was reached.
+        Checked by all threads after every game, so it is read with relaxed
+        memory order. */
+    std::atomic<bool> m_aborted;
     
-    volatile bool m_isTreeOutOfMemory;
+    std::atomic<bool> m_isTreeOutOfMemory;
+
+    /** @name Thread pool
+        The threads are kept running between searches. StartPlay() starts
+        SearchLoop() in all threads by incrementing m_playGeneration; threads
+        that are waiting for work notice the change while spinning, so
+        starting a search takes microseconds. Only threads that have been
+        idle for longer block on m_playStarted and need a notification.
+        The same holds for the main thread in WaitPlayFinished(). */
+    // @{
+
+    /** Incremented to start the search loop in all threads. */
+    std::atomic<unsigned int> m_playGeneration;
+
+    /** Number of threads that have not finished SearchLoop(). */
+    std::atomic<unsigned int> m_threadsPlaying;
+
+    /** Number of threads that have not left the game loop in SearchLoop().
+        OnThreadEndSearch() is only called after all threads left it. */
+    std::atomic<unsigned int> m_threadsInGameLoop;
+
+    /** Number of threads blocked on m_playStarted. */
+    std::atomic<unsigned int> m_sleepingThreads;
+
+    /** The main thread is blocked on m_playFinished. */
+    std::atomic<bool> m_isWaitingForPlay;
+
+    /** Tells the threads to terminate instead of starting SearchLoop(). */
+    std::atomic<bool> m_quitThreads;
+
+    boost::mutex m_poolMutex;
+
+    boost::condition m_playStarted;
 
-    std::auto_ptr<boost::barrier> m_searchLoopFinished;
+    boost::condition m_playFinished;
+
+    // @} // name
 
     /** See SgUctEarlyAbortParam. */
     bool m_wasEarlyAbort;
@@ -977,6 +1071,9 @@ private:
     /** See PruneMinCount() */
     SgUctValue m_pruneMinCount;
 
+    /** See PruneHighWaterMark() */
+    double m_pruneHighWaterMark;
+
     /** See parameter moveRange in constructor */
     const int m_moveRange;
 
@@ -990,7 +1087,7 @@ private:
     SgUctValue m_maxGames;
 
     /** Number of games played in the current search. */
-    SgUctValue m_numberGames;
+    std::atomic<std::size_t> m_numberGames;
 
     SgUctValue m_startRootMoveCount;
 
@@ -1002,7 +1099,7 @@ private:
         per total maximum search time) */
     SgUctValue m_checkTimeInterval;
 
-    volatile SgUctValue m_nextCheckTime;
+    std::atomic<SgUctValue> m_nextCheckTime;
 
     double m_lastScoreDisplayTime;
 
@@ -1030,6 +1127,12 @@ private:
     /** See VirtualLoss() */
     bool m_virtualLoss;
 
+    /** See BatchSize() */
+    std::size_t m_batchSize;
+
+    /** Queue for the leaves evaluated with the BatchEvaluator(). */
+    SgUctBatchQueue m_batchQueue;
+
     std::string m_logFileName;
 
     SgTimer m_timer;
@@ -1079,8 +1182,20 @@ private:
 
     void DeleteThreads();
 
+    void FinishPlay();
+
     void ExpandNode(SgUctThreadState& state, const SgUctNode& node);
 
+    /** Check if the thread can create n nodes.
+        Sets the out of memory flags, if the tree is full or has reached
+        PruneHighWaterMark(). */
+    bool CheckTreeCapacity(SgUctThreadState& state, std::size_t n);
+
+    void EvaluateInBatch(SgUctThreadState& state, bool abort,
+                         bool isTerminal);
+
+    bool UseVirtualLoss() const;
+
     void CreateChildren(SgUctThreadState& state, const SgUctNode& node,
                         bool deleteChildTrees);
 
@@ -1105,6 +1220,8 @@ private:
     
     void SearchLoop(SgUctThreadState& state, GlobalLock* lock);
 
+    void StartPlay();
+
     const SgUctNode& SelectChild(int& randomizeCounter, const SgUctNode& node);
 
     std::string SummaryLine(const SgUctGameInfo& info) const;
@@ -1125,8 +1242,27 @@ private:
     void UpdateStatistics(const SgUctGameInfo& info);
 
     void UpdateTree(const SgUctGameInfo& info);
+
+    unsigned int WaitForPlay(unsigned int generation);
+
+    void WaitPlayFinished();
 };
 
+inline SgUctBatchEvaluator* SgUctSearch::BatchEvaluator() const
+{
+    return m_batchQueue.Evaluator();
+}
+
+inline double SgUctSearch::BatchLatency() const
+{
+    return m_batchQueue.MaxLatency();
+}
+
+inline std::size_t SgUctSearch::BatchSize() const
+{
+    return m_batchSize;
+}
+
 inline float SgUctSearch::BiasTermConstant() const
 {
     return m_biasTermConstant;
@@ -1207,6 +1343,11 @@ inline bool SgUctSearch::PruneFullTree() const
     return m_pruneFullTree;
 }
 
+inline double SgUctSearch::PruneHighWaterMark() const
+{
+    return m_pruneHighWaterMark;
+}
+
 inline SgUctValue SgUctSearch::PruneMinCount() const
 {
     return m_pruneMinCount;
@@ -1232,6 +1373,22 @@ inline float SgUctSearch::RaveWeightFinal() const
     return m_raveWeightFinal;
 }
 
+inline void SgUctSearch::SetBatchEvaluator(SgUctBatchEvaluator* evaluator)
+{
+    m_batchQueue.SetEvaluator(evaluator);
+}
+
+inline void SgUctSearch::SetBatchLatency(double seconds)
+{
+    m_batchQueue.SetMaxLatency(seconds);
+}
+
+inline void SgUctSearch::SetBatchSize(std::size_t size)
+{
+    SG_ASSERT(size > 0);
+    m_batchSize = size;
+}
+
 inline void SgUctSearch::SetBiasTermConstant(float biasTermConstant)
 {
     m_biasTermConstant = biasTermConstant;
@@ -1302,6 +1459,12 @@ inline void SgUctSearch::SetPruneFullTree(bool enable)
     m_pruneFullTree = enable;
 }
 
+inline void SgUctSearch::SetPruneHighWaterMark(double fraction)
+{
+    SG_ASSERT(fraction > 0 && fraction <= 1);
+    m_pruneHighWaterMark = fraction;
+}
+
 inline void SgUctSearch::SetPruneMinCount(SgUctValue n)
 {
     m_pruneMinCount = n;
@@ -1313,6 +1476,13 @@ inline void SgUctSearch::SetMpiSynchronizer(const SgMpiSynchronizerHandle
     m_mpiSynchronizer = SgMpiSynchronizerHandle(synchronizerHandle);
 }
 
+inline void SgUctSearch::AddRootChildResults(const SgUctNode& child,
+                                             SgUctValue eval,
+                                             SgUctValue count)
+{
+    m_tree.AddGameResults(child, &m_tree.Root(), eval, count);
+}
+
 inline SgMpiSynchronizerHandle SgUctSearch::MpiSynchronizer()
 {
     return SgMpiSynchronizerHandle(m_mpiSynchronizer);
@@ -1363,6 +1533,12 @@ inline void SgUctSearch::SetVirtualLoss(bool enable)
     m_virtualLoss = enable;
 }
 
+inline bool SgUctSearch::UseVirtualLoss() const
+{
+    return ((m_virtualLoss || m_batchQueue.Evaluator() != 0)
+            && m_numberThreads > 1);
+}
+
 inline const SgUctSearchStat& SgUctSearch::Statistics() const
 {
     return m_statistics;
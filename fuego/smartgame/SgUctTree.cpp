@@ -6,8 +6,13 @@
 #include "SgSystem.h"
 #include "SgUctTree.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
 #include "SgDebug.h"
+#include "SgException.h"
 #include "SgTimer.h"
 
 using namespace std;
@@ -16,13 +21,67 @@ using boost::shared_ptr;
 
 //----------------------------------------------------------------------------
 
-SgUctAllocator::~SgUctAllocator()
+namespace {
+
+/** Minimum move count of the start node for extracting a subtree in
+    parallel.
+    Smaller subtrees are copied faster than the threads are created. */
+const SgUctValue PARALLEL_EXTRACT_MIN_COUNT = 20000;
+
+/** Number of open subtrees per thread when extracting a subtree in parallel.
+    More subtrees than threads are needed to balance the work, because the
+    sizes of the subtrees are only estimated by their move counts. */
+const size_t PARALLEL_EXTRACT_TASKS_PER_THREAD = 8;
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+/** Node of the top levels of a subtree extracted in parallel.
+    See SgUctTree::ExtractSubtreeParallel() */
+struct SgUctTree::ExtractTask
 {
-    if (m_start != 0)
+    /** Compare tasks by the move count of their source nodes. */
+    class Larger
     {
-        Clear();
-        std::free(m_start);
-    }
+    public:
+        Larger(const vector<ExtractTask>& tasks)
+            : m_tasks(tasks)
+        { }
+
+        bool operator()(size_t i, size_t j) const
+        {
+            return m_tasks[i].m_node->MoveCount()
+                > m_tasks[j].m_node->MoveCount();
+        }
+
+    private:
+        const vector<ExtractTask>& m_tasks;
+    };
+
+    SgUctNode* m_targetNode;
+
+    const SgUctNode* m_node;
+
+    /** Index of the task of the parent node, -1 for the start node. */
+    int m_parent;
+
+    /** The subtree was copied completely. */
+    bool m_isComplete;
+
+    ExtractTask(SgUctNode& targetNode, const SgUctNode& node, int parent)
+        : m_targetNode(&targetNode),
+          m_node(&node),
+          m_parent(parent),
+          m_isComplete(true)
+    { }
+};
+
+//----------------------------------------------------------------------------
+
+SgUctAllocator::~SgUctAllocator()
+{
+    Clear();
 }
 
 bool SgUctAllocator::Contains(const SgUctNode& node) const
@@ -37,17 +96,10 @@ void SgUctAllocator::Swap(SgUctAllocator& allocator)
     swap(m_endOfStorage, allocator.m_endOfStorage);
 }
 
-void SgUctAllocator::SetMaxNodes(std::size_t maxNodes)
+void SgUctAllocator::SetStorage(SgUctNode* start, std::size_t maxNodes)
 {
-    if (m_start != 0)
-    {
-        Clear();
-        std::free(m_start);
-    }
-    void* ptr = std::malloc(maxNodes * sizeof(SgUctNode));
-    if (ptr == 0)
-        throw std::bad_alloc();
-    m_start = static_cast<SgUctNode*>(ptr);
+    Clear();
+    m_start = start;
     m_finish = m_start;
     m_endOfStorage = m_start + maxNodes;
 }
@@ -55,9 +107,19 @@ void SgUctAllocator::SetMaxNodes(std::size_t maxNodes)
 //----------------------------------------------------------------------------
 
 SgUctTree::SgUctTree()
-    : m_maxNodes(0),
-      m_root(SG_NULLMOVE)
+    : m_maxNodes(0)
 {
+    void* ptr = std::malloc(sizeof(SgUctNode));
+    if (ptr == 0)
+        throw std::bad_alloc();
+    m_nodes = static_cast<SgUctNode*>(ptr);
+    new(m_nodes) SgUctNode(SG_NULLMOVE);
+}
+
+SgUctTree::~SgUctTree()
+{
+    m_allocators.clear();
+    FreeNodes();
 }
 
 void SgUctTree::ApplyFilter(std::size_t allocatorId, const SgUctNode& node,
@@ -80,21 +142,15 @@ void SgUctTree::ApplyFilter(std::size_t allocatorId, const SgUctNode& node,
         {
             SgUctNode* child = allocator.CreateOne(move);
             child->CopyDataFrom(*it);
-            int childNuChildren = (*it).NuChildren();
-            child->SetNuChildren(childNuChildren);
-            if (childNuChildren > 0)
-                child->SetFirstChild((*it).FirstChild());
+            const SgUctNode* childFirstChild;
+            int childNuChildren = (*it).Children(childFirstChild);
+            child->SetChildren(childFirstChild, childNuChildren);
             ++nuChildren;
         }
     }
 
     SgUctNode& nonConstNode = const_cast<SgUctNode&>(node);
-    // Write order dependency: SgUctSearch in lock-free mode assumes that
-    // m_firstChild is valid if m_nuChildren is greater zero
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetFirstChild(firstChild);
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetNuChildren(nuChildren);
+    nonConstNode.SetChildren(firstChild, nuChildren);
 }
 
 void SgUctTree::SetChildren(std::size_t allocatorId, const SgUctNode& node,
@@ -119,10 +175,9 @@ void SgUctTree::SetChildren(std::size_t allocatorId, const SgUctNode& node,
                 found = true;
                 SgUctNode* child = allocator.CreateOne(move);
                 child->CopyDataFrom(*it);
-                int childNuChildren = (*it).NuChildren();
-                child->SetNuChildren(childNuChildren);
-                if (childNuChildren > 0)
-                    child->SetFirstChild((*it).FirstChild());
+                const SgUctNode* childFirstChild;
+                int childNuChildren = (*it).Children(childFirstChild);
+                child->SetChildren(childFirstChild, childNuChildren);
                 ++nuChildren;
                 break;
             }
@@ -136,12 +191,7 @@ void SgUctTree::SetChildren(std::size_t allocatorId, const SgUctNode& node,
     SG_ASSERT((size_t)nuChildren == moves.size());
 
     SgUctNode& nonConstNode = const_cast<SgUctNode&>(node);
-    // Write order dependency: SgUctSearch in lock-free mode assumes that
-    // m_firstChild is valid if m_nuChildren is greater zero
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetFirstChild(firstChild);
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetNuChildren(nuChildren);
+    nonConstNode.SetChildren(firstChild, nuChildren);
 }
 
 void SgUctTree::CheckConsistency() const
@@ -155,14 +205,14 @@ void SgUctTree::Clear()
 {
     for (size_t i = 0; i < NuAllocators(); ++i)
         Allocator(i).Clear();
-    m_root = SgUctNode(SG_NULLMOVE);
+    RootNode() = SgUctNode(SG_NULLMOVE);
 }
 
 /** Check if node is in tree.
     Only used for assertions. May not be available in future implementations. */
 bool SgUctTree::Contains(const SgUctNode& node) const
 {
-    if (&node == &m_root)
+    if (&node == &Root())
         return true;
     for (size_t i = 0; i < NuAllocators(); ++i)
         if (Allocator(i).Contains(node))
@@ -176,9 +226,9 @@ void SgUctTree::CopyPruneLowCount(SgUctTree& target, SgUctValue minCount,
     size_t allocatorId = 0;
     SgTimer timer;
     bool abort = false;
-    CopySubtree(target, target.m_root, m_root, minCount, allocatorId,
+    CopySubtree(target, target.RootNode(), Root(), minCount, allocatorId,
                 warnTruncate, abort, timer, maxTime,
-                /* alwaysKeepProven */ false);
+                /* alwaysKeepProven */ false, /* cycleAllocators */ true);
     SgSynchronizeThreadMemory();
 }
 
@@ -191,19 +241,24 @@ void SgUctTree::CopyPruneLowCount(SgUctTree& target, SgUctValue minCount,
     @param minCount The minimum count (SgUctNode::MoveCount()) of a non-root
     node in the source tree to copy
     @param currentAllocatorId The current node allocator. Will be incremented
-    in each call to CopySubtree to use node allocators of target tree evenly.
+    in each call to CopySubtree to use node allocators of target tree evenly,
+    if cycleAllocators is true.
     @param warnTruncate Print warning to SgDebug() if tree was
     truncated (e.g due to reassigning nodes to different allocators)
     @param[in,out] abort Flag to abort copying. Must be initialized to false
     by top-level caller
     @param timer
     @param maxTime See ExtractSubtree() 
-    @param alwaysKeepProven Copy proven nodes even if below minCount */
- bool SgUctTree::CopySubtree(SgUctTree& target, SgUctNode& targetNode,
+    @param alwaysKeepProven Copy proven nodes even if below minCount
+    @param cycleAllocators Use all allocators of the target tree; if false,
+    only currentAllocatorId is used (by the threads of
+    ExtractSubtreeParallel()) */
+bool SgUctTree::CopySubtree(SgUctTree& target, SgUctNode& targetNode,
                             const SgUctNode& node, SgUctValue minCount,
                             std::size_t& currentAllocatorId,
                             bool warnTruncate, bool& abort, SgTimer& timer,
-                            double maxTime, bool alwaysKeepProven) const
+                            double maxTime, bool alwaysKeepProven,
+                            bool cycleAllocators) const
 
 {
     SG_ASSERT(Contains(node));
@@ -264,8 +319,7 @@ void SgUctTree::CopyPruneLowCount(SgUctTree& target, SgUctValue minCount,
     }
 
     SgUctNode* firstTargetChild = targetAllocator.Finish();
-    targetNode.SetFirstChild(firstTargetChild);
-    targetNode.SetNuChildren(nuChildren);
+    targetNode.SetChildren(firstTargetChild, nuChildren);
 
     // Create target nodes first (must be contiguous in the target tree)
     targetAllocator.CreateN(nuChildren);
@@ -276,13 +330,17 @@ void SgUctTree::CopyPruneLowCount(SgUctTree& target, SgUctValue minCount,
     for (SgUctChildIterator it(*this, node); it; ++it, ++targetChild)
     {
         const SgUctNode& child = *it;
-        ++currentAllocatorId; // Cycle to use allocators uniformly
-        if (currentAllocatorId >= target.NuAllocators())
-            currentAllocatorId = 0;
+        if (cycleAllocators)
+        {
+            ++currentAllocatorId; // Cycle to use allocators uniformly
+            if (currentAllocatorId >= target.NuAllocators())
+                currentAllocatorId = 0;
+        }
         copiedCompleteTree &= CopySubtree(target, *targetChild, child, 
                                           minCount, currentAllocatorId,
                                           warnTruncate, abort, timer,
-                                          maxTime, alwaysKeepProven);
+                                          maxTime, alwaysKeepProven,
+                                          cycleAllocators);
     }
     if (!copiedCompleteTree && targetNode.IsProven())
         targetNode.SetProvenType(SG_NOT_PROVEN);
@@ -302,7 +360,7 @@ void SgUctTree::CreateAllocators(std::size_t nuThreads)
 
 void SgUctTree::DumpDebugInfo(std::ostream& out) const
 {
-    out << "Root " << &m_root << '\n';
+    out << "Root " << &Root() << '\n';
     for (size_t i = 0; i < NuAllocators(); ++i)
         out << "Allocator " << i
             << " size=" << Allocator(i).NuNodes()
@@ -318,14 +376,175 @@ void SgUctTree::ExtractSubtree(SgUctTree& target, const SgUctNode& node,
     SG_ASSERT(&target != this);
     SG_ASSERT(target.MaxNodes() == MaxNodes());
     target.Clear();
-    size_t allocatorId = 0;
-    SgTimer timer;
-    bool abort = false;
-    CopySubtree(target, target.m_root, node, minCount, allocatorId, warnTruncate,
-                abort, timer, maxTime, /* alwaysKeepProven */ true);
+    if (target.NuAllocators() > 1
+        && node.MoveCount() >= PARALLEL_EXTRACT_MIN_COUNT)
+        ExtractSubtreeParallel(target, node, warnTruncate, maxTime, minCount);
+    else
+    {
+        size_t allocatorId = 0;
+        SgTimer timer;
+        bool abort = false;
+        CopySubtree(target, target.RootNode(), node, minCount, allocatorId,
+                    warnTruncate, abort, timer, maxTime,
+                    /* alwaysKeepProven */ true, /* cycleAllocators */ true);
+    }
     SgSynchronizeThreadMemory();
 }
 
+/** Copy the subtree of a node with one thread per allocator of the target
+    tree.
+    See ExtractSubtree(). The top levels are expanded in breadth-first order
+    with the same rules as CopySubtree(), until there are
+    PARALLEL_EXTRACT_TASKS_PER_THREAD open subtrees per thread (or no node
+    left to expand). */
+void SgUctTree::ExtractSubtreeParallel(SgUctTree& target,
+                                       const SgUctNode& node,
+                                       bool warnTruncate, double maxTime,
+                                       SgUctValue minCount) const
+{
+    const size_t nuThreads = target.NuAllocators();
+    const size_t minOpenTasks = nuThreads * PARALLEL_EXTRACT_TASKS_PER_THREAD;
+    SgUctAllocator& topAllocator = target.Allocator(0);
+    vector<ExtractTask> tasks;
+    tasks.push_back(ExtractTask(target.RootNode(), node, -1));
+    // Tasks before next are expanded, the others are open
+    size_t next = 0;
+    for ( ; next < tasks.size() && tasks.size() - next < minOpenTasks; ++next)
+    {
+        SgUctNode& targetNode = *tasks[next].m_targetNode;
+        const SgUctNode& n = *tasks[next].m_node;
+        targetNode.CopyDataFrom(n);
+        const SgUctNode* firstChild;
+        int nuChildren = n.Children(firstChild);
+        if (nuChildren == 0)
+            continue;
+        if (! n.IsProven() && n.MoveCount() < minCount)
+        {
+            tasks[next].m_isComplete = false;
+            continue;
+        }
+        if (! topAllocator.HasCapacity(nuChildren))
+        {
+            if (warnTruncate)
+                SgDebug() << "SgUctTree::ExtractSubtree: "
+                    "Truncated (allocator capacity)\n";
+            targetNode.SetPosCount(0);
+            tasks[next].m_isComplete = false;
+            continue;
+        }
+        SgUctNode* firstTargetChild = topAllocator.Finish();
+        topAllocator.CreateN(nuChildren);
+        targetNode.SetChildren(firstTargetChild, nuChildren);
+        for (int i = 0; i < nuChildren; ++i)
+            tasks.push_back(ExtractTask(firstTargetChild[i], firstChild[i],
+                                        static_cast<int>(next)));
+    }
+
+    // Distribute the open subtrees, largest first, to the thread with the
+    // lowest sum of move counts
+    vector<size_t> openTasks;
+    for (size_t i = next; i < tasks.size(); ++i)
+        openTasks.push_back(i);
+    sort(openTasks.begin(), openTasks.end(), ExtractTask::Larger(tasks));
+    vector<vector<size_t> > threadTasks(nuThreads);
+    vector<SgUctValue> threadCount(nuThreads, 0);
+    for (vector<size_t>::const_iterator it = openTasks.begin();
+         it != openTasks.end(); ++it)
+    {
+        size_t t = min_element(threadCount.begin(), threadCount.end())
+                   - threadCount.begin();
+        threadTasks[t].push_back(*it);
+        threadCount[t] += tasks[*it].m_node->MoveCount();
+    }
+    boost::scoped_array<bool> aborted(new bool[nuThreads]);
+    fill(aborted.get(), aborted.get() + nuThreads, false);
+    boost::thread_group threads;
+    for (size_t t = 1; t < nuThreads; ++t)
+        if (! threadTasks[t].empty())
+            threads.create_thread(boost::bind(
+                                     &SgUctTree::ExtractSubtreeThread, this,
+                                     boost::ref(target), boost::ref(tasks),
+                                     boost::cref(threadTasks[t]), t,
+                                     maxTime, minCount,
+                                     boost::ref(aborted[t])));
+    ExtractSubtreeThread(target, tasks, threadTasks[0], 0, maxTime, minCount,
+                         aborted[0]);
+    threads.join_all();
+    // The threads don't write to SgDebug(), the warnings are written here
+    if (warnTruncate)
+        for (size_t t = 0; t < nuThreads; ++t)
+            if (aborted[t])
+                SgDebug() << "SgUctTree::ExtractSubtree: Truncated"
+                    " (allocator capacity, max time or aborted) in thread "
+                          << t << '\n';
+
+    // Parents are stored before their children, so a reverse iteration
+    // propagates incomplete subtrees up to the root
+    for (size_t i = tasks.size() - 1; i > 0; --i)
+        if (! tasks[i].m_isComplete)
+            tasks[tasks[i].m_parent].m_isComplete = false;
+    for (size_t i = 0; i < next; ++i)
+        if (! tasks[i].m_isComplete && tasks[i].m_targetNode->IsProven())
+            tasks[i].m_targetNode->SetProvenType(SG_NOT_PROVEN);
+}
+
+/** Thread function of ExtractSubtreeParallel().
+    Copies the subtrees of the given tasks to one allocator of the target
+    tree. Uses its own timer and abort flag.
+    @param[out] abort Set to true if the copy was truncated. The caller
+    writes the warning, so that the threads don't write to SgDebug() at the
+    same time. */
+void SgUctTree::ExtractSubtreeThread(SgUctTree& target,
+                                     vector<ExtractTask>& tasks,
+                                     const vector<size_t>& taskIndices,
+                                     size_t allocatorId, double maxTime,
+                                     SgUctValue minCount, bool& abort) const
+{
+    SgTimer timer;
+    for (vector<size_t>::const_iterator it = taskIndices.begin();
+         it != taskIndices.end(); ++it)
+    {
+        ExtractTask& task = tasks[*it];
+        task.m_isComplete = CopySubtree(target, *task.m_targetNode,
+                                        *task.m_node, minCount, allocatorId,
+                                        /* warnTruncate */ false, abort,
+                                        timer, maxTime,
+                                        /* alwaysKeepProven */ true,
+                                        /* cycleAllocators */ false);
+    }
+}
+
+/** Recursive function used by SgUctTree::PruneLowCount.
+    Collects the child arrays that remain in the pruned tree. Uses the same
+    rules as CopySubtree() with alwaysKeepProven = false; like CopySubtree()
+    it resets the proven type of nodes whose subtree is not kept completely.
+    @param node The node
+    @param minCount See PruneLowCount()
+    @param[out] childArrays First child and number of children of the
+    remaining child arrays
+    @return @c true if the complete subtree of the node remains */
+bool SgUctTree::MarkPrunedSubtree(const SgUctNode& node, SgUctValue minCount,
+                  vector<pair<const SgUctNode*,int> >& childArrays)
+{
+    const SgUctNode* firstChild;
+    int nuChildren = node.Children(firstChild);
+    if (nuChildren == 0)
+        return true;
+    if (node.MoveCount() < minCount)
+    {
+        if (node.IsProven())
+            SetProvenType(node, SG_NOT_PROVEN);
+        return false;
+    }
+    childArrays.push_back(make_pair(firstChild, nuChildren));
+    bool isComplete = true;
+    for (int i = 0; i < nuChildren; ++i)
+        isComplete &= MarkPrunedSubtree(firstChild[i], minCount, childArrays);
+    if (! isComplete && node.IsProven())
+        SetProvenType(node, SG_NOT_PROVEN);
+    return isComplete;
+}
+
 void SgUctTree::MergeChildren(std::size_t allocatorId, const SgUctNode& node,
                               const std::vector<SgUctMoveInfo>& moves,
                               bool deleteChildTrees)
@@ -339,10 +558,7 @@ void SgUctTree::MergeChildren(std::size_t allocatorId, const SgUctNode& node,
 
     if (nuNewChildren == 0)
     {
-        // Write order dependency
-        nonConstNode.SetNuChildren(0);
-        SgSynchronizeThreadMemory();
-        nonConstNode.SetFirstChild(0);
+        nonConstNode.SetChildren(0, 0);
         return;
     }
 
@@ -367,11 +583,10 @@ void SgUctTree::MergeChildren(std::size_t allocatorId, const SgUctNode& node,
                 {
                     newChild->SetPosCount(oldChild.PosCount());
                     parentCount += oldChild.MoveCount();
-                    if (oldChild.HasChildren())
-                    {
-                        newChild->SetFirstChild(oldChild.FirstChild());
-                        newChild->SetNuChildren(oldChild.NuChildren());
-                    }
+                    const SgUctNode* oldFirstChild;
+                    int oldNuChildren = oldChild.Children(oldFirstChild);
+                    if (oldNuChildren > 0)
+                        newChild->SetChildren(oldFirstChild, oldNuChildren);
                 }
                 break;
             }
@@ -379,23 +594,9 @@ void SgUctTree::MergeChildren(std::size_t allocatorId, const SgUctNode& node,
     }
     nonConstNode.SetPosCount(parentCount);
 
-    // Write order dependency: We do not want an SgUctChildIterator to
-    // run past the end of a node's children, which can happen if one
-    // is created between the two statements below. We modify node in
-    // such a way so as to avoid that.
-    SgSynchronizeThreadMemory();
-    if (nonConstNode.NuChildren() < nuNewChildren)
-    {
-        nonConstNode.SetFirstChild(newFirstChild);
-        SgSynchronizeThreadMemory();
-        nonConstNode.SetNuChildren(nuNewChildren);
-    }
-    else
-    {
-        nonConstNode.SetNuChildren(nuNewChildren);
-        SgSynchronizeThreadMemory();
-        nonConstNode.SetFirstChild(newFirstChild);
-    }
+    // SetChildren() orders the writes, such that an SgUctChildIterator
+    // created concurrently does not run past the end of the children
+    nonConstNode.SetChildren(newFirstChild, nuNewChildren);
 }
 
 std::size_t SgUctTree::NuNodes() const
@@ -406,6 +607,82 @@ std::size_t SgUctTree::NuNodes() const
     return nuNodes;
 }
 
+void SgUctTree::PruneLowCount(SgUctValue minCount)
+{
+    typedef pair<const SgUctNode*,int> ChildArray;
+    vector<ChildArray> childArrays;
+    MarkPrunedSubtree(Root(), minCount, childArrays);
+    // Each node is reachable from only one parent, but remove duplicates to
+    // be safe, they would be moved twice
+    sort(childArrays.begin(), childArrays.end());
+    childArrays.erase(unique(childArrays.begin(), childArrays.end()),
+                      childArrays.end());
+
+    // Compute the new positions. The arrays are sorted by address, so the
+    // new position of an array is never after its old position and arrays
+    // can be moved in this order without overwriting arrays not yet moved.
+    vector<SgUctNode*> finish(NuAllocators());
+    for (size_t i = 0; i < NuAllocators(); ++i)
+        finish[i] = Allocator(i).Start();
+    vector<SgUctNode*> newFirstChild(childArrays.size());
+    for (size_t i = 0; i < childArrays.size(); ++i)
+    {
+        size_t allocatorId = 0;
+        while (! Allocator(allocatorId).Contains(*childArrays[i].first))
+        {
+            ++allocatorId;
+            SG_ASSERT(allocatorId < NuAllocators());
+        }
+        newFirstChild[i] = finish[allocatorId];
+        finish[allocatorId] += childArrays[i].second;
+    }
+
+    // Move the nodes and update the links to their children
+    for (size_t i = 0; i <= childArrays.size(); ++i)
+    {
+        // The root (i == childArrays.size()) is not moved; update it last
+        SgUctNode* node;
+        SgUctNode* target;
+        int nuNodes;
+        if (i < childArrays.size())
+        {
+            node = const_cast<SgUctNode*>(childArrays[i].first);
+            target = newFirstChild[i];
+            nuNodes = childArrays[i].second;
+        }
+        else
+        {
+            node = &RootNode();
+            target = node;
+            nuNodes = 1;
+        }
+        for (int j = 0; j < nuNodes; ++j, ++node, ++target)
+        {
+            const SgUctNode* firstChild;
+            int nuChildren = node->Children(firstChild);
+            SgUctNode* newChildren = 0;
+            if (nuChildren > 0)
+            {
+                vector<ChildArray>::const_iterator pos =
+                    lower_bound(childArrays.begin(), childArrays.end(),
+                                ChildArray(firstChild, 0));
+                if (pos != childArrays.end() && pos->first == firstChild)
+                    newChildren = newFirstChild[pos - childArrays.begin()];
+                else
+                    nuChildren = 0;
+            }
+            if (target != node)
+            {
+                new(target) SgUctNode(SG_NULLMOVE);
+                target->CopyDataFrom(*node);
+            }
+            target->SetChildren(newChildren, nuChildren);
+        }
+    }
+    for (size_t i = 0; i < NuAllocators(); ++i)
+        Allocator(i).Truncate(finish[i]);
+}
+
 void SgUctTree::SetMaxNodes(std::size_t maxNodes)
 {
     Clear();
@@ -416,21 +693,43 @@ void SgUctTree::SetMaxNodes(std::size_t maxNodes)
         SG_ASSERT(false);
         return;
     }
-    m_maxNodes = maxNodes;
     size_t maxNodesPerAlloc = maxNodes / nuAllocators;
+    size_t nuNodes = 1 + maxNodesPerAlloc * nuAllocators;
+#ifdef SG_UCT_COMPACT_NODE
+    if (nuNodes > size_t(std::numeric_limits<int32_t>::max()))
+        throw SgException("SgUctTree::SetMaxNodes: too many nodes for "
+                          "compact node layout");
+#endif
+    if (nuNodes > std::numeric_limits<size_t>::max() / sizeof(SgUctNode))
+        throw std::bad_alloc();
+    void* ptr = std::malloc(nuNodes * sizeof(SgUctNode));
+    if (ptr == 0)
+        throw std::bad_alloc();
+    FreeNodes();
+    m_nodes = static_cast<SgUctNode*>(ptr);
+    new(m_nodes) SgUctNode(SG_NULLMOVE);
+    m_maxNodes = maxNodes;
     for (size_t i = 0; i < NuAllocators(); ++i)
-        Allocator(i).SetMaxNodes(maxNodesPerAlloc);
+        Allocator(i).SetStorage(m_nodes + 1 + i * maxNodesPerAlloc,
+                                maxNodesPerAlloc);
 }
 
 void SgUctTree::Swap(SgUctTree& tree)
 {
     SG_ASSERT(MaxNodes() == tree.MaxNodes());
     SG_ASSERT(NuAllocators() == tree.NuAllocators());
-    swap(m_root, tree.m_root);
+    swap(m_nodes, tree.m_nodes);
     for (size_t i = 0; i < NuAllocators(); ++i)
         Allocator(i).Swap(tree.Allocator(i));
 }
 
+void SgUctTree::FreeNodes()
+{
+    m_nodes[0].~SgUctNode();
+    std::free(m_nodes);
+    m_nodes = 0;
+}
+
 void SgUctTree::ThrowConsistencyError(const string& message) const
 {
     DumpDebugInfo(SgDebug());
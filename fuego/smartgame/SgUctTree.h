@@ -6,12 +6,18 @@
 #ifndef SG_UCTTREE_H
 #define SG_UCTTREE_H
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <stack>
+#include <utility>
+#include <vector>
+#include <stdint.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
 #include "SgMove.h"
 #include "SgStatistics.h"
-#include "SgStatisticsVlt.h"
+#include "SgStatisticsAtomic.h"
 #include "SgUctValue.h"
 
 class SgTimer;
@@ -20,7 +26,7 @@ class SgTimer;
 
 typedef SgStatisticsBase<float,std::size_t> SgUctStatisticsBase;
 
-typedef SgStatisticsVltBase<float,std::size_t> SgUctStatisticsBaseVolatile;
+typedef SgStatisticsAtomicBase<float,std::size_t> SgUctStatisticsBaseAtomic;
 
 //----------------------------------------------------------------------------
 
@@ -101,12 +107,29 @@ typedef enum
 //----------------------------------------------------------------------------
 
 /** Node used in SgUctTree.
-    All data members are declared as volatile to avoid that the compiler
-    re-orders writes, which can break assumptions made by SgUctSearch in
-    lock-free mode (see @ref sguctsearchlockfree). For example, the search
-    relies on the fact that m_firstChild is valid, if m_nuChildren is greater
-    zero or that the mean value of the move and RAVE value statistics is valid
-    if the corresponding count is greater zero.
+    All data members that are modified during a search are atomic, because
+    SgUctSearch in lock-free mode reads and writes them concurrently without
+    locking (see @ref sguctsearchlockfree). Counts and values are accessed
+    with relaxed memory order, apart from the orderings the search relies on:
+    the children information is published with release order (see
+    SetChildren()) and the mean value of the move and RAVE value statistics
+    is valid if the corresponding count is greater zero (see
+    SgStatisticsAtomicBase).
+
+    If SG_UCT_COMPACT_NODE is defined at compile time, a more compact layout
+    is used, which reduces the size of a node from 72 to 40 bytes on 64-bit
+    systems. This allows trees with more nodes in the same memory and
+    reduces the number of cache lines touched when iterating over the
+    children of a node. In the compact layout,
+    - SgUctValue is @c float (unless SG_UCT_VALUE_TYPE is defined), which
+      limits the counts to 2^24 (see SgUctValue)
+    - the first child is stored as a 32-bit offset relative to the node,
+      together with the number of children in a single 64-bit atomic
+      variable, so the children information is published with a single
+      store; this requires that all nodes of a tree are stored in one array
+      of less than 2^31 nodes (see SgUctTree::SetMaxNodes())
+    - the move and the virtual loss count are stored in 16 bits, the proven
+      type in 8 bits
     @ingroup sguctgroup */
 class SgUctNode
 {
@@ -114,6 +137,15 @@ public:
     /** Initializes node with given move, value and count. */
     SgUctNode(const SgUctMoveInfo& info);
 
+    /** Copy all data including the children information.
+        Not atomic as a whole; only used if no other thread writes to
+        @c node. With SG_UCT_COMPACT_NODE, a node with children can only be
+        copied to a node in the same array of nodes. */
+    SgUctNode(const SgUctNode& node);
+
+    /** See copy constructor. */
+    SgUctNode& operator=(const SgUctNode& node);
+
     /** Add game result.
         @param eval The game result (e.g. score or 0/1 for win loss) */
     void AddGameResult(SgUctValue eval);
@@ -162,11 +194,26 @@ public:
         manages nodes. Use SgUctChildIterator to access children nodes. */
     int NuChildren() const;
 
-    /** See FirstChild() */
-    void SetFirstChild(const SgUctNode* child);
-
-    /** See NuChildren() */
-    void SetNuChildren(int nuChildren);
+    /** Get first child and number of children as a consistent pair.
+        Unlike calling FirstChild() and NuChildren(), this can be used while
+        another thread changes the children with SetChildren(): the number
+        of children returned never exceeds the number of children of the
+        array at the returned pointer.
+        @return The number of children; zero if the node has no children,
+        then @c firstChild is undefined. */
+    int Children(const SgUctNode*& firstChild) const;
+
+    /** Link the node to a new array of children.
+        Used by SgUctTree after the children are fully created and
+        initialized. If the number of children grows, the first child is
+        stored before the number of children, otherwise after it. The first
+        child is always stored with release order, so are the number of
+        children when it grows. Together with the reads in Children(),
+        another thread never sees more children than the array it gets a
+        pointer to contains.
+        @param firstChild The first child; ignored if @c nuChildren is zero
+        @param nuChildren The new number of children */
+    void SetChildren(const SgUctNode* firstChild, int nuChildren);
 
     /** Increment the position count.
         See PosCount() */
@@ -245,39 +292,110 @@ public:
     void SetProvenType(SgUctProvenType type);
 
 private:
-    SgUctStatisticsVolatile m_statistics;
+#ifdef SG_UCT_COMPACT_NODE
+    typedef int16_t MoveStorage;
+
+    typedef int16_t VirtualLossStorage;
+
+    typedef uint8_t ProvenTypeStorage;
+
+    /** Offset of the first child relative to this node in the lower 32 bits
+        and number of children in the upper 32 bits. */
+    std::atomic<uint64_t> m_children;
+#else
+    typedef SgMove MoveStorage;
+
+    typedef int VirtualLossStorage;
+
+    typedef SgUctProvenType ProvenTypeStorage;
 
-    const SgUctNode* volatile m_firstChild;
+    std::atomic<const SgUctNode*> m_firstChild;
 
-    volatile int m_nuChildren;
+    std::atomic<int> m_nuChildren;
+#endif
 
-    volatile SgMove m_move;
+    /** Move of the node.
+        Not atomic, because it is only written before the node is published
+        to other threads by SetChildren() of its parent. */
+    MoveStorage m_move;
+
+    SgUctStatisticsAtomic m_statistics;
 
     /** RAVE statistics.
         Uses double for count to allow adding fractional values if RAVE
         updates are weighted. */
-    SgUctStatisticsVolatile m_raveValue;
+    SgUctStatisticsAtomic m_raveValue;
+
+    std::atomic<SgUctValue> m_posCount;
 
-    volatile SgUctValue m_posCount;
+    std::atomic<SgUctValue> m_knowledgeCount;
 
-    volatile SgUctValue m_knowledgeCount;
+    std::atomic<VirtualLossStorage> m_virtualLossCount;
 
-    volatile SgUctProvenType m_provenType;
+    std::atomic<ProvenTypeStorage> m_provenType;
 
-    volatile int m_virtualLossCount;
+    /** Add count to the position count with a compare-and-swap loop. */
+    void AddPosCount(SgUctValue count);
+
+    /** Subtract count from the position count, if it does not become
+        negative. */
+    void SubtractPosCount(SgUctValue count);
 };
 
+#ifdef SG_UCT_COMPACT_NODE
+BOOST_STATIC_ASSERT(sizeof(SgUctValue) == 4);
+#endif
+
 inline SgUctNode::SgUctNode(const SgUctMoveInfo& info)
-    : m_statistics(info.m_value, info.m_count),
+    :
+#ifdef SG_UCT_COMPACT_NODE
+      m_children(0),
+#else
+      m_firstChild(0),
       m_nuChildren(0),
-      m_move(info.m_move),
+#endif
+      m_move(static_cast<MoveStorage>(info.m_move)),
+      m_statistics(info.m_value, info.m_count),
       m_raveValue(info.m_raveValue, info.m_raveCount),
       m_posCount(0),
       m_knowledgeCount(0),
-      m_provenType(SG_NOT_PROVEN),
-      m_virtualLossCount(0)
+      m_virtualLossCount(0),
+      m_provenType(SG_NOT_PROVEN)
+{
+    SG_ASSERT(m_move == info.m_move); // Fits into MoveStorage
+}
+
+inline SgUctNode::SgUctNode(const SgUctNode& node)
+    :
+#ifdef SG_UCT_COMPACT_NODE
+      m_children(0),
+#else
+      m_firstChild(0),
+      m_nuChildren(0),
+#endif
+      m_move(node.m_move),
+      m_statistics(node.m_statistics),
+      m_raveValue(node.m_raveValue),
+      m_posCount(node.m_posCount.load(std::memory_order_relaxed)),
+      m_knowledgeCount(node.m_knowledgeCount.load(std::memory_order_relaxed)),
+      m_virtualLossCount(
+                    node.m_virtualLossCount.load(std::memory_order_relaxed)),
+      m_provenType(node.m_provenType.load(std::memory_order_relaxed))
 {
-    // m_firstChild is not initialized, only defined if m_nuChildren > 0
+    // The children information is relative to the node in the compact
+    // layout and needs to be converted
+    const SgUctNode* firstChild;
+    int nuChildren = node.Children(firstChild);
+    SetChildren(firstChild, nuChildren);
+}
+
+inline SgUctNode& SgUctNode::operator=(const SgUctNode& node)
+{
+    CopyDataFrom(node);
+    const SgUctNode* firstChild;
+    int nuChildren = node.Children(firstChild);
+    SetChildren(firstChild, nuChildren);
+    return *this;
 }
 
 inline void SgUctNode::AddGameResult(SgUctValue eval)
@@ -328,21 +446,54 @@ inline void SgUctNode::CopyDataFrom(const SgUctNode& node)
     m_statistics = node.m_statistics;
     m_move = node.m_move;
     m_raveValue = node.m_raveValue;
-    m_posCount = node.m_posCount;
-    m_knowledgeCount = node.m_knowledgeCount;
-    m_provenType = node.m_provenType;
-    m_virtualLossCount = node.m_virtualLossCount;
+    m_posCount.store(node.m_posCount.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    m_knowledgeCount.store(
+                node.m_knowledgeCount.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    m_provenType.store(node.m_provenType.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+    m_virtualLossCount.store(
+                node.m_virtualLossCount.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+}
+
+inline int SgUctNode::Children(const SgUctNode*& firstChild) const
+{
+#ifdef SG_UCT_COMPACT_NODE
+    uint64_t children = m_children.load(std::memory_order_acquire);
+    firstChild = this + static_cast<int32_t>(children & 0xffffffffu);
+    return static_cast<int>(children >> 32);
+#else
+    // See SetChildren(). If the children grew, a reader that sees the new
+    // number of children (first read) also sees the new first child. If they
+    // shrank, a reader that sees the new first child also sees the new
+    // number of children (second read). Taking the minimum of both reads
+    // is safe in both cases. The first child is always stored with release
+    // order, so a reader that sees a new first child also sees the
+    // initialized children, even if it read the old number of children.
+    int nuChildren = m_nuChildren.load(std::memory_order_acquire);
+    firstChild = m_firstChild.load(std::memory_order_acquire);
+    int nuChildrenAfter = m_nuChildren.load(std::memory_order_relaxed);
+    return std::min(nuChildren, nuChildrenAfter);
+#endif
 }
 
 inline const SgUctNode* SgUctNode::FirstChild() const
 {
     SG_ASSERT(HasChildren()); // Otherwise m_firstChild is undefined
-    return m_firstChild;
+#ifdef SG_UCT_COMPACT_NODE
+    const SgUctNode* firstChild;
+    Children(firstChild);
+    return firstChild;
+#else
+    return m_firstChild.load(std::memory_order_acquire);
+#endif
 }
 
 inline bool SgUctNode::HasChildren() const
 {
-    return (m_nuChildren > 0);
+    return (NuChildren() > 0);
 }
 
 inline bool SgUctNode::HasMean() const
@@ -357,48 +508,57 @@ inline bool SgUctNode::HasRaveValue() const
 
 inline int SgUctNode::VirtualLossCount() const
 {
-    return m_virtualLossCount;
+    return m_virtualLossCount.load(std::memory_order_relaxed);
 }
 
 inline void SgUctNode::AddVirtualLoss()
 {
-    m_virtualLossCount++;
+    m_virtualLossCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 inline void SgUctNode::RemoveVirtualLoss()
 {
-    // May become negative with lock-free multithreading.  Negative
-    // values are allowed so that errors introduced by multithreading
-    // will tend to average out.
-    m_virtualLossCount--;
+    m_virtualLossCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void SgUctNode::AddPosCount(SgUctValue count)
+{
+    SgUctValue posCount = m_posCount.load(std::memory_order_relaxed);
+    while (! m_posCount.compare_exchange_weak(posCount, posCount + count,
+                                              std::memory_order_relaxed))
+        ;
+}
+
+inline void SgUctNode::SubtractPosCount(SgUctValue count)
+{
+    SgUctValue posCount = m_posCount.load(std::memory_order_relaxed);
+    do
+    {
+        if (posCount < count)
+            return;
+    }
+    while (! m_posCount.compare_exchange_weak(posCount, posCount - count,
+                                              std::memory_order_relaxed));
 }
 
 inline void SgUctNode::IncPosCount()
 {
-    ++m_posCount;
+    AddPosCount(1);
 }
 
 inline void SgUctNode::IncPosCount(SgUctValue count)
 {
-    m_posCount += count;
+    AddPosCount(count);
 }
 
 inline void SgUctNode::DecPosCount()
 {
-    SgUctValue posCount = m_posCount;
-    if (posCount > 0)
-    {
-        m_posCount = posCount - 1;
-    }
+    SubtractPosCount(1);
 }
 
 inline void SgUctNode::DecPosCount(SgUctValue count)
 {
-    SgUctValue posCount = m_posCount;
-    if (posCount >= count)
-    {
-        m_posCount = posCount - count;
-    }
+    SubtractPosCount(count);
 }
 
 inline void SgUctNode::InitializeValue(SgUctValue value, SgUctValue count)
@@ -429,12 +589,16 @@ inline SgUctValue SgUctNode::MoveCount() const
 
 inline int SgUctNode::NuChildren() const
 {
-    return m_nuChildren;
+#ifdef SG_UCT_COMPACT_NODE
+    return static_cast<int>(m_children.load(std::memory_order_acquire) >> 32);
+#else
+    return m_nuChildren.load(std::memory_order_acquire);
+#endif
 }
 
 inline SgUctValue SgUctNode::PosCount() const
 {
-    return m_posCount;
+    return m_posCount.load(std::memory_order_relaxed);
 }
 
 inline SgUctValue SgUctNode::RaveCount() const
@@ -447,62 +611,88 @@ inline SgUctValue SgUctNode::RaveValue() const
     return m_raveValue.Mean();
 }
 
-inline void SgUctNode::SetFirstChild(const SgUctNode* child)
-{
-    m_firstChild = child;
-}
-
-inline void SgUctNode::SetNuChildren(int nuChildren)
+inline void SgUctNode::SetChildren(const SgUctNode* firstChild,
+                                   int nuChildren)
 {
     SG_ASSERT(nuChildren >= 0);
-    m_nuChildren = nuChildren;
+#ifdef SG_UCT_COMPACT_NODE
+    if (nuChildren == 0)
+    {
+        m_children.store(0, std::memory_order_release);
+        return;
+    }
+    std::ptrdiff_t offset = firstChild - this;
+    SG_ASSERT(offset == static_cast<int32_t>(offset));
+    m_children.store(static_cast<uint32_t>(static_cast<int32_t>(offset))
+                     | (static_cast<uint64_t>(nuChildren) << 32),
+                     std::memory_order_release);
+#else
+    if (nuChildren == 0)
+    {
+        m_nuChildren.store(0, std::memory_order_release);
+        return;
+    }
+    if (nuChildren > m_nuChildren.load(std::memory_order_relaxed))
+    {
+        m_firstChild.store(firstChild, std::memory_order_release);
+        m_nuChildren.store(nuChildren, std::memory_order_release);
+    }
+    else
+    {
+        m_nuChildren.store(nuChildren, std::memory_order_relaxed);
+        m_firstChild.store(firstChild, std::memory_order_release);
+    }
+#endif
 }
 
 inline void SgUctNode::SetPosCount(SgUctValue value)
 {
-    m_posCount = value;
+    m_posCount.store(value, std::memory_order_relaxed);
 }
 
 inline SgUctValue SgUctNode::KnowledgeCount() const
 {
-    return m_knowledgeCount;
+    return m_knowledgeCount.load(std::memory_order_relaxed);
 }
 
 inline void SgUctNode::SetKnowledgeCount(SgUctValue count)
 {
-    m_knowledgeCount = count;
+    m_knowledgeCount.store(count, std::memory_order_relaxed);
 }
 
 inline bool SgUctNode::IsProven() const
 {
-    return m_provenType != SG_NOT_PROVEN;
+    return ProvenType() != SG_NOT_PROVEN;
 }
 
 inline bool SgUctNode::IsProvenWin() const
 {
-    return m_provenType == SG_PROVEN_WIN;
+    return ProvenType() == SG_PROVEN_WIN;
 }
 
 inline bool SgUctNode::IsProvenLoss() const
 {
-    return m_provenType == SG_PROVEN_LOSS;
+    return ProvenType() == SG_PROVEN_LOSS;
 }
 
 inline SgUctProvenType SgUctNode::ProvenType() const
 {
-    return m_provenType;
+    return static_cast<SgUctProvenType>(
+                              m_provenType.load(std::memory_order_relaxed));
 }
 
 inline void SgUctNode::SetProvenType(SgUctProvenType type)
 {
-    m_provenType = type;
+    m_provenType.store(static_cast<ProvenTypeStorage>(type),
+                       std::memory_order_relaxed);
 }
 
 //----------------------------------------------------------------------------
 
 /** Allocater for nodes used in the implementation of SgUctTree.
     Each thread has its own node allocator to allow lock-free usage of
-    SgUctTree.
+    SgUctTree. The storage of the allocators of a tree is a part of a single
+    array owned by the tree (see SgUctTree::SetMaxNodes()).
     @ingroup sguctgroup */
 class SgUctAllocator
 {
@@ -520,7 +710,12 @@ public:
 
     std::size_t MaxNodes() const;
 
-    void SetMaxNodes(std::size_t maxNodes);
+    /** Set the storage for the nodes.
+        Clears the allocator. The storage is not owned by the allocator.
+        @param start Start of an array of uninitialized memory for at least
+        @c maxNodes nodes.
+        @param maxNodes The maximum number of nodes */
+    void SetStorage(SgUctNode* start, std::size_t maxNodes);
 
     /** Check if allocator contains node.
         This function uses pointer comparisons. Since the result of
@@ -530,12 +725,20 @@ public:
         for nodes not in the allocator. */
     bool Contains(const SgUctNode& node) const;
 
+    SgUctNode* Start();
+
     const SgUctNode* Start() const;
 
     SgUctNode* Finish();
 
     const SgUctNode* Finish() const;
 
+    /** Remove all nodes starting at a given position.
+        Used by SgUctTree::PruneLowCount() after the remaining nodes were
+        moved to the start of the storage.
+        REQUIRES: Start() <= finish <= Finish() */
+    void Truncate(SgUctNode* finish);
+
     /** Create a new node at the end of the storage.
         REQUIRES: HasCapacity(1)
         @param move The constructor argument.
@@ -637,11 +840,25 @@ inline std::size_t SgUctAllocator::NuNodes() const
     return m_finish - m_start;
 }
 
+inline SgUctNode* SgUctAllocator::Start()
+{
+    return m_start;
+}
+
 inline const SgUctNode* SgUctAllocator::Start() const
 {
     return m_start;
 }
 
+inline void SgUctAllocator::Truncate(SgUctNode* finish)
+{
+    SG_ASSERT(finish >= m_start);
+    SG_ASSERT(finish <= m_finish);
+    for (SgUctNode* it = finish; it != m_finish; ++it)
+        it->~SgUctNode();
+    m_finish = finish;
+}
+
 //----------------------------------------------------------------------------
 
 /** Tree used in SgUctSearch.
@@ -661,6 +878,8 @@ public:
         SetMaxNodes() must be called (in this order). */
     SgUctTree();
 
+    ~SgUctTree();
+
     /** Create node allocators for threads. */
     void CreateAllocators(std::size_t nuThreads);
 
@@ -705,12 +924,15 @@ public:
     std::size_t MaxNodes() const;
 
     /** Change maximum number of nodes.
-        Also clears the tree. This will call SetMaxNodes() at each registered
-        allocator with maxNodes / numberAllocators as an argument. The real
-        maximum number of nodes can be higher (because the root node is
-        owned by this class, not an allocator) or lower (if maxNodes is not
-        a multiple of the number of allocators).
-        @param maxNodes Maximum number of nodes */
+        Also clears the tree. Allocates a single array for the root node and
+        the nodes of all allocators, each registered allocator gets
+        maxNodes / numberAllocators nodes of it. The real maximum number of
+        nodes can be higher (because the root node is owned by this class,
+        not an allocator) or lower (if maxNodes is not a multiple of the
+        number of allocators).
+        @param maxNodes Maximum number of nodes. With SG_UCT_COMPACT_NODE,
+        it must be less than 2^31 (see SgUctNode).
+        @throws SgException if maxNodes is too large */
     void SetMaxNodes(std::size_t maxNodes);
 
     /** Swap content with another tree.
@@ -735,6 +957,14 @@ public:
         The tree will be truncated if one of the allocators overflows (can
         happen due to reassigning nodes to different allocators), the given
         max time is exceeded or on SgUserAbort().
+        If the target tree has more than one allocator and the subtree is
+        large, the subtree is copied in parallel: the top levels of the
+        subtree are copied to the first allocator, until there are enough
+        open subtrees below them; then the open subtrees are distributed to
+        one thread per allocator (balanced by their move counts), and each
+        thread copies its subtrees only to its own allocator. The result
+        contains the same nodes as the sequential copy, but the nodes are
+        assigned to the allocators differently.
         @param[out] target The resulting subtree. Must have the same maximum
         number of nodes. Will be cleared before using.
         @param node The start node of the subtree.
@@ -761,6 +991,19 @@ public:
                    bool warnTruncate,
                    double maxTime = std::numeric_limits<double>::max()) const;
 
+    /** Prune low count nodes in place.
+        Removes the same nodes as CopyPruneLowCount(), but without a second
+        tree: the remaining nodes are moved towards the start of the storage
+        of their allocator, keeping their order, and the links to them are
+        updated. Each node stays in its allocator, and each allocator is
+        truncated to the end of its compacted nodes, so the freed nodes can
+        be allocated again. The only additional memory is a list of the
+        remaining child arrays. Must not be called while other threads use
+        the tree.
+        @param minCount The minimum count (SgUctNode::MoveCount()) of a node
+        to keep its children */
+    void PruneLowCount(SgUctValue minCount);
+
     const SgUctNode& Root() const;
 
     std::size_t NuAllocators() const;
@@ -833,7 +1076,12 @@ public:
 private:
     std::size_t m_maxNodes;
 
-    SgUctNode m_root;
+    /** Array with the root node at index 0, followed by the storage of the
+        allocators.
+        All nodes of the tree are stored in one array, because the compact
+        node layout stores children as offsets between nodes (see
+        SgUctNode). */
+    SgUctNode* m_nodes;
 
     /** Allocators.
         The elements are owned by the vector (shared_ptr is only used because
@@ -849,11 +1097,32 @@ private:
 
     const SgUctAllocator& Allocator(std::size_t i) const;
 
+    SgUctNode& RootNode();
+
+    /** Free the node array.
+        Requires that the allocators are cleared. */
+    void FreeNodes();
+
+    struct ExtractTask;
+
     bool CopySubtree(SgUctTree& target, SgUctNode& targetNode,
                      const SgUctNode& node, SgUctValue minCount,
                      std::size_t& currentAllocatorId, bool warnTruncate,
                      bool& abort, SgTimer& timer, double maxTime,
-                     bool alwaysKeepProven) const;
+                     bool alwaysKeepProven, bool cycleAllocators) const;
+
+    void ExtractSubtreeParallel(SgUctTree& target, const SgUctNode& node,
+                                bool warnTruncate, double maxTime,
+                                SgUctValue minCount) const;
+
+    void ExtractSubtreeThread(SgUctTree& target,
+                              std::vector<ExtractTask>& tasks,
+                              const std::vector<std::size_t>& taskIndices,
+                              std::size_t allocatorId, double maxTime,
+                              SgUctValue minCount, bool& abort) const;
+
+    bool MarkPrunedSubtree(const SgUctNode& node, SgUctValue minCount,
+              std::vector<std::pair<const SgUctNode*,int> >& childArrays);
 
     void ThrowConsistencyError(const std::string& message) const;
 };
@@ -905,13 +1174,8 @@ inline void SgUctTree::CreateChildren(std::size_t allocatorId,
     
     SgUctValue parentCount = allocator.Create(moves);
 
-    // Write order dependency: SgUctSearch in lock-free mode assumes that
-    // m_firstChild is valid if m_nuChildren is greater zero
     nonConstNode.SetPosCount(parentCount);
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetFirstChild(firstChild);
-    SgSynchronizeThreadMemory();
-    nonConstNode.SetNuChildren(nuChildren);
+    nonConstNode.SetChildren(firstChild, nuChildren);
 }
 
 inline void SgUctTree::RemoveGameResult(const SgUctNode& node,
@@ -1019,7 +1283,12 @@ inline std::size_t SgUctTree::NuNodes(std::size_t allocatorId) const
 
 inline const SgUctNode& SgUctTree::Root() const
 {
-    return m_root;
+    return m_nodes[0];
+}
+
+inline SgUctNode& SgUctTree::RootNode()
+{
+    return m_nodes[0];
 }
 
 inline void SgUctTree::SetKnowledgeCount(const SgUctNode& node,
@@ -1081,9 +1350,9 @@ inline SgUctChildIterator::SgUctChildIterator(const SgUctTree& tree,
 {
     SG_DEBUG_ONLY(tree);
     SG_ASSERT(tree.Contains(node));
-    SG_ASSERT(node.HasChildren());
-    m_current = node.FirstChild();
-    m_last = m_current + node.NuChildren();
+    int nuChildren = node.Children(m_current);
+    SG_ASSERT(nuChildren > 0);
+    m_last = m_current + nuChildren;
 }
 
 inline const SgUctNode& SgUctChildIterator::operator*() const
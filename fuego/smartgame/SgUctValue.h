@@ -10,7 +10,7 @@
 #include <limits>
 #include <boost/static_assert.hpp>
 #include "SgStatistics.h"
-#include "SgStatisticsVlt.h"
+#include "SgStatisticsAtomic.h"
 
 //----------------------------------------------------------------------------
 
@@ -22,10 +22,14 @@
     simulations before the count and mean values go into "saturation". This
     maximum is given by 2^d-1 with d being the digits in the mantissa (=23 for
     IEEE 754 float's). The search will terminate when this number is
-    reached. */
+    reached.
+    If SG_UCT_COMPACT_NODE is defined (see SgUctNode), the default type is
+    @c float. */
 
-#ifdef SG_UCT_VALUE_TYPE
+#if defined(SG_UCT_VALUE_TYPE)
 typedef SG_UCT_VALUE_TYPE SgUctValue;
+#elif defined(SG_UCT_COMPACT_NODE)
+typedef float SgUctValue;
 #else
 typedef double SgUctValue;
 #endif
@@ -34,7 +38,7 @@ BOOST_STATIC_ASSERT(! std::numeric_limits<SgUctValue>::is_integer);
 
 typedef SgStatisticsBase<SgUctValue,SgUctValue> SgUctStatistics;
 
-typedef SgStatisticsVltBase<SgUctValue,SgUctValue> SgUctStatisticsVolatile;
+typedef SgStatisticsAtomicBase<SgUctValue,SgUctValue> SgUctStatisticsAtomic;
 
 //----------------------------------------------------------------------------
 